@@ -28,69 +28,708 @@
  */
 
 
-static int matchesPattern(const char *fname, const char *wildcard,
-                          int caseSensitive)
+/*
+ * A pattern is compiled into one GlobSegment per path element. Each segment
+ *  remembers the literal text before its first '*' and after its last '*',
+ *  so most names are rejected by a length check and two short compares. The
+ *  pieces between stars ("runs") are located with memchr() on their first
+ *  literal character instead of walking the name a byte at a time.
+ */
+typedef struct GlobRun
+{
+    const char *str;  /* points into the owning segment's pattern. */
+    size_t len;
+} GlobRun;
+
+typedef struct GlobSegment
+{
+    char *pattern;     /* segment text, lowercased if case-insensitive. */
+    size_t patlen;
+    size_t minlen;     /* count of non-'*' chars; shortest possible match. */
+    size_t prefixlen;  /* chars before the first '*'. */
+    size_t suffixlen;  /* chars after the last '*'. */
+    GlobRun *runs;     /* runs between the first and last '*'. */
+    size_t numruns;
+    int hasStar;
+    int isLiteral;     /* no wildcards at all; can be looked up directly. */
+    int isGlobstar;    /* "**": zero or more directories. */
+} GlobSegment;
+
+struct PHYSFSEXT_Glob
+{
+    GlobSegment *segments;
+    size_t numsegments;
+    int caseSensitive;
+};
+
+
+static int runMatches(const char *pat, const char *str, size_t len)
+{
+    size_t i;
+    for (i = 0; i < len; i++)
+    {
+        if ((pat[i] != '?') && (pat[i] != str[i]))
+            return 0;
+    } /* for */
+    return 1;
+} /* runMatches */
+
+
+/* (name) must already be lowercased if the segment is case-insensitive. */
+static int matchSegment(const GlobSegment *seg, const char *name, size_t len)
+{
+    const char *pat = seg->pattern;
+    const char *end;
+    size_t i;
+
+    if (len < seg->minlen)
+        return 0;
+    else if (!seg->hasStar)
+        return (len == seg->minlen) && runMatches(pat, name, len);
+
+    if (!runMatches(pat, name, seg->prefixlen))
+        return 0;
+
+    end = name + len;
+    if (!runMatches(pat + (seg->patlen - seg->suffixlen),
+                    end - seg->suffixlen, seg->suffixlen))
+        return 0;
+
+    /* Every run is bracketed by stars, so the leftmost fit is always safe. */
+    end -= seg->suffixlen;
+    name += seg->prefixlen;
+    for (i = 0; i < seg->numruns; i++)
+    {
+        const GlobRun *run = &seg->runs[i];
+        const char first = run->str[0];
+
+        while (1)
+        {
+            if ((size_t) (end - name) < run->len)
+                return 0;
+
+            if (first != '?')
+            {
+                const size_t avail = (size_t) (end - name) - run->len + 1;
+                name = (const char *) memchr(name, first, avail);
+                if (name == NULL)
+                    return 0;
+            } /* if */
+
+            if (runMatches(run->str, name, run->len))
+                break;
+            name++;
+        } /* while */
+
+        name += run->len;
+    } /* for */
+
+    return 1;
+} /* matchSegment */
+
+
+static int compileSegment(const PHYSFS_Allocator *a, GlobSegment *seg,
+                          const char *str, size_t len, int caseSensitive)
+{
+    size_t firststar = len;
+    size_t laststar = 0;
+    size_t i;
+
+    memset(seg, '\0', sizeof (*seg));
+    seg->pattern = (char *) a->Malloc(len + 1);
+    if (seg->pattern == NULL)
+        return 0;
+
+    for (i = 0; i < len; i++)
+        seg->pattern[i] = caseSensitive ? str[i] : (char) tolower(str[i]);
+    seg->pattern[len] = '\0';
+    seg->patlen = len;
+
+    if ((len == 2) && (str[0] == '*') && (str[1] == '*'))
+    {
+        seg->isGlobstar = 1;
+        return 1;
+    } /* if */
+
+    seg->isLiteral = 1;
+    for (i = 0; i < len; i++)
+    {
+        if (str[i] == '*')
+        {
+            seg->hasStar = 1;
+            seg->isLiteral = 0;
+            if (firststar == len)
+                firststar = i;
+            laststar = i;
+        } /* if */
+        else
+        {
+            if (str[i] == '?')
+                seg->isLiteral = 0;
+            seg->minlen++;
+        } /* else */
+    } /* for */
+
+    if (!seg->hasStar)
+        return 1;
+
+    seg->prefixlen = firststar;
+    seg->suffixlen = len - (laststar + 1);
+
+    /* upper bound on runs: one per star. */
+    seg->runs = (GlobRun *) a->Malloc(sizeof (GlobRun) * (len + 1));
+    if (seg->runs == NULL)
+        return 0;
+
+    for (i = firststar; i < laststar; )
+    {
+        size_t start;
+        while ((i < laststar) && (seg->pattern[i] == '*'))
+            i++;
+        start = i;
+        while ((i < laststar) && (seg->pattern[i] != '*'))
+            i++;
+        if (i > start)
+        {
+            seg->runs[seg->numruns].str = seg->pattern + start;
+            seg->runs[seg->numruns].len = i - start;
+            seg->numruns++;
+        } /* if */
+    } /* for */
+
+    return 1;
+} /* compileSegment */
+
+
+static void freeSegment(const PHYSFS_Allocator *a, GlobSegment *seg)
 {
-    char x, y;
-    const char *fnameptr = fname;
-    const char *wildptr = wildcard;
+    a->Free(seg->pattern);
+    a->Free(seg->runs);
+} /* freeSegment */
+
+
+void PHYSFSEXT_freeGlob(PHYSFSEXT_Glob *glob)
+{
+    const PHYSFS_Allocator *a = PHYSFS_getAllocator();
+    size_t i;
+
+    if (glob == NULL)
+        return;
+
+    for (i = 0; i < glob->numsegments; i++)
+        freeSegment(a, &glob->segments[i]);
+    a->Free(glob->segments);
+    a->Free(glob);
+} /* PHYSFSEXT_freeGlob */
+
+
+PHYSFSEXT_Glob *PHYSFSEXT_compileGlob(const char *pattern, int caseSensitive)
+{
+    const PHYSFS_Allocator *a = PHYSFS_getAllocator();
+    PHYSFSEXT_Glob *retval;
+    const char *ptr;
+    size_t maxsegs = 1;
+
+    if ((a == NULL) || (pattern == NULL))
+        return NULL;
+
+    for (ptr = pattern; *ptr; ptr++)
+        maxsegs += (*ptr == '/');
 
-    while ((*wildptr) && (*fnameptr))
+    retval = (PHYSFSEXT_Glob *) a->Malloc(sizeof (PHYSFSEXT_Glob));
+    if (retval == NULL)
+        return NULL;
+
+    memset(retval, '\0', sizeof (*retval));
+    retval->caseSensitive = caseSensitive;
+    retval->segments = (GlobSegment *) a->Malloc(sizeof (GlobSegment) * maxsegs);
+    if (retval->segments == NULL)
+    {
+        a->Free(retval);
+        return NULL;
+    } /* if */
+
+    ptr = pattern;
+    while (*ptr)
     {
-        y = *wildptr;
-        if (y == '*')
+        const char *sep = strchr(ptr, '/');
+        const size_t len = sep ? (size_t) (sep - ptr) : strlen(ptr);
+        GlobSegment *seg = &retval->segments[retval->numsegments];
+        const int globstar = ((len == 2) && (ptr[0] == '*') && (ptr[1] == '*'));
+        const GlobSegment *prev = retval->numsegments ? (seg - 1) : NULL;
+
+        /* skip empty elements, and collapse "**" runs so we don't report
+           the same path more than once. */
+        if ((len > 0) && !(globstar && prev && prev->isGlobstar))
         {
-            do
+            if (!compileSegment(a, seg, ptr, len, caseSensitive))
             {
-                wildptr++;  /* skip multiple '*' in a row... */
-            } while (*wildptr == '*');
+                retval->numsegments++;  /* so this one gets freed, too. */
+                PHYSFSEXT_freeGlob(retval);
+                return NULL;
+            } /* if */
+            retval->numsegments++;
+        } /* if */
+
+        ptr += len;
+        if (*ptr == '/')
+            ptr++;
+    } /* while */
+
+    return retval;
+} /* PHYSFSEXT_compileGlob */
+
+
+static int matchFromSegment(const PHYSFSEXT_Glob *glob, size_t idx,
+                            const char *path)
+{
+    for (; idx < glob->numsegments; idx++)
+    {
+        const GlobSegment *seg = &glob->segments[idx];
+        const char *sep = strchr(path, '/');
+        const size_t len = sep ? (size_t) (sep - path) : strlen(path);
 
-            y = (caseSensitive) ? *wildptr : (char) tolower(*wildptr);
+        if (seg->isGlobstar)
+        {
+            if (idx == glob->numsegments - 1)
+                return (*path != '\0');   /* matches anything under here. */
 
             while (1)
             {
-                x = (caseSensitive) ? *fnameptr : (char) tolower(*fnameptr);
-                if ((!x) || (x == y))
-                    break;
-                else
-                    fnameptr++;
+                if (matchFromSegment(glob, idx + 1, path))
+                    return 1;
+                sep = strchr(path, '/');
+                if (sep == NULL)
+                    return 0;
+                path = sep + 1;
             } /* while */
         } /* if */
 
-        else if (y == '?')
+        if ((*path == '\0') || !matchSegment(seg, path, len))
+            return 0;
+
+        path += len;
+        if (*path == '/')
+            path++;
+    } /* for */
+
+    return (*path == '\0');
+} /* matchFromSegment */
+
+
+int PHYSFSEXT_matchGlob(const PHYSFSEXT_Glob *glob, const char *path)
+{
+    const PHYSFS_Allocator *a;
+    char *lowered;
+    size_t len;
+    size_t i;
+    int retval;
+
+    if ((glob == NULL) || (path == NULL))
+        return 0;
+
+    while (*path == '/')
+        path++;
+
+    if (glob->caseSensitive)
+        return matchFromSegment(glob, 0, path);
+
+    a = PHYSFS_getAllocator();
+    len = strlen(path);
+    lowered = (char *) a->Malloc(len + 1);
+    if (lowered == NULL)
+        return 0;
+    for (i = 0; i <= len; i++)
+        lowered[i] = (char) tolower(path[i]);
+    retval = matchFromSegment(glob, 0, lowered);
+    a->Free(lowered);
+    return retval;
+} /* PHYSFSEXT_matchGlob */
+
+
+/*
+ * The tree walker keeps one path buffer for the whole walk, and only ever
+ *  enumerates directories whose next pattern element has a wildcard in it.
+ *  Literal elements are checked with a single PHYSFS_stat(), and we only
+ *  stat() enumerated children that already matched, so whole subtrees that
+ *  can't match are never visited.
+ *
+ * Directories are listed with PHYSFS_enumerateFiles(), which merges what
+ *  every mount has, so a directory that several archives supply is still
+ *  only walked once. A "**" element can reach the same path along more
+ *  than one route, so every reported path also goes through a small hash
+ *  set first.
+ */
+typedef struct GlobWalkData
+{
+    const PHYSFS_Allocator *allocator;
+    const PHYSFSEXT_Glob *glob;
+    PHYSFS_EnumerateCallback callback;
+    void *origData;
+    char *path;
+    size_t pathalloc;
+    char *scratch;   /* lowercased names for case-insensitive matching. */
+    size_t scratchalloc;
+    char **seen;     /* open-addressed set of paths already reported. */
+    size_t seenalloc;  /* always zero or a power of two. */
+    size_t seencount;
+} GlobWalkData;
+
+static PHYSFS_EnumerateCallbackResult globWalk(GlobWalkData *data,
+                                               size_t dirlen, size_t segidx);
+
+static int ensureBuffer(GlobWalkData *data, char **buf, size_t *alloc,
+                        size_t len)
+{
+    if (len > *alloc)
+    {
+        void *ptr = data->allocator->Realloc(*buf, len * 2);
+        if (ptr == NULL)
         {
-            wildptr++;
-            fnameptr++;
-        } /* else if */
+            PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+            return 0;
+        } /* if */
+        *buf = (char *) ptr;
+        *alloc = len * 2;
+    } /* if */
+    return 1;
+} /* ensureBuffer */
 
-        else
+/* appends "/name" (or "name" at the root) to the path, returns new length. */
+static size_t appendPath(GlobWalkData *data, size_t dirlen, const char *name,
+                         size_t namelen)
+{
+    const size_t sep = (dirlen > 0) ? 1 : 0;
+    if (!ensureBuffer(data, &data->path, &data->pathalloc,
+                      dirlen + sep + namelen + 1))
+        return 0;
+    if (sep)
+        data->path[dirlen] = '/';
+    memcpy(data->path + dirlen + sep, name, namelen);
+    data->path[dirlen + sep + namelen] = '\0';
+    return dirlen + sep + namelen;
+} /* appendPath */
+
+static size_t hashPath(const char *str, size_t len)
+{
+    size_t hash = 5381;
+    while (len--)
+        hash = ((hash << 5) + hash) ^ (unsigned char) *(str++);
+    return hash;
+} /* hashPath */
+
+/* returns 1 if (path) was added, 0 if already seen, -1 if out of memory. */
+static int markSeen(GlobWalkData *data, const char *path, size_t len)
+{
+    size_t mask;
+    size_t i;
+    char *str;
+
+    if ((data->seencount + 1) * 2 > data->seenalloc)  /* keep it half full. */
+    {
+        const size_t newalloc = data->seenalloc ? data->seenalloc * 2 : 64;
+        char **newseen = (char **) data->allocator->Malloc(sizeof (char *) * newalloc);
+        if (newseen == NULL)
+            return -1;
+        memset(newseen, '\0', sizeof (char *) * newalloc);
+        for (i = 0; i < data->seenalloc; i++)
         {
-            if (caseSensitive)
-                x = *fnameptr;
-            else
+            char *old = data->seen[i];
+            if (old != NULL)
             {
-                x = tolower(*fnameptr);
-                y = tolower(y);
+                size_t j = hashPath(old, strlen(old)) & (newalloc - 1);
+                while (newseen[j] != NULL)
+                    j = (j + 1) & (newalloc - 1);
+                newseen[j] = old;
             } /* if */
+        } /* for */
+        data->allocator->Free(data->seen);
+        data->seen = newseen;
+        data->seenalloc = newalloc;
+    } /* if */
 
-            wildptr++;
-            fnameptr++;
+    mask = data->seenalloc - 1;
+    for (i = hashPath(path, len) & mask; data->seen[i] != NULL; i = (i + 1) & mask)
+    {
+        if (strcmp(data->seen[i], path) == 0)
+            return 0;
+    } /* for */
 
-            if (x != y)
-                return 0;
-        } /* else */
-    } /* while */
+    str = (char *) data->allocator->Malloc(len + 1);
+    if (str == NULL)
+        return -1;
+    memcpy(str, path, len + 1);
+    data->seen[i] = str;
+    data->seencount++;
+    return 1;
+} /* markSeen */
+
+static PHYSFS_EnumerateCallbackResult reportMatch(GlobWalkData *data,
+                                                  size_t dirlen,
+                                                  size_t pathlen)
+{
+    PHYSFS_EnumerateCallbackResult rc;
+    const int added = markSeen(data, data->path, pathlen);
+
+    if (added < 0)
+    {
+        PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+        return PHYSFS_ENUM_ERROR;
+    } /* if */
+    else if (added == 0)
+        return PHYSFS_ENUM_OK;  /* got here along another "**" route. */
+
+    if (dirlen == 0)
+        rc = data->callback(data->origData, "/", data->path);
+    else
+    {
+        data->path[dirlen] = '\0';  /* split into dir and name in place. */
+        rc = data->callback(data->origData, data->path, data->path + dirlen + 1);
+        data->path[dirlen] = '/';
+    } /* else */
+    data->path[pathlen] = '\0';
+    if (rc == PHYSFS_ENUM_ERROR)
+        PHYSFS_setErrorCode(PHYSFS_ERR_APP_CALLBACK);
+    return rc;
+} /* reportMatch */
+
+static int isDirectory(const char *path)
+{
+    PHYSFS_Stat statbuf;
+    return (PHYSFS_stat(path, &statbuf) &&
+            (statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY));
+} /* isDirectory */
+
+/* Matches one enumerated (fname) in the directory at (dirlen). */
+static PHYSFS_EnumerateCallbackResult globWalkChild(GlobWalkData *data,
+                                                    size_t dirlen,
+                                                    size_t segidx,
+                                                    const char *fname)
+{
+    const GlobSegment *seg = &data->glob->segments[segidx];
+    const int last = (segidx == data->glob->numsegments - 1);
+    const size_t namelen = strlen(fname);
+    PHYSFS_EnumerateCallbackResult rc = PHYSFS_ENUM_OK;
+    const char *name = fname;
+    size_t pathlen;
+
+    if (!seg->isGlobstar && !data->glob->caseSensitive)
+    {
+        size_t i;
+        if (!ensureBuffer(data, &data->scratch, &data->scratchalloc, namelen+1))
+            return PHYSFS_ENUM_ERROR;
+        for (i = 0; i < namelen; i++)
+            data->scratch[i] = (char) tolower(fname[i]);
+        name = data->scratch;
+    } /* if */
+
+    if (!seg->isGlobstar && !matchSegment(seg, name, namelen))
+        return PHYSFS_ENUM_OK;  /* pruned. */
+
+    pathlen = appendPath(data, dirlen, fname, namelen);
+    if (pathlen == 0)
+        return PHYSFS_ENUM_ERROR;
+
+    if (seg->isGlobstar)
+    {
+        const int isdir = isDirectory(data->path);
+        if (last)  /* trailing "**" matches everything below. */
+            rc = reportMatch(data, dirlen, pathlen);
+        if ((rc == PHYSFS_ENUM_OK) && isdir)
+            rc = globWalk(data, pathlen, segidx);
+    } /* if */
+    else if (last)
+        rc = reportMatch(data, dirlen, pathlen);
+    else if (isDirectory(data->path))
+        rc = globWalk(data, pathlen, segidx + 1);
+
+    data->path[dirlen] = '\0';
+    return rc;
+} /* globWalkChild */
+
+static PHYSFS_EnumerateCallbackResult globWalk(GlobWalkData *data,
+                                               size_t dirlen, size_t segidx)
+{
+    const GlobSegment *seg;
+    PHYSFS_EnumerateCallbackResult rc;
+    char **list;
+    char **i;
+
+    if (segidx >= data->glob->numsegments)
+        return PHYSFS_ENUM_OK;
+
+    seg = &data->glob->segments[segidx];
+
+    /* no wildcards? Don't enumerate, just see if it's there. */
+    if (seg->isLiteral && data->glob->caseSensitive)
+    {
+        const int last = (segidx == data->glob->numsegments - 1);
+        PHYSFS_Stat statbuf;
+        size_t pathlen = appendPath(data, dirlen, seg->pattern, seg->patlen);
+        rc = PHYSFS_ENUM_OK;
+        if (pathlen == 0)
+            rc = PHYSFS_ENUM_ERROR;
+        else if (!PHYSFS_stat(data->path, &statbuf))
+            rc = PHYSFS_ENUM_OK;  /* nothing down this way. */
+        else if (last)
+            rc = reportMatch(data, dirlen, pathlen);
+        else if (statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY)
+            rc = globWalk(data, pathlen, segidx + 1);
+        data->path[dirlen] = '\0';
+        return rc;
+    } /* if */
+
+    /* "**" can match zero directories, so try the rest of the pattern here. */
+    if (seg->isGlobstar && (segidx < data->glob->numsegments - 1))
+    {
+        rc = globWalk(data, dirlen, segidx + 1);
+        if (rc != PHYSFS_ENUM_OK)
+            return rc;
+    } /* if */
+
+    list = PHYSFS_enumerateFiles((dirlen > 0) ? data->path : "/");
+    if (list == NULL)
+        return PHYSFS_ENUM_ERROR;
+
+    rc = PHYSFS_ENUM_OK;
+    for (i = list; (*i != NULL) && (rc == PHYSFS_ENUM_OK); i++)
+        rc = globWalkChild(data, dirlen, segidx, *i);
+
+    PHYSFS_freeList(list);
+    return rc;
+} /* globWalk */
+
+
+int PHYSFSEXT_enumerateGlob(const PHYSFSEXT_Glob *glob,
+                            PHYSFS_EnumerateCallback c, void *d)
+{
+    GlobWalkData data;
+    PHYSFS_EnumerateCallbackResult rc;
+    size_t i;
+
+    if ((glob == NULL) || (c == NULL))
+    {
+        PHYSFS_setErrorCode(PHYSFS_ERR_INVALID_ARGUMENT);
+        return 0;
+    } /* if */
+
+    memset(&data, '\0', sizeof (data));
+    data.allocator = PHYSFS_getAllocator();
+    if (data.allocator == NULL)
+        return 0;
+
+    data.glob = glob;
+    data.callback = c;
+    data.origData = d;
+
+    if (!ensureBuffer(&data, &data.path, &data.pathalloc, 256))
+        return 0;
+    data.path[0] = '\0';
 
-    while (*wildptr == '*')
-        wildptr++;
+    rc = globWalk(&data, 0, 0);
 
-    return (*fnameptr == *wildptr);
+    for (i = 0; i < data.seenalloc; i++)
+    {
+        if (data.seen[i] != NULL)
+            data.allocator->Free(data.seen[i]);
+    } /* for */
+    data.allocator->Free(data.seen);
+    data.allocator->Free(data.path);
+    data.allocator->Free(data.scratch);
+    return (rc == PHYSFS_ENUM_ERROR) ? 0 : 1;
+} /* PHYSFSEXT_enumerateGlob */
+
+
+typedef struct GlobListData
+{
+    const PHYSFS_Allocator *allocator;
+    char **list;
+    size_t size;
+    size_t alloc;
+} GlobListData;
+
+static PHYSFS_EnumerateCallbackResult globListCallback(void *_data,
+                                                       const char *origdir,
+                                                       const char *fname)
+{
+    GlobListData *data = (GlobListData *) _data;
+    const int root = (strcmp(origdir, "/") == 0);
+    const size_t len = (root ? 0 : strlen(origdir) + 1) + strlen(fname) + 1;
+    char *str;
+
+    if (data->size + 1 >= data->alloc)
+    {
+        const size_t newalloc = data->alloc ? data->alloc * 2 : 64;
+        void *ptr = data->allocator->Realloc(data->list,
+                                             sizeof (char *) * newalloc);
+        if (ptr == NULL)
+            return PHYSFS_ENUM_ERROR;
+        data->list = (char **) ptr;
+        data->alloc = newalloc;
+    } /* if */
+
+    str = (char *) data->allocator->Malloc(len);
+    if (str == NULL)
+        return PHYSFS_ENUM_ERROR;
+
+    if (root)
+        strcpy(str, fname);
+    else
+        sprintf(str, "%s/%s", origdir, fname);
+    data->list[data->size++] = str;
+    return PHYSFS_ENUM_OK;
+} /* globListCallback */
+
+
+char **PHYSFSEXT_enumerateFilesGlob(const char *pattern, int caseSensitive)
+{
+    PHYSFSEXT_Glob *glob = PHYSFSEXT_compileGlob(pattern, caseSensitive);
+    GlobListData data;
+
+    if (glob == NULL)
+        return NULL;
+
+    memset(&data, '\0', sizeof (data));
+    data.allocator = PHYSFS_getAllocator();
+    data.list = (char **) data.allocator->Malloc(sizeof (char *) * 64);
+    data.alloc = (data.list != NULL) ? 64 : 0;
+
+    if ((data.list == NULL) || !PHYSFSEXT_enumerateGlob(glob, globListCallback, &data))
+    {
+        if (data.list != NULL)
+        {
+            data.list[data.size] = NULL;
+            PHYSFSEXT_freeEnumeration(data.list);
+        } /* if */
+        PHYSFSEXT_freeGlob(glob);
+        return NULL;
+    } /* if */
+
+    PHYSFSEXT_freeGlob(glob);
+    data.list[data.size] = NULL;
+    return data.list;
+} /* PHYSFSEXT_enumerateFilesGlob */
+
+
+/* The single-directory wildcard API is just one compiled segment. */
+static int matchesPattern(const GlobSegment *seg, const char *fname,
+                          int caseSensitive, char *scratch)
+{
+    const size_t len = strlen(fname);
+    if (!caseSensitive)
+    {
+        size_t i;
+        for (i = 0; i < len; i++)
+            scratch[i] = (char) tolower(fname[i]);
+        fname = scratch;
+    } /* if */
+    return matchSegment(seg, fname, len);
 } /* matchesPattern */
 
 typedef struct
 {
     const PHYSFS_Allocator *allocator;
-    const char *wildcard;
+    GlobSegment segment;
     int caseSensitive;
     PHYSFS_EnumFilesCallback callback;
     void *origData;
@@ -104,8 +743,20 @@ typedef struct
 static void wildcardCallback(void *_d, const char *origdir, const char *fname)
 {
     const WildcardCallbackData *data = (const WildcardCallbackData *) _d;
-    if (matchesPattern(fname, data->wildcard, data->caseSensitive))
+    char *scratch = NULL;
+
+    if (!data->caseSensitive)
+    {
+        scratch = (char *) data->allocator->Malloc(strlen(fname) + 1);
+        if (scratch == NULL)
+            return;
+    } /* if */
+
+    if (matchesPattern(&data->segment, fname, data->caseSensitive, scratch))
         data->callback(data->origData, origdir, fname);
+
+    if (scratch != NULL)
+        data->allocator->Free(scratch);
 } /* wildcardCallback */
 
 
@@ -117,11 +768,15 @@ void PHYSFSEXT_enumerateFilesCallbackWildcard(const char *dir,
 {
     WildcardCallbackData data;
     data.allocator = PHYSFS_getAllocator();
-    data.wildcard = wildcard;
     data.caseSensitive = caseSensitive;
     data.callback = c;
     data.origData = d;
-    PHYSFS_enumerateFilesCallback(dir, wildcardCallback, &data);
+    if (compileSegment(data.allocator, &data.segment, wildcard,
+                       strlen(wildcard), caseSensitive))
+    {
+        PHYSFS_enumerateFilesCallback(dir, wildcardCallback, &data);
+    } /* if */
+    freeSegment(data.allocator, &data.segment);
 } /* PHYSFSEXT_enumerateFilesCallbackWildcard */
 
 
@@ -144,18 +799,43 @@ char **PHYSFSEXT_enumerateFilesWildcard(const char *dir, const char *wildcard,
     const PHYSFS_Allocator *allocator = PHYSFS_getAllocator();
     char **list = PHYSFS_enumerateFiles(dir);
     char **retval = NULL;
+    char *scratch = NULL;
+    size_t longest = 0;
     int totalmatches = 0;
     int matches = 0;
+    GlobSegment segment;
     char **i;
 
+    if (list == NULL)
+        return NULL;
+
+    if (!compileSegment(allocator, &segment, wildcard, strlen(wildcard),
+                        caseSensitive))
+    {
+        freeSegment(allocator, &segment);
+        PHYSFS_freeList(list);
+        return NULL;
+    } /* if */
+
+    for (i = list; *i != NULL; i++)
+    {
+        const size_t len = strlen(*i);
+        if (len > longest)
+            longest = len;
+    } /* for */
+
+    scratch = (char *) allocator->Malloc(longest + 1);
+    if (scratch == NULL)
+        goto wildcard_done;
+
     for (i = list; *i != NULL; i++)
     {
         #if 0
         printf("matchesPattern: '%s' vs '%s' (%s) ... %s\n", *i, wildcard,
                caseSensitive ? "case" : "nocase",
-               matchesPattern(*i, wildcard, caseSensitive) ? "true" : "false");
+               matchesPattern(&segment, *i, caseSensitive, scratch) ? "true" : "false");
         #endif
-        if (matchesPattern(*i, wildcard, caseSensitive))
+        if (matchesPattern(&segment, *i, caseSensitive, scratch))
             totalmatches++;
     } /* for */
 
@@ -164,7 +844,7 @@ char **PHYSFSEXT_enumerateFilesWildcard(const char *dir, const char *wildcard,
     {
         for (i = list; ((matches < totalmatches) && (*i != NULL)); i++)
         {
-            if (matchesPattern(*i, wildcard, caseSensitive))
+            if (matchesPattern(&segment, *i, caseSensitive, scratch))
             {
                 retval[matches] = (char *) allocator->Malloc(strlen(*i) + 1);
                 if (retval[matches] == NULL)
@@ -187,6 +867,9 @@ char **PHYSFSEXT_enumerateFilesWildcard(const char *dir, const char *wildcard,
         } /* if */
     } /* if */
 
+wildcard_done:
+    allocator->Free(scratch);
+    freeSegment(allocator, &segment);
     PHYSFS_freeList(list);
     return retval;
 } /* PHYSFSEXT_enumerateFilesWildcard */
@@ -202,7 +885,10 @@ int main(int argc, char **argv)
     if (argc != 3)
     {
         printf("USAGE: %s <pattern> <caseSen>\n"
-               "   where <caseSen> is 1 or 0.\n", argv[0]);
+               "   where <caseSen> is 1 or 0.\n"
+               "   Patterns with a '/' in them are matched recursively,\n"
+               "   and can use '**' to match any number of directories.\n",
+               argv[0]);
         return 1;
     } /* if */
 
@@ -219,7 +905,18 @@ int main(int argc, char **argv)
         return 1;
     } /* if */
 
-    flist = PHYSFSEXT_enumerateFilesWildcard("/", argv[1], atoi(argv[2]));
+    if (strchr(argv[1], '/') != NULL)
+        flist = PHYSFSEXT_enumerateFilesGlob(argv[1], atoi(argv[2]));
+    else
+        flist = PHYSFSEXT_enumerateFilesWildcard("/", argv[1], atoi(argv[2]));
+
+    if (flist == NULL)
+    {
+        fprintf(stderr, "enumeration failed: %s\n", PHYSFS_getErrorByCode(PHYSFS_getLastErrorCode()));
+        PHYSFS_deinit();
+        return 1;
+    } /* if */
+
     rc = 0;
     for (i = flist; *i; i++)
     {
@@ -236,4 +933,3 @@ int main(int argc, char **argv)
 #endif
 
 /* end of globbing.c ... */
-
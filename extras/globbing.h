@@ -19,6 +19,12 @@
  *  wildcard pattern. You must call PHYSFSEXT_freeEnumeration() on the results,
  *  just PHYSFS_enumerateFiles() would do with PHYSFS_freeList().
  *
+ * For patterns that span directories, use PHYSFSEXT_enumerateFilesGlob(),
+ *  or compile the pattern once with PHYSFSEXT_compileGlob() and reuse it
+ *  with PHYSFSEXT_enumerateGlob() and PHYSFSEXT_matchGlob(). These walk the
+ *  search path, and only descend into directories that could possibly
+ *  contain a match.
+ *
  * License: this code is public domain. I make no warranty that it is useful,
  *  correct, harmless, or environmentally safe.
  *
@@ -155,6 +161,117 @@ PHYSFS_DECL void PHYSFSEXT_enumerateFilesCallbackWildcard(const char *dir,
                                               PHYSFS_EnumFilesCallback c,
                                               void *d);
 
+
+/**
+ * \typedef PHYSFSEXT_Glob
+ * \brief A compiled glob pattern.
+ *
+ * This is opaque; create one with PHYSFSEXT_compileGlob() and release it
+ *  with PHYSFSEXT_freeGlob().
+ *
+ * \sa PHYSFSEXT_compileGlob
+ */
+typedef struct PHYSFSEXT_Glob PHYSFSEXT_Glob;
+
+
+/**
+ * \fn PHYSFSEXT_Glob *PHYSFSEXT_compileGlob(const char *pattern, int caseSensitive)
+ * \brief Compile a glob pattern for repeated use.
+ *
+ * The pattern is in platform-independent notation and is split on '/' into
+ *  path elements. Each element can use '*' (any run of characters) and
+ *  '?' (any single character), which never match across a '/'. An element
+ *  that is exactly "**" matches zero or more whole directories: with one
+ *  between a "textures" element and a "*_n.ktx2" element, the pattern
+ *  finds normal maps at any depth under "textures".
+ *
+ * Compiling precomputes everything about the pattern that doesn't depend
+ *  on the name being tested, so matching a name is usually a length check
+ *  and a couple of short compares. Elements without any wildcards are
+ *  looked up directly instead of enumerating their parent directory.
+ *
+ *    \param pattern The glob pattern to compile.
+ *    \param caseSensitive Zero for case-insensitive matching,
+ *                         non-zero for case-sensitive.
+ *   \return A compiled pattern, or NULL on error (probably out of memory).
+ *
+ * \sa PHYSFSEXT_freeGlob
+ * \sa PHYSFSEXT_matchGlob
+ * \sa PHYSFSEXT_enumerateGlob
+ */
+PHYSFS_DECL PHYSFSEXT_Glob *PHYSFSEXT_compileGlob(const char *pattern,
+                                                 int caseSensitive);
+
+/**
+ * \fn void PHYSFSEXT_freeGlob(PHYSFSEXT_Glob *glob)
+ * \brief Free a compiled glob pattern.
+ *
+ * As this uses PhysicsFS's allocator, you must free it before calling
+ *  PHYSFS_deinit().
+ *
+ *    \param glob Pattern from PHYSFSEXT_compileGlob(). NULL is ignored.
+ */
+PHYSFS_DECL void PHYSFSEXT_freeGlob(PHYSFSEXT_Glob *glob);
+
+/**
+ * \fn int PHYSFSEXT_matchGlob(const PHYSFSEXT_Glob *glob, const char *path)
+ * \brief Test a path against a compiled glob pattern.
+ *
+ * This doesn't touch the search path at all; it's just string matching.
+ *
+ *    \param glob Pattern from PHYSFSEXT_compileGlob().
+ *    \param path Path in platform-independent notation.
+ *   \return Non-zero if (path) matches, zero otherwise.
+ */
+PHYSFS_DECL int PHYSFSEXT_matchGlob(const PHYSFSEXT_Glob *glob,
+                                    const char *path);
+
+/**
+ * \fn int PHYSFSEXT_enumerateGlob(const PHYSFSEXT_Glob *glob, PHYSFS_EnumerateCallback c, void *d)
+ * \brief Find every path in the search path that matches a glob pattern.
+ *
+ * This walks the interpolated directory tree from the root, but only
+ *  enumerates directories that the next element of the pattern could match
+ *  inside, and only stats entries that already matched, so unrelated
+ *  subtrees are never visited.
+ *
+ * The callback gets the directory each match lives in and the match's name
+ *  within it, just like PHYSFS_enumerate(). Like PHYSFS_enumerateFiles(),
+ *  each path is reported once, even if several archives in the search path
+ *  supply it. Returning PHYSFS_ENUM_STOP from the callback ends the whole
+ *  walk.
+ *
+ *    \param glob Pattern from PHYSFSEXT_compileGlob().
+ *    \param c Callback function to notify about matches.
+ *    \param d Application-defined data passed to callback. Can be NULL.
+ *   \return non-zero on success, zero on failure.
+ *
+ * \sa PHYSFS_enumerate
+ */
+PHYSFS_DECL int PHYSFSEXT_enumerateGlob(const PHYSFSEXT_Glob *glob,
+                                        PHYSFS_EnumerateCallback c, void *d);
+
+/**
+ * \fn char **PHYSFSEXT_enumerateFilesGlob(const char *pattern, int caseSensitive)
+ * \brief Get a list of every path in the search path that matches a glob.
+ *
+ * This is a convenience wrapper over PHYSFSEXT_compileGlob() and
+ *  PHYSFSEXT_enumerateGlob(). Each string is a full path in
+ *  platform-independent notation, like "textures/rock/cliff_n.ktx2".
+ *  Each path is listed once, and no ordering is promised.
+ *
+ * Free the results with PHYSFSEXT_freeEnumeration().
+ *
+ *    \param pattern The glob pattern to use; see PHYSFSEXT_compileGlob().
+ *    \param caseSensitive Zero for case-insensitive matching,
+ *                         non-zero for case-sensitive.
+ *   \return Null-terminated array of null-terminated strings, or NULL.
+ *
+ * \sa PHYSFSEXT_freeEnumeration
+ */
+PHYSFS_DECL char **PHYSFSEXT_enumerateFilesGlob(const char *pattern,
+                                               int caseSensitive);
+
 #ifdef __cplusplus
 }
 #endif
@@ -79,6 +79,37 @@ typedef struct
     "Content-Type: %s\n" \
     "\n"
 
+#define txt200len \
+    "HTTP/1.0 200 OK\n" \
+    "Connection: close\n" \
+    "Content-Type: %s\n" \
+    "Content-Length: %llu\n" \
+    "\n"
+
+#define txt206 \
+    "HTTP/1.0 206 Partial Content\n" \
+    "Connection: close\n" \
+    "Content-Type: %s\n" \
+    "Content-Length: %llu\n" \
+    "Content-Range: bytes %llu-%llu/%llu\n" \
+    "\n"
+
+#define txt416 \
+    "HTTP/1.0 416 Range Not Satisfiable\n" \
+    "Connection: close\n" \
+    "Content-Range: bytes */%llu\n" \
+    "\n"
+
+/* a "Range: bytes=..." header: first-last, first-, or -suffixlength. */
+typedef struct
+{
+    int present;
+    int has_first;
+    int has_last;
+    unsigned long long first;
+    unsigned long long last;
+} http_range;
+
 static const char *lastError(void)
 {
     return PHYSFS_getErrorByCode(PHYSFS_getLastErrorCode());
@@ -114,9 +145,49 @@ static int writeString(const char *ipstr, const int sock, const char *fmt, ...)
 } /* writeString */
 
 
-static void feed_file_http(const char *ipstr, int sock, const char *fname)
+static void parse_range(const char *request, http_range *range)
+{
+    const char *ptr = strstr(request, "\nRange: bytes=");
+    char *endp;
+
+    memset(range, '\0', sizeof (*range));
+    if (ptr == NULL)
+        return;
+
+    ptr += strlen("\nRange: bytes=");
+    if ((*ptr >= '0') && (*ptr <= '9'))
+    {
+        range->first = strtoull(ptr, &endp, 10);
+        range->has_first = 1;
+        ptr = endp;
+    } /* if */
+
+    if (*ptr != '-')
+        return;  /* bogus (or multiple ranges); just send everything. */
+
+    ptr++;
+    if ((*ptr >= '0') && (*ptr <= '9'))
+    {
+        range->last = strtoull(ptr, &endp, 10);
+        range->has_last = 1;
+        ptr = endp;
+    } /* if */
+
+    if ((*ptr == '\r') || (*ptr == '\n') || (*ptr == '\0'))
+        range->present = (range->has_first || range->has_last);
+} /* parse_range */
+
+
+static void feed_file_http(const char *ipstr, int sock, const char *fname,
+                           const http_range *range)
 {
+    /* !!! FIXME: mimetype */
+    const char *mimetype = "text/plain; charset=utf-8";
     PHYSFS_File *in = PHYSFS_openRead(fname);
+    PHYSFS_sint64 len;
+    unsigned long long first = 0;
+    unsigned long long remaining;
+    int rc;
 
     if (in == NULL)
     {
@@ -125,25 +196,54 @@ static void feed_file_http(const char *ipstr, int sock, const char *fname)
         return;
     } /* if */
 
-    /* !!! FIXME: mimetype */
-    if (writeString(ipstr, sock, txt200, "text/plain; charset=utf-8"))
+    len = PHYSFS_fileLength(in);
+    if (len < 0)
+        rc = writeString(ipstr, sock, txt200, mimetype);
+    else if (!range->present)
+        rc = writeString(ipstr, sock, txt200len, mimetype, (unsigned long long) len);
+    else
     {
-        do
+        const unsigned long long total = (unsigned long long) len;
+        unsigned long long last = total - 1;
+
+        if (!range->has_first)  /* suffix: the last N bytes. */
+            first = (range->last >= total) ? 0 : total - range->last;
+        else
         {
-            char buffer[1024];
-            PHYSFS_sint64 br = PHYSFS_readBytes(in, buffer, sizeof (buffer));
-            if (br == -1)
-            {
-                printf("%s: Read error: %s.\n", ipstr, lastError());
-                break;
-            } /* if */
-
-            else if (!writeAll(ipstr, sock, buffer, (size_t) br))
-            {
-                break;
-            } /* else if */
-        } while (!PHYSFS_eof(in));
-    } /* if */
+            first = range->first;
+            if (range->has_last && (range->last < last))
+                last = range->last;
+        } /* else */
+
+        if ((total == 0) || (first > last) ||
+            (range->has_first && range->has_last && (range->first > range->last)))
+        {
+            writeString(ipstr, sock, txt416, total);
+            PHYSFS_close(in);
+            return;
+        } /* if */
+
+        printf("%s: range %llu-%llu of %llu.\n", ipstr, first, last, total);
+        rc = writeString(ipstr, sock, txt206, mimetype, (last - first) + 1,
+                         first, last, total) && PHYSFS_seek(in, first);
+        len = (PHYSFS_sint64) ((last - first) + 1);
+    } /* else */
+
+    remaining = (len < 0) ? ~0ULL : (unsigned long long) len;
+    while (rc && (remaining > 0) && !PHYSFS_eof(in))
+    {
+        char buffer[1024];
+        const size_t want = (remaining < sizeof (buffer)) ? (size_t) remaining : sizeof (buffer);
+        PHYSFS_sint64 br = PHYSFS_readBytes(in, buffer, want);
+        if (br == -1)
+        {
+            printf("%s: Read error: %s.\n", ipstr, lastError());
+            break;
+        } /* if */
+
+        rc = writeAll(ipstr, sock, buffer, (size_t) br);
+        remaining -= (unsigned long long) br;
+    } /* while */
 
     PHYSFS_close(in);
 } /* feed_file_http */
@@ -192,7 +292,8 @@ static void feed_dir_http(const char *ipstr, int sock, const char *dname)
     PHYSFS_freeList(list);
 } /* feed_dir_http */
 
-static void feed_http_request(const char *ipstr, int sock, const char *fname)
+static void feed_http_request(const char *ipstr, int sock, const char *fname,
+                              const http_range *range)
 {
     PHYSFS_Stat statbuf;
 
@@ -208,7 +309,7 @@ static void feed_http_request(const char *ipstr, int sock, const char *fname)
     if (statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY)
         feed_dir_http(ipstr, sock, fname);
     else
-        feed_file_http(ipstr, sock, fname);
+        feed_file_http(ipstr, sock, fname, range);
 } /* feed_http_request */
 
 
@@ -217,14 +318,16 @@ static void *do_http(void *_args)
     http_args *args = (http_args *) _args;
     char ipstr[128];
     char buffer[512];
+    http_range range;
     char *ptr;
     strncpy(ipstr, inet_ntoa(((struct sockaddr_in *) args->addr)->sin_addr),
             sizeof (ipstr));
     ipstr[sizeof (ipstr) - 1] = '\0';
 
     printf("%s: connected.\n", ipstr);
-    read(args->sock, buffer, sizeof (buffer));
-    buffer[sizeof (buffer) - 1] = '\0';
+    memset(buffer, '\0', sizeof (buffer));
+    read(args->sock, buffer, sizeof (buffer) - 1);
+    parse_range(buffer, &range);
     ptr = strchr(buffer, '\n');
     if (!ptr)
         printf("%s: potentially bogus request.\n", ipstr);
@@ -244,7 +347,7 @@ static void *do_http(void *_args)
             ptr = strchr(buffer + 5, ' ');
             if (ptr != NULL)
                 *ptr = '\0';
-            feed_http_request(ipstr, args->sock, buffer + 4);
+            feed_http_request(ipstr, args->sock, buffer + 4, &range);
         } /* if */
     } /* else */
 
@@ -0,0 +1,1330 @@
+/*
+ * This code provides a PHYSFS_Io that reads a file from an HTTP server with
+ *  Range requests, so you can mount a remote archive without downloading
+ *  all of it first.
+ *
+ * Please see physfshttpio.h for details.
+ *
+ * License: this code is public domain. There is no warranty that it is
+ *  useful, correct, harmless, or environmentally safe.
+ *
+ * This particular file may be used however you like, including copying it
+ *  verbatim into a closed-source project, exploiting it commercially, and
+ *  removing any trace of its authors from the source. Enhancements and
+ *  corrections are welcome, but you don't have to send patches if you make
+ *  changes. This code has NO WARRANTY.
+ *
+ * Unless otherwise stated, the rest of PhysicsFS falls under the zlib license.
+ *  Please see LICENSE.txt in the root of the source tree.
+ *
+ *  This file was written by the PhysicsFS contributors.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET HTTPSocket;
+#define HTTP_NO_SOCKET INVALID_SOCKET
+#else
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+typedef int HTTPSocket;
+#define HTTP_NO_SOCKET (-1)
+#define closesocket close
+#endif
+
+#include "physfshttpio.h"
+
+#define HTTP_DEFAULT_BLOCKSIZE (64 * 1024)
+#define HTTP_DEFAULT_CACHESIZE (8 * 1024 * 1024)
+#define HTTP_MIN_BLOCKS 4
+#define HTTP_MAX_PREFETCH 32     /* blocks. */
+#define HTTP_TIMEOUT_SECS 30
+#define HTTP_RECVBUF_SIZE 8192
+#define HTTP_LINE_SIZE 1024
+
+typedef struct HTTPBlock
+{
+    PHYSFS_uint64 index;
+    PHYSFS_uint32 len;          /* only less than blocksize for the last one. */
+    struct HTTPBlock *hashnext;
+    struct HTTPBlock *prev;     /* LRU list; (mru) is the head. */
+    struct HTTPBlock *next;
+    PHYSFS_uint8 *data;         /* points just past this struct. */
+} HTTPBlock;
+
+/* state shared by an Io and all its duplicates. */
+typedef struct
+{
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+    int refcount;
+    char *host;
+    char *port;
+    char *path;
+    char *cachedir;
+    char cachekey[17];
+    char validator[128];        /* ETag or Last-Modified, if the server sent one. */
+    HTTPSocket sock;
+    size_t recvpos;
+    size_t recvlen;
+    char recvbuf[HTTP_RECVBUF_SIZE];
+    PHYSFS_uint64 length;
+    PHYSFS_uint32 blocksize;
+    PHYSFS_uint32 maxblocks;
+    PHYSFS_uint32 numblocks;
+    PHYSFS_uint32 hashsize;
+    HTTPBlock **hash;
+    HTTPBlock *mru;
+    HTTPBlock *lru;
+} HTTPShared;
+
+typedef struct
+{
+    HTTPShared *shared;
+    PHYSFS_uint64 pos;
+    PHYSFS_uint64 lastend;      /* where the previous read stopped. */
+    PHYSFS_uint32 window;       /* current prefetch, in blocks. */
+} HTTPIoInfo;
+
+typedef struct
+{
+    int status;
+    int keepalive;
+    int chunked;
+    int have_length;
+    PHYSFS_uint64 content_length;
+    int have_range;
+    PHYSFS_uint64 range_start;
+    PHYSFS_uint64 range_end;
+    PHYSFS_uint64 range_total;
+    char validator[128];
+} HTTPResponse;
+
+
+static void httpLock(HTTPShared *s)
+{
+#ifdef _WIN32
+    EnterCriticalSection(&s->mutex);
+#else
+    pthread_mutex_lock(&s->mutex);
+#endif
+} /* httpLock */
+
+static void httpUnlock(HTTPShared *s)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&s->mutex);
+#else
+    pthread_mutex_unlock(&s->mutex);
+#endif
+} /* httpUnlock */
+
+
+static char *httpStrdup(const char *str, size_t len)
+{
+    char *retval = (char *) PHYSFS_getAllocator()->Malloc(len + 1);
+    if (retval == NULL)
+        PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+    else
+    {
+        memcpy(retval, str, len);
+        retval[len] = '\0';
+    } /* else */
+    return retval;
+} /* httpStrdup */
+
+
+static int httpHeaderIs(const char *line, const char *name, const char **val)
+{
+    const size_t len = strlen(name);
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        char ch = line[i];
+        if ((ch >= 'A') && (ch <= 'Z'))
+            ch += 'a' - 'A';
+        if (ch != name[i])  /* (name) is always lowercase. */
+            return 0;
+    } /* for */
+
+    if (line[len] != ':')
+        return 0;
+
+    line += len + 1;
+    while ((*line == ' ') || (*line == '\t'))
+        line++;
+    *val = line;
+    return 1;
+} /* httpHeaderIs */
+
+
+static int httpParseUInt64(const char **_str, PHYSFS_uint64 *val)
+{
+    const char *str = *_str;
+    PHYSFS_uint64 retval = 0;
+
+    if ((*str < '0') || (*str > '9'))
+        return 0;
+
+    while ((*str >= '0') && (*str <= '9'))
+    {
+        const PHYSFS_uint64 digit = (PHYSFS_uint64) (*str - '0');
+        if (retval > ((~((PHYSFS_uint64) 0)) - digit) / 10)
+            return 0;  /* overflow. */
+        retval = (retval * 10) + digit;
+        str++;
+    } /* while */
+
+    *_str = str;
+    *val = retval;
+    return 1;
+} /* httpParseUInt64 */
+
+
+/* "bytes 0-499/1234" */
+static int httpParseContentRange(const char *val, HTTPResponse *resp)
+{
+    if (strncmp(val, "bytes ", 6) != 0)
+        return 0;
+
+    val += 6;
+    if (!httpParseUInt64(&val, &resp->range_start) || (*(val++) != '-'))
+        return 0;
+    else if (!httpParseUInt64(&val, &resp->range_end) || (*(val++) != '/'))
+        return 0;
+    else if (!httpParseUInt64(&val, &resp->range_total))
+        return 0;
+
+    return ((resp->range_start <= resp->range_end) &&
+            (resp->range_end < resp->range_total));
+} /* httpParseContentRange */
+
+
+/* Blocks on disk are named for the URL and the file's length and validator,
+   so a changed file on the server doesn't get mixed with stale blocks. */
+static void httpMakeCacheKey(HTTPShared *s, const char *url)
+{
+    PHYSFS_uint64 hash = 0xCBF29CE484222325ULL;  /* FNV-1a */
+    char lenstr[32];
+    const char *strs[3];
+    size_t i;
+
+    snprintf(lenstr, sizeof (lenstr), "%llu", (unsigned long long) s->length);
+    strs[0] = url;
+    strs[1] = lenstr;
+    strs[2] = s->validator;
+    for (i = 0; i < 3; i++)
+    {
+        const char *ptr;
+        for (ptr = strs[i]; *ptr; ptr++)
+        {
+            hash ^= (PHYSFS_uint8) *ptr;
+            hash *= 0x100000001B3ULL;
+        } /* for */
+        hash ^= '\n';
+        hash *= 0x100000001B3ULL;
+    } /* for */
+
+    snprintf(s->cachekey, sizeof (s->cachekey), "%08x%08x",
+             (unsigned int) (hash >> 32), (unsigned int) (hash & 0xFFFFFFFF));
+} /* httpMakeCacheKey */
+
+
+static void httpDisconnect(HTTPShared *s)
+{
+    if (s->sock != HTTP_NO_SOCKET)
+    {
+        closesocket(s->sock);
+        s->sock = HTTP_NO_SOCKET;
+    } /* if */
+    s->recvpos = s->recvlen = 0;
+} /* httpDisconnect */
+
+
+static int httpConnect(HTTPShared *s)
+{
+    struct addrinfo hints;
+    struct addrinfo *addrs = NULL;
+    struct addrinfo *ai;
+
+    if (s->sock != HTTP_NO_SOCKET)
+        return 1;  /* still have a keep-alive connection. */
+
+    memset(&hints, '\0', sizeof (hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(s->host, s->port, &hints, &addrs) != 0)
+    {
+        PHYSFS_setErrorCode(PHYSFS_ERR_NOT_FOUND);
+        return 0;
+    } /* if */
+
+    for (ai = addrs; ai != NULL; ai = ai->ai_next)
+    {
+        const int one = 1;
+#ifdef _WIN32
+        const DWORD timeout = HTTP_TIMEOUT_SECS * 1000;
+#else
+        struct timeval timeout;
+        timeout.tv_sec = HTTP_TIMEOUT_SECS;
+        timeout.tv_usec = 0;
+#endif
+
+        s->sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (s->sock == HTTP_NO_SOCKET)
+            continue;
+
+        setsockopt(s->sock, SOL_SOCKET, SO_RCVTIMEO,
+                   (const char *) &timeout, sizeof (timeout));
+        setsockopt(s->sock, SOL_SOCKET, SO_SNDTIMEO,
+                   (const char *) &timeout, sizeof (timeout));
+        setsockopt(s->sock, IPPROTO_TCP, TCP_NODELAY,
+                   (const char *) &one, sizeof (one));
+
+        if (connect(s->sock, ai->ai_addr, (int) ai->ai_addrlen) == 0)
+            break;
+
+        httpDisconnect(s);
+    } /* for */
+
+    freeaddrinfo(addrs);
+
+    if (s->sock == HTTP_NO_SOCKET)
+    {
+        PHYSFS_setErrorCode(PHYSFS_ERR_IO);
+        return 0;
+    } /* if */
+
+    s->recvpos = s->recvlen = 0;
+    return 1;
+} /* httpConnect */
+
+
+static int httpSendAll(HTTPShared *s, const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        const int rc = (int) send(s->sock, buf, (int) len, 0);
+        if (rc <= 0)
+            return 0;
+        buf += rc;
+        len -= (size_t) rc;
+    } /* while */
+    return 1;
+} /* httpSendAll */
+
+
+/* refill the receive buffer. Returns bytes now available, zero at EOF/error. */
+static size_t httpFill(HTTPShared *s)
+{
+    if (s->recvpos == s->recvlen)
+    {
+        const int rc = (int) recv(s->sock, s->recvbuf, sizeof (s->recvbuf), 0);
+        s->recvpos = 0;
+        s->recvlen = (rc > 0) ? (size_t) rc : 0;
+    } /* if */
+    return s->recvlen - s->recvpos;
+} /* httpFill */
+
+
+static int httpRecvAll(HTTPShared *s, void *_buf, size_t len)
+{
+    PHYSFS_uint8 *buf = (PHYSFS_uint8 *) _buf;
+
+    /* whatever's already buffered... */
+    if (s->recvpos < s->recvlen)
+    {
+        size_t cpy = s->recvlen - s->recvpos;
+        if (cpy > len)
+            cpy = len;
+        memcpy(buf, s->recvbuf + s->recvpos, cpy);
+        s->recvpos += cpy;
+        buf += cpy;
+        len -= cpy;
+    } /* if */
+
+    /* ...then straight from the socket into the block. */
+    while (len > 0)
+    {
+        const int rc = (int) recv(s->sock, (char *) buf, (int) len, 0);
+        if (rc <= 0)
+            return 0;
+        buf += rc;
+        len -= (size_t) rc;
+    } /* while */
+
+    return 1;
+} /* httpRecvAll */
+
+
+/* Returns the line length, or -1 at EOF/error before the end of the line. */
+static int httpRecvLine(HTTPShared *s, char *line, size_t linesize)
+{
+    size_t len = 0;
+
+    while (1)
+    {
+        char ch;
+        if (httpFill(s) == 0)
+            return -1;
+
+        ch = s->recvbuf[s->recvpos++];
+        if (ch == '\n')
+            break;
+        else if ((ch != '\r') && (len < linesize - 1))
+            line[len++] = ch;  /* overlong lines are truncated. */
+    } /* while */
+
+    line[len] = '\0';
+    return (int) len;
+} /* httpRecvLine */
+
+
+/* Returns -1 if the connection died before we saw a status line (a stale
+   keep-alive connection, probably, so try again), 0 on error, 1 if okay. */
+static int httpRecvHeaders(HTTPShared *s, HTTPResponse *resp)
+{
+    char line[HTTP_LINE_SIZE];
+    const char *val;
+    int minor = 0;
+
+    memset(resp, '\0', sizeof (*resp));
+
+    if (httpRecvLine(s, line, sizeof (line)) < 0)
+        return -1;
+
+    if ((strncmp(line, "HTTP/1.", 7) != 0) || (line[7] < '0') ||
+        (line[7] > '9') || (line[8] != ' ') || (line[9] < '1') ||
+        (line[9] > '5'))
+    {
+        PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+        return 0;
+    } /* if */
+
+    minor = line[7] - '0';
+    resp->status = atoi(line + 9);
+    resp->keepalive = (minor >= 1);
+
+    while (1)
+    {
+        const int len = httpRecvLine(s, line, sizeof (line));
+        if (len < 0)
+        {
+            PHYSFS_setErrorCode(PHYSFS_ERR_IO);
+            return 0;
+        } /* if */
+
+        else if (len == 0)
+            break;  /* end of headers. */
+
+        else if (httpHeaderIs(line, "connection", &val))
+        {
+            if (strstr(val, "close") || strstr(val, "Close"))
+                resp->keepalive = 0;
+            else if (strstr(val, "keep-alive") || strstr(val, "Keep-Alive"))
+                resp->keepalive = 1;
+        } /* else if */
+
+        else if (httpHeaderIs(line, "content-length", &val))
+            resp->have_length = httpParseUInt64(&val, &resp->content_length);
+
+        else if (httpHeaderIs(line, "content-range", &val))
+            resp->have_range = httpParseContentRange(val, resp);
+
+        else if (httpHeaderIs(line, "transfer-encoding", &val))
+            resp->chunked = (strstr(val, "chunked") != NULL);
+
+        else if (httpHeaderIs(line, "etag", &val))
+            snprintf(resp->validator, sizeof (resp->validator), "%s", val);
+
+        else if (httpHeaderIs(line, "last-modified", &val))
+        {
+            if (resp->validator[0] == '\0')  /* ETag wins. */
+                snprintf(resp->validator, sizeof (resp->validator), "%s", val);
+        } /* else if */
+    } /* while */
+
+    return 1;
+} /* httpRecvHeaders */
+
+
+/* Send a GET for (range), like "bytes=0-65535", and read the headers.
+   A keep-alive connection might have been closed by the server since we
+   last used it, so if it dies before answering, reconnect and try again. */
+static int httpRequest(HTTPShared *s, const char *range, HTTPResponse *resp)
+{
+    char req[HTTP_LINE_SIZE * 2];
+    int tries;
+    int len;
+
+    len = snprintf(req, sizeof (req),
+                   "GET %s HTTP/1.1\r\n"
+                   "Host: %s\r\n"
+                   "Range: %s\r\n"
+                   "Connection: keep-alive\r\n"
+                   "User-Agent: physfshttpio\r\n"
+                   "\r\n", s->path, s->host, range);
+    if ((len < 0) || (len >= (int) sizeof (req)))
+    {
+        PHYSFS_setErrorCode(PHYSFS_ERR_INVALID_ARGUMENT);
+        return 0;
+    } /* if */
+
+    for (tries = 0; tries < 2; tries++)
+    {
+        const int reused = (s->sock != HTTP_NO_SOCKET);
+        int rc;
+
+        if (!httpConnect(s))
+            return 0;
+
+        rc = httpSendAll(s, req, (size_t) len) ? httpRecvHeaders(s, resp) : -1;
+        if (rc > 0)
+        {
+            if (resp->chunked)
+            {
+                httpDisconnect(s);
+                PHYSFS_setErrorCode(PHYSFS_ERR_UNSUPPORTED);
+                return 0;
+            } /* if */
+
+            else if ((resp->status == 206) && resp->have_range)
+                return 1;
+
+            else if (resp->status == 200)
+            {
+                resp->keepalive = 0;  /* we won't read the whole body. */
+                return 1;
+            } /* else if */
+
+            httpDisconnect(s);
+            PHYSFS_setErrorCode((resp->status == 404) ? PHYSFS_ERR_NOT_FOUND :
+                                (resp->status == 403) ? PHYSFS_ERR_PERMISSION :
+                                PHYSFS_ERR_IO);
+            return 0;
+        } /* if */
+
+        httpDisconnect(s);
+        if ((rc == 0) || !reused)
+        {
+            if (rc != 0)
+                PHYSFS_setErrorCode(PHYSFS_ERR_IO);
+            return 0;
+        } /* if */
+    } /* for */
+
+    PHYSFS_setErrorCode(PHYSFS_ERR_IO);
+    return 0;
+} /* httpRequest */
+
+
+static int httpSkip(HTTPShared *s, PHYSFS_uint64 len)
+{
+    while (len > 0)
+    {
+        size_t avail = httpFill(s);
+        if (avail == 0)
+            return 0;
+        else if (avail > len)
+            avail = (size_t) len;
+        s->recvpos += avail;
+        len -= avail;
+    } /* while */
+    return 1;
+} /* httpSkip */
+
+
+static HTTPBlock *httpFindBlock(HTTPShared *s, const PHYSFS_uint64 index)
+{
+    HTTPBlock *block;
+    for (block = s->hash[index % s->hashsize]; block; block = block->hashnext)
+    {
+        if (block->index == index)
+            return block;
+    } /* for */
+    return NULL;
+} /* httpFindBlock */
+
+
+static void httpUnlinkLRU(HTTPShared *s, HTTPBlock *block)
+{
+    if (block->prev)
+        block->prev->next = block->next;
+    else
+        s->mru = block->next;
+
+    if (block->next)
+        block->next->prev = block->prev;
+    else
+        s->lru = block->prev;
+
+    block->prev = block->next = NULL;
+} /* httpUnlinkLRU */
+
+
+static void httpTouchBlock(HTTPShared *s, HTTPBlock *block)
+{
+    if (s->mru != block)
+    {
+        httpUnlinkLRU(s, block);
+        block->next = s->mru;
+        if (s->mru)
+            s->mru->prev = block;
+        s->mru = block;
+        if (s->lru == NULL)
+            s->lru = block;
+    } /* if */
+} /* httpTouchBlock */
+
+
+/* Get an unused block: a new one, or the least recently used, evicted. */
+static HTTPBlock *httpAllocBlock(HTTPShared *s)
+{
+    HTTPBlock *block;
+
+    if (s->numblocks < s->maxblocks)
+    {
+        block = (HTTPBlock *) PHYSFS_getAllocator()->Malloc(sizeof (HTTPBlock) + s->blocksize);
+        if (block == NULL)
+        {
+            if (s->lru == NULL)
+            {
+                PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+                return NULL;
+            } /* if */
+        } /* if */
+
+        else
+        {
+            memset(block, '\0', sizeof (*block));
+            block->data = (PHYSFS_uint8 *) (block + 1);
+            s->numblocks++;
+            return block;
+        } /* else */
+    } /* if */
+
+    /* evict. */
+    block = s->lru;
+    httpUnlinkLRU(s, block);
+    {
+        HTTPBlock **prev = &s->hash[block->index % s->hashsize];
+        while (*prev != block)
+            prev = &(*prev)->hashnext;
+        *prev = block->hashnext;
+    }
+    block->hashnext = NULL;
+    return block;
+} /* httpAllocBlock */
+
+
+static void httpFreeBlock(HTTPShared *s, HTTPBlock *block)
+{
+    PHYSFS_getAllocator()->Free(block);
+    s->numblocks--;
+} /* httpFreeBlock */
+
+
+static void httpInsertBlock(HTTPShared *s, HTTPBlock *block)
+{
+    HTTPBlock **bucket = &s->hash[block->index % s->hashsize];
+    block->hashnext = *bucket;
+    *bucket = block;
+    block->prev = NULL;
+    block->next = s->mru;
+    if (s->mru)
+        s->mru->prev = block;
+    s->mru = block;
+    if (s->lru == NULL)
+        s->lru = block;
+} /* httpInsertBlock */
+
+
+static PHYSFS_uint32 httpBlockLen(const HTTPShared *s, const PHYSFS_uint64 index)
+{
+    const PHYSFS_uint64 start = index * s->blocksize;
+    const PHYSFS_uint64 avail = s->length - start;
+    return (avail < s->blocksize) ? (PHYSFS_uint32) avail : s->blocksize;
+} /* httpBlockLen */
+
+
+static int httpBlockPath(const HTTPShared *s, const PHYSFS_uint64 index,
+                         const char *ext, char *buf, const size_t buflen)
+{
+    const int rc = snprintf(buf, buflen, "%s/%s-%llx.%s", s->cachedir,
+                            s->cachekey, (unsigned long long) index, ext);
+    return ((rc > 0) && (rc < (int) buflen));
+} /* httpBlockPath */
+
+
+static void httpDiskStore(const HTTPShared *s, const HTTPBlock *block)
+{
+    char path[1024];
+    char tmppath[1024];
+    FILE *io;
+
+    if (s->cachedir == NULL)
+        return;
+    else if (!httpBlockPath(s, block->index, "blk", path, sizeof (path)))
+        return;
+    else if (!httpBlockPath(s, block->index, "tmp", tmppath, sizeof (tmppath)))
+        return;
+
+    /* write aside and rename, so nobody ever sees half a block. */
+    io = fopen(tmppath, "wb");
+    if (io == NULL)
+        return;
+    else if (fwrite(block->data, block->len, 1, io) != 1)
+    {
+        fclose(io);
+        remove(tmppath);
+        return;
+    } /* else if */
+
+    fclose(io);
+#ifdef _WIN32
+    remove(path);
+#endif
+    if (rename(tmppath, path) != 0)
+        remove(tmppath);
+} /* httpDiskStore */
+
+
+static HTTPBlock *httpDiskLoad(HTTPShared *s, const PHYSFS_uint64 index)
+{
+    const PHYSFS_uint32 len = httpBlockLen(s, index);
+    HTTPBlock *block;
+    char path[1024];
+    FILE *io;
+    int ok;
+
+    if (s->cachedir == NULL)
+        return NULL;
+    else if (!httpBlockPath(s, index, "blk", path, sizeof (path)))
+        return NULL;
+    else if ((io = fopen(path, "rb")) == NULL)
+        return NULL;
+    else if ((block = httpAllocBlock(s)) == NULL)
+    {
+        fclose(io);
+        return NULL;
+    } /* else if */
+
+    /* must be exactly the right size; anything else is a damaged block. */
+    ok = (fread(block->data, len, 1, io) == 1) && (fgetc(io) == EOF);
+    fclose(io);
+
+    if (!ok)
+    {
+        httpFreeBlock(s, block);
+        remove(path);
+        return NULL;
+    } /* if */
+
+    block->index = index;
+    block->len = len;
+    httpInsertBlock(s, block);
+    return block;
+} /* httpDiskLoad */
+
+
+static int httpSameFile(HTTPShared *s, const HTTPResponse *resp)
+{
+    const PHYSFS_uint64 total = resp->have_range ? resp->range_total :
+                                resp->content_length;
+    if ((resp->status == 200) && !resp->have_length)
+        return 1;  /* can't tell. */
+    else if (total != s->length)
+        return 0;
+    else if (resp->validator[0] && s->validator[0])
+        return (strcmp(resp->validator, s->validator) == 0);
+    return 1;
+} /* httpSameFile */
+
+
+/* Fetch (count) blocks starting at (first) with a single request. */
+static int httpFetchBlocks(HTTPShared *s, const PHYSFS_uint64 first,
+                           const PHYSFS_uint32 count)
+{
+    const PHYSFS_uint64 start = first * s->blocksize;
+    PHYSFS_uint64 end = start + ((PHYSFS_uint64) count * s->blocksize);
+    PHYSFS_uint64 index;
+    HTTPResponse resp;
+    char range[64];
+
+    if (end > s->length)
+        end = s->length;
+
+    snprintf(range, sizeof (range), "bytes=%llu-%llu",
+             (unsigned long long) start, (unsigned long long) (end - 1));
+
+    if (!httpRequest(s, range, &resp))
+        return 0;
+
+    if (!httpSameFile(s, &resp))
+    {
+        httpDisconnect(s);
+        PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+        return 0;
+    } /* if */
+
+    if (resp.status == 200)  /* server ignored the Range. Skip to our part. */
+    {
+        if (!httpSkip(s, start))
+        {
+            httpDisconnect(s);
+            PHYSFS_setErrorCode(PHYSFS_ERR_IO);
+            return 0;
+        } /* if */
+    } /* if */
+
+    else
+    {
+        /* it's allowed to send less than we asked for, but not elsewhere. */
+        if (resp.range_start != start)
+        {
+            httpDisconnect(s);
+            PHYSFS_setErrorCode(PHYSFS_ERR_IO);
+            return 0;
+        } /* if */
+        else if (resp.range_end + 1 < end)
+            end = resp.range_end + 1;
+    } /* else */
+
+    for (index = first; (index * s->blocksize) < end; index++)
+    {
+        const PHYSFS_uint32 len = httpBlockLen(s, index);
+        HTTPBlock *block;
+
+        if ((index * s->blocksize) + len > end)
+        {
+            if (!httpSkip(s, end - (index * s->blocksize)))
+                httpDisconnect(s);
+            break;  /* short response; leave the partial block for later. */
+        } /* if */
+
+        block = httpAllocBlock(s);
+        if (block == NULL)
+        {
+            httpDisconnect(s);
+            return 0;
+        } /* if */
+
+        else if (!httpRecvAll(s, block->data, len))
+        {
+            httpFreeBlock(s, block);
+            httpDisconnect(s);
+            PHYSFS_setErrorCode(PHYSFS_ERR_IO);
+            return 0;
+        } /* else if */
+
+        block->index = index;
+        block->len = len;
+
+        /* a block might already be here if the last response was short. */
+        if (httpFindBlock(s, index) != NULL)
+            httpFreeBlock(s, block);
+        else
+        {
+            httpInsertBlock(s, block);
+            httpDiskStore(s, block);
+        } /* else */
+    } /* for */
+
+    if (!resp.keepalive)
+        httpDisconnect(s);
+
+    return 1;
+} /* httpFetchBlocks */
+
+
+/* Find a block in memory or on disk, or download it, along with every
+   other missing block up to (last) and (prefetch) more past that. */
+static HTTPBlock *httpGetBlock(HTTPShared *s, const PHYSFS_uint64 index,
+                               const PHYSFS_uint64 last,
+                               const PHYSFS_uint32 prefetch)
+{
+    const PHYSFS_uint64 numblocks = (s->length + s->blocksize - 1) / s->blocksize;
+    const PHYSFS_uint32 maxrun = s->maxblocks / 2;
+    PHYSFS_uint64 end = index + 1;
+    HTTPBlock *block;
+    int tries;
+
+    block = httpFindBlock(s, index);
+    if (block != NULL)
+    {
+        httpTouchBlock(s, block);
+        return block;
+    } /* if */
+
+    block = httpDiskLoad(s, index);
+    if (block != NULL)
+        return block;
+
+    /* grow the request over neighbours we don't have either. Don't fetch
+       more than half the cache at once, so a request doesn't evict itself. */
+    while ((end < numblocks) && (end <= last + prefetch) &&
+           ((end - index) < maxrun) && (httpFindBlock(s, end) == NULL))
+    {
+        if ((end <= last) && (httpDiskLoad(s, end) != NULL))
+            break;
+        end++;
+    } /* while */
+
+    for (tries = 0; tries < 2; tries++)
+    {
+        if (!httpFetchBlocks(s, index, (PHYSFS_uint32) (end - index)))
+            return NULL;
+
+        block = httpFindBlock(s, index);
+        if (block != NULL)
+            return block;
+        end = index + 1;  /* short response? Ask for just this one. */
+    } /* for */
+
+    PHYSFS_setErrorCode(PHYSFS_ERR_IO);
+    return NULL;
+} /* httpGetBlock */
+
+
+static PHYSFS_sint64 httpIo_read(PHYSFS_Io *io, void *_buf, PHYSFS_uint64 len)
+{
+    HTTPIoInfo *info = (HTTPIoInfo *) io->opaque;
+    HTTPShared *s = info->shared;
+    PHYSFS_uint8 *buf = (PHYSFS_uint8 *) _buf;
+    PHYSFS_sint64 retval = 0;
+    PHYSFS_uint32 maxprefetch;
+    PHYSFS_uint64 last;
+
+    if (info->pos >= s->length)
+        return 0;
+    else if (len > s->length - info->pos)
+        len = s->length - info->pos;
+    if (len == 0)
+        return 0;
+
+    /* reading straight through? Fetch ahead, more the longer it goes on. */
+    maxprefetch = s->maxblocks / 4;
+    if (maxprefetch > HTTP_MAX_PREFETCH)
+        maxprefetch = HTTP_MAX_PREFETCH;
+
+    if (info->pos != info->lastend)
+        info->window = 0;
+    else if (info->window == 0)
+        info->window = 1;
+    else if (info->window < maxprefetch)
+        info->window *= 2;
+
+    if (info->window > maxprefetch)
+        info->window = maxprefetch;
+
+    last = (info->pos + len - 1) / s->blocksize;
+
+    httpLock(s);
+    while (len > 0)
+    {
+        const PHYSFS_uint64 index = info->pos / s->blocksize;
+        const PHYSFS_uint32 offset = (PHYSFS_uint32) (info->pos % s->blocksize);
+        HTTPBlock *block = httpGetBlock(s, index, last, info->window);
+        PHYSFS_uint32 cpy;
+
+        if (block == NULL)
+        {
+            if (retval == 0)
+                retval = -1;
+            break;
+        } /* if */
+
+        cpy = block->len - offset;
+        if (cpy > len)
+            cpy = (PHYSFS_uint32) len;
+        memcpy(buf, block->data + offset, cpy);
+        buf += cpy;
+        len -= cpy;
+        retval += cpy;
+        info->pos += cpy;
+    } /* while */
+    httpUnlock(s);
+
+    info->lastend = info->pos;
+    return retval;
+} /* httpIo_read */
+
+
+static PHYSFS_sint64 httpIo_write(PHYSFS_Io *io, const void *b, PHYSFS_uint64 l)
+{
+    PHYSFS_setErrorCode(PHYSFS_ERR_READ_ONLY);
+    return -1;
+} /* httpIo_write */
+
+
+static int httpIo_seek(PHYSFS_Io *io, PHYSFS_uint64 offset)
+{
+    HTTPIoInfo *info = (HTTPIoInfo *) io->opaque;
+    if (offset > info->shared->length)
+    {
+        PHYSFS_setErrorCode(PHYSFS_ERR_PAST_EOF);
+        return 0;
+    } /* if */
+
+    info->pos = offset;
+    return 1;
+} /* httpIo_seek */
+
+
+static PHYSFS_sint64 httpIo_tell(PHYSFS_Io *io)
+{
+    return (PHYSFS_sint64) ((HTTPIoInfo *) io->opaque)->pos;
+} /* httpIo_tell */
+
+
+static PHYSFS_sint64 httpIo_length(PHYSFS_Io *io)
+{
+    return (PHYSFS_sint64) ((HTTPIoInfo *) io->opaque)->shared->length;
+} /* httpIo_length */
+
+
+static int httpIo_flush(PHYSFS_Io *io)
+{
+    return 1;  /* nothing to do. */
+} /* httpIo_flush */
+
+
+static void httpFreeShared(HTTPShared *s)
+{
+    const PHYSFS_Allocator *a = PHYSFS_getAllocator();
+
+    httpDisconnect(s);
+
+    while (s->mru != NULL)
+    {
+        HTTPBlock *block = s->mru;
+        s->mru = block->next;
+        a->Free(block);
+    } /* while */
+
+#ifdef _WIN32
+    DeleteCriticalSection(&s->mutex);
+#else
+    pthread_mutex_destroy(&s->mutex);
+#endif
+
+    a->Free(s->hash);
+    a->Free(s->host);
+    a->Free(s->port);
+    a->Free(s->path);
+    a->Free(s->cachedir);
+    a->Free(s);
+} /* httpFreeShared */
+
+
+static void httpIo_destroy(PHYSFS_Io *io)
+{
+    HTTPIoInfo *info = (HTTPIoInfo *) io->opaque;
+    HTTPShared *s = info->shared;
+    int refcount;
+
+    httpLock(s);
+    refcount = --s->refcount;
+    httpUnlock(s);
+
+    if (refcount == 0)
+        httpFreeShared(s);
+
+    PHYSFS_getAllocator()->Free(info);
+    PHYSFS_getAllocator()->Free(io);
+} /* httpIo_destroy */
+
+
+static PHYSFS_Io *httpIo_duplicate(PHYSFS_Io *io);
+
+static PHYSFS_Io *httpMakeIo(HTTPShared *s)
+{
+    const PHYSFS_Allocator *a = PHYSFS_getAllocator();
+    PHYSFS_Io *retval = (PHYSFS_Io *) a->Malloc(sizeof (PHYSFS_Io));
+    HTTPIoInfo *info = (HTTPIoInfo *) a->Malloc(sizeof (HTTPIoInfo));
+
+    if ((retval == NULL) || (info == NULL))
+    {
+        if (retval)
+            a->Free(retval);
+        if (info)
+            a->Free(info);
+        PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+        return NULL;
+    } /* if */
+
+    memset(info, '\0', sizeof (*info));
+    info->shared = s;
+    info->lastend = ~((PHYSFS_uint64) 0);
+
+    memset(retval, '\0', sizeof (*retval));
+    retval->version = 0;
+    retval->opaque = info;
+    retval->read = httpIo_read;
+    retval->write = httpIo_write;
+    retval->seek = httpIo_seek;
+    retval->tell = httpIo_tell;
+    retval->length = httpIo_length;
+    retval->duplicate = httpIo_duplicate;
+    retval->flush = httpIo_flush;
+    retval->destroy = httpIo_destroy;
+    return retval;
+} /* httpMakeIo */
+
+
+static PHYSFS_Io *httpIo_duplicate(PHYSFS_Io *io)
+{
+    HTTPShared *s = ((HTTPIoInfo *) io->opaque)->shared;
+    PHYSFS_Io *retval = httpMakeIo(s);
+    if (retval != NULL)
+    {
+        httpLock(s);
+        s->refcount++;
+        httpUnlock(s);
+    } /* if */
+    return retval;
+} /* httpIo_duplicate */
+
+
+static int httpParseUrl(HTTPShared *s, const char *url)
+{
+    const char *host;
+    const char *hostend;
+    const char *path;
+
+    if (strncmp(url, "http://", 7) != 0)
+    {
+        PHYSFS_setErrorCode(PHYSFS_ERR_UNSUPPORTED);
+        return 0;
+    } /* if */
+
+    host = url + 7;
+    path = strchr(host, '/');
+    if (path == NULL)
+        path = host + strlen(host);
+
+    hostend = path;
+    if (*host == '[')  /* IPv6 literal. */
+    {
+        const char *bracket = memchr(host, ']', (size_t) (path - host));
+        if (bracket == NULL)
+        {
+            PHYSFS_setErrorCode(PHYSFS_ERR_INVALID_ARGUMENT);
+            return 0;
+        } /* if */
+        host++;
+        hostend = bracket;
+        s->port = (bracket[1] == ':') ?
+                    httpStrdup(bracket + 2, (size_t) (path - (bracket + 2))) :
+                    httpStrdup("80", 2);
+    } /* if */
+    else
+    {
+        const char *colon = memchr(host, ':', (size_t) (path - host));
+        if (colon != NULL)
+            hostend = colon;
+        s->port = colon ? httpStrdup(colon + 1, (size_t) (path - (colon + 1))) :
+                          httpStrdup("80", 2);
+    } /* else */
+
+    if (hostend == host)
+    {
+        PHYSFS_setErrorCode(PHYSFS_ERR_INVALID_ARGUMENT);
+        return 0;
+    } /* if */
+
+    s->host = httpStrdup(host, (size_t) (hostend - host));
+    s->path = (*path) ? httpStrdup(path, strlen(path)) : httpStrdup("/", 1);
+    return ((s->host != NULL) && (s->port != NULL) && (s->path != NULL));
+} /* httpParseUrl */
+
+
+/* Ask for the last block of the file: that tells us its length and gets
+   the part of a ZIP we need first anyhow. */
+static int httpProbe(HTTPShared *s)
+{
+    HTTPResponse resp;
+    HTTPBlock *block;
+    char range[64];
+    PHYSFS_uint64 start;
+
+    snprintf(range, sizeof (range), "bytes=-%u", (unsigned int) s->blocksize);
+    if (!httpRequest(s, range, &resp))
+        return 0;  /* (an empty file can't satisfy any range, so it fails.) */
+
+    if (resp.status == 206)
+    {
+        s->length = resp.range_total;
+        start = resp.range_start;
+    } /* if */
+    else if (resp.have_length)  /* 200: no Range support; body is everything. */
+    {
+        s->length = resp.content_length;
+        start = 0;
+    } /* else if */
+    else
+    {
+        httpDisconnect(s);
+        PHYSFS_setErrorCode(PHYSFS_ERR_UNSUPPORTED);
+        return 0;
+    } /* else */
+
+    snprintf(s->validator, sizeof (s->validator), "%s", resp.validator);
+
+    if (s->length > 0)
+    {
+        const PHYSFS_uint64 index = (s->length - 1) / s->blocksize;
+        const PHYSFS_uint64 blockstart = index * s->blocksize;
+        const PHYSFS_uint32 len = httpBlockLen(s, index);
+
+        /* the suffix we asked for always covers all of the last block. */
+        if (httpSkip(s, blockstart - start) &&
+            ((block = httpAllocBlock(s)) != NULL))
+        {
+            if (httpRecvAll(s, block->data, len))
+            {
+                block->index = index;
+                block->len = len;
+                httpInsertBlock(s, block);
+            } /* if */
+            else
+            {
+                httpFreeBlock(s, block);
+                resp.keepalive = 0;
+            } /* else */
+        } /* if */
+        else
+        {
+            resp.keepalive = 0;
+        } /* else */
+    } /* if */
+
+    if (!resp.keepalive)
+        httpDisconnect(s);
+
+    return 1;
+} /* httpProbe */
+
+
+PHYSFS_Io *PHYSFSHTTP_createIo(const char *url, PHYSFS_uint32 blockSize,
+                               PHYSFS_uint32 cacheSize, const char *cacheDir)
+{
+    const PHYSFS_Allocator *a = PHYSFS_getAllocator();
+    HTTPShared *s;
+    PHYSFS_Io *retval;
+
+#ifdef _WIN32
+    static int wsa_initialized = 0;
+    if (!wsa_initialized)
+    {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+        {
+            PHYSFS_setErrorCode(PHYSFS_ERR_OS_ERROR);
+            return NULL;
+        } /* if */
+        wsa_initialized = 1;
+    } /* if */
+#endif
+
+    if ((a == NULL) || (url == NULL))
+    {
+        PHYSFS_setErrorCode(a ? PHYSFS_ERR_INVALID_ARGUMENT : PHYSFS_ERR_NOT_INITIALIZED);
+        return NULL;
+    } /* if */
+
+    if (blockSize == 0)
+        blockSize = HTTP_DEFAULT_BLOCKSIZE;
+    if (cacheSize == 0)
+        cacheSize = HTTP_DEFAULT_CACHESIZE;
+
+    s = (HTTPShared *) a->Malloc(sizeof (HTTPShared));
+    if (s == NULL)
+    {
+        PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+        return NULL;
+    } /* if */
+
+    memset(s, '\0', sizeof (*s));
+    s->sock = HTTP_NO_SOCKET;
+    s->refcount = 1;
+    s->blocksize = blockSize;
+    s->maxblocks = cacheSize / blockSize;
+    if (s->maxblocks < HTTP_MIN_BLOCKS)
+        s->maxblocks = HTTP_MIN_BLOCKS;
+    s->hashsize = s->maxblocks;
+#ifdef _WIN32
+    InitializeCriticalSection(&s->mutex);
+#else
+    pthread_mutex_init(&s->mutex, NULL);
+#endif
+
+    s->hash = (HTTPBlock **) a->Malloc(sizeof (HTTPBlock *) * s->hashsize);
+    if (s->hash == NULL)
+    {
+        PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+        httpFreeShared(s);
+        return NULL;
+    } /* if */
+    memset(s->hash, '\0', sizeof (HTTPBlock *) * s->hashsize);
+
+    if (cacheDir != NULL)
+    {
+        s->cachedir = httpStrdup(cacheDir, strlen(cacheDir));
+        if (s->cachedir == NULL)
+        {
+            httpFreeShared(s);
+            return NULL;
+        } /* if */
+    } /* if */
+
+    if (!httpParseUrl(s, url) || !httpProbe(s))
+    {
+        httpFreeShared(s);
+        return NULL;
+    } /* if */
+
+    httpMakeCacheKey(s, url);
+    if (s->mru != NULL)
+        httpDiskStore(s, s->mru);  /* the block httpProbe() got. */
+
+    retval = httpMakeIo(s);
+    if (retval == NULL)
+        httpFreeShared(s);
+    return retval;
+} /* PHYSFSHTTP_createIo */
+
+
+int PHYSFSHTTP_mount(const char *url, const char *cacheDir,
+                     const char *mountPoint, int appendToPath)
+{
+    PHYSFS_Io *io = PHYSFSHTTP_createIo(url, 0, 0, cacheDir);
+    if (io == NULL)
+        return 0;
+
+    if (!PHYSFS_mountIo(io, url, mountPoint, appendToPath))
+    {
+        io->destroy(io);
+        return 0;
+    } /* if */
+
+    return 1;
+} /* PHYSFSHTTP_mount */
+
+/* end of physfshttpio.c ... */
@@ -0,0 +1,89 @@
+/*
+ * This code provides a PHYSFS_Io that reads a file from an HTTP server with
+ *  Range requests, so you can mount a remote archive without downloading
+ *  all of it first.
+ *
+ * License: this code is public domain. There is no warranty that it is
+ *  useful, correct, harmless, or environmentally safe.
+ *
+ * This particular file may be used however you like, including copying it
+ *  verbatim into a closed-source project, exploiting it commercially, and
+ *  removing any trace of its authors from the source. Enhancements and
+ *  corrections are welcome, but you don't have to send patches if you make
+ *  changes. This code has NO WARRANTY.
+ *
+ * Unless otherwise stated, the rest of PhysicsFS falls under the zlib license.
+ *  Please see LICENSE.txt in the root of the source tree.
+ *
+ *  This file was written by the PhysicsFS contributors.
+ */
+
+#ifndef _INCLUDE_PHYSFSHTTPIO_H_
+#define _INCLUDE_PHYSFSHTTPIO_H_
+
+#include "physfs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Make a read-only PHYSFS_Io for a file on an HTTP server.
+ *
+ * The file is read in fixed-size blocks, which are kept in an in-memory
+ *  LRU cache and, if (cacheDir) isn't NULL, in files in that directory, so
+ *  a later run doesn't have to download them again. A read that misses the
+ *  cache fetches every missing block it touches with one Range request, and
+ *  reads that keep going forward through the file fetch a growing number of
+ *  blocks past what they asked for. Mounting a ZIP this way only downloads
+ *  the end of the file and its central directory, then whatever you read.
+ *
+ * The first request fetches the last block of the file, to learn its length
+ *  (and because that's where a ZIP's directory is). If the server ignores
+ *  Range requests, everything still works, but each miss downloads the file
+ *  from the start up to the blocks it needs.
+ *
+ * Only plain "http://host[:port]/path" URLs are supported: no TLS, no
+ *  redirects, no authentication. One keep-alive connection is shared by the
+ *  Io and its duplicates, so reads through them are serialized. If the file
+ *  changes on the server while it's open, reads fail with PHYSFS_ERR_CORRUPT.
+ *
+ *   @param url the file to read.
+ *   @param blockSize bytes per cached block, or zero for a default (64KB).
+ *   @param cacheSize bytes of memory to use for cached blocks, or zero for a
+ *                    default (8MB). At least four blocks are always kept.
+ *   @param cacheDir existing directory, in platform-dependent notation, to
+ *                   store blocks in, or NULL to only cache in memory.
+ *  @return A new PHYSFS_Io on success, NULL on error. Specifics
+ *           of the error can be gleaned from PHYSFS_getLastErrorCode().
+ */
+PHYSFS_DECL PHYSFS_Io *PHYSFSHTTP_createIo(const char *url,
+                                           PHYSFS_uint32 blockSize,
+                                           PHYSFS_uint32 cacheSize,
+                                           const char *cacheDir);
+
+/**
+ * Mount an archive on an HTTP server, as PHYSFS_mountIo() would mount a
+ *  local one. This uses PHYSFSHTTP_createIo() with default block and cache
+ *  sizes, and (url) is the name to pass to PHYSFS_unmount() later.
+ *
+ *   @param url the archive to mount.
+ *   @param cacheDir directory to store downloaded blocks in, or NULL.
+ *   @param mountPoint Location in the interpolated tree that this archive
+ *                     will be "mounted", in platform-independent notation.
+ *                     NULL or "" is equivalent to "/".
+ *   @param appendToPath nonzero to append to search path, zero to prepend.
+ *  @return nonzero if added to path, zero on failure (bogus archive, server
+ *           unreachable, etc). Use PHYSFS_getLastErrorCode() to obtain the
+ *           specific error.
+ */
+PHYSFS_DECL int PHYSFSHTTP_mount(const char *url, const char *cacheDir,
+                                 const char *mountPoint, int appendToPath);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* include-once blocker */
+
+/* end of physfshttpio.h ... */
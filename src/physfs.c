@@ -11,6 +11,8 @@
 #define __PHYSICSFS_INTERNAL__
 #include "physfs_internal.h"
 
+#include <stddef.h>  /* offsetof() */
+
 #if defined(_MSC_VER)
 #include <stdarg.h>
 
@@ -66,6 +68,37 @@ typedef struct __PHYSFS_FILEHANDLE__
 } FileHandle;
 
 
+typedef struct __PHYSFS_INTERNEDPATH__
+{
+    char *path;  /* sanitized, platform-independent. */
+    size_t len;  /* strlen(path). */
+    PHYSFS_uint32 components;  /* number of path elements. */
+    PHYSFS_uint32 *offsets;  /* where each element starts in (path)... */
+    PHYSFS_uint32 *hashes;  /* ...and __PHYSFS_hashString() from there on. */
+} InternedPath;
+
+
+typedef struct __PHYSFS_DIRVIEWMOUNT__
+{
+    DirHandle *dirHandle;  /* a mount that has the directory... */
+    char *arcdir;  /* ...under this name, root and all. */
+    size_t arcdirlen;  /* strlen(arcdir). */
+    PHYSFS_uint32 hash;  /* __PHYSFS_hashString() of arcdir plus a '/'. */
+} DirViewMount;
+
+typedef struct __PHYSFS_DIRVIEW__
+{
+    char *dirname;  /* sanitized, platform-independent. */
+    size_t dirnamelen;  /* strlen(dirname). */
+    PHYSFS_uint32 generation;  /* searchPathGeneration when resolved. */
+    int allowSymLinks;  /* allowSymLinks when resolved. */
+    int useFullPaths;  /* a mount point is in here; don't be clever. */
+    DirViewMount *mounts;  /* in search path order. */
+    size_t nummounts;
+    size_t longestArcdir;
+} DirView;
+
+
 typedef struct __PHYSFS_ERRSTATETYPE__
 {
     void *tid;
@@ -78,6 +111,7 @@ typedef struct __PHYSFS_ERRSTATETYPE__
 static int initialized = 0;
 static ErrState *errorStates = NULL;
 static DirHandle *searchPath = NULL;
+static PHYSFS_uint32 searchPathGeneration = 0;  /* bumped on any change. */
 static DirHandle *writeDir = NULL;
 static FileHandle *openWriteList = NULL;
 static FileHandle *openReadList = NULL;
@@ -85,6 +119,7 @@ static char *baseDir = NULL;
 static char *userDir = NULL;
 static char *prefDir = NULL;
 static int allowSymLinks = 0;
+static char *archiveIndexDir = NULL;
 static PHYSFS_Archiver **archivers = NULL;
 static PHYSFS_ArchiveInfo **archiveInfo = NULL;
 static volatile size_t numArchivers = 0;
@@ -104,10 +139,10 @@ static inline int __PHYSFS_atomicAdd(int *ptrval, const int val)
 {
     int retval;
     __PHYSFS_platformGrabMutex(stateLock);
-    retval = *ptrval;
-    *ptrval = retval + val;
+    retval = *ptrval + val;
+    *ptrval = retval;
     __PHYSFS_platformReleaseMutex(stateLock);
-    return retval;
+    return retval;  /* new value, like _InterlockedIncrement(). */
 } /* __PHYSFS_atomicAdd */
 
 int __PHYSFS_ATOMIC_INCR(int *ptrval)
@@ -125,10 +160,277 @@ int __PHYSFS_ATOMIC_DECR(int *ptrval)
 
 /* PHYSFS_Io implementation for i/o to physical filesystem... */
 
-/* !!! FIXME: maybe refcount the paths in a string pool? */
-typedef struct __PHYSFS_NativeIoInfo
+/*
+ * Files opened for reading share a NativeFd: every duplicate of a native Io
+ *  reads through the same platform handle with positional reads, each Io
+ *  keeping its own file position. When a limit is set with
+ *  PHYSFS_setMaxOpenFiles(), the least recently used handles that aren't
+ *  in the middle of a read are closed to stay under it, and reopened by
+ *  path the next time they're needed. A file that changed in the meantime
+ *  (its fingerprint, taken when we first opened it, differs) fails with
+ *  PHYSFS_ERR_IO instead of silently reading the new contents.
+ *
+ * The exception is an archiver refreshing itself, which means to see the
+ *  changes: __PHYSFS_nativeIoBeginRefresh() switches to whatever is at the
+ *  path now, keeping the old handle around, and the end of the refresh
+ *  either adopts the new file and its fingerprint or goes back to the old.
+ *  A handle that's swapped out while a read is using it is closed when
+ *  that read is done.
+ *
+ * Extraction cache files are pinned instead: they stay out of the pool and
+ *  keep their handle until the last Io using them is destroyed, since the
+ *  cache may delete them at any time and they couldn't be reopened.
+ *
+ * All of this is protected by nativeFdLock.
+ */
+typedef struct __PHYSFS_NativeFd
+{
+    char *path;
+    void *handle;  /* NULL while evicted. */
+    PHYSFS_uint64 fingerprint;
+    int haveFingerprint;
+    void *oldhandle;  /* during a refresh: what to go back to. */
+    PHYSFS_uint64 oldfingerprint;
+    int oldHaveFingerprint;
+    int refreshing;
+    void *retired;  /* swapped out during a read; close when not busy. */
+    PHYSFS_uint32 refcount;  /* Ios using this. */
+    PHYSFS_uint32 busy;  /* reads in progress; can't evict while nonzero. */
+    int pinned;  /* not in the pool; never closed to make room. */
+    struct __PHYSFS_NativeFd *prev;  /* LRU list of open handles... */
+    struct __PHYSFS_NativeFd *next;  /* ...newest first. */
+} NativeFd;
+
+static void *nativeFdLock = NULL;
+static NativeFd *nativeFdNewest = NULL;
+static NativeFd *nativeFdOldest = NULL;
+static PHYSFS_uint32 nativeFdOpen = 0;
+static PHYSFS_uint32 nativeFdMax = 0;  /* zero: no limit. */
+
+static void nativeFdGrabLock(void)
+{
+    if (nativeFdLock != NULL)
+        __PHYSFS_platformGrabMutex(nativeFdLock);
+} /* nativeFdGrabLock */
+
+static void nativeFdReleaseLock(void)
+{
+    if (nativeFdLock != NULL)
+        __PHYSFS_platformReleaseMutex(nativeFdLock);
+} /* nativeFdReleaseLock */
+
+/* MAKE SURE you hold nativeFdLock before calling this! */
+static void nativeFdUnlink(NativeFd *fd)
+{
+    if (fd->prev) fd->prev->next = fd->next; else nativeFdNewest = fd->next;
+    if (fd->next) fd->next->prev = fd->prev; else nativeFdOldest = fd->prev;
+    fd->prev = fd->next = NULL;
+} /* nativeFdUnlink */
+
+/* MAKE SURE you hold nativeFdLock before calling this! */
+static void nativeFdLinkNewest(NativeFd *fd)
+{
+    fd->prev = NULL;
+    fd->next = nativeFdNewest;
+    if (nativeFdNewest) nativeFdNewest->prev = fd; else nativeFdOldest = fd;
+    nativeFdNewest = fd;
+} /* nativeFdLinkNewest */
+
+/* MAKE SURE you hold nativeFdLock before calling this! */
+static void nativeFdClose(NativeFd *fd)
+{
+    assert(fd->handle != NULL);
+    assert(fd->busy == 0);
+    nativeFdUnlink(fd);
+    __PHYSFS_platformClose(fd->handle);
+    fd->handle = NULL;
+    nativeFdOpen--;
+} /* nativeFdClose */
+
+/* Close idle handles, oldest first, until no more than (keep) are open.
+    MAKE SURE you hold nativeFdLock before calling this! */
+static void nativeFdMakeRoom(const PHYSFS_uint32 keep)
+{
+    NativeFd *fd = nativeFdOldest;
+    while ((fd != NULL) && (nativeFdOpen > keep))
+    {
+        NativeFd *prev = fd->prev;
+        if (fd->busy == 0)
+            nativeFdClose(fd);
+        fd = prev;
+    } /* while */
+} /* nativeFdMakeRoom */
+
+/* Get (fd)'s handle, reopening it if it was evicted, and mark it busy.
+    Call nativeFdRelease() when done with it. */
+static void *nativeFdAcquire(NativeFd *fd)
 {
     void *handle;
+
+    nativeFdGrabLock();
+
+    if (fd->handle != NULL)
+    {
+        if ((!fd->pinned) && (fd != nativeFdNewest))
+        {
+            nativeFdUnlink(fd);
+            nativeFdLinkNewest(fd);
+        } /* if */
+    } /* if */
+
+    else
+    {
+        PHYSFS_uint64 fp;
+        if (nativeFdMax)
+            nativeFdMakeRoom(nativeFdMax - 1);
+
+        fd->handle = __PHYSFS_platformOpenRead(fd->path);
+        if (fd->handle == NULL)
+        {
+            nativeFdReleaseLock();
+            return NULL;
+        } /* if */
+
+        nativeFdLinkNewest(fd);
+        nativeFdOpen++;
+
+        /* !!! FIXME: this can race with the file being replaced between the
+           !!! FIXME:  open and the fingerprint. */
+        if (fd->haveFingerprint)
+        {
+            if ( (!__PHYSFS_platformFingerprint(fd->path, &fp)) ||
+                 (fp != fd->fingerprint) )
+            {
+                nativeFdClose(fd);
+                nativeFdReleaseLock();
+                BAIL(PHYSFS_ERR_IO, NULL);  /* file changed under us. */
+            } /* if */
+        } /* if */
+    } /* else */
+
+    fd->busy++;
+    handle = fd->handle;
+    nativeFdReleaseLock();
+    return handle;
+} /* nativeFdAcquire */
+
+/* Close a handle we've stopped using, now or once reads are done with it.
+    MAKE SURE you hold nativeFdLock before calling this! */
+static void nativeFdRetire(NativeFd *fd, void *handle)
+{
+    if (handle == NULL)
+        return;
+    else if (fd->busy > 0)
+    {
+        assert(fd->retired == NULL);
+        fd->retired = handle;
+        return;
+    } /* else if */
+
+    __PHYSFS_platformClose(handle);
+    nativeFdOpen--;
+} /* nativeFdRetire */
+
+static void nativeFdRelease(NativeFd *fd)
+{
+    nativeFdGrabLock();
+    assert(fd->busy > 0);
+    fd->busy--;
+    if ((fd->busy == 0) && (fd->retired != NULL))
+    {
+        void *retired = fd->retired;
+        fd->retired = NULL;
+        nativeFdRetire(fd, retired);
+    } /* if */
+    if ((nativeFdMax) && (nativeFdOpen > nativeFdMax))
+        nativeFdMakeRoom(nativeFdMax);  /* we went over while things were busy. */
+    nativeFdReleaseLock();
+} /* nativeFdRelease */
+
+static NativeFd *nativeFdCreate(const char *path, const int pinned)
+{
+    NativeFd *fd = (NativeFd *) allocator.Malloc(sizeof (NativeFd));
+    BAIL_IF(!fd, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    memset(fd, '\0', sizeof (NativeFd));
+    fd->path = (char *) allocator.Malloc(strlen(path) + 1);
+    if (!fd->path)
+    {
+        allocator.Free(fd);
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    } /* if */
+    strcpy(fd->path, path);
+
+    fd->pinned = pinned;
+    if (pinned)
+    {
+        fd->handle = __PHYSFS_platformOpenRead(path);
+        if (fd->handle == NULL)
+        {
+            allocator.Free(fd->path);
+            allocator.Free(fd);
+            return NULL;
+        } /* if */
+        fd->refcount = 1;
+        return fd;
+    } /* if */
+
+    nativeFdGrabLock();
+    if (nativeFdMax)
+        nativeFdMakeRoom(nativeFdMax - 1);
+
+    fd->handle = __PHYSFS_platformOpenRead(path);
+    if (fd->handle == NULL)
+    {
+        nativeFdReleaseLock();
+        allocator.Free(fd->path);
+        allocator.Free(fd);
+        return NULL;
+    } /* if */
+
+    /* what a reopen has to match, if the limit ever closes this. */
+    fd->haveFingerprint = __PHYSFS_platformFingerprint(path, &fd->fingerprint);
+
+    fd->refcount = 1;
+    nativeFdLinkNewest(fd);
+    nativeFdOpen++;
+    nativeFdReleaseLock();
+    return fd;
+} /* nativeFdCreate */
+
+static void nativeFdUnref(NativeFd *fd)
+{
+    nativeFdGrabLock();
+    assert(fd->refcount > 0);
+    if (--fd->refcount > 0)
+    {
+        nativeFdReleaseLock();
+        return;
+    } /* if */
+
+    assert(!fd->refreshing);
+    if (fd->retired != NULL)
+        nativeFdRetire(fd, fd->retired);
+
+    if (fd->pinned)
+        __PHYSFS_platformClose(fd->handle);
+    else if (fd->handle != NULL)
+    {
+        nativeFdUnlink(fd);
+        __PHYSFS_platformClose(fd->handle);
+        nativeFdOpen--;
+    } /* else if */
+    nativeFdReleaseLock();
+
+    allocator.Free(fd->path);
+    allocator.Free(fd);
+} /* nativeFdUnref */
+
+
+typedef struct __PHYSFS_NativeIoInfo
+{
+    void *handle;  /* for 'w' and 'a'; NULL for 'r'. */
+    NativeFd *fd;  /* for 'r'; NULL for 'w' and 'a'. */
+    PHYSFS_uint64 pos;  /* for 'r'; the others use the handle's pointer. */
     const char *path;
     int mode;   /* 'r', 'w', or 'a' */
 } NativeIoInfo;
@@ -136,51 +438,111 @@ typedef struct __PHYSFS_NativeIoInfo
 static PHYSFS_sint64 nativeIo_read(PHYSFS_Io *io, void *buf, PHYSFS_uint64 len)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    return __PHYSFS_platformRead(info->handle, buf, len);
+    PHYSFS_sint64 rc;
+    void *handle;
+
+    if (info->fd == NULL)
+        return __PHYSFS_platformRead(info->handle, buf, len);
+
+    handle = nativeFdAcquire(info->fd);
+    BAIL_IF_ERRPASS(!handle, -1);
+    rc = __PHYSFS_platformReadAt(handle, buf, len, info->pos);
+    nativeFdRelease(info->fd);
+    if (rc > 0)
+        info->pos += (PHYSFS_uint64) rc;
+    return rc;
 } /* nativeIo_read */
 
 static PHYSFS_sint64 nativeIo_write(PHYSFS_Io *io, const void *buffer,
                                     PHYSFS_uint64 len)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
+    BAIL_IF(info->fd != NULL, PHYSFS_ERR_OPEN_FOR_READING, -1);
     return __PHYSFS_platformWrite(info->handle, buffer, len);
 } /* nativeIo_write */
 
 static int nativeIo_seek(PHYSFS_Io *io, PHYSFS_uint64 offset)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    return __PHYSFS_platformSeek(info->handle, offset);
+    if (info->fd == NULL)
+        return __PHYSFS_platformSeek(info->handle, offset);
+    BAIL_IF(((PHYSFS_sint64) offset) < 0, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    info->pos = offset;
+    return 1;
 } /* nativeIo_seek */
 
 static PHYSFS_sint64 nativeIo_tell(PHYSFS_Io *io)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    return __PHYSFS_platformTell(info->handle);
+    if (info->fd == NULL)
+        return __PHYSFS_platformTell(info->handle);
+    return (PHYSFS_sint64) info->pos;
 } /* nativeIo_tell */
 
 static PHYSFS_sint64 nativeIo_length(PHYSFS_Io *io)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    return __PHYSFS_platformFileLength(info->handle);
+    PHYSFS_sint64 retval;
+    void *handle;
+
+    if (info->fd == NULL)
+        return __PHYSFS_platformFileLength(info->handle);
+
+    handle = nativeFdAcquire(info->fd);
+    BAIL_IF_ERRPASS(!handle, -1);
+    retval = __PHYSFS_platformFileLength(handle);
+    nativeFdRelease(info->fd);
+    return retval;
 } /* nativeIo_length */
 
 static PHYSFS_Io *nativeIo_duplicate(PHYSFS_Io *io)
 {
-    NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    return __PHYSFS_createNativeIo(info->path, info->mode);
+    NativeIoInfo *origInfo = (NativeIoInfo *) io->opaque;
+    NativeIoInfo *info = NULL;
+    PHYSFS_Io *retval = NULL;
+
+    if (origInfo->fd == NULL)
+        return __PHYSFS_createNativeIo(origInfo->path, origInfo->mode);
+
+    /* share the descriptor instead of opening the file again. */
+    retval = (PHYSFS_Io *) allocator.Malloc(sizeof (PHYSFS_Io));
+    BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    info = (NativeIoInfo *) allocator.Malloc(sizeof (NativeIoInfo));
+    if (!info)
+    {
+        allocator.Free(retval);
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    } /* if */
+
+    nativeFdGrabLock();
+    origInfo->fd->refcount++;
+    nativeFdReleaseLock();
+
+    memcpy(info, origInfo, sizeof (NativeIoInfo));
+    info->pos = 0;
+    memcpy(retval, io, sizeof (PHYSFS_Io));
+    retval->opaque = info;
+    return retval;
 } /* nativeIo_duplicate */
 
 static int nativeIo_flush(PHYSFS_Io *io)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
+    if (info->fd != NULL)
+        return 1;  /* nothing to flush on a read-only file. */
     return __PHYSFS_platformFlush(info->handle);
 } /* nativeIo_flush */
 
 static void nativeIo_destroy(PHYSFS_Io *io)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    __PHYSFS_platformClose(info->handle);
-    allocator.Free((void *) info->path);
+    if (info->fd != NULL)
+        nativeFdUnref(info->fd);  /* (info->path) belongs to (info->fd). */
+    else
+    {
+        __PHYSFS_platformClose(info->handle);
+        allocator.Free((void *) info->path);
+    } /* else */
     allocator.Free(info);
     allocator.Free(io);
 } /* nativeIo_destroy */
@@ -198,10 +560,12 @@ static const PHYSFS_Io __PHYSFS_nativeIoInterface =
     nativeIo_destroy
 };
 
-PHYSFS_Io *__PHYSFS_createNativeIo(const char *path, const int mode)
+static PHYSFS_Io *createNativeIo(const char *path, const int mode,
+                                 const int pinned)
 {
     PHYSFS_Io *io = NULL;
     NativeIoInfo *info = NULL;
+    NativeFd *fd = NULL;
     void *handle = NULL;
     char *pathdup = NULL;
 
@@ -211,21 +575,31 @@ PHYSFS_Io *__PHYSFS_createNativeIo(const char *path, const int mode)
     GOTO_IF(!io, PHYSFS_ERR_OUT_OF_MEMORY, createNativeIo_failed);
     info = (NativeIoInfo *) allocator.Malloc(sizeof (NativeIoInfo));
     GOTO_IF(!info, PHYSFS_ERR_OUT_OF_MEMORY, createNativeIo_failed);
-    pathdup = (char *) allocator.Malloc(strlen(path) + 1);
-    GOTO_IF(!pathdup, PHYSFS_ERR_OUT_OF_MEMORY, createNativeIo_failed);
 
     if (mode == 'r')
-        handle = __PHYSFS_platformOpenRead(path);
-    else if (mode == 'w')
-        handle = __PHYSFS_platformOpenWrite(path);
-    else if (mode == 'a')
-        handle = __PHYSFS_platformOpenAppend(path);
+    {
+        fd = nativeFdCreate(path, pinned);
+        GOTO_IF_ERRPASS(!fd, createNativeIo_failed);
+    } /* if */
+
+    else
+    {
+        pathdup = (char *) allocator.Malloc(strlen(path) + 1);
+        GOTO_IF(!pathdup, PHYSFS_ERR_OUT_OF_MEMORY, createNativeIo_failed);
 
-    GOTO_IF_ERRPASS(!handle, createNativeIo_failed);
+        if (mode == 'w')
+            handle = __PHYSFS_platformOpenWrite(path);
+        else if (mode == 'a')
+            handle = __PHYSFS_platformOpenAppend(path);
+
+        GOTO_IF_ERRPASS(!handle, createNativeIo_failed);
+        strcpy(pathdup, path);
+    } /* else */
 
-    strcpy(pathdup, path);
     info->handle = handle;
-    info->path = pathdup;
+    info->fd = fd;
+    info->pos = 0;
+    info->path = fd ? fd->path : pathdup;
     info->mode = mode;
     memcpy(io, &__PHYSFS_nativeIoInterface, sizeof (*io));
     io->opaque = info;
@@ -237,8 +611,104 @@ createNativeIo_failed:
     if (info != NULL) allocator.Free(info);
     if (io != NULL) allocator.Free(io);
     return NULL;
+} /* createNativeIo */
+
+PHYSFS_Io *__PHYSFS_createNativeIo(const char *path, const int mode)
+{
+    return createNativeIo(path, mode, 0);
 } /* __PHYSFS_createNativeIo */
 
+const char *__PHYSFS_nativeIoPath(PHYSFS_Io *io)
+{
+    if (io->read != nativeIo_read)
+        return NULL;
+    return ((NativeIoInfo *) io->opaque)->path;
+} /* __PHYSFS_nativeIoPath */
+
+int __PHYSFS_nativeIoBeginRefresh(PHYSFS_Io *io)
+{
+    NativeFd *fd;
+    PHYSFS_uint64 fp = 0;
+    int havefp;
+    void *handle;
+
+    if ((io->read != nativeIo_read) || (((NativeIoInfo *) io->opaque)->fd == NULL))
+        return 1;  /* not ours, or not pooled; nothing to do. */
+
+    fd = ((NativeIoInfo *) io->opaque)->fd;
+    havefp = __PHYSFS_platformFingerprint(fd->path, &fp);
+
+    nativeFdGrabLock();
+    assert(!fd->refreshing);
+
+    /* still the file we opened? Then there's nothing to switch. */
+    if ( (fd->handle != NULL) && (havefp) && (fd->haveFingerprint) &&
+         (fp == fd->fingerprint) )
+    {
+        nativeFdReleaseLock();
+        return 1;
+    } /* if */
+
+    if (fd->retired != NULL)  /* a slow read still has an older handle. */
+    {
+        nativeFdReleaseLock();
+        BAIL(PHYSFS_ERR_BUSY, 0);
+    } /* if */
+
+    if (nativeFdMax)
+        nativeFdMakeRoom(nativeFdMax - 1);
+    handle = __PHYSFS_platformOpenRead(fd->path);
+    if (handle == NULL)
+    {
+        nativeFdReleaseLock();
+        return 0;
+    } /* if */
+    nativeFdOpen++;
+
+    fd->oldhandle = fd->handle;
+    fd->oldfingerprint = fd->fingerprint;
+    fd->oldHaveFingerprint = fd->haveFingerprint;
+    if (fd->handle == NULL)
+        nativeFdLinkNewest(fd);
+    fd->handle = handle;
+    fd->haveFingerprint = __PHYSFS_platformFingerprint(fd->path, &fd->fingerprint);
+    fd->refreshing = 1;
+    fd->busy++;  /* don't evict either handle until we're done. */
+    nativeFdReleaseLock();
+    return 1;
+} /* __PHYSFS_nativeIoBeginRefresh */
+
+void __PHYSFS_nativeIoEndRefresh(PHYSFS_Io *io, const int keep)
+{
+    NativeFd *fd;
+
+    if ((io->read != nativeIo_read) || (((NativeIoInfo *) io->opaque)->fd == NULL))
+        return;
+
+    fd = ((NativeIoInfo *) io->opaque)->fd;
+    nativeFdGrabLock();
+    if (fd->refreshing)
+    {
+        void *old = fd->oldhandle;
+        fd->refreshing = 0;
+        fd->oldhandle = NULL;
+        fd->busy--;
+
+        if (keep)
+            nativeFdRetire(fd, old);
+        else
+        {
+            nativeFdRetire(fd, fd->handle);
+            fd->handle = old;
+            fd->fingerprint = fd->oldfingerprint;
+            fd->haveFingerprint = fd->oldHaveFingerprint;
+            if (old == NULL)  /* it was evicted before, so it is again. */
+                nativeFdUnlink(fd);
+        } /* else */
+    } /* if */
+    nativeFdReleaseLock();
+} /* __PHYSFS_nativeIoEndRefresh */
+
 
 /* PHYSFS_Io implementation for i/o to a memory buffer... */
 
@@ -413,6 +883,149 @@ createMemoryIo_failed:
 } /* __PHYSFS_createMemoryIo */
 
 
+/* PHYSFS_Io implementation for i/o to a window of another PHYSFS_Io... */
+
+typedef struct __PHYSFS_SubIoInfo
+{
+    PHYSFS_Io *parent;  /* private to us, so we always know where it is. */
+    PHYSFS_uint64 base;
+    PHYSFS_uint64 len;
+    PHYSFS_uint64 pos;
+    PHYSFS_File *owner;  /* PHYSFS_mountHandle()'s file, or NULL. */
+} SubIoInfo;
+
+static PHYSFS_sint64 subIo_read(PHYSFS_Io *io, void *buf, PHYSFS_uint64 len)
+{
+    SubIoInfo *info = (SubIoInfo *) io->opaque;
+    const PHYSFS_uint64 avail = info->len - info->pos;
+    PHYSFS_sint64 rc;
+
+    if (avail == 0)
+        return 0;  /* we're at EOF; nothing to do. */
+
+    if (len > avail)
+        len = avail;
+
+    rc = info->parent->read(info->parent, buf, len);
+    if (rc > 0)
+        info->pos += (PHYSFS_uint64) rc;
+
+    return rc;
+} /* subIo_read */
+
+static PHYSFS_sint64 subIo_write(PHYSFS_Io *io, const void *buffer,
+                                 PHYSFS_uint64 len)
+{
+    BAIL(PHYSFS_ERR_READ_ONLY, -1);
+} /* subIo_write */
+
+static int subIo_seek(PHYSFS_Io *io, PHYSFS_uint64 offset)
+{
+    SubIoInfo *info = (SubIoInfo *) io->opaque;
+    BAIL_IF(offset > info->len, PHYSFS_ERR_PAST_EOF, 0);
+    BAIL_IF_ERRPASS(!info->parent->seek(info->parent, info->base + offset), 0);
+    info->pos = offset;
+    return 1;
+} /* subIo_seek */
+
+static PHYSFS_sint64 subIo_tell(PHYSFS_Io *io)
+{
+    const SubIoInfo *info = (SubIoInfo *) io->opaque;
+    return (PHYSFS_sint64) info->pos;
+} /* subIo_tell */
+
+static PHYSFS_sint64 subIo_length(PHYSFS_Io *io)
+{
+    const SubIoInfo *info = (SubIoInfo *) io->opaque;
+    return (PHYSFS_sint64) info->len;
+} /* subIo_length */
+
+static PHYSFS_Io *subIo_duplicate(PHYSFS_Io *io)
+{
+    SubIoInfo *info = (SubIoInfo *) io->opaque;
+    PHYSFS_Io *parent = info->parent->duplicate(info->parent);
+    PHYSFS_Io *retval;
+
+    BAIL_IF_ERRPASS(!parent, NULL);
+    retval = __PHYSFS_createSubIo(parent, info->base, info->len);
+    if (!retval)
+        parent->destroy(parent);
+    return retval;
+} /* subIo_duplicate */
+
+static int subIo_flush(PHYSFS_Io *io) { return 1;  /* it's read-only. */ }
+
+static void subIo_destroy(PHYSFS_Io *io)
+{
+    SubIoInfo *info = (SubIoInfo *) io->opaque;
+    info->parent->destroy(info->parent);
+    if (info->owner != NULL)
+        PHYSFS_close(info->owner);
+    allocator.Free(info);
+    allocator.Free(io);
+} /* subIo_destroy */
+
+static const PHYSFS_Io __PHYSFS_subIoInterface =
+{
+    CURRENT_PHYSFS_IO_API_VERSION, NULL,
+    subIo_read,
+    subIo_write,
+    subIo_seek,
+    subIo_tell,
+    subIo_length,
+    subIo_duplicate,
+    subIo_flush,
+    subIo_destroy
+};
+
+PHYSFS_Io *__PHYSFS_createSubIo(PHYSFS_Io *io, PHYSFS_uint64 offset,
+                                PHYSFS_uint64 len)
+{
+    PHYSFS_Io *retval = NULL;
+    SubIoInfo *info = NULL;
+    PHYSFS_Io *parent = io;
+    PHYSFS_uint64 base = offset;
+
+    /* a window of a window is just a smaller window of the original. */
+    if (io->read == subIo_read)
+    {
+        const SubIoInfo *inner = (const SubIoInfo *) io->opaque;
+        BAIL_IF(offset > inner->len, PHYSFS_ERR_CORRUPT, NULL);
+        BAIL_IF(len > inner->len - offset, PHYSFS_ERR_CORRUPT, NULL);
+        parent = inner->parent;
+        base = inner->base + offset;
+    } /* if */
+
+    retval = (PHYSFS_Io *) allocator.Malloc(sizeof (PHYSFS_Io));
+    GOTO_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, createSubIo_failed);
+    info = (SubIoInfo *) allocator.Malloc(sizeof (SubIoInfo));
+    GOTO_IF(!info, PHYSFS_ERR_OUT_OF_MEMORY, createSubIo_failed);
+    GOTO_IF_ERRPASS(!parent->seek(parent, base), createSubIo_failed);
+
+    if (parent != io)  /* take the inner window's parent, drop the rest. */
+    {
+        SubIoInfo *inner = (SubIoInfo *) io->opaque;
+        assert(inner->owner == NULL);
+        allocator.Free(inner);
+        allocator.Free(io);
+    } /* if */
+
+    info->parent = parent;
+    info->base = base;
+    info->len = len;
+    info->pos = 0;
+    info->owner = NULL;
+    memcpy(retval, &__PHYSFS_subIoInterface, sizeof (*retval));
+    retval->opaque = info;
+    return retval;
+
+createSubIo_failed:
+    if (info != NULL) allocator.Free(info);
+    if (retval != NULL) allocator.Free(retval);
+    return NULL;
+} /* __PHYSFS_createSubIo */
+
+
 /* PHYSFS_Io implementation for i/o to a PHYSFS_File... */
 
 static PHYSFS_sint64 handleIo_read(PHYSFS_Io *io, void *buf, PHYSFS_uint64 len)
@@ -869,11 +1482,100 @@ static DirHandle *tryOpenDir(PHYSFS_Io *io, const PHYSFS_Archiver *funcs,
 } /* tryOpenDir */
 
 
+/*
+ * How much of a file openDirectory() reads up front for archivers to sniff.
+ *  The head reaches the first ISO9660 volume descriptor (sector 16), and the
+ *  tail is big enough to hold a ZIP's end-of-central-dir record plus the
+ *  longest possible zipfile comment.
+ */
+#define SNIFF_HEAD_BYTES (32 * 1024 + 2048)
+#define SNIFF_TAIL_BYTES (0xFFFF + 22)
+
+typedef struct
+{
+    PHYSFS_uint8 *buf;
+    const PHYSFS_uint8 *tail;
+    PHYSFS_uint64 headlen;
+    PHYSFS_uint64 taillen;
+    PHYSFS_sint64 filelen;
+} SniffBuffer;
+
+static PHYSFS_uint64 sniffRead(PHYSFS_Io *io, PHYSFS_uint8 *buf,
+                               const PHYSFS_uint64 len)
+{
+    PHYSFS_uint64 total = 0;
+    while (total < len)
+    {
+        const PHYSFS_sint64 rc = io->read(io, buf + total, len - total);
+        if (rc <= 0)
+            break;
+        total += (PHYSFS_uint64) rc;
+    } /* while */
+    return total;
+} /* sniffRead */
+
+
+/* Read the head and tail of (io) once, for every archiver's sniff(). */
+static int readSniffBuffer(PHYSFS_Io *io, SniffBuffer *sb)
+{
+    PHYSFS_uint8 *tailbuf;
+
+    memset(sb, '\0', sizeof (*sb));
+    sb->buf = (PHYSFS_uint8 *) allocator.Malloc(SNIFF_HEAD_BYTES + SNIFF_TAIL_BYTES);
+    BAIL_IF(!sb->buf, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    tailbuf = sb->buf + SNIFF_HEAD_BYTES;
+
+    sb->filelen = io->length(io);
+    if (!io->seek(io, 0))
+    {
+        allocator.Free(sb->buf);
+        sb->buf = NULL;
+        return 0;
+    } /* if */
+
+    sb->headlen = sniffRead(io, sb->buf, SNIFF_HEAD_BYTES);
+
+    if (sb->filelen < 0)
+        sb->tail = tailbuf;  /* no length, no tail. */
+    else if ((PHYSFS_uint64) sb->filelen <= sb->headlen)  /* all in head. */
+    {
+        sb->taillen = sb->headlen;
+        if (sb->taillen > SNIFF_TAIL_BYTES)
+            sb->taillen = SNIFF_TAIL_BYTES;
+        sb->tail = sb->buf + (sb->headlen - sb->taillen);
+    } /* else if */
+    else
+    {
+        const PHYSFS_uint64 pos = ((PHYSFS_uint64) sb->filelen) - SNIFF_TAIL_BYTES;
+        sb->tail = tailbuf;
+        if (io->seek(io, pos))
+        {
+            if (sniffRead(io, tailbuf, SNIFF_TAIL_BYTES) == SNIFF_TAIL_BYTES)
+                sb->taillen = SNIFF_TAIL_BYTES;
+        } /* if */
+    } /* else */
+
+    return 1;
+} /* readSniffBuffer */
+
+
+/* 1 if (funcs) recognizes the data, 0 if it rejects it, -1 if unsure. */
+static int sniffArchive(const PHYSFS_Archiver *funcs, const SniffBuffer *sb)
+{
+    if ((sb == NULL) || (funcs->sniff == NULL))
+        return -1;
+    return funcs->sniff(sb->buf, sb->headlen, sb->tail, sb->taillen,
+                        sb->filelen);
+} /* sniffArchive */
+
+
 static DirHandle *openDirectory(PHYSFS_Io *io, const char *d, int forWriting)
 {
     DirHandle *retval = NULL;
     PHYSFS_Archiver **i;
     const char *ext;
+    SniffBuffer sniffbuf;
+    const SniffBuffer *sb = NULL;
     int created_io = 0;
     int claimed = 0;
     PHYSFS_ErrorCode errcode;
@@ -899,32 +1601,42 @@ static DirHandle *openDirectory(PHYSFS_Io *io, const char *d, int forWriting)
         created_io = 1;
     } /* if */
 
+    /* read the start and end of the file once, instead of once per archiver. */
+    if ((!forWriting) && (readSniffBuffer(io, &sniffbuf)))
+        sb = &sniffbuf;
+
+    #define EXT_MATCHES(arc) \
+        ((ext != NULL) && (PHYSFS_utf8stricmp(ext, (arc)->info.extension) == 0))
+
     ext = find_filename_extension(d);
-    if (ext != NULL)
+
+    /* Look for archivers with matching file extensions first... */
+    for (i = archivers; (*i != NULL) && (retval == NULL) && !claimed; i++)
     {
-        /* Look for archivers with matching file extensions first... */
-        for (i = archivers; (*i != NULL) && (retval == NULL) && !claimed; i++)
-        {
-            if (PHYSFS_utf8stricmp(ext, (*i)->info.extension) == 0)
-                retval = tryOpenDir(io, *i, d, forWriting, &claimed);
-        } /* for */
+        if (EXT_MATCHES(*i) && (sniffArchive(*i, sb) != 0))
+            retval = tryOpenDir(io, *i, d, forWriting, &claimed);
+    } /* for */
 
-        /* failing an exact file extension match, try all the others... */
-        for (i = archivers; (*i != NULL) && (retval == NULL) && !claimed; i++)
-        {
-            if (PHYSFS_utf8stricmp(ext, (*i)->info.extension) != 0)
-                retval = tryOpenDir(io, *i, d, forWriting, &claimed);
-        } /* for */
-    } /* if */
+    /* ...then ones that recognize the data, then ones that can't tell. */
+    for (i = archivers; (*i != NULL) && (retval == NULL) && !claimed; i++)
+    {
+        if (!EXT_MATCHES(*i) && (sniffArchive(*i, sb) == 1))
+            retval = tryOpenDir(io, *i, d, forWriting, &claimed);
+    } /* for */
 
-    else  /* no extension? Try them all. */
+    for (i = archivers; (*i != NULL) && (retval == NULL) && !claimed; i++)
     {
-        for (i = archivers; (*i != NULL) && (retval == NULL) && !claimed; i++)
+        if (!EXT_MATCHES(*i) && (sniffArchive(*i, sb) == -1))
             retval = tryOpenDir(io, *i, d, forWriting, &claimed);
-    } /* else */
+    } /* for */
+
+    #undef EXT_MATCHES
 
     errcode = currentErrorCode();
 
+    if (sb != NULL)
+        allocator.Free(sniffbuf.buf);
+
     if ((!retval) && (created_io))
         io->destroy(io);
 
@@ -1083,1993 +1795,4558 @@ badDirHandle:
 } /* createDirHandle */
 
 
-/* MAKE SURE you've got the stateLock held before calling this! */
-static int freeDirHandle(DirHandle *dh, FileHandle *openList)
-{
-    FileHandle *i;
+/*
+ * The resident tier: files that get opened a lot are read into memory
+ *  once, and later opens get a memoryIo over that buffer instead of going
+ *  back to the archive. Entries are keyed on the DirHandle that provided
+ *  the file plus its sanitized path, and track open counts even while not
+ *  resident, so we know what's hot. Counts are halved whenever we're
+ *  tracking too many files, which also forgets the ones that went cold.
+ *  Resident entries are also kept in a list, least-opened first, so making
+ *  room only looks at as many of them as it evicts.
+ *
+ * Promoting a file means reading all of it, so it doesn't happen under
+ *  stateLock: the open that decides on it claims the entry, reads its own
+ *  new handle into a buffer once the lock is released, and then takes the
+ *  lock again to publish the buffer, or throw it away if the entry was
+ *  dropped (or promoted some other way) in the meantime.
+ *
+ * All of this is protected by stateLock.
+ */
 
-    if (dh == NULL)
-        return 1;
+#define RESIDENT_HASH_BUCKETS 256
+#define RESIDENT_MAX_TRACKED 4096
+#define RESIDENT_DEFAULT_PROMOTE_AFTER 3
 
-    for (i = openList; i != NULL; i = i->next)
-        BAIL_IF(i->dirHandle == dh, PHYSFS_ERR_FILES_STILL_OPEN, 0);
+typedef struct __PHYSFS_RESIDENTENTRY__
+{
+    const DirHandle *dirHandle;
+    char *fname;
+    PHYSFS_uint32 hash;
+    PHYSFS_uint32 accesses;
+    PHYSFS_uint32 pins;
+    PHYSFS_uint32 promoting;  /* ticket of a promotion in flight, or zero. */
+    PHYSFS_Io *io;  /* parent memoryIo if resident, NULL if just tracked. */
+    PHYSFS_uint64 size;
+    struct __PHYSFS_RESIDENTENTRY__ *next;
+    struct __PHYSFS_RESIDENTENTRY__ *colder;  /* list of resident entries, */
+    struct __PHYSFS_RESIDENTENTRY__ *hotter;  /*  by ascending (accesses). */
+} ResidentEntry;
+
+/* A promotion residentNoteOpen() claimed, for residentFinishPromotion(). */
+typedef struct
+{
+    const DirHandle *dirHandle;
+    char *fname;
+    PHYSFS_uint32 hash;  /* __PHYSFS_hashString() of (fname). */
+    PHYSFS_uint64 len;
+    PHYSFS_uint32 ticket;  /* zero if there's nothing to do. */
+} ResidentPromotion;
 
-    dh->funcs->closeArchive(dh->opaque);
-    allocator.Free(dh->dirName);
-    allocator.Free(dh->mountPoint);
-    allocator.Free(dh);
-    return 1;
-} /* freeDirHandle */
+static ResidentEntry *residentBuckets[RESIDENT_HASH_BUCKETS];
+static ResidentEntry *residentColdest = NULL;
+static ResidentEntry *residentHottest = NULL;
+static PHYSFS_uint32 residentTicket = 0;
+static PHYSFS_uint32 residentTracked = 0;
+static PHYSFS_uint32 residentPromoteAfter = RESIDENT_DEFAULT_PROMOTE_AFTER;
+static PHYSFS_ResidentStats residentStats;
 
+static inline int residentActive(void)
+{
+    return ((residentStats.budget > 0) || (residentStats.pinned > 0));
+} /* residentActive */
 
-static char *calculateBaseDir(const char *argv0)
+/* (hash) is __PHYSFS_hashString() of all of (fname). */
+static ResidentEntry *residentFind(const DirHandle *dh, const char *fname,
+                                   const PHYSFS_uint32 hash, const int create)
 {
-    const char dirsep = __PHYSFS_platformDirSeparator;
-    char *retval = NULL;
-    char *ptr = NULL;
+    ResidentEntry **bucket = &residentBuckets[hash % RESIDENT_HASH_BUCKETS];
+    ResidentEntry *e;
 
-    /* Give the platform layer first shot at this. */
-    retval = __PHYSFS_platformCalcBaseDir(argv0);
-    if (retval != NULL)
-        return retval;
+    for (e = *bucket; e != NULL; e = e->next)
+    {
+        if ((e->hash == hash) && (e->dirHandle == dh) && (!strcmp(e->fname, fname)))
+            return e;
+    } /* for */
 
-    /* We need argv0 to go on. */
-    BAIL_IF(argv0 == NULL, PHYSFS_ERR_ARGV0_IS_NULL, NULL);
+    if (!create)
+        return NULL;
 
-    ptr = strrchr(argv0, dirsep);
-    if (ptr != NULL)
+    e = (ResidentEntry *) allocator.Malloc(sizeof (ResidentEntry));
+    BAIL_IF(!e, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    memset(e, '\0', sizeof (*e));
+    e->fname = (char *) allocator.Malloc(strlen(fname) + 1);
+    if (!e->fname)
     {
-        const size_t size = ((size_t) (ptr - argv0)) + 1;
-        retval = (char *) allocator.Malloc(size + 1);
-        BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
-        memcpy(retval, argv0, size);
-        retval[size] = '\0';
-        return retval;
+        allocator.Free(e);
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, NULL);
     } /* if */
 
-    /* argv0 wasn't helpful. */
-    BAIL(PHYSFS_ERR_INVALID_ARGUMENT, NULL);
-} /* calculateBaseDir */
+    strcpy(e->fname, fname);
+    e->dirHandle = dh;
+    e->hash = hash;
+    e->next = *bucket;
+    *bucket = e;
+    residentTracked++;
+    return e;
+} /* residentFind */
+
+/* Put resident (e) in the list, looking for its spot from (from) on, which
+    must be the coldest entry or one no hotter than (e) is now. */
+static void residentLinkHeat(ResidentEntry *e, ResidentEntry *from)
+{
+    ResidentEntry *hotter = from;
+    while ((hotter != NULL) && (hotter->accesses <= e->accesses))
+        hotter = hotter->hotter;
+
+    e->hotter = hotter;
+    e->colder = hotter ? hotter->colder : residentHottest;
+    if (e->colder) e->colder->hotter = e; else residentColdest = e;
+    if (hotter) hotter->colder = e; else residentHottest = e;
+} /* residentLinkHeat */
+
+static void residentUnlinkHeat(ResidentEntry *e)
+{
+    if (e->colder) e->colder->hotter = e->hotter; else residentColdest = e->hotter;
+    if (e->hotter) e->hotter->colder = e->colder; else residentHottest = e->colder;
+    e->colder = e->hotter = NULL;
+} /* residentUnlinkHeat */
+
+/* Resident (e) was just opened again; move it up the list if it passed anyone. */
+static void residentWarmed(ResidentEntry *e)
+{
+    ResidentEntry *from = e->hotter;
+    if ((from != NULL) && (from->accesses < e->accesses))
+    {
+        residentUnlinkHeat(e);
+        residentLinkHeat(e, from);
+    } /* if */
+} /* residentWarmed */
 
+static void residentEvict(ResidentEntry *e)
+{
+    if (e->io != NULL)
+    {
+        residentUnlinkHeat(e);
+        e->io->destroy(e->io);  /* open handles keep their own reference. */
+        e->io = NULL;
+        residentStats.used -= e->size;
+        residentStats.files--;
+        e->size = 0;
+    } /* if */
+} /* residentEvict */
 
-static int initializeMutexes(void)
+/* Drop every entry (keep) says no to; NULL (keep) drops them all. */
+static void residentPrune(int (*keep)(ResidentEntry *, const void *),
+                         const void *data)
 {
-    errorLock = __PHYSFS_platformCreateMutex();
-    if (errorLock == NULL)
-        goto initializeMutexes_failed;
+    size_t i;
+    for (i = 0; i < RESIDENT_HASH_BUCKETS; i++)
+    {
+        ResidentEntry **prev = &residentBuckets[i];
+        ResidentEntry *e = *prev;
+        while (e != NULL)
+        {
+            ResidentEntry *next = e->next;
+            if ((keep != NULL) && (keep(e, data)))
+                prev = &e->next;
+            else
+            {
+                residentEvict(e);
+                if (e->pins > 0)
+                    residentStats.pinned--;
+                *prev = next;
+                allocator.Free(e->fname);
+                allocator.Free(e);
+                residentTracked--;
+            } /* else */
+            e = next;
+        } /* while */
+    } /* for */
+} /* residentPrune */
 
-    stateLock = __PHYSFS_platformCreateMutex();
-    if (stateLock == NULL)
-        goto initializeMutexes_failed;
+static int residentKeepOtherDir(ResidentEntry *e, const void *dh)
+{
+    return (e->dirHandle != (const DirHandle *) dh);
+} /* residentKeepOtherDir */
 
-    return 1;  /* success. */
+static int residentKeepOtherName(ResidentEntry *e, const void *fname)
+{
+    return (strcmp(e->fname, (const char *) fname) != 0);
+} /* residentKeepOtherName */
 
-initializeMutexes_failed:
-    if (errorLock != NULL)
-        __PHYSFS_platformDestroyMutex(errorLock);
+static int residentKeepPinned(ResidentEntry *e, const void *unused)
+{
+    return (e->pins > 0);
+} /* residentKeepPinned */
 
-    if (stateLock != NULL)
-        __PHYSFS_platformDestroyMutex(stateLock);
+/* halves everyone's count as it goes, so busy files stay and idle ones fade.
+    Halving keeps the resident list in order. */
+static int residentKeepWarm(ResidentEntry *e, const void *unused)
+{
+    e->accesses /= 2;
+    return ((e->accesses > 0) || (e->io != NULL) || (e->pins > 0));
+} /* residentKeepWarm */
 
-    errorLock = stateLock = NULL;
-    return 0;  /* failed. */
-} /* initializeMutexes */
+/* Would dropping files opened less than (accesses) times make (size) fit? */
+static int residentHasRoom(const PHYSFS_uint64 size,
+                           const PHYSFS_uint32 accesses)
+{
+    PHYSFS_uint64 colder = 0;
+    const ResidentEntry *e;
 
+    for (e = residentColdest; e != NULL; e = e->hotter)
+    {
+        if ((residentStats.used - colder) + size <= residentStats.budget)
+            break;
+        else if (e->accesses >= accesses)
+            break;
+        else if (e->pins == 0)
+            colder += e->size;
+    } /* for */
 
-static int doRegisterArchiver(const PHYSFS_Archiver *_archiver);
+    return ((residentStats.used - colder) + size <= residentStats.budget);
+} /* residentHasRoom */
 
-static int initStaticArchivers(void)
+/* Drop the least-opened unpinned files until (size) more bytes fit. */
+static int residentMakeRoom(const PHYSFS_uint64 size,
+                            const PHYSFS_uint32 accesses, const int force)
 {
-    #define REGISTER_STATIC_ARCHIVER(arc) { \
-        if (!doRegisterArchiver(&__PHYSFS_Archiver_##arc)) { \
-            return 0; \
-        } \
-    }
+    ResidentEntry *e = residentColdest;
 
-    #if PHYSFS_SUPPORTS_ZIP
-        REGISTER_STATIC_ARCHIVER(ZIP);
-    #endif
-    #if PHYSFS_SUPPORTS_7Z
-        SZIP_global_init();
-        REGISTER_STATIC_ARCHIVER(7Z);
-    #endif
-    #if PHYSFS_SUPPORTS_GRP
-        REGISTER_STATIC_ARCHIVER(GRP);
-    #endif
-    #if PHYSFS_SUPPORTS_QPAK
-        REGISTER_STATIC_ARCHIVER(QPAK);
-    #endif
-    #if PHYSFS_SUPPORTS_HOG
-        REGISTER_STATIC_ARCHIVER(HOG);
-    #endif
-    #if PHYSFS_SUPPORTS_MVL
-        REGISTER_STATIC_ARCHIVER(MVL);
-    #endif
-    #if PHYSFS_SUPPORTS_WAD
-        REGISTER_STATIC_ARCHIVER(WAD);
-    #endif
-    #if PHYSFS_SUPPORTS_SLB
-        REGISTER_STATIC_ARCHIVER(SLB);
-    #endif
-    #if PHYSFS_SUPPORTS_ISO9660
-        REGISTER_STATIC_ARCHIVER(ISO9660);
-    #endif
-    #if PHYSFS_SUPPORTS_VDF
-        REGISTER_STATIC_ARCHIVER(VDF)
-    #endif
+    /* don't evict anything unless it'll actually be enough. */
+    if ((!force) && (!residentHasRoom(size, accesses)))
+        return 0;
 
-    #undef REGISTER_STATIC_ARCHIVER
+    while ((e != NULL) && (residentStats.used + size > residentStats.budget))
+    {
+        ResidentEntry *hotter = e->hotter;
+        if ((!force) && (e->accesses >= accesses))
+            return 0;  /* everything resident is at least as hot. */
+        else if (e->pins == 0)
+        {
+            residentEvict(e);
+            residentStats.evictions++;
+        } /* else if */
+        e = hotter;
+    } /* while */
 
+    /* pins can go over budget; nothing else can. */
+    return (force || (residentStats.used + size <= residentStats.budget));
+} /* residentMakeRoom */
+
+/* Make (e) resident with (len) bytes in (buf), which it takes over. */
+static int residentPublish(ResidentEntry *e, PHYSFS_uint8 *buf,
+                           const PHYSFS_uint64 len)
+{
+    e->io = __PHYSFS_createMemoryIo(buf, len, allocator.Free);
+    BAIL_IF_ERRPASS(!e->io, 0);
+    e->size = len;
+    residentLinkHeat(e, residentColdest);
+    residentStats.used += e->size;
+    residentStats.files++;
+    residentStats.promotions++;
     return 1;
-} /* initStaticArchivers */
-
-
-static void setDefaultAllocator(void);
-static int doDeinit(void);
+} /* residentPublish */
 
-int PHYSFS_init(const char *argv0)
+/* Read all of (io) into memory and make (e) resident. (io) isn't touched.
+    This reads under stateLock; only PHYSFS_pinFile() uses it. */
+static int residentPromote(ResidentEntry *e, PHYSFS_Io *io, const int force)
 {
-    BAIL_IF(initialized, PHYSFS_ERR_IS_INITIALIZED, 0);
+    PHYSFS_Io *tmp = NULL;
+    PHYSFS_uint8 *buf = NULL;
+    const PHYSFS_sint64 len = io->length(io);
 
-    if (!externalAllocator)
-        setDefaultAllocator();
+    BAIL_IF_ERRPASS(len < 0, 0);
+    BAIL_IF((len > (PHYSFS_sint64) (size_t) len), PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    if ((!force) && ((PHYSFS_uint64) len > residentStats.budget))
+        return 0;
+    else if (!residentMakeRoom((PHYSFS_uint64) len, e->accesses, force))
+        return 0;
 
-    if ((allocator.Init != NULL) && (!allocator.Init())) return 0;
+    buf = (PHYSFS_uint8 *) allocator.Malloc(len ? (size_t) len : 1);
+    GOTO_IF(!buf, PHYSFS_ERR_OUT_OF_MEMORY, residentPromote_failed);
+    tmp = io->duplicate(io);
+    GOTO_IF_ERRPASS(!tmp, residentPromote_failed);
+    GOTO_IF_ERRPASS(!__PHYSFS_readAll(tmp, buf, (size_t) len), residentPromote_failed);
+    tmp->destroy(tmp);
+    tmp = NULL;
 
-    if (!__PHYSFS_platformInit())
-    {
-        if (allocator.Deinit != NULL) allocator.Deinit();
-        return 0;
-    } /* if */
+    GOTO_IF_ERRPASS(!residentPublish(e, buf, (PHYSFS_uint64) len), residentPromote_failed);
+    return 1;
 
-    /* everything below here can be cleaned up safely by doDeinit(). */
+residentPromote_failed:
+    if (tmp != NULL) tmp->destroy(tmp);
+    if (buf != NULL) allocator.Free(buf);
+    return 0;
+} /* residentPromote */
 
-    if (!initializeMutexes()) goto initFailed;
+/* Try the resident tier before asking (dh)'s archiver for (fname). */
+static PHYSFS_Io *residentOpenRead(const DirHandle *dh, const char *fname,
+                                   const PHYSFS_uint32 hash)
+{
+    ResidentEntry *e;
 
-    baseDir = calculateBaseDir(argv0);
-    if (!baseDir) goto initFailed;
+    if (!residentActive())
+        return NULL;
 
-    userDir = __PHYSFS_platformCalcUserDir();
-    if (!userDir) goto initFailed;
+    e = residentFind(dh, fname, hash, 0);
+    if ((e == NULL) || (e->io == NULL))
+        return NULL;
 
-    /* Platform layer is required to append a dirsep. */
-    assert(baseDir[strlen(baseDir) - 1] == __PHYSFS_platformDirSeparator);
-    assert(userDir[strlen(userDir) - 1] == __PHYSFS_platformDirSeparator);
+    e->accesses++;
+    residentWarmed(e);
+    residentStats.hits++;
+    return e->io->duplicate(e->io);
+} /* residentOpenRead */
 
-    if (!initStaticArchivers()) goto initFailed;
+/* (dh)'s archiver opened (fname), whose hash is (hash), as (io). Count it,
+    and maybe claim it for promotion in (p); call residentFinishPromotion()
+    with (p) once you've released stateLock. */
+static void residentNoteOpen(const DirHandle *dh, const char *fname,
+                             const PHYSFS_uint32 hash, PHYSFS_Io *io,
+                             ResidentPromotion *p)
+{
+    ResidentEntry *e;
+    PHYSFS_sint64 len;
 
-    initialized = 1;
+    if (residentStats.budget == 0)
+        return;  /* not counting; pins don't need it. */
 
-    /* This makes sure that the error subsystem is initialized. */
-    PHYSFS_setErrorCode(PHYSFS_getLastErrorCode());
+    residentStats.misses++;
 
-    return 1;
+    if (residentTracked >= RESIDENT_MAX_TRACKED)
+        residentPrune(residentKeepWarm, NULL);
 
-initFailed:
-    doDeinit();
-    return 0;
-} /* PHYSFS_init */
+    e = residentFind(dh, fname, hash, 1);
+    if ((e == NULL) || (e->io != NULL))
+        return;
 
+    e->accesses++;
+    if ((e->accesses < residentPromoteAfter) || (e->promoting != 0))
+        return;  /* not yet, or someone else is on it. */
 
-/* MAKE SURE you hold stateLock before calling this! */
-static int closeFileHandleList(FileHandle **list)
-{
-    FileHandle *i;
-    FileHandle *next = NULL;
+    /* too big or too cold? Don't bother reading it. */
+    len = io->length(io);
+    if ((len < 0) || (!__PHYSFS_ui64FitsAddressSpace((PHYSFS_uint64) len)))
+        return;
+    else if ((PHYSFS_uint64) len > residentStats.budget)
+        return;
+    else if (!residentHasRoom((PHYSFS_uint64) len, e->accesses))
+        return;
 
-    for (i = *list; i != NULL; i = next)
+    p->fname = (char *) allocator.Malloc(strlen(fname) + 1);
+    if (p->fname == NULL)
+        return;  /* no big deal; the archive is fine. */
+    strcpy(p->fname, fname);
+
+    if (++residentTicket == 0)
+        residentTicket++;  /* zero means "not promoting." */
+    e->promoting = p->ticket = residentTicket;
+    p->dirHandle = dh;
+    p->hash = hash;
+    p->len = (PHYSFS_uint64) len;
+} /* residentNoteOpen */
+
+/* Finish what residentNoteOpen() claimed: read the file (fh) just opened
+    into memory, then make it resident if it's still ours to promote.
+    (fh) is on openReadList, so its archive can't go away meanwhile.
+    Call this without holding stateLock. */
+static void residentFinishPromotion(ResidentPromotion *p, PHYSFS_File *_fh)
+{
+    FileHandle *fh = (FileHandle *) _fh;
+    PHYSFS_uint8 *buf = NULL;
+    PHYSFS_Io *dup = NULL;
+    ResidentEntry *e;
+
+    if (p->ticket == 0)
+        return;
+
+    if (fh != NULL)  /* read a duplicate, so (fh) stays at the start. */
     {
-        PHYSFS_Io *io = i->io;
-        next = i->next;
+        PHYSFS_Io *tmp = fh->io->duplicate(fh->io);
+        if (tmp != NULL)
+        {
+            buf = (PHYSFS_uint8 *) allocator.Malloc(p->len ? (size_t) p->len : 1);
+            if ((buf != NULL) && (!__PHYSFS_readAll(tmp, buf, (size_t) p->len)))
+            {
+                allocator.Free(buf);
+                buf = NULL;
+            } /* if */
+            tmp->destroy(tmp);
+        } /* if */
+    } /* if */
 
-        if (io->flush && !io->flush(io))
+    __PHYSFS_platformGrabMutex(stateLock);
+    e = residentFind(p->dirHandle, p->fname, p->hash, 0);
+    if ((e != NULL) && (e->promoting == p->ticket))
+    {
+        e->promoting = 0;
+        if ((buf != NULL) && (e->io == NULL) &&
+            (residentMakeRoom(p->len, e->accesses, 0)) &&
+            (residentPublish(e, buf, p->len)))
         {
-            *list = i;
-            return 0;
+            buf = NULL;  /* (e->io) owns it now. */
+            dup = e->io->duplicate(e->io);
         } /* if */
+    } /* if */
+    __PHYSFS_platformReleaseMutex(stateLock);
 
-        io->destroy(io);
-        allocator.Free(i);
-    } /* for */
+    if (buf != NULL)
+        allocator.Free(buf);
 
-    *list = NULL;
-    return 1;
-} /* closeFileHandleList */
+    if (dup != NULL)  /* hand (fh) the memory copy, too. */
+    {
+        fh->io->destroy(fh->io);
+        fh->io = dup;
+    } /* if */
 
+    allocator.Free(p->fname);
+    p->fname = NULL;
+    p->ticket = 0;
+} /* residentFinishPromotion */
 
-/* MAKE SURE you hold the stateLock before calling this! */
-static void freeSearchPath(void)
+/* Forget anything resident under this path, from any mount. */
+static void residentForget(const char *_fname)
 {
-    DirHandle *i;
-    DirHandle *next = NULL;
+    char *fname;
 
-    closeFileHandleList(&openReadList);
+    if (residentTracked == 0)
+        return;
 
-    if (searchPath != NULL)
+    fname = (char *) __PHYSFS_smallAlloc(strlen(_fname) + 1);
+    if (fname == NULL)  /* can't match names; forget everything instead. */
+        residentPrune(NULL, NULL);
+    else
     {
-        for (i = searchPath; i != NULL; i = next)
-        {
-            next = i->next;
-            freeDirHandle(i, openReadList);
-        } /* for */
-        searchPath = NULL;
-    } /* if */
-} /* freeSearchPath */
+        if (sanitizePlatformIndependentPath(_fname, fname))
+            residentPrune(residentKeepOtherName, fname);
+        __PHYSFS_smallFree(fname);
+    } /* else */
+} /* residentForget */
 
 
-/* MAKE SURE you hold stateLock before calling this! */
-static int archiverInUse(const PHYSFS_Archiver *arc, const DirHandle *list)
+/* the CRC-32 that zlib and .zip files use; filled in by PHYSFS_init(). */
+static PHYSFS_uint32 crcTable[256];
+
+static void initCrcTable(void)
 {
-    const DirHandle *i;
-    for (i = list; i != NULL; i = i->next)
+    PHYSFS_uint32 i;
+    for (i = 0; i < 256; i++)
     {
-        if (i->funcs == arc)
-            return 1;
+        PHYSFS_uint32 crc = i;
+        int j;
+        for (j = 0; j < 8; j++)
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+        crcTable[i] = crc;
     } /* for */
+} /* initCrcTable */
 
-    return 0;  /* not in use */
-} /* archiverInUse */
 
-
-/* MAKE SURE you hold stateLock before calling this! */
-static int doDeregisterArchiver(const size_t idx)
+PHYSFS_uint32 __PHYSFS_crc32(PHYSFS_uint32 crc, const void *_buf, size_t len)
 {
-    const size_t len = (numArchivers - idx) * sizeof (void *);
-    PHYSFS_ArchiveInfo *info = archiveInfo[idx];
-    PHYSFS_Archiver *arc = archivers[idx];
+    const PHYSFS_uint8 *buf = (const PHYSFS_uint8 *) _buf;
+    crc ^= 0xFFFFFFFF;
+    while (len--)
+        crc = crcTable[(crc ^ *(buf++)) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFF;
+} /* __PHYSFS_crc32 */
 
-    /* make sure nothing is still using this archiver */
-    if (archiverInUse(arc, searchPath) || archiverInUse(arc, writeDir))
-        BAIL(PHYSFS_ERR_FILES_STILL_OPEN, 0);
 
-    allocator.Free((void *) info->extension);
-    allocator.Free((void *) info->description);
-    allocator.Free((void *) info->author);
-    allocator.Free((void *) info->url);
-    allocator.Free((void *) arc);
+/*
+ * The extraction cache: archivers that decompress can keep the result in a
+ *  directory on disk, one file per entry, named by a key that identifies
+ *  the contents, so the next open (in this process or any later one) reads
+ *  the file natively instead of decompressing again. Files are published
+ *  atomically, so processes sharing the directory never see partial ones.
+ *
+ * We scan the directory once, when it's set, and after that keep track of
+ *  the files in memory, in least-recently-used order, with a running total
+ *  of their sizes; a hit moves a file to the end (and bumps its modification
+ *  time, for the next process's scan), and the oldest files are deleted when
+ *  a new one doesn't fit the budget. Files other processes add later are
+ *  picked up when we hit them. Deleting a file someone else has open is fine
+ *  on POSIX and fails harmlessly on Windows.
+ *
+ * A file we didn't write ourselves is read once and checked against the
+ *  entry's CRC before we trust it. The decompressing and checking happen on
+ *  the first read from the i/o, not in openRead(), so they don't hold up
+ *  every other thread.
+ *
+ * The bookkeeping is protected by stateLock.
+ */
 
-    memmove(&archiveInfo[idx], &archiveInfo[idx+1], len);
-    memmove(&archivers[idx], &archivers[idx+1], len);
+static char *extractCacheDir = NULL;  /* with a trailing separator. */
+static PHYSFS_uint64 extractCacheBudget = 0;
+static PHYSFS_uint64 extractCacheTotal = 0;
 
-    assert(numArchivers > 0);
-    numArchivers--;
+typedef struct
+{
+    PHYSFS_uint64 key;
+    PHYSFS_uint64 size;
+    PHYSFS_sint64 modtime;  /* only used while scanning. */
+    int verified;  /* contents known to match the CRC? */
+} ExtractCacheFile;
 
-    return 1;
-} /* doDeregisterArchiver */
+static ExtractCacheFile *extractCacheFiles = NULL;  /* oldest first. */
+static size_t extractCacheCount = 0;
+static size_t extractCacheRoom = 0;
 
+static char *extractCachePath(const char *dir, const PHYSFS_uint64 key)
+{
+    const size_t len = strlen(dir) + 24;
+    char *retval = (char *) allocator.Malloc(len);
+    BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    snprintf(retval, len, "%s%08x%08x.xc", dir,
+             (unsigned int) ((key >> 32) & 0xFFFFFFFF),
+             (unsigned int) (key & 0xFFFFFFFF));
+    return retval;
+} /* extractCachePath */
 
-/* Does NOT hold the state lock; we're shutting down. */
-static void freeArchivers(void)
+/* Parse the key back out of a name extractCachePath() made. */
+static int extractCacheParseName(const char *fname, PHYSFS_uint64 *key)
 {
-    while (numArchivers > 0)
+    PHYSFS_uint64 val = 0;
+    int i;
+
+    if ((strlen(fname) != 19) || (strcmp(fname + 16, ".xc") != 0))
+        return 0;  /* not ours, or a file still being written. */
+
+    for (i = 0; i < 16; i++)
     {
-        if (!doDeregisterArchiver(numArchivers - 1))
-            assert(!"nothing should be mounted during shutdown.");
-    } /* while */
+        const char ch = fname[i];
+        val <<= 4;
+        if ((ch >= '0') && (ch <= '9'))
+            val |= (PHYSFS_uint64) (ch - '0');
+        else if ((ch >= 'a') && (ch <= 'f'))
+            val |= (PHYSFS_uint64) (ch - 'a' + 10);
+        else
+            return 0;
+    } /* for */
 
-    allocator.Free(archivers);
-    allocator.Free(archiveInfo);
-    archivers = NULL;
-    archiveInfo = NULL;
-} /* freeArchivers */
+    *key = val;
+    return 1;
+} /* extractCacheParseName */
 
+static ExtractCacheFile *extractCacheFind(const PHYSFS_uint64 key)
+{
+    size_t i;
+    for (i = 0; i < extractCacheCount; i++)
+    {
+        if (extractCacheFiles[i].key == key)
+            return &extractCacheFiles[i];
+    } /* for */
+    return NULL;
+} /* extractCacheFind */
 
-static int doDeinit(void)
+static void extractCacheForget(ExtractCacheFile *f)
 {
-    closeFileHandleList(&openWriteList);
-    BAIL_IF(!PHYSFS_setWriteDir(NULL), PHYSFS_ERR_FILES_STILL_OPEN, 0);
+    const size_t idx = (size_t) (f - extractCacheFiles);
+    extractCacheTotal -= f->size;
+    extractCacheCount--;
+    memmove(f, f + 1, (extractCacheCount - idx) * sizeof (ExtractCacheFile));
+} /* extractCacheForget */
 
-    freeSearchPath();
-    freeArchivers();
-    freeErrorStates();
+/* Move (f) to the most recently used end of the list; returns its new spot. */
+static ExtractCacheFile *extractCacheUsed(ExtractCacheFile *f)
+{
+    ExtractCacheFile tmp;
+    const size_t idx = (size_t) (f - extractCacheFiles);
+    memcpy(&tmp, f, sizeof (tmp));
+    memmove(f, f + 1, (extractCacheCount - idx - 1) * sizeof (ExtractCacheFile));
+    f = &extractCacheFiles[extractCacheCount - 1];
+    memcpy(f, &tmp, sizeof (tmp));
+    return f;
+} /* extractCacheUsed */
 
-    if (baseDir != NULL)
-    {
-        allocator.Free(baseDir);
-        baseDir = NULL;
-    } /* if */
+/* Append a file as the most recently used. Doesn't check the budget. */
+static ExtractCacheFile *extractCacheAdd(const PHYSFS_uint64 key,
+                                         const PHYSFS_uint64 size)
+{
+    ExtractCacheFile *f;
 
-    if (userDir != NULL)
+    if (extractCacheCount == extractCacheRoom)
     {
-        allocator.Free(userDir);
-        userDir = NULL;
+        const size_t room = extractCacheRoom ? extractCacheRoom * 2 : 64;
+        void *ptr = allocator.Realloc(extractCacheFiles,
+                                      room * sizeof (ExtractCacheFile));
+        BAIL_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        extractCacheFiles = (ExtractCacheFile *) ptr;
+        extractCacheRoom = room;
     } /* if */
 
-    if (prefDir != NULL)
+    f = &extractCacheFiles[extractCacheCount++];
+    f->key = key;
+    f->size = size;
+    f->modtime = 0;
+    f->verified = 0;
+    extractCacheTotal += size;
+    return f;
+} /* extractCacheAdd */
+
+static void extractCacheClear(void)
+{
+    if (extractCacheFiles != NULL)
+        allocator.Free(extractCacheFiles);
+    extractCacheFiles = NULL;
+    extractCacheCount = extractCacheRoom = 0;
+    extractCacheTotal = 0;
+} /* extractCacheClear */
+
+static PHYSFS_EnumerateCallbackResult extractCacheScanFile(void *data,
+                                        const char *origdir, const char *fname)
+{
+    ExtractCacheFile *f;
+    PHYSFS_uint64 key;
+    PHYSFS_Stat st;
+    char *path;
+
+    if (!extractCacheParseName(fname, &key))
+        return PHYSFS_ENUM_OK;
+
+    path = extractCachePath(origdir, key);
+    BAIL_IF_ERRPASS(!path, PHYSFS_ENUM_ERROR);
+    if ( (!__PHYSFS_platformStat(path, &st, 0)) ||
+         (st.filetype != PHYSFS_FILETYPE_REGULAR) )
     {
-        allocator.Free(prefDir);
-        prefDir = NULL;
+        allocator.Free(path);  /* someone else evicted it? Fine. */
+        return PHYSFS_ENUM_OK;
     } /* if */
+    allocator.Free(path);
 
-    if (archiveInfo != NULL)
-    {
-        allocator.Free(archiveInfo);
-        archiveInfo = NULL;
-    } /* if */
+    f = extractCacheAdd(key, (st.filesize > 0) ? (PHYSFS_uint64) st.filesize : 0);
+    BAIL_IF_ERRPASS(!f, PHYSFS_ENUM_ERROR);
+    f->modtime = st.modtime;
+    return PHYSFS_ENUM_OK;
+} /* extractCacheScanFile */
 
-    if (archivers != NULL)
-    {
-        allocator.Free(archivers);
-        archivers = NULL;
-    } /* if */
+static int extractCacheCmp(void *_a, size_t one, size_t two)
+{
+    const ExtractCacheFile *a = ((const ExtractCacheFile *) _a) + one;
+    const ExtractCacheFile *b = ((const ExtractCacheFile *) _a) + two;
+    return (a->modtime < b->modtime) ? -1 : (a->modtime > b->modtime) ? 1 : 0;
+} /* extractCacheCmp */
 
-    longest_root = 0;
-    allowSymLinks = 0;
-    initialized = 0;
+static void extractCacheSwap(void *_a, size_t one, size_t two)
+{
+    ExtractCacheFile *a = (ExtractCacheFile *) _a;
+    ExtractCacheFile tmp;
+    memcpy(&tmp, &a[one], sizeof (tmp));
+    memcpy(&a[one], &a[two], sizeof (tmp));
+    memcpy(&a[two], &tmp, sizeof (tmp));
+} /* extractCacheSwap */
 
-    if (errorLock) __PHYSFS_platformDestroyMutex(errorLock);
-    if (stateLock) __PHYSFS_platformDestroyMutex(stateLock);
+/* Rebuild the list from what's in the directory now. */
+static void extractCacheScan(void)
+{
+    extractCacheClear();
+    __PHYSFS_platformEnumerate(extractCacheDir, extractCacheScanFile,
+                               extractCacheDir, NULL);
+    __PHYSFS_sort(extractCacheFiles, extractCacheCount,
+                  extractCacheCmp, extractCacheSwap);
+} /* extractCacheScan */
 
-    if (allocator.Deinit != NULL)
-        allocator.Deinit();
+/* Delete the least recently used files until (size) more bytes fit. */
+static void extractCacheMakeRoom(const PHYSFS_uint64 size)
+{
+    size_t i;
 
-    errorLock = stateLock = NULL;
+    for (i = 0; i < extractCacheCount; i++)
+    {
+        const ExtractCacheFile *f = &extractCacheFiles[i];
+        char *path;
 
-    __PHYSFS_platformDeinit();
+        if (extractCacheTotal + size <= extractCacheBudget)
+            break;
 
-    return 1;
-} /* doDeinit */
+        /* if this fails, it's gone already or in use; stop counting it. */
+        path = extractCachePath(extractCacheDir, f->key);
+        if (path != NULL)
+        {
+            (void) __PHYSFS_platformDelete(path);
+            allocator.Free(path);
+        } /* if */
+        extractCacheTotal -= f->size;
+    } /* for */
 
+    if (i > 0)  /* (extractCacheFiles is still NULL if nothing's cached.) */
+    {
+        extractCacheCount -= i;
+        memmove(extractCacheFiles, extractCacheFiles + i,
+                extractCacheCount * sizeof (ExtractCacheFile));
+    } /* if */
+} /* extractCacheMakeRoom */
 
-int PHYSFS_deinit(void)
-{
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
-    return doDeinit();
-} /* PHYSFS_deinit */
 
+/* PHYSFS_Io implementation that settles on a cached copy at first read... */
 
-int PHYSFS_isInit(void)
+typedef struct
 {
-    return initialized;
-} /* PHYSFS_isInit */
-
+    PHYSFS_Io *io;  /* the decompressing i/o, until we've settled. */
+    char *path;  /* NULL once we've settled. */
+    PHYSFS_uint64 key;
+    PHYSFS_uint64 len;
+    PHYSFS_uint32 crc;
+} ExtractCacheIoInfo;
 
-char *__PHYSFS_strdup(const char *str)
+/* Is (path) still in the cache directory, if there still is one? */
+static int extractCacheStillUsing(const char *path)
 {
-    char *retval = (char *) allocator.Malloc(strlen(str) + 1);
-    if (retval)
-        strcpy(retval, str);
-    return retval;
-} /* __PHYSFS_strdup */
+    const size_t len = extractCacheDir ? strlen(extractCacheDir) : 0;
+    return (len > 0) && (strncmp(path, extractCacheDir, len) == 0);
+} /* extractCacheStillUsing */
 
-
-PHYSFS_uint32 __PHYSFS_hashString(const char *str, size_t len)
+static PHYSFS_uint32 extractCacheCrcIo(PHYSFS_Io *io, int *okay)
 {
-    PHYSFS_uint32 hash = 5381;
-    while (len--)
-        hash = ((hash << 5) + hash) ^ *(str++);
-    return hash;
-} /* __PHYSFS_hashString */
+    PHYSFS_uint8 buf[4096];
+    PHYSFS_uint32 crc = 0;
+    PHYSFS_sint64 br;
 
+    while ((br = io->read(io, buf, sizeof (buf))) > 0)
+        crc = __PHYSFS_crc32(crc, buf, (size_t) br);
 
-/* MAKE SURE you hold stateLock before calling this! */
-static int doRegisterArchiver(const PHYSFS_Archiver *_archiver)
+    *okay = ((br == 0) && (io->seek(io, 0)));
+    return crc;
+} /* extractCacheCrcIo */
+
+/* Try to use a copy already on disk. Returns NULL if there's no good one. */
+static PHYSFS_Io *extractCacheIoTryHit(ExtractCacheIoInfo *info)
 {
-    const PHYSFS_uint32 maxver = CURRENT_PHYSFS_ARCHIVER_API_VERSION;
-    const size_t len = (numArchivers + 2) * sizeof (void *);
-    PHYSFS_Archiver *archiver = NULL;
-    PHYSFS_ArchiveInfo *info = NULL;
-    const char *ext = NULL;
-    void *ptr = NULL;
-    size_t i;
+    PHYSFS_Io *io = NULL;
+    ExtractCacheFile *f;
+    int verified = 0;
+    int okay = 0;
 
-    BAIL_IF(!_archiver, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(_archiver->version > maxver, PHYSFS_ERR_UNSUPPORTED, 0);
-    BAIL_IF(!_archiver->info.extension, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->info.description, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->info.author, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->info.url, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->openArchive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->enumerate, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->openRead, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->openWrite, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->openAppend, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->remove, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->mkdir, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->closeArchive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->stat, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    __PHYSFS_platformGrabMutex(stateLock);
+    f = extractCacheStillUsing(info->path) ? extractCacheFind(info->key) : NULL;
+    verified = ((f != NULL) && (f->size == info->len) && (f->verified));
+    __PHYSFS_platformReleaseMutex(stateLock);
 
-    ext = _archiver->info.extension;
-    for (i = 0; i < numArchivers; i++)
+    io = createNativeIo(info->path, 'r', 1);  /* pinned: we may delete it. */
+    if (io == NULL)
+        okay = 0;  /* not there, or someone just evicted it. */
+    else if (io->length(io) != (PHYSFS_sint64) info->len)
+        okay = 0;
+    else if (verified)
+        okay = 1;
+    else
     {
-        if (PHYSFS_utf8stricmp(archiveInfo[i]->extension, ext) == 0)
-            BAIL(PHYSFS_ERR_DUPLICATE, 0);
-    } /* for */
-
-    /* make a copy of the data. */
-    archiver = (PHYSFS_Archiver *) allocator.Malloc(sizeof (*archiver));
-    GOTO_IF(!archiver, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
-
-    /* Must copy sizeof (OLD_VERSION_OF_STRUCT) when version changes! */
-    memcpy(archiver, _archiver, sizeof (*archiver));
-
-    info = (PHYSFS_ArchiveInfo *) &archiver->info;
-    memset(info, '\0', sizeof (*info));  /* NULL in case an alloc fails. */
-    #define CPYSTR(item) \
-        info->item = __PHYSFS_strdup(_archiver->info.item); \
-        GOTO_IF(!info->item, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
-    CPYSTR(extension);
-    CPYSTR(description);
-    CPYSTR(author);
-    CPYSTR(url);
-    info->supportsSymlinks = _archiver->info.supportsSymlinks;
-    #undef CPYSTR
-
-    ptr = allocator.Realloc(archiveInfo, len);
-    GOTO_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
-    archiveInfo = (PHYSFS_ArchiveInfo **) ptr;
+        const PHYSFS_uint32 crc = extractCacheCrcIo(io, &okay);
+        okay = okay && (crc == info->crc);
+    } /* else */
 
-    ptr = allocator.Realloc(archivers, len);
-    GOTO_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
-    archivers = (PHYSFS_Archiver **) ptr;
+    __PHYSFS_platformGrabMutex(stateLock);
+    f = extractCacheStillUsing(info->path) ? extractCacheFind(info->key) : NULL;
+    if (f != NULL)
+    {
+        if (okay && (f->size == info->len))
+            extractCacheUsed(f)->verified = 1;
+        else if (!okay)
+            extractCacheForget(f);
+    } /* if */
+    else if (okay && extractCacheStillUsing(info->path))
+    {
+        f = extractCacheAdd(info->key, info->len);  /* another process's. */
+        if (f != NULL)
+            f->verified = 1;
+    } /* else if */
+    __PHYSFS_platformReleaseMutex(stateLock);
 
-    archiveInfo[numArchivers] = info;
-    archiveInfo[numArchivers + 1] = NULL;
+    if (okay)
+        (void) __PHYSFS_platformTouch(info->path);  /* for the next scan. */
+    else if (io != NULL)
+    {
+        io->destroy(io);
+        io = NULL;
+        if (!verified)  /* bad copy? Get it out of everyone's way. */
+            (void) __PHYSFS_platformDelete(info->path);
+    } /* else if */
 
-    archivers[numArchivers] = archiver;
-    archivers[numArchivers + 1] = NULL;
+    return io;
+} /* extractCacheIoTryHit */
 
-    numArchivers++;
+/* Decompress the whole thing and publish it. Returns NULL on failure. */
+static PHYSFS_Io *extractCacheIoFill(ExtractCacheIoInfo *info)
+{
+    PHYSFS_Io *retval = NULL;
+    PHYSFS_uint8 *buf;
+    int reserved = 0;
 
-    return 1;
+    BAIL_IF(!__PHYSFS_ui64FitsAddressSpace(info->len), PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    buf = (PHYSFS_uint8 *) allocator.Malloc(info->len ? (size_t) info->len : 1);
+    BAIL_IF(!buf, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    if (!__PHYSFS_readAll(info->io, buf, (size_t) info->len))
+    {
+        allocator.Free(buf);
+        return NULL;
+    } /* if */
 
-regfailed:
-    if (info != NULL)
+    /* only publish what matches the archive's CRC. */
+    if (__PHYSFS_crc32(0, buf, (size_t) info->len) == info->crc)
     {
-        allocator.Free((void *) info->extension);
-        allocator.Free((void *) info->description);
-        allocator.Free((void *) info->author);
-        allocator.Free((void *) info->url);
+        __PHYSFS_platformGrabMutex(stateLock);
+        if ((extractCacheStillUsing(info->path)) && (!extractCacheFind(info->key)))
+        {
+            extractCacheMakeRoom(info->len);
+            reserved = (extractCacheAdd(info->key, info->len) != NULL);
+        } /* if */
+        __PHYSFS_platformReleaseMutex(stateLock);
     } /* if */
-    allocator.Free(archiver);
 
-    return 0;
-} /* doRegisterArchiver */
+    if (reserved)
+    {
+        if (__PHYSFS_platformPublishFile(info->path, buf, info->len))
+            retval = createNativeIo(info->path, 'r', 1);
+
+        __PHYSFS_platformGrabMutex(stateLock);
+        if (extractCacheStillUsing(info->path))
+        {
+            ExtractCacheFile *f = extractCacheFind(info->key);
+            if (f == NULL)
+                ;  /* evicted already?! */
+            else if (retval != NULL)
+                f->verified = 1;
+            else
+                extractCacheForget(f);
+        } /* if */
+        __PHYSFS_platformReleaseMutex(stateLock);
+    } /* if */
 
+    if (retval != NULL)
+        allocator.Free(buf);
+    else  /* couldn't cache it, but we've got it right here anyhow. */
+    {
+        retval = __PHYSFS_createMemoryIo(buf, info->len, allocator.Free);
+        if (retval == NULL)
+            allocator.Free(buf);
+    } /* else */
 
-int PHYSFS_registerArchiver(const PHYSFS_Archiver *archiver)
-{
-    int retval;
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
-    __PHYSFS_platformGrabMutex(stateLock);
-    retval = doRegisterArchiver(archiver);
-    __PHYSFS_platformReleaseMutex(stateLock);
     return retval;
-} /* PHYSFS_registerArchiver */
-
+} /* extractCacheIoFill */
 
-int PHYSFS_deregisterArchiver(const char *ext)
+static int extractCacheIoSettle(ExtractCacheIoInfo *info)
 {
-    size_t i;
+    PHYSFS_Io *io;
 
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
-    BAIL_IF(!ext, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    if (info->path == NULL)
+        return 1;  /* already did. */
 
-    __PHYSFS_platformGrabMutex(stateLock);
-    for (i = 0; i < numArchivers; i++)
+    io = extractCacheIoTryHit(info);
+    if (io == NULL)
+        io = extractCacheIoFill(info);
+
+    if (io != NULL)
+        info->io->destroy(info->io);
+    else  /* can't cache it at all; just read it the slow way. */
     {
-        if (PHYSFS_utf8stricmp(archiveInfo[i]->extension, ext) == 0)
-        {
-            const int retval = doDeregisterArchiver(i);
-            __PHYSFS_platformReleaseMutex(stateLock);
-            return retval;
-        } /* if */
-    } /* for */
-    __PHYSFS_platformReleaseMutex(stateLock);
+        BAIL_IF_ERRPASS(!info->io->seek(info->io, 0), 0);
+        io = info->io;
+    } /* else */
 
-    BAIL(PHYSFS_ERR_NOT_FOUND, 0);
-} /* PHYSFS_deregisterArchiver */
+    info->io = io;
+    allocator.Free(info->path);
+    info->path = NULL;
+    return 1;
+} /* extractCacheIoSettle */
 
+static PHYSFS_sint64 extractCacheIo_read(PHYSFS_Io *io, void *buf,
+                                         PHYSFS_uint64 len)
+{
+    ExtractCacheIoInfo *info = (ExtractCacheIoInfo *) io->opaque;
+    BAIL_IF_ERRPASS(!extractCacheIoSettle(info), -1);
+    return info->io->read(info->io, buf, len);
+} /* extractCacheIo_read */
 
-const PHYSFS_ArchiveInfo **PHYSFS_supportedArchiveTypes(void)
+static PHYSFS_sint64 extractCacheIo_write(PHYSFS_Io *io, const void *buffer,
+                                          PHYSFS_uint64 len)
 {
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, NULL);
-    return (const PHYSFS_ArchiveInfo **) archiveInfo;
-} /* PHYSFS_supportedArchiveTypes */
+    BAIL(PHYSFS_ERR_OPEN_FOR_READING, -1);
+} /* extractCacheIo_write */
 
+static int extractCacheIo_seek(PHYSFS_Io *io, PHYSFS_uint64 offset)
+{
+    ExtractCacheIoInfo *info = (ExtractCacheIoInfo *) io->opaque;
+    BAIL_IF_ERRPASS(!extractCacheIoSettle(info), 0);
+    return info->io->seek(info->io, offset);
+} /* extractCacheIo_seek */
 
-void PHYSFS_freeList(void *list)
+static PHYSFS_sint64 extractCacheIo_tell(PHYSFS_Io *io)
 {
-    void **i;
-    if (list != NULL)
-    {
-        for (i = (void **) list; *i != NULL; i++)
-            allocator.Free(*i);
-
-        allocator.Free(list);
-    } /* if */
-} /* PHYSFS_freeList */
-
+    ExtractCacheIoInfo *info = (ExtractCacheIoInfo *) io->opaque;
+    return info->io->tell(info->io);
+} /* extractCacheIo_tell */
 
-const char *PHYSFS_getDirSeparator(void)
+static PHYSFS_sint64 extractCacheIo_length(PHYSFS_Io *io)
 {
-    static char retval[2] = { __PHYSFS_platformDirSeparator, '\0' };
-    return retval;
-} /* PHYSFS_getDirSeparator */
-
+    ExtractCacheIoInfo *info = (ExtractCacheIoInfo *) io->opaque;
+    return (PHYSFS_sint64) info->len;
+} /* extractCacheIo_length */
 
-char **PHYSFS_getCdRomDirs(void)
+static PHYSFS_Io *extractCacheIo_duplicate(PHYSFS_Io *io)
 {
-    return doEnumStringList(__PHYSFS_platformDetectAvailableCDs);
-} /* PHYSFS_getCdRomDirs */
+    ExtractCacheIoInfo *info = (ExtractCacheIoInfo *) io->opaque;
+    BAIL_IF_ERRPASS(!extractCacheIoSettle(info), NULL);
+    return info->io->duplicate(info->io);
+} /* extractCacheIo_duplicate */
 
+static int extractCacheIo_flush(PHYSFS_Io *io) { return 1;  /* it's read-only. */ }
 
-void PHYSFS_getCdRomDirsCallback(PHYSFS_StringCallback callback, void *data)
+static void extractCacheIo_destroy(PHYSFS_Io *io)
 {
-    __PHYSFS_platformDetectAvailableCDs(callback, data);
-} /* PHYSFS_getCdRomDirsCallback */
-
+    ExtractCacheIoInfo *info = (ExtractCacheIoInfo *) io->opaque;
+    info->io->destroy(info->io);
+    if (info->path != NULL)
+        allocator.Free(info->path);
+    allocator.Free(info);
+    allocator.Free(io);
+} /* extractCacheIo_destroy */
 
-const char *PHYSFS_getPrefDir(const char *org, const char *app)
+static const PHYSFS_Io __PHYSFS_extractCacheIoInterface =
 {
-    const char dirsep = __PHYSFS_platformDirSeparator;
-    PHYSFS_Stat statbuf;
-    char *ptr = NULL;
-    char *endstr = NULL;
+    CURRENT_PHYSFS_IO_API_VERSION, NULL,
+    extractCacheIo_read,
+    extractCacheIo_write,
+    extractCacheIo_seek,
+    extractCacheIo_tell,
+    extractCacheIo_length,
+    extractCacheIo_duplicate,
+    extractCacheIo_flush,
+    extractCacheIo_destroy
+};
 
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
-    BAIL_IF(!org, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
-    BAIL_IF(*org == '\0', PHYSFS_ERR_INVALID_ARGUMENT, NULL);
-    BAIL_IF(!app, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
-    BAIL_IF(*app == '\0', PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+PHYSFS_Io *__PHYSFS_extractCacheWrap(const PHYSFS_uint64 key,
+                                     const PHYSFS_uint32 crc,
+                                     PHYSFS_Io *io, const PHYSFS_uint64 len)
+{
+    ExtractCacheIoInfo *info;
+    PHYSFS_Io *retval;
+    char *path;
 
-    allocator.Free(prefDir);
-    prefDir = __PHYSFS_platformCalcPrefDir(org, app);
-    BAIL_IF_ERRPASS(!prefDir, NULL);
+    /* leave room for plenty of others; one huge file shouldn't flush them. */
+    if ((extractCacheDir == NULL) || (len > extractCacheBudget / 4))
+        return io;
+    else if (!__PHYSFS_ui64FitsAddressSpace(len))
+        return io;
 
-    assert(strlen(prefDir) > 0);
-    endstr = prefDir + (strlen(prefDir) - 1);
-    assert(*endstr == dirsep);
-    *endstr = '\0';  /* mask out the final dirsep for now. */
+    path = extractCachePath(extractCacheDir, key);
+    if (path == NULL)
+        return io;
 
-    if (!__PHYSFS_platformStat(prefDir, &statbuf, 1))
+    retval = (PHYSFS_Io *) allocator.Malloc(sizeof (PHYSFS_Io));
+    info = (ExtractCacheIoInfo *) allocator.Malloc(sizeof (ExtractCacheIoInfo));
+    if ((!retval) || (!info))
     {
-        for (ptr = strchr(prefDir, dirsep); ptr; ptr = strchr(ptr+1, dirsep))
-        {
-            *ptr = '\0';
-            __PHYSFS_platformMkDir(prefDir);
-            *ptr = dirsep;
-        } /* for */
-
-        if (!__PHYSFS_platformMkDir(prefDir))
-        {
-            allocator.Free(prefDir);
-            prefDir = NULL;
-        } /* if */
+        if (retval) allocator.Free(retval);
+        if (info) allocator.Free(info);
+        allocator.Free(path);
+        return io;
     } /* if */
 
-    *endstr = dirsep;  /* readd the final dirsep. */
-
-    return prefDir;
-} /* PHYSFS_getPrefDir */
+    info->io = io;
+    info->path = path;
+    info->key = key;
+    info->len = len;
+    info->crc = crc;
+    memcpy(retval, &__PHYSFS_extractCacheIoInterface, sizeof (*retval));
+    retval->opaque = info;
+    return retval;
+} /* __PHYSFS_extractCacheWrap */
 
 
-const char *PHYSFS_getBaseDir(void)
+/* MAKE SURE you've got the stateLock held before calling this! */
+static int freeDirHandle(DirHandle *dh, FileHandle *openList)
 {
-    return baseDir;   /* this is calculated in PHYSFS_init()... */
-} /* PHYSFS_getBaseDir */
+    FileHandle *i;
 
+    if (dh == NULL)
+        return 1;
 
-const char *__PHYSFS_getUserDir(void)  /* not deprecated internal version. */
-{
-    return userDir;   /* this is calculated in PHYSFS_init()... */
-} /* __PHYSFS_getUserDir */
+    for (i = openList; i != NULL; i = i->next)
+        BAIL_IF(i->dirHandle == dh, PHYSFS_ERR_FILES_STILL_OPEN, 0);
 
+    if (residentTracked > 0)
+        residentPrune(residentKeepOtherDir, dh);
 
-const char *PHYSFS_getUserDir(void)
-{
-    return __PHYSFS_getUserDir();
-} /* PHYSFS_getUserDir */
+    dh->funcs->closeArchive(dh->opaque);
+    allocator.Free(dh->dirName);
+    allocator.Free(dh->mountPoint);
+    allocator.Free(dh);
+    return 1;
+} /* freeDirHandle */
 
 
-const char *PHYSFS_getWriteDir(void)
+static char *calculateBaseDir(const char *argv0)
 {
-    const char *retval = NULL;
+    const char dirsep = __PHYSFS_platformDirSeparator;
+    char *retval = NULL;
+    char *ptr = NULL;
 
-    __PHYSFS_platformGrabMutex(stateLock);
-    if (writeDir != NULL)
-        retval = writeDir->dirName;
-    __PHYSFS_platformReleaseMutex(stateLock);
+    /* Give the platform layer first shot at this. */
+    retval = __PHYSFS_platformCalcBaseDir(argv0);
+    if (retval != NULL)
+        return retval;
 
-    return retval;
-} /* PHYSFS_getWriteDir */
+    /* We need argv0 to go on. */
+    BAIL_IF(argv0 == NULL, PHYSFS_ERR_ARGV0_IS_NULL, NULL);
 
+    ptr = strrchr(argv0, dirsep);
+    if (ptr != NULL)
+    {
+        const size_t size = ((size_t) (ptr - argv0)) + 1;
+        retval = (char *) allocator.Malloc(size + 1);
+        BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        memcpy(retval, argv0, size);
+        retval[size] = '\0';
+        return retval;
+    } /* if */
 
-int PHYSFS_setWriteDir(const char *newDir)
-{
-    int retval = 1;
+    /* argv0 wasn't helpful. */
+    BAIL(PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+} /* calculateBaseDir */
 
-    __PHYSFS_platformGrabMutex(stateLock);
 
-    if (writeDir != NULL)
-    {
-        BAIL_IF_MUTEX_ERRPASS(!freeDirHandle(writeDir, openWriteList),
-                            stateLock, 0);
-        writeDir = NULL;
-    } /* if */
+static int initializeMutexes(void)
+{
+    errorLock = __PHYSFS_platformCreateMutex();
+    if (errorLock == NULL)
+        goto initializeMutexes_failed;
 
-    if (newDir != NULL)
-    {
-        writeDir = createDirHandle(NULL, newDir, NULL, 1);
-        retval = (writeDir != NULL);
-    } /* if */
+    stateLock = __PHYSFS_platformCreateMutex();
+    if (stateLock == NULL)
+        goto initializeMutexes_failed;
 
-    __PHYSFS_platformReleaseMutex(stateLock);
+    nativeFdLock = __PHYSFS_platformCreateMutex();
+    if (nativeFdLock == NULL)
+        goto initializeMutexes_failed;
 
-    return retval;
-} /* PHYSFS_setWriteDir */
+    return 1;  /* success. */
 
+initializeMutexes_failed:
+    if (errorLock != NULL)
+        __PHYSFS_platformDestroyMutex(errorLock);
 
-int PHYSFS_setRoot(const char *archive, const char *subdir)
-{
-    DirHandle *i;
+    if (stateLock != NULL)
+        __PHYSFS_platformDestroyMutex(stateLock);
 
-    BAIL_IF(!archive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    errorLock = stateLock = nativeFdLock = NULL;
+    return 0;  /* failed. */
+} /* initializeMutexes */
 
-    __PHYSFS_platformGrabMutex(stateLock);
 
-    for (i = searchPath; i != NULL; i = i->next)
-    {
-        if ((i->dirName != NULL) && (strcmp(archive, i->dirName) == 0))
-        {
-            if (!subdir || (strcmp(subdir, "/") == 0))
-            {
-                if (i->root)
-                    allocator.Free(i->root);
-                i->root = NULL;
-                i->rootlen = 0;
-            } /* if */
-            else
-            {
-                const size_t len = strlen(subdir) + 1;
-                char *ptr = (char *) allocator.Malloc(len);
-                BAIL_IF_MUTEX(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
-                if (!sanitizePlatformIndependentPath(subdir, ptr))
-                {
-                    allocator.Free(ptr);
-                    BAIL_MUTEX_ERRPASS(stateLock, 0);
-                } /* if */
+static int doRegisterArchiver(const PHYSFS_Archiver *_archiver);
 
-                if (i->root)
-                    allocator.Free(i->root);
-                i->root = ptr;
-                i->rootlen = len;
+static int initStaticArchivers(void)
+{
+    #define REGISTER_STATIC_ARCHIVER(arc) { \
+        if (!doRegisterArchiver(&__PHYSFS_Archiver_##arc)) { \
+            return 0; \
+        } \
+    }
 
-                if (longest_root < len)
-                    longest_root = len;
-            } /* else */
+    #if PHYSFS_SUPPORTS_ZIP
+        REGISTER_STATIC_ARCHIVER(ZIP);
+    #endif
+    #if PHYSFS_SUPPORTS_7Z
+        SZIP_global_init();
+        REGISTER_STATIC_ARCHIVER(7Z);
+    #endif
+    #if PHYSFS_SUPPORTS_GRP
+        REGISTER_STATIC_ARCHIVER(GRP);
+    #endif
+    #if PHYSFS_SUPPORTS_QPAK
+        REGISTER_STATIC_ARCHIVER(QPAK);
+    #endif
+    #if PHYSFS_SUPPORTS_HOG
+        REGISTER_STATIC_ARCHIVER(HOG);
+    #endif
+    #if PHYSFS_SUPPORTS_MVL
+        REGISTER_STATIC_ARCHIVER(MVL);
+    #endif
+    #if PHYSFS_SUPPORTS_WAD
+        REGISTER_STATIC_ARCHIVER(WAD);
+    #endif
+    #if PHYSFS_SUPPORTS_SLB
+        REGISTER_STATIC_ARCHIVER(SLB);
+    #endif
+    #if PHYSFS_SUPPORTS_ISO9660
+        REGISTER_STATIC_ARCHIVER(ISO9660);
+    #endif
+    #if PHYSFS_SUPPORTS_VDF
+        REGISTER_STATIC_ARCHIVER(VDF)
+    #endif
+    #if PHYSFS_SUPPORTS_CAS
+        REGISTER_STATIC_ARCHIVER(CAS);
+    #endif
+    #if PHYSFS_SUPPORTS_TAR
+        REGISTER_STATIC_ARCHIVER(TAR);
+    #endif
 
-            break;
-        } /* if */
-    } /* for */
+    #undef REGISTER_STATIC_ARCHIVER
 
-    __PHYSFS_platformReleaseMutex(stateLock);
     return 1;
-} /* PHYSFS_setRoot */
+} /* initStaticArchivers */
 
 
-static int doMount(PHYSFS_Io *io, const char *fname,
-                   const char *mountPoint, int appendToPath)
-{
-    DirHandle *dh;
-    DirHandle *prev = NULL;
-    DirHandle *i;
+static void setDefaultAllocator(void);
+static int doDeinit(void);
 
-    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+int PHYSFS_init(const char *argv0)
+{
+    BAIL_IF(initialized, PHYSFS_ERR_IS_INITIALIZED, 0);
 
-    if (mountPoint == NULL)
-        mountPoint = "/";
+    if (!externalAllocator)
+        setDefaultAllocator();
 
-    __PHYSFS_platformGrabMutex(stateLock);
+    if ((allocator.Init != NULL) && (!allocator.Init())) return 0;
 
-    for (i = searchPath; i != NULL; i = i->next)
+    if (!__PHYSFS_platformInit())
     {
-        /* already in search path? */
-        if ((i->dirName != NULL) && (strcmp(fname, i->dirName) == 0))
-            BAIL_MUTEX_ERRPASS(stateLock, 1);
-        prev = i;
-    } /* for */
-
-    dh = createDirHandle(io, fname, mountPoint, 0);
-    BAIL_IF_MUTEX_ERRPASS(!dh, stateLock, 0);
-
-    if (appendToPath)
-    {
-        if (prev == NULL)
-            searchPath = dh;
-        else
-            prev->next = dh;
+        if (allocator.Deinit != NULL) allocator.Deinit();
+        return 0;
     } /* if */
-    else
-    {
-        dh->next = searchPath;
-        searchPath = dh;
-    } /* else */
-
-    __PHYSFS_platformReleaseMutex(stateLock);
-    return 1;
-} /* doMount */
-
 
-int PHYSFS_mountIo(PHYSFS_Io *io, const char *fname,
-                   const char *mountPoint, int appendToPath)
-{
-    BAIL_IF(!io, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(io->version != 0, PHYSFS_ERR_UNSUPPORTED, 0);
-    return doMount(io, fname, mountPoint, appendToPath);
-} /* PHYSFS_mountIo */
+    /* everything below here can be cleaned up safely by doDeinit(). */
 
+    if (!initializeMutexes()) goto initFailed;
 
-int PHYSFS_mountMemory(const void *buf, PHYSFS_uint64 len, void (*del)(void *),
-                       const char *fname, const char *mountPoint,
-                       int appendToPath)
-{
-    int retval = 0;
-    PHYSFS_Io *io = NULL;
+    initCrcTable();
 
-    BAIL_IF(!buf, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    baseDir = calculateBaseDir(argv0);
+    if (!baseDir) goto initFailed;
 
-    io = __PHYSFS_createMemoryIo(buf, len, del);
-    BAIL_IF_ERRPASS(!io, 0);
-    retval = doMount(io, fname, mountPoint, appendToPath);
-    if (!retval)
-    {
-        /* docs say not to call (del) in case of failure, so cheat. */
-        MemoryIoInfo *info = (MemoryIoInfo *) io->opaque;
-        info->destruct = NULL;
-        io->destroy(io);
-    } /* if */
+    userDir = __PHYSFS_platformCalcUserDir();
+    if (!userDir) goto initFailed;
 
-    return retval;
-} /* PHYSFS_mountMemory */
+    /* Platform layer is required to append a dirsep. */
+    assert(baseDir[strlen(baseDir) - 1] == __PHYSFS_platformDirSeparator);
+    assert(userDir[strlen(userDir) - 1] == __PHYSFS_platformDirSeparator);
 
+    if (!initStaticArchivers()) goto initFailed;
 
-int PHYSFS_mountHandle(PHYSFS_File *file, const char *fname,
-                       const char *mountPoint, int appendToPath)
-{
-    int retval = 0;
-    PHYSFS_Io *io = NULL;
+    initialized = 1;
 
-    BAIL_IF(!file, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    /* This makes sure that the error subsystem is initialized. */
+    PHYSFS_setErrorCode(PHYSFS_getLastErrorCode());
 
-    io = __PHYSFS_createHandleIo(file);
-    BAIL_IF_ERRPASS(!io, 0);
-    retval = doMount(io, fname, mountPoint, appendToPath);
-    if (!retval)
-    {
-        /* docs say not to destruct in case of failure, so cheat. */
-        io->opaque = NULL;
-        io->destroy(io);
-    } /* if */
+    return 1;
 
-    return retval;
-} /* PHYSFS_mountHandle */
+initFailed:
+    doDeinit();
+    return 0;
+} /* PHYSFS_init */
 
 
-int PHYSFS_mount(const char *newDir, const char *mountPoint, int appendToPath)
+/* MAKE SURE you hold stateLock before calling this! */
+static int closeFileHandleList(FileHandle **list)
 {
-    BAIL_IF(!newDir, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    return doMount(NULL, newDir, mountPoint, appendToPath);
-} /* PHYSFS_mount */
+    FileHandle *i;
+    FileHandle *next = NULL;
 
+    for (i = *list; i != NULL; i = next)
+    {
+        PHYSFS_Io *io = i->io;
+        next = i->next;
 
-int PHYSFS_addToSearchPath(const char *newDir, int appendToPath)
-{
-    return PHYSFS_mount(newDir, NULL, appendToPath);
-} /* PHYSFS_addToSearchPath */
+        if (io->flush && !io->flush(io))
+        {
+            *list = i;
+            return 0;
+        } /* if */
 
+        io->destroy(io);
+        allocator.Free(i);
+    } /* for */
 
-int PHYSFS_removeFromSearchPath(const char *oldDir)
-{
-    return PHYSFS_unmount(oldDir);
-} /* PHYSFS_removeFromSearchPath */
+    *list = NULL;
+    return 1;
+} /* closeFileHandleList */
 
 
-int PHYSFS_unmount(const char *oldDir)
+/* MAKE SURE you hold the stateLock before calling this! */
+static void freeSearchPath(void)
 {
     DirHandle *i;
-    DirHandle *prev = NULL;
     DirHandle *next = NULL;
 
-    BAIL_IF(oldDir == NULL, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    closeFileHandleList(&openReadList);
 
-    __PHYSFS_platformGrabMutex(stateLock);
-    for (i = searchPath; i != NULL; i = i->next)
+    if (searchPath != NULL)
     {
-        if (strcmp(i->dirName, oldDir) == 0)
+        for (i = searchPath; i != NULL; i = next)
         {
             next = i->next;
-            BAIL_IF_MUTEX_ERRPASS(!freeDirHandle(i, openReadList),
-                                stateLock, 0);
+            freeDirHandle(i, openReadList);
+        } /* for */
+        searchPath = NULL;
+        searchPathGeneration++;
+    } /* if */
+} /* freeSearchPath */
 
-            if (prev == NULL)
-                searchPath = next;
-            else
-                prev->next = next;
 
-            BAIL_MUTEX_ERRPASS(stateLock, 1);
-        } /* if */
-        prev = i;
+/* MAKE SURE you hold stateLock before calling this! */
+static int archiverInUse(const PHYSFS_Archiver *arc, const DirHandle *list)
+{
+    const DirHandle *i;
+    for (i = list; i != NULL; i = i->next)
+    {
+        if (i->funcs == arc)
+            return 1;
     } /* for */
 
-    BAIL_MUTEX(PHYSFS_ERR_NOT_MOUNTED, stateLock, 0);
-} /* PHYSFS_unmount */
+    return 0;  /* not in use */
+} /* archiverInUse */
 
 
-char **PHYSFS_getSearchPath(void)
+/* MAKE SURE you hold stateLock before calling this! */
+static int doDeregisterArchiver(const size_t idx)
 {
-    return doEnumStringList(PHYSFS_getSearchPathCallback);
-} /* PHYSFS_getSearchPath */
+    const size_t len = (numArchivers - idx) * sizeof (void *);
+    PHYSFS_ArchiveInfo *info = archiveInfo[idx];
+    PHYSFS_Archiver *arc = archivers[idx];
+
+    /* make sure nothing is still using this archiver */
+    if (archiverInUse(arc, searchPath) || archiverInUse(arc, writeDir))
+        BAIL(PHYSFS_ERR_FILES_STILL_OPEN, 0);
 
+    allocator.Free((void *) info->extension);
+    allocator.Free((void *) info->description);
+    allocator.Free((void *) info->author);
+    allocator.Free((void *) info->url);
+    allocator.Free((void *) arc);
 
-const char *PHYSFS_getMountPoint(const char *dir)
+    memmove(&archiveInfo[idx], &archiveInfo[idx+1], len);
+    memmove(&archivers[idx], &archivers[idx+1], len);
+
+    assert(numArchivers > 0);
+    numArchivers--;
+
+    return 1;
+} /* doDeregisterArchiver */
+
+
+/* Does NOT hold the state lock; we're shutting down. */
+static void freeArchivers(void)
 {
-    DirHandle *i;
-    __PHYSFS_platformGrabMutex(stateLock);
-    for (i = searchPath; i != NULL; i = i->next)
+    while (numArchivers > 0)
     {
-        if (strcmp(i->dirName, dir) == 0)
-        {
-            const char *retval = ((i->mountPoint) ? i->mountPoint : "/");
-            __PHYSFS_platformReleaseMutex(stateLock);
-            return retval;
-        } /* if */
-    } /* for */
-    __PHYSFS_platformReleaseMutex(stateLock);
+        if (!doDeregisterArchiver(numArchivers - 1))
+            assert(!"nothing should be mounted during shutdown.");
+    } /* while */
 
-    BAIL(PHYSFS_ERR_NOT_MOUNTED, NULL);
-} /* PHYSFS_getMountPoint */
+    allocator.Free(archivers);
+    allocator.Free(archiveInfo);
+    archivers = NULL;
+    archiveInfo = NULL;
+} /* freeArchivers */
 
 
-void PHYSFS_getSearchPathCallback(PHYSFS_StringCallback callback, void *data)
+static int doDeinit(void)
 {
-    DirHandle *i;
-
-    __PHYSFS_platformGrabMutex(stateLock);
+    closeFileHandleList(&openWriteList);
+    BAIL_IF(!PHYSFS_setWriteDir(NULL), PHYSFS_ERR_FILES_STILL_OPEN, 0);
 
-    for (i = searchPath; i != NULL; i = i->next)
-        callback(data, i->dirName);
+    freeSearchPath();
+    freeArchivers();
+    freeErrorStates();
 
-    __PHYSFS_platformReleaseMutex(stateLock);
-} /* PHYSFS_getSearchPathCallback */
+    if (baseDir != NULL)
+    {
+        allocator.Free(baseDir);
+        baseDir = NULL;
+    } /* if */
 
+    if (userDir != NULL)
+    {
+        allocator.Free(userDir);
+        userDir = NULL;
+    } /* if */
 
-typedef struct setSaneCfgEnumData
-{
-    const char *archiveExt;
-    size_t archiveExtLen;
-    int archivesFirst;
-    PHYSFS_ErrorCode errcode;
-} setSaneCfgEnumData;
+    if (prefDir != NULL)
+    {
+        allocator.Free(prefDir);
+        prefDir = NULL;
+    } /* if */
 
-static PHYSFS_EnumerateCallbackResult setSaneCfgEnumCallback(void *_data,
-                                                const char *dir, const char *f)
-{
-    setSaneCfgEnumData *data = (setSaneCfgEnumData *) _data;
-    const size_t extlen = data->archiveExtLen;
-    const size_t l = strlen(f);
-    const char *ext;
+    if (archiveIndexDir != NULL)
+    {
+        allocator.Free(archiveIndexDir);
+        archiveIndexDir = NULL;
+    } /* if */
 
-    if ((l > extlen) && (f[l - extlen - 1] == '.'))
+    if (extractCacheDir != NULL)
     {
-        ext = f + (l - extlen);
-        if (PHYSFS_utf8stricmp(ext, data->archiveExt) == 0)
-        {
-            const char dirsep = __PHYSFS_platformDirSeparator;
-            const char *d = PHYSFS_getRealDir(f);
-            const size_t allocsize = strlen(d) + l + 2;
-            char *str = (char *) __PHYSFS_smallAlloc(allocsize);
-            if (str == NULL)
-                data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
-            else
-            {
-                snprintf(str, allocsize, "%s%c%s", d, dirsep, f);
-                if (!PHYSFS_mount(str, NULL, data->archivesFirst == 0))
-                    data->errcode = currentErrorCode();
-                __PHYSFS_smallFree(str);
-            } /* else */
-        } /* if */
+        allocator.Free(extractCacheDir);
+        extractCacheDir = NULL;
     } /* if */
+    extractCacheBudget = 0;
+    extractCacheClear();
 
-    /* !!! FIXME: if we want to abort on errors... */
-    /*return (data->errcode != PHYSFS_ERR_OK) ? PHYSFS_ENUM_ERROR : PHYSFS_ENUM_OK;*/
+    if (archiveInfo != NULL)
+    {
+        allocator.Free(archiveInfo);
+        archiveInfo = NULL;
+    } /* if */
 
-    return PHYSFS_ENUM_OK;  /* keep going */
-} /* setSaneCfgEnumCallback */
+    if (archivers != NULL)
+    {
+        allocator.Free(archivers);
+        archivers = NULL;
+    } /* if */
 
+    residentPrune(NULL, NULL);
+    memset(&residentStats, '\0', sizeof (residentStats));
+    residentPromoteAfter = RESIDENT_DEFAULT_PROMOTE_AFTER;
 
-int PHYSFS_setSaneConfig(const char *organization, const char *appName,
-                         const char *archiveExt, int includeCdRoms,
-                         int archivesFirst)
-{
-    const char *basedir;
-    const char *prefdir;
+    longest_root = 0;
+    allowSymLinks = 0;
+    initialized = 0;
 
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    nativeFdMax = 0;
 
-    prefdir = PHYSFS_getPrefDir(organization, appName);
-    BAIL_IF_ERRPASS(!prefdir, 0);
+    if (errorLock) __PHYSFS_platformDestroyMutex(errorLock);
+    if (stateLock) __PHYSFS_platformDestroyMutex(stateLock);
+    if (nativeFdLock) __PHYSFS_platformDestroyMutex(nativeFdLock);
 
-    basedir = PHYSFS_getBaseDir();
-    BAIL_IF_ERRPASS(!basedir, 0);
+    if (allocator.Deinit != NULL)
+        allocator.Deinit();
 
-    BAIL_IF(!PHYSFS_setWriteDir(prefdir), PHYSFS_ERR_NO_WRITE_DIR, 0);
+    errorLock = stateLock = nativeFdLock = NULL;
 
-    /* !!! FIXME: these can fail and we should report that... */
+    __PHYSFS_platformDeinit();
 
-    /* Put write dir first in search path... */
-    PHYSFS_mount(prefdir, NULL, 0);
+    return 1;
+} /* doDeinit */
 
-    /* Put base path on search path... */
-    PHYSFS_mount(basedir, NULL, 1);
 
-    /* handle CD-ROMs... */
-    if (includeCdRoms)
-    {
-        char **cds = PHYSFS_getCdRomDirs();
-        char **i;
-        for (i = cds; *i != NULL; i++)
-            PHYSFS_mount(*i, NULL, 1);
-        PHYSFS_freeList(cds);
-    } /* if */
+int PHYSFS_deinit(void)
+{
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    return doDeinit();
+} /* PHYSFS_deinit */
 
-    /* Root out archives, and add them to search path... */
-    if (archiveExt != NULL)
-    {
-        setSaneCfgEnumData data;
-        memset(&data, '\0', sizeof (data));
-        data.archiveExt = archiveExt;
-        data.archiveExtLen = strlen(archiveExt);
-        data.archivesFirst = archivesFirst;
-        data.errcode = PHYSFS_ERR_OK;
-        if (!PHYSFS_enumerate("/", setSaneCfgEnumCallback, &data))
-        {
-            /* !!! FIXME: use this if we're reporting errors.
-            PHYSFS_ErrorCode errcode = currentErrorCode();
-            if (errcode == PHYSFS_ERR_APP_CALLBACK)
-                errcode = data->errcode; */
-        } /* if */
-    } /* if */
 
-    return 1;
-} /* PHYSFS_setSaneConfig */
+int PHYSFS_isInit(void)
+{
+    return initialized;
+} /* PHYSFS_isInit */
 
 
-void PHYSFS_permitSymbolicLinks(int allow)
+char *__PHYSFS_strdup(const char *str)
 {
-    allowSymLinks = allow;
-} /* PHYSFS_permitSymbolicLinks */
+    char *retval = (char *) allocator.Malloc(strlen(str) + 1);
+    if (retval)
+        strcpy(retval, str);
+    return retval;
+} /* __PHYSFS_strdup */
 
 
-int PHYSFS_symbolicLinksPermitted(void)
+/* Carry on hashing (len) more bytes: hashing "ab" is hashing "b" from "a". */
+static inline PHYSFS_uint32 hashStringFrom(PHYSFS_uint32 hash,
+                                           const char *str, size_t len)
 {
-    return allowSymLinks;
-} /* PHYSFS_symbolicLinksPermitted */
+    while (len--)
+        hash = ((hash << 5) + hash) ^ *(str++);
+    return hash;
+} /* hashStringFrom */
+
+PHYSFS_uint32 __PHYSFS_hashString(const char *str, size_t len)
+{
+    return hashStringFrom(5381, str, len);
+} /* __PHYSFS_hashString */
 
 
 /*
- * Verify that (fname) (in platform-independent notation), in relation
- *  to (h) is secure. That means that each element of fname is checked
- *  for symlinks (if they aren't permitted). This also allows for quick
- *  rejection of files that exist outside an archive's mountpoint.
- *
- * With some exceptions (like PHYSFS_mkdir(), which builds multiple subdirs
- *  at a time), you should always pass zero for "allowMissing" for efficiency.
- *
- * (fname) must point to an output from sanitizePlatformIndependentPath(),
- *  since it will make sure that path names are in the right format for
- *  passing certain checks. It will also do checks for "insecure" pathnames
- *  like ".." which should be done once instead of once per archive. This also
- *  gives us license to treat (fname) as scratch space in this function.
- *
- * (fname)'s buffer must have enough space available before it for this
- *  function to prepend any root directory for this DirHandle.
- *
- * Returns non-zero if string is safe, zero if there's a security issue.
- *  PHYSFS_getLastError() will specify what was wrong. (*fname) will be
- *  updated to point past any mount point elements so it is prepared to
- *  be used with the archiver directly.
+ * Find (arcfname)'s hash, if we already know it: (arcfname) is the string
+ *  about to be handed to (h) for a lookup of (ip), and we know it when it
+ *  starts at one of (ip)'s element boundaries within (fname), with no root
+ *  directory prepended. Returns zero if we don't know it.
  */
-static int verifyPath(DirHandle *h, char **_fname, int allowMissing)
+static int internedHash(const InternedPath *ip, const DirHandle *h,
+                        const char *fname, const char *arcfname,
+                        PHYSFS_uint32 *hash)
 {
-    char *fname = *_fname;
-    int retval = 1;
-    char *start;
-    char *end;
-
-    if ((*fname == '\0') && (!h->root))  /* quick rejection. */
-        return 1;
-
-    /* !!! FIXME: This codeblock sucks. */
-    if (h->mountPoint != NULL)  /* NULL mountpoint means "/". */
-    {
-        size_t mntpntlen = strlen(h->mountPoint);
-        size_t len = strlen(fname);
-        assert(mntpntlen > 1); /* root mount points should be NULL. */
-        /* not under the mountpoint, so skip this archive. */
-        BAIL_IF(len < mntpntlen-1, PHYSFS_ERR_NOT_FOUND, 0);
-        /* !!! FIXME: Case insensitive? */
-        retval = strncmp(h->mountPoint, fname, mntpntlen-1);
-        BAIL_IF(retval != 0, PHYSFS_ERR_NOT_FOUND, 0);
-        if (len > mntpntlen-1)  /* corner case... */
-            BAIL_IF(fname[mntpntlen-1]!='/', PHYSFS_ERR_NOT_FOUND, 0);
-        fname += mntpntlen-1;  /* move to start of actual archive path. */
-        if (*fname == '/')
-            fname++;
-        *_fname = fname;  /* skip mountpoint for later use. */
-        retval = 1;  /* may be reset, below. */
-    } /* if */
-
-    /* prepend the root directory, if any. */
-    if (h->root)
-    {
-        const int isempty = (*fname == '\0');
-        fname -= h->rootlen - 1;
-        strcpy(fname, h->root);
-        if (!isempty)
-            fname[h->rootlen - 2] = '/';
-        *_fname = fname;
-    } /* if */
-
-    start = fname;
-    if (!allowSymLinks)
+    if ((ip != NULL) && (h->root == NULL) && (*arcfname != '\0'))
     {
-        while (1)
+        const size_t ofs = (size_t) (arcfname - fname);
+        PHYSFS_uint32 i;
+        for (i = 0; (i < ip->components) && (ip->offsets[i] <= ofs); i++)
         {
-            PHYSFS_Stat statbuf;
-            int rc = 0;
-            end = strchr(start, '/');
-
-            if (end != NULL) *end = '\0';
-            rc = h->funcs->stat(h->opaque, fname, &statbuf);
-            if (rc)
-                rc = (statbuf.filetype == PHYSFS_FILETYPE_SYMLINK);
-            else if (currentErrorCode() == PHYSFS_ERR_NOT_FOUND)
-                retval = 0;
-
-            if (end != NULL) *end = '/';
-
-            /* insecure path (has a disallowed symlink in it)? */
-            BAIL_IF(rc, PHYSFS_ERR_SYMLINK_FORBIDDEN, 0);
-
-            /* break out early if path element is missing. */
-            if (!retval)
+            if (ip->offsets[i] == ofs)
             {
-                /*
-                 * We need to clear it if it's the last element of the path,
-                 *  since this might be a non-existant file we're opening
-                 *  for writing...
-                 */
-                if ((end == NULL) || (allowMissing))
-                    retval = 1;
-                break;
+                *hash = ip->hashes[i];
+                return 1;
             } /* if */
-
-            if (end == NULL)
-                break;
-
-            start = end + 1;
-        } /* while */
+        } /* for */
     } /* if */
 
-    return retval;
-} /* verifyPath */
+    return 0;
+} /* internedHash */
 
 
-/* This must hold the stateLock before calling. */
-static int doMkdir(const char *_dname, char *dname)
+/*
+ * (h)'s openRead() and stat(), but if (hashed), and (h) is an archiver that
+ *  can take it, hand over (arcfname)'s known (hash) so it isn't worked out
+ *  again. Other archivers just get the usual call.
+ */
+static PHYSFS_Io *archiverOpenRead(const DirHandle *h, const char *arcfname,
+                                   const int hashed, const PHYSFS_uint32 hash)
 {
-    DirHandle *h = writeDir;
-    char *start;
-    char *end;
-    int retval = 0;
-    int exists = 1;  /* force existance check on first path element. */
-
-    assert(h != NULL);
-
-    BAIL_IF_ERRPASS(!sanitizePlatformIndependentPathWithRoot(h, _dname, dname), 0);
-    BAIL_IF_ERRPASS(!verifyPath(h, &dname, 1), 0);
-
-    start = dname;
-    while (1)
+    if (hashed)
     {
-        end = strchr(start, '/');
-        if (end != NULL)
-            *end = '\0';
-
-        /* only check for existance if all parent dirs existed, too... */
-        if (exists)
-        {
-            PHYSFS_Stat statbuf;
-            const int rc = h->funcs->stat(h->opaque, dname, &statbuf);
-            if ((!rc) && (currentErrorCode() == PHYSFS_ERR_NOT_FOUND))
-                exists = 0;
-            retval = ((rc) && (statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY));
-        } /* if */
+        if (h->funcs->openRead == UNPK_openRead)
+            return UNPK_openReadHashed(h->opaque, arcfname, hash);
+        #if PHYSFS_SUPPORTS_ZIP
+        else if (h->funcs == &__PHYSFS_Archiver_ZIP)
+            return ZIP_openReadHashed(h->opaque, arcfname, hash);
+        #endif
+    } /* if */
 
-        if (!exists)
-            retval = h->funcs->mkdir(h->opaque, dname);
+    return h->funcs->openRead(h->opaque, arcfname);
+} /* archiverOpenRead */
 
-        if (!retval)
-            break;
+static int archiverStat(const DirHandle *h, const char *arcfname,
+                        const int hashed, const PHYSFS_uint32 hash,
+                        PHYSFS_Stat *st)
+{
+    if (hashed)
+    {
+        if (h->funcs->stat == UNPK_stat)
+            return UNPK_statHashed(h->opaque, arcfname, hash, st);
+        #if PHYSFS_SUPPORTS_ZIP
+        else if (h->funcs == &__PHYSFS_Archiver_ZIP)
+            return ZIP_statHashed(h->opaque, arcfname, hash, st);
+        #endif
+    } /* if */
 
-        if (end == NULL)
-            break;
+    return h->funcs->stat(h->opaque, arcfname, st);
+} /* archiverStat */
 
-        *end = '/';
-        start = end + 1;
-    } /* while */
 
-    return retval;
-} /* doMkdir */
+PHYSFS_uint64 __PHYSFS_mixFingerprint(PHYSFS_uint64 fp, const PHYSFS_uint64 val)
+{
+    /* boost-style combine, then a 64-bit finalizer so every bit counts. */
+    fp ^= val + __PHYSFS_UI64(0x9E3779B97F4A7C15) + (fp << 6) + (fp >> 2);
+    fp ^= fp >> 33;
+    fp *= __PHYSFS_UI64(0xFF51AFD7ED558CCD);
+    fp ^= fp >> 33;
+    return fp;
+} /* __PHYSFS_mixFingerprint */
 
 
-int PHYSFS_mkdir(const char *_dname)
+/* MAKE SURE you hold stateLock before calling this! */
+static int doRegisterArchiver(const PHYSFS_Archiver *_archiver)
 {
-    int retval = 0;
-    char *dname;
-    size_t len;
-
-    BAIL_IF(!_dname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    const PHYSFS_uint32 maxver = CURRENT_PHYSFS_ARCHIVER_API_VERSION;
+    const size_t len = (numArchivers + 2) * sizeof (void *);
+    PHYSFS_Archiver *archiver = NULL;
+    PHYSFS_ArchiveInfo *info = NULL;
+    const char *ext = NULL;
+    void *ptr = NULL;
+    size_t i;
 
-    __PHYSFS_platformGrabMutex(stateLock);
-    BAIL_IF_MUTEX(!writeDir, PHYSFS_ERR_NO_WRITE_DIR, stateLock, 0);
-    len = strlen(_dname) + dirHandleRootLen(writeDir) + 1;
-    dname = (char *) __PHYSFS_smallAlloc(len);
-    BAIL_IF_MUTEX(!dname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
-    retval = doMkdir(_dname, dname);
-    __PHYSFS_platformReleaseMutex(stateLock);
-    __PHYSFS_smallFree(dname);
-    return retval;
-} /* PHYSFS_mkdir */
+    BAIL_IF(!_archiver, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(_archiver->version > maxver, PHYSFS_ERR_UNSUPPORTED, 0);
+    BAIL_IF(!_archiver->info.extension, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->info.description, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->info.author, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->info.url, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->openArchive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->enumerate, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->openRead, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->openWrite, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->openAppend, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->remove, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->mkdir, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->closeArchive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->stat, PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
+    ext = _archiver->info.extension;
+    for (i = 0; i < numArchivers; i++)
+    {
+        if (PHYSFS_utf8stricmp(archiveInfo[i]->extension, ext) == 0)
+            BAIL(PHYSFS_ERR_DUPLICATE, 0);
+    } /* for */
 
-/* This must hold the stateLock before calling. */
-static int doDelete(const char *_fname, char *fname)
-{
-    DirHandle *h = writeDir;
-    BAIL_IF_ERRPASS(!sanitizePlatformIndependentPathWithRoot(h, _fname, fname), 0);
-    BAIL_IF_ERRPASS(!verifyPath(h, &fname, 0), 0);
-    return h->funcs->remove(h->opaque, fname);
-} /* doDelete */
+    /* make a copy of the data. */
+    archiver = (PHYSFS_Archiver *) allocator.Malloc(sizeof (*archiver));
+    GOTO_IF(!archiver, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
 
+    /* Must copy sizeof (OLD_VERSION_OF_STRUCT) when version changes! */
+    memset(archiver, '\0', sizeof (*archiver));
+    if (_archiver->version == 0)
+        memcpy(archiver, _archiver, offsetof(PHYSFS_Archiver, fingerprint));
+    else if (_archiver->version == 1)
+        memcpy(archiver, _archiver, offsetof(PHYSFS_Archiver, refresh));
+    else if (_archiver->version == 2)
+        memcpy(archiver, _archiver, offsetof(PHYSFS_Archiver, sniff));
+    else
+        memcpy(archiver, _archiver, sizeof (*archiver));
 
-int PHYSFS_delete(const char *_fname)
-{
-    int retval;
-    char *fname;
-    size_t len;
+    info = (PHYSFS_ArchiveInfo *) &archiver->info;
+    memset(info, '\0', sizeof (*info));  /* NULL in case an alloc fails. */
+    #define CPYSTR(item) \
+        info->item = __PHYSFS_strdup(_archiver->info.item); \
+        GOTO_IF(!info->item, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
+    CPYSTR(extension);
+    CPYSTR(description);
+    CPYSTR(author);
+    CPYSTR(url);
+    info->supportsSymlinks = _archiver->info.supportsSymlinks;
+    #undef CPYSTR
 
-    __PHYSFS_platformGrabMutex(stateLock);
-    BAIL_IF_MUTEX(!writeDir, PHYSFS_ERR_NO_WRITE_DIR, stateLock, 0);
-    len = strlen(_fname) + dirHandleRootLen(writeDir) + 1;
-    fname = (char *) __PHYSFS_smallAlloc(len);
-    BAIL_IF_MUTEX(!fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
-    retval = doDelete(_fname, fname);
-    __PHYSFS_platformReleaseMutex(stateLock);
-    __PHYSFS_smallFree(fname);
-    return retval;
-} /* PHYSFS_delete */
+    ptr = allocator.Realloc(archiveInfo, len);
+    GOTO_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
+    archiveInfo = (PHYSFS_ArchiveInfo **) ptr;
 
+    ptr = allocator.Realloc(archivers, len);
+    GOTO_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
+    archivers = (PHYSFS_Archiver **) ptr;
 
-static DirHandle *getRealDirHandle(const char *_fname)
-{
-    DirHandle *retval = NULL;
-    char *allocated_fname = NULL;
-    char *fname = NULL;
-    size_t len;
+    archiveInfo[numArchivers] = info;
+    archiveInfo[numArchivers + 1] = NULL;
 
-    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    archivers[numArchivers] = archiver;
+    archivers[numArchivers + 1] = NULL;
 
-    __PHYSFS_platformGrabMutex(stateLock);
-    len = strlen(_fname) + longest_root + 1;
-    allocated_fname = __PHYSFS_smallAlloc(len);
-    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, NULL);
-    fname = allocated_fname + longest_root;
-    if (sanitizePlatformIndependentPath(_fname, fname))
+    numArchivers++;
+
+    return 1;
+
+regfailed:
+    if (info != NULL)
     {
-        DirHandle *i;
-        for (i = searchPath; i != NULL; i = i->next)
-        {
-            char *arcfname = fname;
-            if (partOfMountPoint(i, arcfname))
-            {
-                retval = i;
-                break;
-            } /* if */
-            else if (verifyPath(i, &arcfname, 0))
-            {
-                PHYSFS_Stat statbuf;
-                if (i->funcs->stat(i->opaque, arcfname, &statbuf))
-                {
-                    retval = i;
-                    break;
-                } /* if */
-            } /* if */
-        } /* for */
+        allocator.Free((void *) info->extension);
+        allocator.Free((void *) info->description);
+        allocator.Free((void *) info->author);
+        allocator.Free((void *) info->url);
     } /* if */
+    allocator.Free(archiver);
 
-    __PHYSFS_platformReleaseMutex(stateLock);
-    __PHYSFS_smallFree(allocated_fname);
-    return retval;
-} /* getRealDirHandle */
+    return 0;
+} /* doRegisterArchiver */
 
-const char *PHYSFS_getRealDir(const char *fname)
+
+int PHYSFS_registerArchiver(const PHYSFS_Archiver *archiver)
 {
-    DirHandle *dh = getRealDirHandle(fname);
-    return dh ? dh->dirName : NULL;
-} /* PHYSFS_getRealDir */
+    int retval;
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    __PHYSFS_platformGrabMutex(stateLock);
+    retval = doRegisterArchiver(archiver);
+    __PHYSFS_platformReleaseMutex(stateLock);
+    return retval;
+} /* PHYSFS_registerArchiver */
 
 
-static int locateInStringList(const char *str,
-                              char **list,
-                              PHYSFS_uint32 *pos)
+int PHYSFS_deregisterArchiver(const char *ext)
 {
-    PHYSFS_uint32 len = *pos;
-    PHYSFS_uint32 half_len;
-    PHYSFS_uint32 lo = 0;
-    PHYSFS_uint32 middle;
-    int cmp;
+    size_t i;
 
-    while (len > 0)
-    {
-        half_len = len >> 1;
-        middle = lo + half_len;
-        cmp = strcmp(list[middle], str);
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    BAIL_IF(!ext, PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
-        if (cmp == 0)  /* it's in the list already. */
-            return 1;
-        else if (cmp > 0)
-            len = half_len;
-        else
+    __PHYSFS_platformGrabMutex(stateLock);
+    for (i = 0; i < numArchivers; i++)
+    {
+        if (PHYSFS_utf8stricmp(archiveInfo[i]->extension, ext) == 0)
         {
-            lo = middle + 1;
-            len -= half_len + 1;
-        } /* else */
-    } /* while */
+            const int retval = doDeregisterArchiver(i);
+            __PHYSFS_platformReleaseMutex(stateLock);
+            return retval;
+        } /* if */
+    } /* for */
+    __PHYSFS_platformReleaseMutex(stateLock);
 
-    *pos = lo;
-    return 0;
-} /* locateInStringList */
+    BAIL(PHYSFS_ERR_NOT_FOUND, 0);
+} /* PHYSFS_deregisterArchiver */
 
 
-static PHYSFS_EnumerateCallbackResult enumFilesCallback(void *data,
-                                        const char *origdir, const char *str)
+const PHYSFS_ArchiveInfo **PHYSFS_supportedArchiveTypes(void)
 {
-    PHYSFS_uint32 pos;
-    void *ptr;
-    char *newstr;
-    EnumStringListCallbackData *pecd = (EnumStringListCallbackData *) data;
-
-    /*
-     * See if file is in the list already, and if not, insert it in there
-     *  alphabetically...
-     */
-    pos = pecd->size;
-    if (locateInStringList(str, pecd->list, &pos))
-        return PHYSFS_ENUM_OK;  /* already in the list, but keep going. */
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, NULL);
+    return (const PHYSFS_ArchiveInfo **) archiveInfo;
+} /* PHYSFS_supportedArchiveTypes */
 
-    ptr = allocator.Realloc(pecd->list, (pecd->size + 2) * sizeof (char *));
-    newstr = (char *) allocator.Malloc(strlen(str) + 1);
-    if (ptr != NULL)
-        pecd->list = (char **) ptr;
 
-    if ((ptr == NULL) || (newstr == NULL))
+void PHYSFS_freeList(void *list)
+{
+    void **i;
+    if (list != NULL)
     {
-        if (newstr)
-            allocator.Free(newstr);
+        for (i = (void **) list; *i != NULL; i++)
+            allocator.Free(*i);
 
-        pecd->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
-        return PHYSFS_ENUM_ERROR;  /* better luck next time. */
+        allocator.Free(list);
     } /* if */
+} /* PHYSFS_freeList */
 
-    strcpy(newstr, str);
 
-    if (pos != pecd->size)
-    {
-        memmove(&pecd->list[pos+1], &pecd->list[pos],
-                 sizeof (char *) * ((pecd->size) - pos));
-    } /* if */
+const char *PHYSFS_getDirSeparator(void)
+{
+    static char retval[2] = { __PHYSFS_platformDirSeparator, '\0' };
+    return retval;
+} /* PHYSFS_getDirSeparator */
 
-    pecd->list[pos] = newstr;
-    pecd->size++;
 
-    return PHYSFS_ENUM_OK;
-} /* enumFilesCallback */
+char **PHYSFS_getCdRomDirs(void)
+{
+    return doEnumStringList(__PHYSFS_platformDetectAvailableCDs);
+} /* PHYSFS_getCdRomDirs */
 
 
-char **PHYSFS_enumerateFiles(const char *path)
+void PHYSFS_getCdRomDirsCallback(PHYSFS_StringCallback callback, void *data)
 {
-    EnumStringListCallbackData ecd;
-    memset(&ecd, '\0', sizeof (ecd));
-    ecd.list = (char **) allocator.Malloc(sizeof (char *));
-    BAIL_IF(!ecd.list, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
-    if (!PHYSFS_enumerate(path, enumFilesCallback, &ecd))
-    {
-        const PHYSFS_ErrorCode errcode = currentErrorCode();
-        PHYSFS_uint32 i;
-        for (i = 0; i < ecd.size; i++)
-            allocator.Free(ecd.list[i]);
-        allocator.Free(ecd.list);
-        BAIL_IF(errcode == PHYSFS_ERR_APP_CALLBACK, ecd.errcode, NULL);
-        return NULL;
-    } /* if */
-
-    ecd.list[ecd.size] = NULL;
-    return ecd.list;
-} /* PHYSFS_enumerateFiles */
+    __PHYSFS_platformDetectAvailableCDs(callback, data);
+} /* PHYSFS_getCdRomDirsCallback */
 
 
-/*
- * Broke out to seperate function so we can use stack allocation gratuitously.
- */
-static PHYSFS_EnumerateCallbackResult enumerateFromMountPoint(DirHandle *i,
-                                    const char *arcfname,
-                                    PHYSFS_EnumerateCallback callback,
-                                    const char *_fname, void *data)
+const char *PHYSFS_getPrefDir(const char *org, const char *app)
 {
-    PHYSFS_EnumerateCallbackResult retval;
-    const size_t len = strlen(arcfname);
+    const char dirsep = __PHYSFS_platformDirSeparator;
+    PHYSFS_Stat statbuf;
     char *ptr = NULL;
-    char *end = NULL;
-    const size_t slen = strlen(i->mountPoint) + 1;
-    char *mountPoint = (char *) __PHYSFS_smallAlloc(slen);
+    char *endstr = NULL;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    BAIL_IF(!org, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    BAIL_IF(*org == '\0', PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    BAIL_IF(!app, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    BAIL_IF(*app == '\0', PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+
+    allocator.Free(prefDir);
+    prefDir = __PHYSFS_platformCalcPrefDir(org, app);
+    BAIL_IF_ERRPASS(!prefDir, NULL);
+
+    assert(strlen(prefDir) > 0);
+    endstr = prefDir + (strlen(prefDir) - 1);
+    assert(*endstr == dirsep);
+    *endstr = '\0';  /* mask out the final dirsep for now. */
+
+    if (!__PHYSFS_platformStat(prefDir, &statbuf, 1))
+    {
+        for (ptr = strchr(prefDir, dirsep); ptr; ptr = strchr(ptr+1, dirsep))
+        {
+            *ptr = '\0';
+            __PHYSFS_platformMkDir(prefDir);
+            *ptr = dirsep;
+        } /* for */
+
+        if (!__PHYSFS_platformMkDir(prefDir))
+        {
+            allocator.Free(prefDir);
+            prefDir = NULL;
+        } /* if */
+    } /* if */
+
+    *endstr = dirsep;  /* readd the final dirsep. */
+
+    return prefDir;
+} /* PHYSFS_getPrefDir */
+
+
+const char *PHYSFS_getBaseDir(void)
+{
+    return baseDir;   /* this is calculated in PHYSFS_init()... */
+} /* PHYSFS_getBaseDir */
+
+
+const char *__PHYSFS_getUserDir(void)  /* not deprecated internal version. */
+{
+    return userDir;   /* this is calculated in PHYSFS_init()... */
+} /* __PHYSFS_getUserDir */
+
+
+const char *PHYSFS_getUserDir(void)
+{
+    return __PHYSFS_getUserDir();
+} /* PHYSFS_getUserDir */
+
+
+const char *PHYSFS_getWriteDir(void)
+{
+    const char *retval = NULL;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    if (writeDir != NULL)
+        retval = writeDir->dirName;
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    return retval;
+} /* PHYSFS_getWriteDir */
+
+
+int PHYSFS_setWriteDir(const char *newDir)
+{
+    int retval = 1;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    if (writeDir != NULL)
+    {
+        BAIL_IF_MUTEX_ERRPASS(!freeDirHandle(writeDir, openWriteList),
+                            stateLock, 0);
+        writeDir = NULL;
+    } /* if */
+
+    if (newDir != NULL)
+    {
+        writeDir = createDirHandle(NULL, newDir, NULL, 1);
+        retval = (writeDir != NULL);
+    } /* if */
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    return retval;
+} /* PHYSFS_setWriteDir */
+
+
+int PHYSFS_setRoot(const char *archive, const char *subdir)
+{
+    DirHandle *i;
+
+    BAIL_IF(!archive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        if ((i->dirName != NULL) && (strcmp(archive, i->dirName) == 0))
+        {
+            if (!subdir || (strcmp(subdir, "/") == 0))
+            {
+                if (i->root)
+                    allocator.Free(i->root);
+                i->root = NULL;
+                i->rootlen = 0;
+            } /* if */
+            else
+            {
+                const size_t len = strlen(subdir) + 1;
+                char *ptr = (char *) allocator.Malloc(len);
+                BAIL_IF_MUTEX(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+                if (!sanitizePlatformIndependentPath(subdir, ptr))
+                {
+                    allocator.Free(ptr);
+                    BAIL_MUTEX_ERRPASS(stateLock, 0);
+                } /* if */
+
+                if (i->root)
+                    allocator.Free(i->root);
+                i->root = ptr;
+                i->rootlen = len;
+
+                if (longest_root < len)
+                    longest_root = len;
+            } /* else */
+
+            if (residentTracked > 0)  /* same names, different files now. */
+                residentPrune(residentKeepOtherDir, i);
+
+            searchPathGeneration++;
+            break;
+        } /* if */
+    } /* for */
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+    return 1;
+} /* PHYSFS_setRoot */
+
+
+static int doMount(PHYSFS_Io *io, const char *fname,
+                   const char *mountPoint, int appendToPath)
+{
+    DirHandle *dh;
+    DirHandle *prev = NULL;
+    DirHandle *i;
+
+    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    if (mountPoint == NULL)
+        mountPoint = "/";
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        /* already in search path? */
+        if ((i->dirName != NULL) && (strcmp(fname, i->dirName) == 0))
+            BAIL_MUTEX_ERRPASS(stateLock, 1);
+        prev = i;
+    } /* for */
+
+    dh = createDirHandle(io, fname, mountPoint, 0);
+    BAIL_IF_MUTEX_ERRPASS(!dh, stateLock, 0);
+
+    if (appendToPath)
+    {
+        if (prev == NULL)
+            searchPath = dh;
+        else
+            prev->next = dh;
+    } /* if */
+    else
+    {
+        dh->next = searchPath;
+        searchPath = dh;
+    } /* else */
+
+    searchPathGeneration++;
+    __PHYSFS_platformReleaseMutex(stateLock);
+    return 1;
+} /* doMount */
+
+
+int PHYSFS_mountIo(PHYSFS_Io *io, const char *fname,
+                   const char *mountPoint, int appendToPath)
+{
+    BAIL_IF(!io, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(io->version != 0, PHYSFS_ERR_UNSUPPORTED, 0);
+    return doMount(io, fname, mountPoint, appendToPath);
+} /* PHYSFS_mountIo */
+
+
+int PHYSFS_mountMemory(const void *buf, PHYSFS_uint64 len, void (*del)(void *),
+                       const char *fname, const char *mountPoint,
+                       int appendToPath)
+{
+    int retval = 0;
+    PHYSFS_Io *io = NULL;
+
+    BAIL_IF(!buf, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    io = __PHYSFS_createMemoryIo(buf, len, del);
+    BAIL_IF_ERRPASS(!io, 0);
+    retval = doMount(io, fname, mountPoint, appendToPath);
+    if (!retval)
+    {
+        /* docs say not to call (del) in case of failure, so cheat. */
+        MemoryIoInfo *info = (MemoryIoInfo *) io->opaque;
+        info->destruct = NULL;
+        io->destroy(io);
+    } /* if */
+
+    return retval;
+} /* PHYSFS_mountMemory */
+
+
+int PHYSFS_mountHandle(PHYSFS_File *file, const char *fname,
+                       const char *mountPoint, int appendToPath)
+{
+    int retval = 0;
+    PHYSFS_Io *io = NULL;
+
+    FileHandle *fh = (FileHandle *) file;
+
+    BAIL_IF(!file, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    /*
+     * If the file is stored as-is inside another archive, skip the
+     *  PHYSFS_File layer and read straight from the outer archive's Io. We
+     *  still hang on to the handle until unmount, like the docs promise.
+     */
+    if ((fh->forReading) && (fh->io->read == subIo_read))
+    {
+        io = fh->io->duplicate(fh->io);
+        if (io != NULL)
+        {
+            ((SubIoInfo *) io->opaque)->owner = file;
+            retval = doMount(io, fname, mountPoint, appendToPath);
+            if (!retval)
+            {
+                /* docs say not to close in case of failure, so cheat. */
+                ((SubIoInfo *) io->opaque)->owner = NULL;
+                io->destroy(io);
+            } /* if */
+            return retval;
+        } /* if */
+    } /* if */
+
+    io = __PHYSFS_createHandleIo(file);
+    BAIL_IF_ERRPASS(!io, 0);
+    retval = doMount(io, fname, mountPoint, appendToPath);
+    if (!retval)
+    {
+        /* docs say not to destruct in case of failure, so cheat. */
+        io->opaque = NULL;
+        io->destroy(io);
+    } /* if */
+
+    return retval;
+} /* PHYSFS_mountHandle */
+
+
+int PHYSFS_mount(const char *newDir, const char *mountPoint, int appendToPath)
+{
+    BAIL_IF(!newDir, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    return doMount(NULL, newDir, mountPoint, appendToPath);
+} /* PHYSFS_mount */
+
+
+int PHYSFS_addToSearchPath(const char *newDir, int appendToPath)
+{
+    return PHYSFS_mount(newDir, NULL, appendToPath);
+} /* PHYSFS_addToSearchPath */
+
+
+int PHYSFS_removeFromSearchPath(const char *oldDir)
+{
+    return PHYSFS_unmount(oldDir);
+} /* PHYSFS_removeFromSearchPath */
+
+
+int PHYSFS_unmount(const char *oldDir)
+{
+    DirHandle *i;
+    DirHandle *prev = NULL;
+    DirHandle *next = NULL;
+
+    BAIL_IF(oldDir == NULL, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        if (strcmp(i->dirName, oldDir) == 0)
+        {
+            next = i->next;
+            BAIL_IF_MUTEX_ERRPASS(!freeDirHandle(i, openReadList),
+                                stateLock, 0);
+
+            if (prev == NULL)
+                searchPath = next;
+            else
+                prev->next = next;
+
+            searchPathGeneration++;
+            BAIL_MUTEX_ERRPASS(stateLock, 1);
+        } /* if */
+        prev = i;
+    } /* for */
+
+    BAIL_MUTEX(PHYSFS_ERR_NOT_MOUNTED, stateLock, 0);
+} /* PHYSFS_unmount */
+
+
+int PHYSFS_refreshMount(const char *dir)
+{
+    DirHandle *i;
+
+    BAIL_IF(dir == NULL, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        if (strcmp(i->dirName, dir) == 0)
+        {
+            int retval;
+            BAIL_IF_MUTEX(!i->funcs->refresh, PHYSFS_ERR_UNSUPPORTED, stateLock, 0);
+            retval = i->funcs->refresh(i->opaque);
+            searchPathGeneration++;  /* directories may have come or gone. */
+            __PHYSFS_platformReleaseMutex(stateLock);
+            return retval;
+        } /* if */
+    } /* for */
+
+    BAIL_MUTEX(PHYSFS_ERR_NOT_MOUNTED, stateLock, 0);
+} /* PHYSFS_refreshMount */
+
+
+int PHYSFS_setArchiveIndexDir(const char *dir)
+{
+    char *ptr = NULL;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+
+    if (dir != NULL)
+    {
+        const char dirsep = __PHYSFS_platformDirSeparator;
+        size_t len = strlen(dir);
+        const int addsep = ((len == 0) || (dir[len - 1] != dirsep));
+        ptr = (char *) allocator.Malloc(len + addsep + 1);
+        BAIL_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        memcpy(ptr, dir, len);
+        if (addsep)
+            ptr[len++] = dirsep;
+        ptr[len] = '\0';
+    } /* if */
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    if (archiveIndexDir != NULL)
+        allocator.Free(archiveIndexDir);
+    archiveIndexDir = ptr;
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    return 1;
+} /* PHYSFS_setArchiveIndexDir */
+
+
+int PHYSFS_setExtractCache(const char *dir, PHYSFS_uint64 budget)
+{
+    char *ptr = NULL;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+
+    if ((dir != NULL) && (budget > 0))
+    {
+        const char dirsep = __PHYSFS_platformDirSeparator;
+        size_t len = strlen(dir);
+        const int addsep = ((len == 0) || (dir[len - 1] != dirsep));
+        ptr = (char *) allocator.Malloc(len + addsep + 1);
+        BAIL_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        memcpy(ptr, dir, len);
+        if (addsep)
+            ptr[len++] = dirsep;
+        ptr[len] = '\0';
+    } /* if */
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    if (extractCacheDir != NULL)
+        allocator.Free(extractCacheDir);
+    extractCacheDir = ptr;
+    extractCacheBudget = ptr ? budget : 0;
+    if (ptr == NULL)
+        extractCacheClear();
+    else
+    {
+        extractCacheScan();  /* the only time we look at the whole thing. */
+        extractCacheMakeRoom(0);  /* the budget might have shrunk. */
+    } /* else */
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    return 1;
+} /* PHYSFS_setExtractCache */
+
+
+int PHYSFS_setMaxOpenFiles(PHYSFS_uint32 max)
+{
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+
+    nativeFdGrabLock();
+    nativeFdMax = max;
+    if (max)
+        nativeFdMakeRoom(max);
+    nativeFdReleaseLock();
+    return 1;
+} /* PHYSFS_setMaxOpenFiles */
+
+
+const char *__PHYSFS_getArchiveIndexDir(void)
+{
+    return archiveIndexDir;  /* archivers only ask while we hold stateLock. */
+} /* __PHYSFS_getArchiveIndexDir */
+
+
+char *__PHYSFS_archiveIndexPath(const char *fname, const char *ext, char **key)
+{
+    size_t keylen;
+    size_t len;
+    char *retval;
+
+    *key = NULL;
+    if (archiveIndexDir == NULL)
+        return NULL;
+
+    *key = __PHYSFS_platformCanonicalPath(fname);
+    BAIL_IF_ERRPASS(!*key, NULL);
+    keylen = strlen(*key);
+
+    len = strlen(archiveIndexDir) + strlen(ext) + 18;
+    retval = (char *) allocator.Malloc(len);
+    if (!retval)
+    {
+        allocator.Free(*key);
+        *key = NULL;
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    } /* if */
+
+    snprintf(retval, len, "%s%08x%08x.%s", archiveIndexDir,
+             (unsigned int) __PHYSFS_hashString(*key, keylen),
+             (unsigned int) keylen, ext);
+    return retval;
+} /* __PHYSFS_archiveIndexPath */
+
+
+/*
+ * Preloaded snapshots: everything under a directory, read into one block
+ *  of memory and mounted in front of the search path. The snapshot is a
+ *  plain UNPK archive over a memoryIo, so opening a file in it is a window
+ *  of that block.
+ */
+
+#define PRELOAD_PREFIX "preload:"
+
+typedef struct
+{
+    char *name;  /* relative to the preloaded directory. */
+    PHYSFS_uint64 pos;
+    PHYSFS_uint64 len;
+    PHYSFS_sint64 ctime;
+    PHYSFS_sint64 mtime;
+    int isdir;
+} PreloadEntry;
+
+typedef struct
+{
+    size_t baselen;  /* chars to skip to get from a full path to a name. */
+    PreloadEntry *entries;
+    size_t count;
+    size_t allocated;
+    PHYSFS_uint64 total;
+} PreloadData;
+
+static void *preloadOpenArchive(PHYSFS_Io *io, const char *name,
+                                int forWriting, int *claimed)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* only PHYSFS_preload() makes these. */
+} /* preloadOpenArchive */
+
+static const PHYSFS_Archiver __PHYSFS_Archiver_PRELOAD =
+{
+    CURRENT_PHYSFS_ARCHIVER_API_VERSION,
+    {
+        "",
+        "Preloaded snapshot",
+        "",
+        "https://icculus.org/physfs/",
+        0,  /* supportsSymlinks */
+    },
+    preloadOpenArchive,
+    UNPK_enumerate,
+    UNPK_openRead,
+    UNPK_openWrite,
+    UNPK_openAppend,
+    UNPK_remove,
+    UNPK_mkdir,
+    UNPK_stat,
+    UNPK_closeArchive,
+    NULL,  /* fingerprint */
+    NULL,  /* refresh */
+    NULL   /* sniff */
+};
+
+static int isMounted(const char *dirName)
+{
+    const DirHandle *i;
+    int retval = 0;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    for (i = searchPath; (i != NULL) && (!retval); i = i->next)
+        retval = (strcmp(i->dirName, dirName) == 0);
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    return retval;
+} /* isMounted */
+
+static void freePreloadData(PreloadData *data)
+{
+    size_t i;
+    for (i = 0; i < data->count; i++)
+        allocator.Free(data->entries[i].name);
+    allocator.Free(data->entries);
+} /* freePreloadData */
+
+static int preloadScan(PreloadData *data, const char *dir);
+
+static int preloadAddEntry(PreloadData *data, const char *dir,
+                           size_t dirlen, const char *f)
+{
+    const size_t len = dirlen + strlen(f) + 2;
+    PHYSFS_Stat statbuf;
+    PreloadEntry *entry;
+    char *path;
+
+    path = (char *) allocator.Malloc(len);
+    BAIL_IF(!path, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+
+    if (dirlen == 0)
+        strcpy(path, f);
+    else
+        snprintf(path, len, "%s/%s", dir, f);
+
+    if (!PHYSFS_stat(path, &statbuf))
+    {
+        allocator.Free(path);
+        return 1;  /* vanished, or a symlink we can't follow. */
+    } /* if */
+    else if ( (statbuf.filetype != PHYSFS_FILETYPE_REGULAR) &&
+              (statbuf.filetype != PHYSFS_FILETYPE_DIRECTORY) )
+    {
+        allocator.Free(path);
+        return 1;
+    } /* else if */
+
+    if (data->count == data->allocated)
+    {
+        const size_t newalloc = data->allocated ? data->allocated * 2 : 64;
+        void *ptr = allocator.Realloc(data->entries,
+                                      newalloc * sizeof (PreloadEntry));
+        if (!ptr)
+        {
+            allocator.Free(path);
+            BAIL(PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        } /* if */
+        data->entries = (PreloadEntry *) ptr;
+        data->allocated = newalloc;
+    } /* if */
+
+    entry = &data->entries[data->count++];
+    entry->name = path;
+    entry->isdir = (statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY);
+    entry->pos = data->total;
+    entry->len = entry->isdir ? 0 : (PHYSFS_uint64) statbuf.filesize;
+    entry->ctime = statbuf.createtime;
+    entry->mtime = statbuf.modtime;
+    data->total += entry->len;
+
+    return entry->isdir ? preloadScan(data, path) : 1;
+} /* preloadAddEntry */
+
+/*
+ * PHYSFS_enumerateFiles() merges every mount's view of (dir), so a path
+ *  that several archives supply is only sized, copied and recursed into
+ *  once; PHYSFS_stat() and PHYSFS_openRead() pick the same copy of it.
+ */
+static int preloadScan(PreloadData *data, const char *dir)
+{
+    char **list = PHYSFS_enumerateFiles(dir);
+    const size_t dirlen = strlen(dir);
+    int retval = 1;
+    char **i;
+
+    BAIL_IF_ERRPASS(!list, 0);
+    for (i = list; (retval) && (*i != NULL); i++)
+        retval = preloadAddEntry(data, dir, dirlen, *i);
+    PHYSFS_freeList(list);
+    return retval;
+} /* preloadScan */
+
+/* Read each file straight into its slot of (buf), in one read apiece. */
+static int preloadReadFiles(PreloadData *data, PHYSFS_uint8 *buf)
+{
+    size_t i;
+    for (i = 0; i < data->count; i++)
+    {
+        const PreloadEntry *entry = &data->entries[i];
+        PHYSFS_File *f;
+        PHYSFS_sint64 br;
+
+        if (entry->isdir)
+            continue;
+
+        f = PHYSFS_openRead(entry->name);
+        BAIL_IF_ERRPASS(!f, 0);
+        br = PHYSFS_readBytes(f, buf + entry->pos, entry->len);
+        PHYSFS_close(f);
+        BAIL_IF_ERRPASS(br < 0, 0);
+        BAIL_IF(((PHYSFS_uint64) br) != entry->len, PHYSFS_ERR_CORRUPT, 0);
+    } /* for */
+
+    return 1;
+} /* preloadReadFiles */
+
+int PHYSFS_preload(const char *_dir)
+{
+    PreloadData data;
+    PHYSFS_uint8 *buf = NULL;
+    PHYSFS_Io *io = NULL;
+    void *opaque = NULL;
+    DirHandle *dh = NULL;
+    char *dir = NULL;
+    size_t dirlen;
+    size_t i;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    BAIL_IF(!_dir, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    memset(&data, '\0', sizeof (data));
+
+    dirlen = strlen(_dir);
+    dh = (DirHandle *) allocator.Malloc(sizeof (DirHandle));
+    GOTO_IF(!dh, PHYSFS_ERR_OUT_OF_MEMORY, preload_failed);
+    memset(dh, '\0', sizeof (DirHandle));
+    dh->dirName = (char *) allocator.Malloc(strlen(PRELOAD_PREFIX) + dirlen + 1);
+    GOTO_IF(!dh->dirName, PHYSFS_ERR_OUT_OF_MEMORY, preload_failed);
+    dir = dh->dirName + strlen(PRELOAD_PREFIX);
+    strcpy(dh->dirName, PRELOAD_PREFIX);
+    GOTO_IF_ERRPASS(!sanitizePlatformIndependentPath(_dir, dir), preload_failed);
+    dirlen = strlen(dir);
+
+    /* already preloaded? Same answer as mounting something twice. */
+    if (isMounted(dh->dirName))
+    {
+        allocator.Free(dh->dirName);
+        allocator.Free(dh);
+        return 1;
+    } /* if */
+
+    /* find everything first, so we can do a single allocation... */
+    data.baselen = dirlen ? dirlen + 1 : 0;
+    GOTO_IF_ERRPASS(!preloadScan(&data, dir), preload_failed);
+
+    GOTO_IF(data.total != (PHYSFS_uint64) (size_t) data.total, PHYSFS_ERR_OUT_OF_MEMORY, preload_failed);
+    buf = (PHYSFS_uint8 *) allocator.Malloc(data.total ? (size_t) data.total : 1);
+    GOTO_IF(!buf, PHYSFS_ERR_OUT_OF_MEMORY, preload_failed);
+
+    /* ...then fill it. */
+    GOTO_IF_ERRPASS(!preloadReadFiles(&data, buf), preload_failed);
+
+    io = __PHYSFS_createMemoryIo(buf, data.total, allocator.Free);
+    GOTO_IF_ERRPASS(!io, preload_failed);
+    buf = NULL;  /* io owns it now. */
+
+    opaque = UNPK_openArchive(io);
+    GOTO_IF_ERRPASS(!opaque, preload_failed);
+    io = NULL;  /* archive owns it now. */
+
+    for (i = 0; i < data.count; i++)
+    {
+        PreloadEntry *entry = &data.entries[i];
+        GOTO_IF_ERRPASS(!UNPK_addEntry(opaque, entry->name + data.baselen,
+                                       entry->isdir, entry->ctime,
+                                       entry->mtime, entry->pos,
+                                       entry->len), preload_failed);
+    } /* for */
+
+    if (dirlen > 0)
+    {
+        dh->mountPoint = (char *) allocator.Malloc(dirlen + 2);
+        GOTO_IF(!dh->mountPoint, PHYSFS_ERR_OUT_OF_MEMORY, preload_failed);
+        strcpy(dh->mountPoint, dir);
+        strcat(dh->mountPoint, "/");
+    } /* if */
+
+    dh->funcs = &__PHYSFS_Archiver_PRELOAD;
+    dh->opaque = opaque;
+    freePreloadData(&data);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    if (isMounted(dh->dirName))  /* another thread beat us to it. */
+    {
+        __PHYSFS_platformReleaseMutex(stateLock);
+        freeDirHandle(dh, NULL);
+        return 1;
+    } /* if */
+    dh->next = searchPath;
+    searchPath = dh;
+    searchPathGeneration++;
+    __PHYSFS_platformReleaseMutex(stateLock);
+    return 1;
+
+preload_failed:
+    freePreloadData(&data);
+    if (opaque != NULL) UNPK_closeArchive(opaque);
+    if (io != NULL) io->destroy(io);
+    if (buf != NULL) allocator.Free(buf);
+    if (dh != NULL)
+    {
+        allocator.Free(dh->mountPoint);
+        allocator.Free(dh->dirName);
+        allocator.Free(dh);
+    } /* if */
+    return 0;
+} /* PHYSFS_preload */
+
+
+int PHYSFS_releasePreload(const char *_dir)
+{
+    char *name;
+    int retval;
+
+    BAIL_IF(!_dir, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    name = (char *) __PHYSFS_smallAlloc(strlen(PRELOAD_PREFIX) + strlen(_dir) + 1);
+    BAIL_IF(!name, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    strcpy(name, PRELOAD_PREFIX);
+    retval = sanitizePlatformIndependentPath(_dir, name + strlen(PRELOAD_PREFIX));
+    if (retval)
+        retval = PHYSFS_unmount(name);
+    __PHYSFS_smallFree(name);
+    return retval;
+} /* PHYSFS_releasePreload */
+
+
+char **PHYSFS_getSearchPath(void)
+{
+    return doEnumStringList(PHYSFS_getSearchPathCallback);
+} /* PHYSFS_getSearchPath */
+
+
+const char *PHYSFS_getMountPoint(const char *dir)
+{
+    DirHandle *i;
+    __PHYSFS_platformGrabMutex(stateLock);
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        if (strcmp(i->dirName, dir) == 0)
+        {
+            const char *retval = ((i->mountPoint) ? i->mountPoint : "/");
+            __PHYSFS_platformReleaseMutex(stateLock);
+            return retval;
+        } /* if */
+    } /* for */
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    BAIL(PHYSFS_ERR_NOT_MOUNTED, NULL);
+} /* PHYSFS_getMountPoint */
+
+
+void PHYSFS_getSearchPathCallback(PHYSFS_StringCallback callback, void *data)
+{
+    DirHandle *i;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    for (i = searchPath; i != NULL; i = i->next)
+        callback(data, i->dirName);
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+} /* PHYSFS_getSearchPathCallback */
+
+
+typedef struct setSaneCfgEnumData
+{
+    const char *archiveExt;
+    size_t archiveExtLen;
+    int archivesFirst;
+    PHYSFS_ErrorCode errcode;
+} setSaneCfgEnumData;
+
+static PHYSFS_EnumerateCallbackResult setSaneCfgEnumCallback(void *_data,
+                                                const char *dir, const char *f)
+{
+    setSaneCfgEnumData *data = (setSaneCfgEnumData *) _data;
+    const size_t extlen = data->archiveExtLen;
+    const size_t l = strlen(f);
+    const char *ext;
+
+    if ((l > extlen) && (f[l - extlen - 1] == '.'))
+    {
+        ext = f + (l - extlen);
+        if (PHYSFS_utf8stricmp(ext, data->archiveExt) == 0)
+        {
+            const char dirsep = __PHYSFS_platformDirSeparator;
+            const char *d = PHYSFS_getRealDir(f);
+            const size_t allocsize = strlen(d) + l + 2;
+            char *str = (char *) __PHYSFS_smallAlloc(allocsize);
+            if (str == NULL)
+                data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+            else
+            {
+                snprintf(str, allocsize, "%s%c%s", d, dirsep, f);
+                if (!PHYSFS_mount(str, NULL, data->archivesFirst == 0))
+                    data->errcode = currentErrorCode();
+                __PHYSFS_smallFree(str);
+            } /* else */
+        } /* if */
+    } /* if */
+
+    /* !!! FIXME: if we want to abort on errors... */
+    /*return (data->errcode != PHYSFS_ERR_OK) ? PHYSFS_ENUM_ERROR : PHYSFS_ENUM_OK;*/
+
+    return PHYSFS_ENUM_OK;  /* keep going */
+} /* setSaneCfgEnumCallback */
+
+
+int PHYSFS_setSaneConfig(const char *organization, const char *appName,
+                         const char *archiveExt, int includeCdRoms,
+                         int archivesFirst)
+{
+    const char *basedir;
+    const char *prefdir;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+
+    prefdir = PHYSFS_getPrefDir(organization, appName);
+    BAIL_IF_ERRPASS(!prefdir, 0);
+
+    basedir = PHYSFS_getBaseDir();
+    BAIL_IF_ERRPASS(!basedir, 0);
+
+    BAIL_IF(!PHYSFS_setWriteDir(prefdir), PHYSFS_ERR_NO_WRITE_DIR, 0);
+
+    /* !!! FIXME: these can fail and we should report that... */
+
+    /* Put write dir first in search path... */
+    PHYSFS_mount(prefdir, NULL, 0);
+
+    /* Put base path on search path... */
+    PHYSFS_mount(basedir, NULL, 1);
+
+    /* handle CD-ROMs... */
+    if (includeCdRoms)
+    {
+        char **cds = PHYSFS_getCdRomDirs();
+        char **i;
+        for (i = cds; *i != NULL; i++)
+            PHYSFS_mount(*i, NULL, 1);
+        PHYSFS_freeList(cds);
+    } /* if */
+
+    /* Root out archives, and add them to search path... */
+    if (archiveExt != NULL)
+    {
+        setSaneCfgEnumData data;
+        memset(&data, '\0', sizeof (data));
+        data.archiveExt = archiveExt;
+        data.archiveExtLen = strlen(archiveExt);
+        data.archivesFirst = archivesFirst;
+        data.errcode = PHYSFS_ERR_OK;
+        if (!PHYSFS_enumerate("/", setSaneCfgEnumCallback, &data))
+        {
+            /* !!! FIXME: use this if we're reporting errors.
+            PHYSFS_ErrorCode errcode = currentErrorCode();
+            if (errcode == PHYSFS_ERR_APP_CALLBACK)
+                errcode = data->errcode; */
+        } /* if */
+    } /* if */
+
+    return 1;
+} /* PHYSFS_setSaneConfig */
+
+
+void PHYSFS_permitSymbolicLinks(int allow)
+{
+    allowSymLinks = allow;
+} /* PHYSFS_permitSymbolicLinks */
+
+
+int PHYSFS_symbolicLinksPermitted(void)
+{
+    return allowSymLinks;
+} /* PHYSFS_symbolicLinksPermitted */
+
+
+/*
+ * The symlink half of verifyPath(): stat each element of (fname), from the
+ *  one starting at (start) on, in (h), and fail if one is a symlink. The
+ *  elements before (start) must have been checked already. Returns zero
+ *  if an element is a symlink or, unless it's the last one or (allowMissing)
+ *  is set, missing. (fname) is scratch space, but is restored on return.
+ */
+static int verifySymLinks(DirHandle *h, char *fname, char *start,
+                          int allowMissing)
+{
+    int retval = 1;
+    char *end;
+
+    while (1)
+    {
+        PHYSFS_Stat statbuf;
+        int rc = 0;
+        end = strchr(start, '/');
+
+        if (end != NULL) *end = '\0';
+        rc = h->funcs->stat(h->opaque, fname, &statbuf);
+        if (rc)
+            rc = (statbuf.filetype == PHYSFS_FILETYPE_SYMLINK);
+        else if (currentErrorCode() == PHYSFS_ERR_NOT_FOUND)
+            retval = 0;
+
+        if (end != NULL) *end = '/';
+
+        /* insecure path (has a disallowed symlink in it)? */
+        BAIL_IF(rc, PHYSFS_ERR_SYMLINK_FORBIDDEN, 0);
+
+        /* break out early if path element is missing. */
+        if (!retval)
+        {
+            /*
+             * We need to clear it if it's the last element of the path,
+             *  since this might be a non-existant file we're opening
+             *  for writing...
+             */
+            if ((end == NULL) || (allowMissing))
+                retval = 1;
+            break;
+        } /* if */
+
+        if (end == NULL)
+            break;
+
+        start = end + 1;
+    } /* while */
+
+    return retval;
+} /* verifySymLinks */
+
+
+/*
+ * Verify that (fname) (in platform-independent notation), in relation
+ *  to (h) is secure. That means that each element of fname is checked
+ *  for symlinks (if they aren't permitted). This also allows for quick
+ *  rejection of files that exist outside an archive's mountpoint.
+ *
+ * With some exceptions (like PHYSFS_mkdir(), which builds multiple subdirs
+ *  at a time), you should always pass zero for "allowMissing" for efficiency.
+ *
+ * (fname) must point to an output from sanitizePlatformIndependentPath(),
+ *  since it will make sure that path names are in the right format for
+ *  passing certain checks. It will also do checks for "insecure" pathnames
+ *  like ".." which should be done once instead of once per archive. This also
+ *  gives us license to treat (fname) as scratch space in this function.
+ *
+ * (fname)'s buffer must have enough space available before it for this
+ *  function to prepend any root directory for this DirHandle.
+ *
+ * Returns non-zero if string is safe, zero if there's a security issue.
+ *  PHYSFS_getLastError() will specify what was wrong. (*fname) will be
+ *  updated to point past any mount point elements so it is prepared to
+ *  be used with the archiver directly.
+ */
+static int verifyPath(DirHandle *h, char **_fname, int allowMissing)
+{
+    char *fname = *_fname;
+    int retval = 1;
+
+    if ((*fname == '\0') && (!h->root))  /* quick rejection. */
+        return 1;
+
+    /* !!! FIXME: This codeblock sucks. */
+    if (h->mountPoint != NULL)  /* NULL mountpoint means "/". */
+    {
+        size_t mntpntlen = strlen(h->mountPoint);
+        size_t len = strlen(fname);
+        assert(mntpntlen > 1); /* root mount points should be NULL. */
+        /* not under the mountpoint, so skip this archive. */
+        BAIL_IF(len < mntpntlen-1, PHYSFS_ERR_NOT_FOUND, 0);
+        /* !!! FIXME: Case insensitive? */
+        retval = strncmp(h->mountPoint, fname, mntpntlen-1);
+        BAIL_IF(retval != 0, PHYSFS_ERR_NOT_FOUND, 0);
+        if (len > mntpntlen-1)  /* corner case... */
+            BAIL_IF(fname[mntpntlen-1]!='/', PHYSFS_ERR_NOT_FOUND, 0);
+        fname += mntpntlen-1;  /* move to start of actual archive path. */
+        if (*fname == '/')
+            fname++;
+        *_fname = fname;  /* skip mountpoint for later use. */
+        retval = 1;  /* may be reset, below. */
+    } /* if */
+
+    /* prepend the root directory, if any. */
+    if (h->root)
+    {
+        const int isempty = (*fname == '\0');
+        fname -= h->rootlen - 1;
+        strcpy(fname, h->root);
+        if (!isempty)
+            fname[h->rootlen - 2] = '/';
+        *_fname = fname;
+    } /* if */
+
+    if (!allowSymLinks)
+        retval = verifySymLinks(h, fname, fname, allowMissing);
+
+    return retval;
+} /* verifyPath */
+
+
+/* This must hold the stateLock before calling. */
+static int doMkdir(const char *_dname, char *dname)
+{
+    DirHandle *h = writeDir;
+    char *start;
+    char *end;
+    int retval = 0;
+    int exists = 1;  /* force existance check on first path element. */
+
+    assert(h != NULL);
+
+    BAIL_IF_ERRPASS(!sanitizePlatformIndependentPathWithRoot(h, _dname, dname), 0);
+    BAIL_IF_ERRPASS(!verifyPath(h, &dname, 1), 0);
+
+    start = dname;
+    while (1)
+    {
+        end = strchr(start, '/');
+        if (end != NULL)
+            *end = '\0';
+
+        /* only check for existance if all parent dirs existed, too... */
+        if (exists)
+        {
+            PHYSFS_Stat statbuf;
+            const int rc = h->funcs->stat(h->opaque, dname, &statbuf);
+            if ((!rc) && (currentErrorCode() == PHYSFS_ERR_NOT_FOUND))
+                exists = 0;
+            retval = ((rc) && (statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY));
+        } /* if */
+
+        if (!exists)
+            retval = h->funcs->mkdir(h->opaque, dname);
+
+        if (!retval)
+            break;
+
+        if (end == NULL)
+            break;
+
+        *end = '/';
+        start = end + 1;
+    } /* while */
+
+    return retval;
+} /* doMkdir */
+
+
+int PHYSFS_mkdir(const char *_dname)
+{
+    int retval = 0;
+    char *dname;
+    size_t len;
+
+    BAIL_IF(!_dname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    BAIL_IF_MUTEX(!writeDir, PHYSFS_ERR_NO_WRITE_DIR, stateLock, 0);
+    len = strlen(_dname) + dirHandleRootLen(writeDir) + 1;
+    dname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!dname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    retval = doMkdir(_dname, dname);
+    searchPathGeneration++;  /* in case the write dir is mounted, too. */
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(dname);
+    return retval;
+} /* PHYSFS_mkdir */
+
+
+/* This must hold the stateLock before calling. */
+static int doDelete(const char *_fname, char *fname)
+{
+    DirHandle *h = writeDir;
+    BAIL_IF_ERRPASS(!sanitizePlatformIndependentPathWithRoot(h, _fname, fname), 0);
+    BAIL_IF_ERRPASS(!verifyPath(h, &fname, 0), 0);
+    return h->funcs->remove(h->opaque, fname);
+} /* doDelete */
+
+
+int PHYSFS_delete(const char *_fname)
+{
+    int retval;
+    char *fname;
+    size_t len;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    BAIL_IF_MUTEX(!writeDir, PHYSFS_ERR_NO_WRITE_DIR, stateLock, 0);
+    len = strlen(_fname) + dirHandleRootLen(writeDir) + 1;
+    fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    retval = doDelete(_fname, fname);
+    if (retval)
+    {
+        residentForget(_fname);
+        searchPathGeneration++;  /* in case the write dir is mounted, too. */
+    } /* if */
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(fname);
+    return retval;
+} /* PHYSFS_delete */
+
+
+/* MAKE SURE you hold stateLock before calling this! */
+static DirHandle *doGetRealDirHandle(char *fname, const InternedPath *ip)
+{
+    DirHandle *i;
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        char *arcfname = fname;
+        if (partOfMountPoint(i, arcfname))
+            return i;
+        else if (verifyPath(i, &arcfname, 0))
+        {
+            PHYSFS_Stat statbuf;
+            PHYSFS_uint32 hash = 0;
+            const int hashed = internedHash(ip, i, fname, arcfname, &hash);
+            if (archiverStat(i, arcfname, hashed, hash, &statbuf))
+                return i;
+        } /* if */
+    } /* for */
+
+    return NULL;
+} /* doGetRealDirHandle */
+
+static DirHandle *getRealDirHandle(const char *_fname)
+{
+    DirHandle *retval = NULL;
+    char *allocated_fname = NULL;
+    char *fname = NULL;
+    size_t len;
+
+    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    len = strlen(_fname) + longest_root + 1;
+    allocated_fname = __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, NULL);
+    fname = allocated_fname + longest_root;
+    if (sanitizePlatformIndependentPath(_fname, fname))
+        retval = doGetRealDirHandle(fname, NULL);
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    return retval;
+} /* getRealDirHandle */
+
+const char *PHYSFS_getRealDir(const char *fname)
+{
+    DirHandle *dh = getRealDirHandle(fname);
+    return dh ? dh->dirName : NULL;
+} /* PHYSFS_getRealDir */
+
+
+static int locateInStringList(const char *str,
+                              char **list,
+                              PHYSFS_uint32 *pos)
+{
+    PHYSFS_uint32 len = *pos;
+    PHYSFS_uint32 half_len;
+    PHYSFS_uint32 lo = 0;
+    PHYSFS_uint32 middle;
+    int cmp;
+
+    while (len > 0)
+    {
+        half_len = len >> 1;
+        middle = lo + half_len;
+        cmp = strcmp(list[middle], str);
+
+        if (cmp == 0)  /* it's in the list already. */
+            return 1;
+        else if (cmp > 0)
+            len = half_len;
+        else
+        {
+            lo = middle + 1;
+            len -= half_len + 1;
+        } /* else */
+    } /* while */
+
+    *pos = lo;
+    return 0;
+} /* locateInStringList */
+
+
+static PHYSFS_EnumerateCallbackResult enumFilesCallback(void *data,
+                                        const char *origdir, const char *str)
+{
+    PHYSFS_uint32 pos;
+    void *ptr;
+    char *newstr;
+    EnumStringListCallbackData *pecd = (EnumStringListCallbackData *) data;
+
+    /*
+     * See if file is in the list already, and if not, insert it in there
+     *  alphabetically...
+     */
+    pos = pecd->size;
+    if (locateInStringList(str, pecd->list, &pos))
+        return PHYSFS_ENUM_OK;  /* already in the list, but keep going. */
+
+    ptr = allocator.Realloc(pecd->list, (pecd->size + 2) * sizeof (char *));
+    newstr = (char *) allocator.Malloc(strlen(str) + 1);
+    if (ptr != NULL)
+        pecd->list = (char **) ptr;
+
+    if ((ptr == NULL) || (newstr == NULL))
+    {
+        if (newstr)
+            allocator.Free(newstr);
+
+        pecd->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+        return PHYSFS_ENUM_ERROR;  /* better luck next time. */
+    } /* if */
+
+    strcpy(newstr, str);
+
+    if (pos != pecd->size)
+    {
+        memmove(&pecd->list[pos+1], &pecd->list[pos],
+                 sizeof (char *) * ((pecd->size) - pos));
+    } /* if */
+
+    pecd->list[pos] = newstr;
+    pecd->size++;
+
+    return PHYSFS_ENUM_OK;
+} /* enumFilesCallback */
+
+
+char **PHYSFS_enumerateFiles(const char *path)
+{
+    EnumStringListCallbackData ecd;
+    memset(&ecd, '\0', sizeof (ecd));
+    ecd.list = (char **) allocator.Malloc(sizeof (char *));
+    BAIL_IF(!ecd.list, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    if (!PHYSFS_enumerate(path, enumFilesCallback, &ecd))
+    {
+        const PHYSFS_ErrorCode errcode = currentErrorCode();
+        PHYSFS_uint32 i;
+        for (i = 0; i < ecd.size; i++)
+            allocator.Free(ecd.list[i]);
+        allocator.Free(ecd.list);
+        BAIL_IF(errcode == PHYSFS_ERR_APP_CALLBACK, ecd.errcode, NULL);
+        return NULL;
+    } /* if */
+
+    ecd.list[ecd.size] = NULL;
+    return ecd.list;
+} /* PHYSFS_enumerateFiles */
+
+
+/*
+ * Broke out to seperate function so we can use stack allocation gratuitously.
+ */
+static PHYSFS_EnumerateCallbackResult enumerateFromMountPoint(DirHandle *i,
+                                    const char *arcfname,
+                                    PHYSFS_EnumerateCallback callback,
+                                    const char *_fname, void *data)
+{
+    PHYSFS_EnumerateCallbackResult retval;
+    const size_t len = strlen(arcfname);
+    char *ptr = NULL;
+    char *end = NULL;
+    const size_t slen = strlen(i->mountPoint) + 1;
+    char *mountPoint = (char *) __PHYSFS_smallAlloc(slen);
+
+    BAIL_IF(!mountPoint, PHYSFS_ERR_OUT_OF_MEMORY, PHYSFS_ENUM_ERROR);
+
+    strcpy(mountPoint, i->mountPoint);
+    ptr = mountPoint + ((len) ? len + 1 : 0);
+    end = strchr(ptr, '/');
+    assert(end);  /* should always find a terminating '/'. */
+    *end = '\0';
+    retval = callback(data, _fname, ptr);
+    __PHYSFS_smallFree(mountPoint);
+
+    BAIL_IF(retval == PHYSFS_ENUM_ERROR, PHYSFS_ERR_APP_CALLBACK, retval);
+    return retval;
+} /* enumerateFromMountPoint */
+
+
+typedef struct SymlinkFilterData
+{
+    PHYSFS_EnumerateCallback callback;
+    void *callbackData;
+    DirHandle *dirhandle;
+    const char *arcfname;
+    PHYSFS_ErrorCode errcode;
+} SymlinkFilterData;
+
+static PHYSFS_EnumerateCallbackResult enumCallbackFilterSymLinks(void *_data,
+                                    const char *origdir, const char *fname)
+{
+    SymlinkFilterData *data = (SymlinkFilterData *) _data;
+    const DirHandle *dh = data->dirhandle;
+    const char *arcfname = data->arcfname;
+    PHYSFS_Stat statbuf;
+    const char *trimmedDir = (*arcfname == '/') ? (arcfname + 1) : arcfname;
+    const size_t slen = strlen(trimmedDir) + strlen(fname) + 2;
+    char *path = (char *) __PHYSFS_smallAlloc(slen);
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+
+    if (path == NULL)
+    {
+        data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+        return PHYSFS_ENUM_ERROR;
+    } /* if */
+
+    snprintf(path, slen, "%s%s%s", trimmedDir, *trimmedDir ? "/" : "", fname);
+
+    if (!dh->funcs->stat(dh->opaque, path, &statbuf))
+    {
+        data->errcode = currentErrorCode();
+        retval = PHYSFS_ENUM_ERROR;
+    } /* if */
+    else
+    {
+        /* Pass it on to the application if it's not a symlink. */
+        if (statbuf.filetype != PHYSFS_FILETYPE_SYMLINK)
+        {
+            retval = data->callback(data->callbackData, origdir, fname);
+            if (retval == PHYSFS_ENUM_ERROR)
+                data->errcode = PHYSFS_ERR_APP_CALLBACK;
+        } /* if */
+    } /* else */
+
+    __PHYSFS_smallFree(path);
+
+    return retval;
+} /* enumCallbackFilterSymLinks */
+
+
+/*
+ * Enumerate (arcfname), already run through verifyPath(), in (i), if it's a
+ *  directory there. (origdir) is the name the app asked for.
+ *  MAKE SURE you hold stateLock before calling this!
+ */
+static PHYSFS_EnumerateCallbackResult enumerateArchive(DirHandle *i,
+                                    const char *arcfname,
+                                    PHYSFS_EnumerateCallback cb,
+                                    const char *origdir, void *data)
+{
+    PHYSFS_EnumerateCallbackResult retval;
+    PHYSFS_Stat statbuf;
+
+    if (!i->funcs->stat(i->opaque, arcfname, &statbuf))
+        return PHYSFS_ENUM_OK;  /* no such dir in this archive, skip it. */
+
+    else if (statbuf.filetype != PHYSFS_FILETYPE_DIRECTORY)
+        return PHYSFS_ENUM_OK;  /* not a directory in this archive, skip it. */
+
+    else if ((!allowSymLinks) && (i->funcs->info.supportsSymlinks))
+    {
+        SymlinkFilterData filterdata;
+        memset(&filterdata, '\0', sizeof (filterdata));
+        filterdata.callback = cb;
+        filterdata.callbackData = data;
+        filterdata.dirhandle = i;
+        filterdata.arcfname = arcfname;
+        filterdata.errcode = PHYSFS_ERR_OK;
+        retval = i->funcs->enumerate(i->opaque, arcfname,
+                                     enumCallbackFilterSymLinks,
+                                     origdir, &filterdata);
+        if (retval == PHYSFS_ENUM_ERROR)
+        {
+            if (currentErrorCode() == PHYSFS_ERR_APP_CALLBACK)
+                PHYSFS_setErrorCode(filterdata.errcode);
+        } /* if */
+        return retval;
+    } /* else if */
+
+    return i->funcs->enumerate(i->opaque, arcfname, cb, origdir, data);
+} /* enumerateArchive */
+
+
+/* MAKE SURE you hold stateLock before calling this! */
+static PHYSFS_EnumerateCallbackResult doEnumerate(char *fname,
+                                    const char *origdir,
+                                    PHYSFS_EnumerateCallback cb, void *data)
+{
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    DirHandle *i;
+
+    for (i = searchPath; (retval == PHYSFS_ENUM_OK) && i; i = i->next)
+    {
+        char *arcfname = fname;
+
+        if (partOfMountPoint(i, arcfname))
+            retval = enumerateFromMountPoint(i, arcfname, cb, origdir, data);
+
+        else if (verifyPath(i, &arcfname, 0))
+            retval = enumerateArchive(i, arcfname, cb, origdir, data);
+    } /* for */
+
+    return retval;
+} /* doEnumerate */
+
+
+int PHYSFS_enumerate(const char *_fn, PHYSFS_EnumerateCallback cb, void *data)
+{
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    size_t len;
+    char *allocated_fname;
+    char *fname;
+
+    BAIL_IF(!_fn, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!cb, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    len = strlen(_fn) + longest_root + 1;
+    allocated_fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    fname = allocated_fname + longest_root;
+    if (!sanitizePlatformIndependentPath(_fn, fname))
+        retval = PHYSFS_ENUM_STOP;
+    else
+        retval = doEnumerate(fname, _fn, cb, data);
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    __PHYSFS_smallFree(allocated_fname);
+
+    return (retval == PHYSFS_ENUM_ERROR) ? 0 : 1;
+} /* PHYSFS_enumerate */
+
+
+typedef struct
+{
+    PHYSFS_EnumFilesCallback callback;
+    void *data;
+} LegacyEnumFilesCallbackData;
+
+static PHYSFS_EnumerateCallbackResult enumFilesCallbackAlwaysSucceed(void *d,
+                                    const char *origdir, const char *fname)
+{
+    LegacyEnumFilesCallbackData *cbdata = (LegacyEnumFilesCallbackData *) d;
+    cbdata->callback(cbdata->data, origdir, fname);
+    return PHYSFS_ENUM_OK;
+} /* enumFilesCallbackAlwaysSucceed */
+
+void PHYSFS_enumerateFilesCallback(const char *fname,
+                                   PHYSFS_EnumFilesCallback callback,
+                                   void *data)
+{
+    LegacyEnumFilesCallbackData cbdata;
+    cbdata.callback = callback;
+    cbdata.data = data;
+    (void) PHYSFS_enumerate(fname, enumFilesCallbackAlwaysSucceed, &cbdata);
+} /* PHYSFS_enumerateFilesCallback */
+
+
+int PHYSFS_exists(const char *fname)
+{
+    return (getRealDirHandle(fname) != NULL);
+} /* PHYSFS_exists */
+
+
+PHYSFS_sint64 PHYSFS_getLastModTime(const char *fname)
+{
+    PHYSFS_Stat statbuf;
+    BAIL_IF_ERRPASS(!PHYSFS_stat(fname, &statbuf), -1);
+    return statbuf.modtime;
+} /* PHYSFS_getLastModTime */
+
+
+int PHYSFS_isDirectory(const char *fname)
+{
+    PHYSFS_Stat statbuf;
+    BAIL_IF_ERRPASS(!PHYSFS_stat(fname, &statbuf), 0);
+    return (statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY);
+} /* PHYSFS_isDirectory */
+
+
+int PHYSFS_isSymbolicLink(const char *fname)
+{
+    PHYSFS_Stat statbuf;
+    BAIL_IF_ERRPASS(!PHYSFS_stat(fname, &statbuf), 0);
+    return (statbuf.filetype == PHYSFS_FILETYPE_SYMLINK);
+} /* PHYSFS_isSymbolicLink */
+
+
+static PHYSFS_File *doOpenWrite(const char *_fname, const int appending)
+{
+    FileHandle *fh = NULL;
+    DirHandle *h;
+    size_t len;
+    char *fname;
+
+    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    h = writeDir;
+    BAIL_IF_MUTEX(!h, PHYSFS_ERR_NO_WRITE_DIR, stateLock, 0);
+
+    len = strlen(_fname) + dirHandleRootLen(h) + 1;
+    fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+
+    if (sanitizePlatformIndependentPathWithRoot(h, _fname, fname))
+    {
+        PHYSFS_Io *io = NULL;
+        char *arcfname = fname;
+        if (verifyPath(h, &arcfname, 0))
+        {
+            const PHYSFS_Archiver *f = h->funcs;
+            if (appending)
+                io = f->openAppend(h->opaque, arcfname);
+            else
+                io = f->openWrite(h->opaque, arcfname);
+
+            if (io)
+            {
+                residentForget(_fname);
+                fh = (FileHandle *) allocator.Malloc(sizeof (FileHandle));
+                if (fh == NULL)
+                {
+                    io->destroy(io);
+                    PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+                } /* if */
+                else
+                {
+                    memset(fh, '\0', sizeof (FileHandle));
+                    fh->io = io;
+                    fh->dirHandle = h;
+                    fh->next = openWriteList;
+                    openWriteList = fh;
+                } /* else */
+            } /* if */
+        } /* if */
+    } /* if */
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    __PHYSFS_smallFree(fname);
+    return ((PHYSFS_File *) fh);
+} /* doOpenWrite */
+
+
+PHYSFS_File *PHYSFS_openWrite(const char *filename)
+{
+    return doOpenWrite(filename, 0);
+} /* PHYSFS_openWrite */
+
+
+PHYSFS_File *PHYSFS_openAppend(const char *filename)
+{
+    return doOpenWrite(filename, 1);
+} /* PHYSFS_openAppend */
+
+
+/* MAKE SURE you hold stateLock before calling this! Once you've released it,
+    pass (promo) to residentFinishPromotion(). */
+static PHYSFS_File *doOpenRead(char *fname, const InternedPath *ip,
+                               ResidentPromotion *promo)
+{
+    FileHandle *fh = NULL;
+    PHYSFS_Io *io = NULL;
+    PHYSFS_uint32 hash = 0;
+    DirHandle *i;
+
+    /* resident files are found by the whole path, whichever mount it's in. */
+    if ((ip != NULL) && (ip->components > 0))
+        hash = ip->hashes[0];
+    else if (residentActive())
+        hash = __PHYSFS_hashString(fname, strlen(fname));
+
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        char *arcfname = fname;
+        if (verifyPath(i, &arcfname, 0))
+        {
+            PHYSFS_uint32 archash = 0;
+            const int hashed = internedHash(ip, i, fname, arcfname, &archash);
+
+            io = residentOpenRead(i, fname, hash);
+            if (io)
+                break;
+
+            io = archiverOpenRead(i, arcfname, hashed, archash);
+            if (io)
+            {
+                residentNoteOpen(i, fname, hash, io, promo);
+                break;
+            } /* if */
+        } /* if */
+    } /* for */
+
+    if (io)
+    {
+        fh = (FileHandle *) allocator.Malloc(sizeof (FileHandle));
+        if (fh == NULL)
+        {
+            io->destroy(io);
+            BAIL(PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        } /* if */
+
+        memset(fh, '\0', sizeof (FileHandle));
+        fh->io = io;
+        fh->forReading = 1;
+        fh->dirHandle = i;
+        fh->next = openReadList;
+        openReadList = fh;
+    } /* if */
+
+    return ((PHYSFS_File *) fh);
+} /* doOpenRead */
+
+
+PHYSFS_File *PHYSFS_openRead(const char *_fname)
+{
+    PHYSFS_File *retval = NULL;
+    ResidentPromotion promo;
+    char *allocated_fname;
+    char *fname;
+    size_t len;
+
+    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    memset(&promo, '\0', sizeof (promo));
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    BAIL_IF_MUTEX(!searchPath, PHYSFS_ERR_NOT_FOUND, stateLock, 0);
+
+    len = strlen(_fname) + longest_root + 1;
+    allocated_fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    fname = allocated_fname + longest_root;
+
+    if (sanitizePlatformIndependentPath(_fname, fname))
+        retval = doOpenRead(fname, NULL, &promo);
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    residentFinishPromotion(&promo, retval);
+    return retval;
+} /* PHYSFS_openRead */
+
+
+int PHYSFS_setResidentBudget(PHYSFS_uint64 bytes, PHYSFS_uint32 promoteAfter)
+{
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    residentStats.budget = bytes;
+    residentPromoteAfter = promoteAfter ? promoteAfter
+                                        : RESIDENT_DEFAULT_PROMOTE_AFTER;
+
+    if (bytes == 0)  /* stop counting; only pins survive. */
+        residentPrune(residentKeepPinned, NULL);
+    else
+        residentMakeRoom(0, 0, 1);
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+    return 1;
+} /* PHYSFS_setResidentBudget */
+
+
+int PHYSFS_pinFile(const char *_fname)
+{
+    int retval = 0;
+    char *allocated_fname;
+    char *fname;
+    size_t len;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    BAIL_IF_MUTEX(!searchPath, PHYSFS_ERR_NOT_FOUND, stateLock, 0);
+
+    len = strlen(_fname) + longest_root + 1;
+    allocated_fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    fname = allocated_fname + longest_root;
+
+    if (sanitizePlatformIndependentPath(_fname, fname))
+    {
+        const PHYSFS_uint32 hash = __PHYSFS_hashString(fname, strlen(fname));
+        DirHandle *i;
+        for (i = searchPath; i != NULL; i = i->next)
+        {
+            char *arcfname = fname;
+            if (verifyPath(i, &arcfname, 0))
+            {
+                ResidentEntry *e = residentFind(i, fname, hash, 0);
+                PHYSFS_Io *io = NULL;
+
+                if ((e == NULL) || (e->io == NULL))
+                {
+                    io = i->funcs->openRead(i->opaque, arcfname);
+                    if (!io)
+                        continue;
+                    else if (!e)
+                        e = residentFind(i, fname, hash, 1);
+                } /* if */
+
+                if ((e != NULL) && ((e->io != NULL) || residentPromote(e, io, 1)))
+                {
+                    if (e->pins++ == 0)
+                        residentStats.pinned++;
+                    retval = 1;
+                } /* if */
+
+                if (io != NULL)
+                    io->destroy(io);
+                break;
+            } /* if */
+        } /* for */
+    } /* if */
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    return retval;
+} /* PHYSFS_pinFile */
+
+
+int PHYSFS_unpinFile(const char *_fname)
+{
+    int retval = 0;
+    PHYSFS_uint32 hash;
+    char *fname;
+    DirHandle *i;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    fname = (char *) __PHYSFS_smallAlloc(strlen(_fname) + 1);
+    BAIL_IF(!fname, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    if (!sanitizePlatformIndependentPath(_fname, fname))
+    {
+        __PHYSFS_smallFree(fname);
+        return 0;
+    } /* if */
+
+    hash = __PHYSFS_hashString(fname, strlen(fname));
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        ResidentEntry *e = residentFind(i, fname, hash, 0);
+        if ((e != NULL) && (e->pins > 0))
+        {
+            if (--e->pins == 0)
+            {
+                residentStats.pinned--;
+                residentMakeRoom(0, 0, 1);  /* we might be over budget. */
+            } /* if */
+            retval = 1;
+            break;
+        } /* if */
+    } /* for */
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(fname);
+
+    BAIL_IF(!retval, PHYSFS_ERR_NOT_FOUND, 0);
+    return 1;
+} /* PHYSFS_unpinFile */
+
+
+int PHYSFS_getResidentStats(PHYSFS_ResidentStats *stats)
+{
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    BAIL_IF(!stats, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    __PHYSFS_platformGrabMutex(stateLock);
+    memcpy(stats, &residentStats, sizeof (*stats));
+    __PHYSFS_platformReleaseMutex(stateLock);
+    return 1;
+} /* PHYSFS_getResidentStats */
+
+
+static int closeHandleInOpenList(FileHandle **list, FileHandle *handle)
+{
+    FileHandle *prev = NULL;
+    FileHandle *i;
+
+    for (i = *list; i != NULL; i = i->next)
+    {
+        if (i == handle)  /* handle is in this list? */
+        {
+            PHYSFS_Io *io = handle->io;
+            PHYSFS_uint8 *tmp = handle->buffer;
+
+            /* send our buffer to io... */
+            if (!PHYSFS_flush((PHYSFS_File *) handle))
+                return -1;
+
+            /* ...then have io send it to the disk... */
+            else if (io->flush && !io->flush(io))
+                return -1;
+
+            /* ...then close the underlying file. */
+            io->destroy(io);
+
+            if (tmp != NULL)  /* free any associated buffer. */
+                allocator.Free(tmp);
+
+            if (prev == NULL)
+                *list = handle->next;
+            else
+                prev->next = handle->next;
+
+            allocator.Free(handle);
+            return 1;
+        } /* if */
+        prev = i;
+    } /* for */
+
+    return 0;
+} /* closeHandleInOpenList */
+
+
+int PHYSFS_close(PHYSFS_File *_handle)
+{
+    FileHandle *handle = (FileHandle *) _handle;
+    int rc;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    /* -1 == close failure. 0 == not found. 1 == success. */
+    rc = closeHandleInOpenList(&openReadList, handle);
+    BAIL_IF_MUTEX_ERRPASS(rc == -1, stateLock, 0);
+    if (!rc)
+    {
+        rc = closeHandleInOpenList(&openWriteList, handle);
+        BAIL_IF_MUTEX_ERRPASS(rc == -1, stateLock, 0);
+    } /* if */
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+    BAIL_IF(!rc, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    return 1;
+} /* PHYSFS_close */
+
+
+static PHYSFS_sint64 doBufferedRead(FileHandle *fh, void *_buffer, size_t len)
+{
+    PHYSFS_uint8 *buffer = (PHYSFS_uint8 *) _buffer;
+    PHYSFS_sint64 retval = 0;
+
+    while (len > 0)
+    {
+        const size_t avail = fh->buffill - fh->bufpos;
+        if (avail > 0)  /* data available in the buffer. */
+        {
+            const size_t cpy = (len < avail) ? len : avail;
+            memcpy(buffer, fh->buffer + fh->bufpos, cpy);
+            assert(len >= cpy);
+            buffer += cpy;
+            len -= cpy;
+            fh->bufpos += cpy;
+            retval += cpy;
+        } /* if */
+
+        else   /* buffer is empty, refill it. */
+        {
+            PHYSFS_Io *io = fh->io;
+            const PHYSFS_sint64 rc = io->read(io, fh->buffer, fh->bufsize);
+            fh->bufpos = 0;
+            if (rc > 0)
+                fh->buffill = (size_t) rc;
+            else
+            {
+                fh->buffill = 0;
+                if (retval == 0)  /* report already-read data, or failure. */
+                    retval = rc;
+                break;
+            } /* else */
+        } /* else */
+    } /* while */
+
+    return retval;
+} /* doBufferedRead */
+
+
+PHYSFS_sint64 PHYSFS_read(PHYSFS_File *handle, void *buffer,
+                          PHYSFS_uint32 size, PHYSFS_uint32 count)
+{
+    const PHYSFS_uint64 len = ((PHYSFS_uint64) size) * ((PHYSFS_uint64) count);
+    const PHYSFS_sint64 retval = PHYSFS_readBytes(handle, buffer, len);
+    return ( (retval <= 0) ? retval : (retval / ((PHYSFS_sint64) size)) );
+} /* PHYSFS_read */
+
+
+PHYSFS_sint64 PHYSFS_readBytes(PHYSFS_File *handle, void *buffer,
+                               PHYSFS_uint64 _len)
+{
+    const size_t len = (size_t) _len;
+    FileHandle *fh = (FileHandle *) handle;
+
+#ifdef PHYSFS_NO_64BIT_SUPPORT
+    const PHYSFS_uint64 maxlen = __PHYSFS_UI64(0x7FFFFFFF);
+#else
+    const PHYSFS_uint64 maxlen = __PHYSFS_UI64(0x7FFFFFFFFFFFFFFF);
+#endif
+
+    if (!__PHYSFS_ui64FitsAddressSpace(_len))
+        BAIL(PHYSFS_ERR_INVALID_ARGUMENT, -1);
+
+    BAIL_IF(_len > maxlen, PHYSFS_ERR_INVALID_ARGUMENT, -1);
+    BAIL_IF(!fh->forReading, PHYSFS_ERR_OPEN_FOR_WRITING, -1);
+    BAIL_IF_ERRPASS(len == 0, 0);
+    if (fh->buffer)
+        return doBufferedRead(fh, buffer, len);
+
+    return fh->io->read(fh->io, buffer, len);
+} /* PHYSFS_readBytes */
+
+
+static PHYSFS_sint64 doBufferedWrite(PHYSFS_File *handle, const void *buffer,
+                                     const size_t len)
+{
+    FileHandle *fh = (FileHandle *) handle;
+
+    /* whole thing fits in the buffer? */
+    if ((fh->buffill + len) < fh->bufsize)
+    {
+        memcpy(fh->buffer + fh->buffill, buffer, len);
+        fh->buffill += len;
+        return (PHYSFS_sint64) len;
+    } /* if */
+
+    /* would overflow buffer. Flush and then write the new objects, too. */
+    BAIL_IF_ERRPASS(!PHYSFS_flush(handle), -1);
+    return fh->io->write(fh->io, buffer, len);
+} /* doBufferedWrite */
+
+
+PHYSFS_sint64 PHYSFS_write(PHYSFS_File *handle, const void *buffer,
+                           PHYSFS_uint32 size, PHYSFS_uint32 count)
+{
+    const PHYSFS_uint64 len = ((PHYSFS_uint64) size) * ((PHYSFS_uint64) count);
+    const PHYSFS_sint64 retval = PHYSFS_writeBytes(handle, buffer, len);
+    return ( (retval <= 0) ? retval : (retval / ((PHYSFS_sint64) size)) );
+} /* PHYSFS_write */
+
+
+PHYSFS_sint64 PHYSFS_writeBytes(PHYSFS_File *handle, const void *buffer,
+                                PHYSFS_uint64 _len)
+{
+    const size_t len = (size_t) _len;
+    FileHandle *fh = (FileHandle *) handle;
+
+#ifdef PHYSFS_NO_64BIT_SUPPORT
+    const PHYSFS_uint64 maxlen = __PHYSFS_UI64(0x7FFFFFFF);
+#else
+    const PHYSFS_uint64 maxlen = __PHYSFS_UI64(0x7FFFFFFFFFFFFFFF);
+#endif
+
+    if (!__PHYSFS_ui64FitsAddressSpace(_len))
+        BAIL(PHYSFS_ERR_INVALID_ARGUMENT, -1);
+
+    BAIL_IF(_len > maxlen, PHYSFS_ERR_INVALID_ARGUMENT, -1);
+    BAIL_IF(fh->forReading, PHYSFS_ERR_OPEN_FOR_READING, -1);
+    BAIL_IF_ERRPASS(len == 0, 0);
+    if (fh->buffer)
+        return doBufferedWrite(handle, buffer, len);
+
+    return fh->io->write(fh->io, buffer, len);
+} /* PHYSFS_write */
+
+
+int PHYSFS_eof(PHYSFS_File *handle)
+{
+    FileHandle *fh = (FileHandle *) handle;
+
+    if (!fh->forReading)  /* never EOF on files opened for write/append. */
+        return 0;
+
+    /* can't be eof if buffer isn't empty */
+    if (fh->bufpos == fh->buffill)
+    {
+        /* check the Io. */
+        PHYSFS_Io *io = fh->io;
+        const PHYSFS_sint64 pos = io->tell(io);
+        const PHYSFS_sint64 len = io->length(io);
+        if ((pos < 0) || (len < 0))
+            return 0;  /* beats me. */
+        return (pos >= len);
+    } /* if */
+
+    return 0;
+} /* PHYSFS_eof */
+
+
+PHYSFS_sint64 PHYSFS_tell(PHYSFS_File *handle)
+{
+    FileHandle *fh = (FileHandle *) handle;
+    const PHYSFS_sint64 pos = fh->io->tell(fh->io);
+    const PHYSFS_sint64 retval = fh->forReading ?
+                                 (pos - fh->buffill) + fh->bufpos :
+                                 (pos + fh->buffill);
+    return retval;
+} /* PHYSFS_tell */
+
+
+int PHYSFS_seek(PHYSFS_File *handle, PHYSFS_uint64 pos)
+{
+    FileHandle *fh = (FileHandle *) handle;
+    BAIL_IF_ERRPASS(!PHYSFS_flush(handle), 0);
+
+    if (fh->buffer && fh->forReading)
+    {
+        /* avoid throwing away our precious buffer if seeking within it. */
+        PHYSFS_sint64 offset = pos - PHYSFS_tell(handle);
+        if ( /* seeking within the already-buffered range? */
+             /* forward? */
+            ((offset >= 0) && (((size_t)offset) <= fh->buffill-fh->bufpos)) ||
+            /* backward? */
+            ((offset < 0) && (((size_t) -offset) <= fh->bufpos)) )
+        {
+            fh->bufpos = (size_t) (((PHYSFS_sint64) fh->bufpos) + offset);
+            return 1; /* successful seek */
+        } /* if */
+    } /* if */
 
-    BAIL_IF(!mountPoint, PHYSFS_ERR_OUT_OF_MEMORY, PHYSFS_ENUM_ERROR);
+    /* we have to fall back to a 'raw' seek. */
+    fh->buffill = fh->bufpos = 0;
+    return fh->io->seek(fh->io, pos);
+} /* PHYSFS_seek */
 
-    strcpy(mountPoint, i->mountPoint);
-    ptr = mountPoint + ((len) ? len + 1 : 0);
-    end = strchr(ptr, '/');
-    assert(end);  /* should always find a terminating '/'. */
-    *end = '\0';
-    retval = callback(data, _fname, ptr);
-    __PHYSFS_smallFree(mountPoint);
 
-    BAIL_IF(retval == PHYSFS_ENUM_ERROR, PHYSFS_ERR_APP_CALLBACK, retval);
-    return retval;
-} /* enumerateFromMountPoint */
+PHYSFS_sint64 PHYSFS_fileLength(PHYSFS_File *handle)
+{
+    PHYSFS_Io *io = ((FileHandle *) handle)->io;
+    return io->length(io);
+} /* PHYSFS_filelength */
 
 
-typedef struct SymlinkFilterData
+int PHYSFS_setBuffer(PHYSFS_File *handle, PHYSFS_uint64 _bufsize)
 {
-    PHYSFS_EnumerateCallback callback;
-    void *callbackData;
-    DirHandle *dirhandle;
-    const char *arcfname;
-    PHYSFS_ErrorCode errcode;
-} SymlinkFilterData;
+    FileHandle *fh = (FileHandle *) handle;
+    const size_t bufsize = (size_t) _bufsize;
 
-static PHYSFS_EnumerateCallbackResult enumCallbackFilterSymLinks(void *_data,
-                                    const char *origdir, const char *fname)
-{
-    SymlinkFilterData *data = (SymlinkFilterData *) _data;
-    const DirHandle *dh = data->dirhandle;
-    const char *arcfname = data->arcfname;
-    PHYSFS_Stat statbuf;
-    const char *trimmedDir = (*arcfname == '/') ? (arcfname + 1) : arcfname;
-    const size_t slen = strlen(trimmedDir) + strlen(fname) + 2;
-    char *path = (char *) __PHYSFS_smallAlloc(slen);
-    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    if (!__PHYSFS_ui64FitsAddressSpace(_bufsize))
+        BAIL(PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
-    if (path == NULL)
+    BAIL_IF_ERRPASS(!PHYSFS_flush(handle), 0);
+
+    /*
+     * For reads, we need to move the file pointer to where it would be
+     *  if we weren't buffering, so that the next read will get the
+     *  right chunk of stuff from the file. PHYSFS_flush() handles writes.
+     */
+    if ((fh->forReading) && (fh->buffill != fh->bufpos))
     {
-        data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
-        return PHYSFS_ENUM_ERROR;
+        PHYSFS_uint64 pos;
+        const PHYSFS_sint64 curpos = fh->io->tell(fh->io);
+        BAIL_IF_ERRPASS(curpos == -1, 0);
+        pos = ((curpos - fh->buffill) + fh->bufpos);
+        BAIL_IF_ERRPASS(!fh->io->seek(fh->io, pos), 0);
     } /* if */
 
-    snprintf(path, slen, "%s%s%s", trimmedDir, *trimmedDir ? "/" : "", fname);
-
-    if (!dh->funcs->stat(dh->opaque, path, &statbuf))
+    if (bufsize == 0)  /* delete existing buffer. */
     {
-        data->errcode = currentErrorCode();
-        retval = PHYSFS_ENUM_ERROR;
+        if (fh->buffer)
+        {
+            allocator.Free(fh->buffer);
+            fh->buffer = NULL;
+        } /* if */
     } /* if */
+
     else
     {
-        /* Pass it on to the application if it's not a symlink. */
-        if (statbuf.filetype != PHYSFS_FILETYPE_SYMLINK)
-        {
-            retval = data->callback(data->callbackData, origdir, fname);
-            if (retval == PHYSFS_ENUM_ERROR)
-                data->errcode = PHYSFS_ERR_APP_CALLBACK;
-        } /* if */
+        PHYSFS_uint8 *newbuf;
+        newbuf = (PHYSFS_uint8 *) allocator.Realloc(fh->buffer, bufsize);
+        BAIL_IF(!newbuf, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        fh->buffer = newbuf;
     } /* else */
 
-    __PHYSFS_smallFree(path);
+    fh->bufsize = bufsize;
+    fh->buffill = fh->bufpos = 0;
+    return 1;
+} /* PHYSFS_setBuffer */
 
-    return retval;
-} /* enumCallbackFilterSymLinks */
 
+int PHYSFS_flush(PHYSFS_File *handle)
+{
+    FileHandle *fh = (FileHandle *) handle;
+    PHYSFS_Io *io;
+    PHYSFS_sint64 rc;
 
-int PHYSFS_enumerate(const char *_fn, PHYSFS_EnumerateCallback cb, void *data)
+    if ((fh->forReading) || (fh->bufpos == fh->buffill))
+        return 1;  /* open for read or buffer empty are successful no-ops. */
+
+    /* dump buffer to disk. */
+    io = fh->io;
+    rc = io->write(io, fh->buffer + fh->bufpos, fh->buffill - fh->bufpos);
+    BAIL_IF_ERRPASS(rc <= 0, 0);
+    fh->bufpos = fh->buffill = 0;
+    return 1;
+} /* PHYSFS_flush */
+
+
+/* set some sane defaults... */
+static void statDefaults(PHYSFS_Stat *stat)
 {
-    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
-    size_t len;
-    char *allocated_fname;
-    char *fname;
+    stat->filesize = -1;
+    stat->modtime = -1;
+    stat->createtime = -1;
+    stat->accesstime = -1;
+    stat->filetype = PHYSFS_FILETYPE_OTHER;
+    stat->readonly = 1;
+} /* statDefaults */
 
-    BAIL_IF(!_fn, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!cb, PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
-    __PHYSFS_platformGrabMutex(stateLock);
+/* MAKE SURE you hold stateLock before calling this! */
+static int doStat(char *fname, PHYSFS_Stat *stat, const InternedPath *ip)
+{
+    int retval = 0;
 
-    len = strlen(_fn) + longest_root + 1;
-    allocated_fname = (char *) __PHYSFS_smallAlloc(len);
-    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
-    fname = allocated_fname + longest_root;
-    if (!sanitizePlatformIndependentPath(_fn, fname))
-        retval = PHYSFS_ENUM_STOP;
+    statDefaults(stat);
+
+    if (*fname == '\0')
+    {
+        stat->filetype = PHYSFS_FILETYPE_DIRECTORY;
+        stat->readonly = !writeDir; /* Writeable if we have a writeDir */
+        retval = 1;
+    } /* if */
     else
     {
         DirHandle *i;
-        SymlinkFilterData filterdata;
-
-        if (!allowSymLinks)
-        {
-            memset(&filterdata, '\0', sizeof (filterdata));
-            filterdata.callback = cb;
-            filterdata.callbackData = data;
-        } /* if */
-
-        for (i = searchPath; (retval == PHYSFS_ENUM_OK) && i; i = i->next)
+        int exists = 0;
+        for (i = searchPath; ((i != NULL) && (!exists)); i = i->next)
         {
             char *arcfname = fname;
-
-            if (partOfMountPoint(i, arcfname))
-                retval = enumerateFromMountPoint(i, arcfname, cb, _fn, data);
-
+            exists = partOfMountPoint(i, arcfname);
+            if (exists)
+            {
+                stat->filetype = PHYSFS_FILETYPE_DIRECTORY;
+                stat->readonly = 1;
+                retval = 1;
+            } /* if */
             else if (verifyPath(i, &arcfname, 0))
             {
-                PHYSFS_Stat statbuf;
-                if (!i->funcs->stat(i->opaque, arcfname, &statbuf))
-                {
-                    if (currentErrorCode() == PHYSFS_ERR_NOT_FOUND)
-                        continue;  /* no such dir in this archive, skip it. */
-                } /* if */
-
-                if (statbuf.filetype != PHYSFS_FILETYPE_DIRECTORY)
-                    continue;  /* not a directory in this archive, skip it. */
-
-                else if ((!allowSymLinks) && (i->funcs->info.supportsSymlinks))
-                {
-                    filterdata.dirhandle = i;
-                    filterdata.arcfname = arcfname;
-                    filterdata.errcode = PHYSFS_ERR_OK;
-                    retval = i->funcs->enumerate(i->opaque, arcfname,
-                                                 enumCallbackFilterSymLinks,
-                                                 _fn, &filterdata);
-                    if (retval == PHYSFS_ENUM_ERROR)
-                    {
-                        if (currentErrorCode() == PHYSFS_ERR_APP_CALLBACK)
-                            PHYSFS_setErrorCode(filterdata.errcode);
-                    } /* if */
-                } /* else if */
-                else
-                {
-                    retval = i->funcs->enumerate(i->opaque, arcfname,
-                                                 cb, _fn, data);
-                } /* else */
+                PHYSFS_uint32 hash = 0;
+                const int hashed = internedHash(ip, i, fname, arcfname, &hash);
+                retval = archiverStat(i, arcfname, hashed, hash, stat);
+                if ((retval) || (currentErrorCode() != PHYSFS_ERR_NOT_FOUND))
+                    exists = 1;
             } /* else if */
         } /* for */
+    } /* else */
 
-    } /* if */
-
-    __PHYSFS_platformReleaseMutex(stateLock);
-
-    __PHYSFS_smallFree(allocated_fname);
-
-    return (retval == PHYSFS_ENUM_ERROR) ? 0 : 1;
-} /* PHYSFS_enumerate */
-
-
-typedef struct
-{
-    PHYSFS_EnumFilesCallback callback;
-    void *data;
-} LegacyEnumFilesCallbackData;
+    return retval;
+} /* doStat */
 
-static PHYSFS_EnumerateCallbackResult enumFilesCallbackAlwaysSucceed(void *d,
-                                    const char *origdir, const char *fname)
-{
-    LegacyEnumFilesCallbackData *cbdata = (LegacyEnumFilesCallbackData *) d;
-    cbdata->callback(cbdata->data, origdir, fname);
-    return PHYSFS_ENUM_OK;
-} /* enumFilesCallbackAlwaysSucceed */
 
-void PHYSFS_enumerateFilesCallback(const char *fname,
-                                   PHYSFS_EnumFilesCallback callback,
-                                   void *data)
+int PHYSFS_stat(const char *_fname, PHYSFS_Stat *stat)
 {
-    LegacyEnumFilesCallbackData cbdata;
-    cbdata.callback = callback;
-    cbdata.data = data;
-    (void) PHYSFS_enumerate(fname, enumFilesCallbackAlwaysSucceed, &cbdata);
-} /* PHYSFS_enumerateFilesCallback */
+    int retval = 0;
+    char *allocated_fname;
+    char *fname;
+    size_t len;
 
+    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!stat, PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
-int PHYSFS_exists(const char *fname)
-{
-    return (getRealDirHandle(fname) != NULL);
-} /* PHYSFS_exists */
+    __PHYSFS_platformGrabMutex(stateLock);
+    len = strlen(_fname) + longest_root + 1;
+    allocated_fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    fname = allocated_fname + longest_root;
 
+    if (sanitizePlatformIndependentPath(_fname, fname))
+        retval = doStat(fname, stat, NULL);
 
-PHYSFS_sint64 PHYSFS_getLastModTime(const char *fname)
-{
-    PHYSFS_Stat statbuf;
-    BAIL_IF_ERRPASS(!PHYSFS_stat(fname, &statbuf), -1);
-    return statbuf.modtime;
-} /* PHYSFS_getLastModTime */
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    return retval;
+} /* PHYSFS_stat */
 
 
-int PHYSFS_isDirectory(const char *fname)
+PHYSFS_sint64 PHYSFS_statMany(const char * const *fnames, PHYSFS_uint32 count,
+                              PHYSFS_Stat *stats, PHYSFS_ErrorCode *errors)
 {
-    PHYSFS_Stat statbuf;
-    BAIL_IF_ERRPASS(!PHYSFS_stat(fname, &statbuf), 0);
-    return (statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY);
-} /* PHYSFS_isDirectory */
-
+    PHYSFS_sint64 retval = -1;
+    PHYSFS_uint32 pending = 0;
+    PHYSFS_uint32 j;
+    size_t *offsets = NULL;
+    char *names = NULL;
+    char *allocated_fname = NULL;
+    char *fname;
+    size_t total = 0;
+    size_t longest = 0;
+    DirHandle *i;
 
-int PHYSFS_isSymbolicLink(const char *fname)
-{
-    PHYSFS_Stat statbuf;
-    BAIL_IF_ERRPASS(!PHYSFS_stat(fname, &statbuf), 0);
-    return (statbuf.filetype == PHYSFS_FILETYPE_SYMLINK);
-} /* PHYSFS_isSymbolicLink */
+    BAIL_IF(!fnames && count, PHYSFS_ERR_INVALID_ARGUMENT, -1);
+    BAIL_IF(!stats && count, PHYSFS_ERR_INVALID_ARGUMENT, -1);
+    BAIL_IF(!errors && count, PHYSFS_ERR_INVALID_ARGUMENT, -1);
 
+    for (j = 0; j < count; j++)
+    {
+        size_t len;
+        BAIL_IF(!fnames[j], PHYSFS_ERR_INVALID_ARGUMENT, -1);
+        len = strlen(fnames[j]) + 1;
+        total += len;
+        if (longest < len)
+            longest = len;
+    } /* for */
 
-static PHYSFS_File *doOpenWrite(const char *_fname, const int appending)
-{
-    FileHandle *fh = NULL;
-    DirHandle *h;
-    size_t len;
-    char *fname;
+    if (count == 0)
+        return 0;
 
-    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    offsets = (size_t *) allocator.Malloc(count * sizeof (size_t));
+    GOTO_IF(!offsets, PHYSFS_ERR_OUT_OF_MEMORY, statMany_failed);
+    names = (char *) allocator.Malloc(total);
+    GOTO_IF(!names, PHYSFS_ERR_OUT_OF_MEMORY, statMany_failed);
 
     __PHYSFS_platformGrabMutex(stateLock);
 
-    h = writeDir;
-    BAIL_IF_MUTEX(!h, PHYSFS_ERR_NO_WRITE_DIR, stateLock, 0);
+    /* one scratch buffer for every lookup, with room for the longest root. */
+    allocated_fname = (char *) allocator.Malloc(longest + longest_root);
+    GOTO_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY,
+                  stateLock, statMany_failed);
+    fname = allocated_fname + longest_root;
 
-    len = strlen(_fname) + dirHandleRootLen(h) + 1;
-    fname = (char *) __PHYSFS_smallAlloc(len);
-    BAIL_IF_MUTEX(!fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    /* sanitize everything once, up front; each mount reuses the result. */
+    total = 0;
+    for (j = 0; j < count; j++)
+    {
+        char *dst = names + total;
+        statDefaults(&stats[j]);
+        offsets[j] = total;
+        total += strlen(fnames[j]) + 1;
+        if (!sanitizePlatformIndependentPath(fnames[j], dst))
+            errors[j] = currentErrorCode();
+        else if (*dst == '\0')
+        {
+            stats[j].filetype = PHYSFS_FILETYPE_DIRECTORY;
+            stats[j].readonly = !writeDir; /* Writeable if we have a writeDir */
+            errors[j] = PHYSFS_ERR_OK;
+        } /* else if */
+        else
+        {
+            errors[j] = PHYSFS_ERR_NOT_FOUND;  /* until a mount says otherwise. */
+            pending++;
+        } /* else */
+    } /* for */
 
-    if (sanitizePlatformIndependentPathWithRoot(h, _fname, fname))
+    /*
+     * Walk the search path once, asking each mount about every name that
+     *  is still unresolved, so each archive's lookup tables stay hot for
+     *  the whole run instead of being revisited per name. First mount to
+     *  give a definite answer wins, just like doStat().
+     */
+    for (i = searchPath; (i != NULL) && (pending > 0); i = i->next)
     {
-        PHYSFS_Io *io = NULL;
-        char *arcfname = fname;
-        if (verifyPath(h, &arcfname, 0))
+        for (j = 0; j < count; j++)
         {
-            const PHYSFS_Archiver *f = h->funcs;
-            if (appending)
-                io = f->openAppend(h->opaque, arcfname);
-            else
-                io = f->openWrite(h->opaque, arcfname);
+            char *arcfname = fname;
 
-            if (io)
+            if (errors[j] != PHYSFS_ERR_NOT_FOUND)
+                continue;  /* resolved, or a bad filename. */
+
+            strcpy(fname, names + offsets[j]);  /* verifyPath() scribbles on it. */
+            if (partOfMountPoint(i, arcfname))
             {
-                fh = (FileHandle *) allocator.Malloc(sizeof (FileHandle));
-                if (fh == NULL)
+                stats[j].filetype = PHYSFS_FILETYPE_DIRECTORY;
+                errors[j] = PHYSFS_ERR_OK;
+                pending--;
+            } /* if */
+            else if (verifyPath(i, &arcfname, 0))
+            {
+                if (i->funcs->stat(i->opaque, arcfname, &stats[j]))
                 {
-                    io->destroy(io);
-                    PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+                    errors[j] = PHYSFS_ERR_OK;
+                    pending--;
                 } /* if */
                 else
                 {
-                    memset(fh, '\0', sizeof (FileHandle));
-                    fh->io = io;
-                    fh->dirHandle = h;
-                    fh->next = openWriteList;
-                    openWriteList = fh;
+                    const PHYSFS_ErrorCode err = currentErrorCode();
+                    if (err != PHYSFS_ERR_NOT_FOUND)
+                    {
+                        errors[j] = err;
+                        pending--;
+                    } /* if */
+                    statDefaults(&stats[j]);
                 } /* else */
-            } /* if */
-        } /* if */
-    } /* if */
+            } /* else if */
+        } /* for */
+    } /* for */
 
     __PHYSFS_platformReleaseMutex(stateLock);
 
-    __PHYSFS_smallFree(fname);
-    return ((PHYSFS_File *) fh);
-} /* doOpenWrite */
+    retval = 0;
+    for (j = 0; j < count; j++)
+        retval += (errors[j] == PHYSFS_ERR_OK);
+
+statMany_failed:
+    if (allocated_fname != NULL) allocator.Free(allocated_fname);
+    if (names != NULL) allocator.Free(names);
+    if (offsets != NULL) allocator.Free(offsets);
+    return retval;
+} /* PHYSFS_statMany */
 
 
-PHYSFS_File *PHYSFS_openWrite(const char *filename)
+PHYSFS_Path *PHYSFS_internPath(const char *_fname)
 {
-    return doOpenWrite(filename, 0);
-} /* PHYSFS_openWrite */
+    InternedPath *ip = NULL;
+    PHYSFS_uint32 components = 0;
+    PHYSFS_uint32 i;
+    size_t alloclen;
+    size_t len;
+    char *fname;
+    char *ptr;
 
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, NULL);
+    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
 
-PHYSFS_File *PHYSFS_openAppend(const char *filename)
+    len = strlen(_fname) + 1;
+    fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF(!fname, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    GOTO_IF_ERRPASS(!sanitizePlatformIndependentPath(_fname, fname), internPath_failed);
+
+    len = strlen(fname);
+    GOTO_IF(len >= 0xFFFFFFFF, PHYSFS_ERR_BAD_FILENAME, internPath_failed);
+    if (len > 0)
+    {
+        components = 1;
+        for (ptr = fname; *ptr; ptr++)
+            components += (*ptr == '/');
+    } /* if */
+
+    alloclen = sizeof (InternedPath) + (components * 2 * sizeof (PHYSFS_uint32)) + len + 1;
+    ip = (InternedPath *) allocator.Malloc(alloclen);
+    GOTO_IF(!ip, PHYSFS_ERR_OUT_OF_MEMORY, internPath_failed);
+    ip->offsets = (PHYSFS_uint32 *) (ip + 1);
+    ip->hashes = ip->offsets + components;
+    ip->path = (char *) (ip->hashes + components);
+    ip->len = len;
+    ip->components = components;
+    memcpy(ip->path, fname, len + 1);
+
+    i = 0;
+    if (components > 0)
+        ip->offsets[i++] = 0;
+    for (ptr = ip->path; *ptr; ptr++)
+    {
+        if (*ptr == '/')
+            ip->offsets[i++] = (PHYSFS_uint32) ((ptr - ip->path) + 1);
+    } /* for */
+    assert(i == components);
+
+    for (i = 0; i < components; i++)
+    {
+        const PHYSFS_uint32 ofs = ip->offsets[i];
+        ip->hashes[i] = __PHYSFS_hashString(ip->path + ofs, len - ofs);
+    } /* for */
+
+internPath_failed:
+    __PHYSFS_smallFree(fname);
+    return (PHYSFS_Path *) ip;
+} /* PHYSFS_internPath */
+
+
+void PHYSFS_freePath(PHYSFS_Path *path)
 {
-    return doOpenWrite(filename, 1);
-} /* PHYSFS_openAppend */
+    if (path != NULL)
+        allocator.Free(path);
+} /* PHYSFS_freePath */
 
 
-PHYSFS_File *PHYSFS_openRead(const char *_fname)
+PHYSFS_File *PHYSFS_openReadPath(const PHYSFS_Path *path)
 {
-    FileHandle *fh = NULL;
+    const InternedPath *ip = (const InternedPath *) path;
+    PHYSFS_File *retval;
+    ResidentPromotion promo;
     char *allocated_fname;
     char *fname;
     size_t len;
 
-    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!ip, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    memset(&promo, '\0', sizeof (promo));
 
     __PHYSFS_platformGrabMutex(stateLock);
-
     BAIL_IF_MUTEX(!searchPath, PHYSFS_ERR_NOT_FOUND, stateLock, 0);
-
-    len = strlen(_fname) + longest_root + 1;
+    len = ip->len + longest_root + 1;  /* no strlen or sanitizing needed. */
     allocated_fname = (char *) __PHYSFS_smallAlloc(len);
     BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
     fname = allocated_fname + longest_root;
+    memcpy(fname, ip->path, ip->len + 1);  /* verifyPath() scribbles on it. */
+    retval = doOpenRead(fname, ip, &promo);
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    residentFinishPromotion(&promo, retval);
+    return retval;
+} /* PHYSFS_openReadPath */
 
-    if (sanitizePlatformIndependentPath(_fname, fname))
-    {
-        PHYSFS_Io *io = NULL;
-        DirHandle *i;
-
-        for (i = searchPath; i != NULL; i = i->next)
-        {
-            char *arcfname = fname;
-            if (verifyPath(i, &arcfname, 0))
-            {
-                io = i->funcs->openRead(i->opaque, arcfname);
-                if (io)
-                    break;
-            } /* if */
-        } /* for */
 
-        if (io)
-        {
-            fh = (FileHandle *) allocator.Malloc(sizeof (FileHandle));
-            if (fh == NULL)
-            {
-                io->destroy(io);
-                PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
-            } /* if */
+int PHYSFS_statPath(const PHYSFS_Path *path, PHYSFS_Stat *stat)
+{
+    const InternedPath *ip = (const InternedPath *) path;
+    int retval;
+    char *allocated_fname;
+    char *fname;
+    size_t len;
 
-            memset(fh, '\0', sizeof (FileHandle));
-            fh->io = io;
-            fh->forReading = 1;
-            fh->dirHandle = i;
-            fh->next = openReadList;
-            openReadList = fh;
-        } /* if */
-    } /* if */
+    BAIL_IF(!ip, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!stat, PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
+    __PHYSFS_platformGrabMutex(stateLock);
+    len = ip->len + longest_root + 1;  /* no strlen or sanitizing needed. */
+    allocated_fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    fname = allocated_fname + longest_root;
+    memcpy(fname, ip->path, ip->len + 1);  /* verifyPath() scribbles on it. */
+    retval = doStat(fname, stat, ip);
     __PHYSFS_platformReleaseMutex(stateLock);
     __PHYSFS_smallFree(allocated_fname);
-    return ((PHYSFS_File *) fh);
-} /* PHYSFS_openRead */
+    return retval;
+} /* PHYSFS_statPath */
 
 
-static int closeHandleInOpenList(FileHandle **list, FileHandle *handle)
+int PHYSFS_existsPath(const PHYSFS_Path *path)
 {
-    FileHandle *prev = NULL;
-    FileHandle *i;
-
-    for (i = *list; i != NULL; i = i->next)
-    {
-        if (i == handle)  /* handle is in this list? */
-        {
-            PHYSFS_Io *io = handle->io;
-            PHYSFS_uint8 *tmp = handle->buffer;
-
-            /* send our buffer to io... */
-            if (!PHYSFS_flush((PHYSFS_File *) handle))
-                return -1;
+    const InternedPath *ip = (const InternedPath *) path;
+    DirHandle *dh;
+    char *allocated_fname;
+    char *fname;
+    size_t len;
 
-            /* ...then have io send it to the disk... */
-            else if (io->flush && !io->flush(io))
-                return -1;
+    BAIL_IF(!ip, PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
-            /* ...then close the underlying file. */
-            io->destroy(io);
+    __PHYSFS_platformGrabMutex(stateLock);
+    len = ip->len + longest_root + 1;  /* no strlen or sanitizing needed. */
+    allocated_fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    fname = allocated_fname + longest_root;
+    memcpy(fname, ip->path, ip->len + 1);  /* verifyPath() scribbles on it. */
+    dh = doGetRealDirHandle(fname, ip);
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    return (dh != NULL);
+} /* PHYSFS_existsPath */
 
-            if (tmp != NULL)  /* free any associated buffer. */
-                allocator.Free(tmp);
 
-            if (prev == NULL)
-                *list = handle->next;
-            else
-                prev->next = handle->next;
+static void dirViewFreeMounts(DirView *dv)
+{
+    size_t i;
+    for (i = 0; i < dv->nummounts; i++)
+        allocator.Free(dv->mounts[i].arcdir);
+    allocator.Free(dv->mounts);
+    dv->mounts = NULL;
+    dv->nummounts = 0;
+    dv->longestArcdir = 0;
+} /* dirViewFreeMounts */
 
-            allocator.Free(handle);
-            return 1;
-        } /* if */
-        prev = i;
-    } /* for */
 
-    return 0;
-} /* closeHandleInOpenList */
+/*
+ * Find (dv)'s directory in every mount that has it, the same way a
+ *  full-path lookup would, and remember where it is, unless that's already
+ *  been done since the search path last changed.
+ *  MAKE SURE you hold stateLock before calling this!
+ */
+static int dirViewResolve(DirView *dv)
+{
+    size_t count = 0;
+    char *allocated_fname;
+    char *fname;
+    DirHandle *i;
 
+    if ((dv->generation == searchPathGeneration) &&
+        (dv->allowSymLinks == allowSymLinks))
+        return 1;  /* still good. */
 
-int PHYSFS_close(PHYSFS_File *_handle)
-{
-    FileHandle *handle = (FileHandle *) _handle;
-    int rc;
+    dirViewFreeMounts(dv);
+    dv->useFullPaths = 0;
 
-    __PHYSFS_platformGrabMutex(stateLock);
+    for (i = searchPath; i != NULL; i = i->next)
+        count++;
 
-    /* -1 == close failure. 0 == not found. 1 == success. */
-    rc = closeHandleInOpenList(&openReadList, handle);
-    BAIL_IF_MUTEX_ERRPASS(rc == -1, stateLock, 0);
-    if (!rc)
+    if (count > 0)
     {
-        rc = closeHandleInOpenList(&openWriteList, handle);
-        BAIL_IF_MUTEX_ERRPASS(rc == -1, stateLock, 0);
+        dv->mounts = (DirViewMount *) allocator.Malloc(sizeof (DirViewMount) * count);
+        BAIL_IF(!dv->mounts, PHYSFS_ERR_OUT_OF_MEMORY, 0);
     } /* if */
 
-    __PHYSFS_platformReleaseMutex(stateLock);
-    BAIL_IF(!rc, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    return 1;
-} /* PHYSFS_close */
-
-
-static PHYSFS_sint64 doBufferedRead(FileHandle *fh, void *_buffer, size_t len)
-{
-    PHYSFS_uint8 *buffer = (PHYSFS_uint8 *) _buffer;
-    PHYSFS_sint64 retval = 0;
+    allocated_fname = (char *) __PHYSFS_smallAlloc(dv->dirnamelen + longest_root + 1);
+    BAIL_IF(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    fname = allocated_fname + longest_root;
 
-    while (len > 0)
+    for (i = searchPath; i != NULL; i = i->next)
     {
-        const size_t avail = fh->buffill - fh->bufpos;
-        if (avail > 0)  /* data available in the buffer. */
+        char *arcfname = fname;
+        PHYSFS_Stat statbuf;
+
+        memcpy(fname, dv->dirname, dv->dirnamelen + 1);
+        if (partOfMountPoint(i, fname))
         {
-            const size_t cpy = (len < avail) ? len : avail;
-            memcpy(buffer, fh->buffer + fh->bufpos, cpy);
-            assert(len >= cpy);
-            buffer += cpy;
-            len -= cpy;
-            fh->bufpos += cpy;
-            retval += cpy;
+            dv->useFullPaths = 1;  /* other mounts show up inside this dir. */
+            break;
         } /* if */
 
-        else   /* buffer is empty, refill it. */
+        else if (!verifyPath(i, &arcfname, 0))
+            continue;
+        else if (!i->funcs->stat(i->opaque, arcfname, &statbuf))
+            continue;
+        else if (statbuf.filetype != PHYSFS_FILETYPE_DIRECTORY)
+            continue;
+        else
         {
-            PHYSFS_Io *io = fh->io;
-            const PHYSFS_sint64 rc = io->read(io, fh->buffer, fh->bufsize);
-            fh->bufpos = 0;
-            if (rc > 0)
-                fh->buffill = (size_t) rc;
-            else
+            DirViewMount *m = &dv->mounts[dv->nummounts];
+            m->arcdirlen = strlen(arcfname);
+            m->arcdir = (char *) allocator.Malloc(m->arcdirlen + 1);
+            if (!m->arcdir)
             {
-                fh->buffill = 0;
-                if (retval == 0)  /* report already-read data, or failure. */
-                    retval = rc;
-                break;
-            } /* else */
+                __PHYSFS_smallFree(allocated_fname);
+                dirViewFreeMounts(dv);
+                BAIL(PHYSFS_ERR_OUT_OF_MEMORY, 0);
+            } /* if */
+            memcpy(m->arcdir, arcfname, m->arcdirlen + 1);
+            m->dirHandle = i;
+            m->hash = __PHYSFS_hashString(arcfname, m->arcdirlen);
+            if (m->arcdirlen > 0)
+                m->hash = hashStringFrom(m->hash, "/", 1);
+            if (m->arcdirlen > dv->longestArcdir)
+                dv->longestArcdir = m->arcdirlen;
+            dv->nummounts++;
         } /* else */
-    } /* while */
+    } /* for */
 
-    return retval;
-} /* doBufferedRead */
+    __PHYSFS_smallFree(allocated_fname);
 
+    if (dv->useFullPaths)
+        dirViewFreeMounts(dv);
 
-PHYSFS_sint64 PHYSFS_read(PHYSFS_File *handle, void *buffer,
-                          PHYSFS_uint32 size, PHYSFS_uint32 count)
+    dv->generation = searchPathGeneration;
+    dv->allowSymLinks = allowSymLinks;
+    return 1;
+} /* dirViewResolve */
+
+
+/*
+ * Put (m)'s directory in front of (relname), which sits in a buffer with
+ *  room for the longest one (and a '/') before it, check the part from
+ *  (relname) on for symlinks. If (hash) isn't NULL and (relname) isn't
+ *  empty, the result's hash goes in (*hash).
+ *  Returns NULL if (m) can't have the file.
+ *  MAKE SURE you hold stateLock before calling this!
+ */
+static char *dirViewArcName(const DirViewMount *m, char *relname,
+                            const size_t rellen, PHYSFS_uint32 *hash)
 {
-    const PHYSFS_uint64 len = ((PHYSFS_uint64) size) * ((PHYSFS_uint64) count);
-    const PHYSFS_sint64 retval = PHYSFS_readBytes(handle, buffer, len);
-    return ( (retval <= 0) ? retval : (retval / ((PHYSFS_sint64) size)) );
-} /* PHYSFS_read */
+    char *arcfname = relname;
 
+    if (m->arcdirlen > 0)
+    {
+        const int sep = (*relname != '\0');
+        arcfname = relname - m->arcdirlen - sep;
+        memcpy(arcfname, m->arcdir, m->arcdirlen);
+        if (sep)
+            arcfname[m->arcdirlen] = '/';
+    } /* if */
 
-PHYSFS_sint64 PHYSFS_readBytes(PHYSFS_File *handle, void *buffer,
-                               PHYSFS_uint64 _len)
+    if ((!allowSymLinks) && (*relname != '\0'))
+    {
+        if (!verifySymLinks(m->dirHandle, arcfname, relname, 0))
+            return NULL;
+    } /* if */
+
+    if ((hash != NULL) && (*relname != '\0'))
+        *hash = hashStringFrom(m->hash, relname, rellen);
+
+    return arcfname;
+} /* dirViewArcName */
+
+
+/* Bytes of scratch space dirViewPrepare() needs for a (rellen) name. */
+#define dirViewScratchLen(dv, rellen) \
+    (longest_root + (dv)->dirnamelen + 1 + (rellen) + 1 + \
+     (dv)->longestArcdir + 1 + (rellen) + 1)
+
+/*
+ * Lay out (scratch) for a lookup of (_relname) in (dv): (*fname) gets the
+ *  full virtual path, with room for any root before it, and (*relname) the
+ *  sanitized (_relname), with room for any mount's directory before it.
+ */
+static int dirViewPrepare(DirView *dv, char *scratch, const char *_relname,
+                          const size_t _rellen, char **fname, char **relname,
+                          size_t *rellen)
 {
-    const size_t len = (size_t) _len;
-    FileHandle *fh = (FileHandle *) handle;
+    char *vpath = scratch + longest_root;
+    char *rel = vpath + dv->dirnamelen + 1 + _rellen + 1 + dv->longestArcdir + 1;
 
-#ifdef PHYSFS_NO_64BIT_SUPPORT
-    const PHYSFS_uint64 maxlen = __PHYSFS_UI64(0x7FFFFFFF);
-#else
-    const PHYSFS_uint64 maxlen = __PHYSFS_UI64(0x7FFFFFFFFFFFFFFF);
-#endif
+    BAIL_IF_ERRPASS(!sanitizePlatformIndependentPath(_relname, rel), 0);
+    *rellen = strlen(rel);
 
-    if (!__PHYSFS_ui64FitsAddressSpace(_len))
-        BAIL(PHYSFS_ERR_INVALID_ARGUMENT, -1);
+    memcpy(vpath, dv->dirname, dv->dirnamelen);
+    if ((dv->dirnamelen > 0) && (*rellen > 0))
+        vpath[dv->dirnamelen] = '/';
+    memcpy(vpath + dv->dirnamelen + ((dv->dirnamelen > 0) && (*rellen > 0)),
+           rel, *rellen + 1);
 
-    BAIL_IF(_len > maxlen, PHYSFS_ERR_INVALID_ARGUMENT, -1);
-    BAIL_IF(!fh->forReading, PHYSFS_ERR_OPEN_FOR_WRITING, -1);
-    BAIL_IF_ERRPASS(len == 0, 0);
-    if (fh->buffer)
-        return doBufferedRead(fh, buffer, len);
+    *fname = vpath;
+    *relname = rel;
+    return 1;
+} /* dirViewPrepare */
+
+
+PHYSFS_Directory *PHYSFS_openDirectory(const char *_dname)
+{
+    DirView *dv = NULL;
+    char *dname = NULL;
+    size_t len;
 
-    return fh->io->read(fh->io, buffer, len);
-} /* PHYSFS_readBytes */
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, NULL);
+    BAIL_IF(!_dname, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
 
+    len = strlen(_dname) + 1;
+    dname = (char *) allocator.Malloc(len);
+    BAIL_IF(!dname, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    GOTO_IF_ERRPASS(!sanitizePlatformIndependentPath(_dname, dname), openDirectory_failed);
 
-static PHYSFS_sint64 doBufferedWrite(PHYSFS_File *handle, const void *buffer,
-                                     const size_t len)
-{
-    FileHandle *fh = (FileHandle *) handle;
+    dv = (DirView *) allocator.Malloc(sizeof (DirView));
+    GOTO_IF(!dv, PHYSFS_ERR_OUT_OF_MEMORY, openDirectory_failed);
+    memset(dv, '\0', sizeof (DirView));
+    dv->dirname = dname;
+    dv->dirnamelen = strlen(dname);
 
-    /* whole thing fits in the buffer? */
-    if ((fh->buffill + len) < fh->bufsize)
+    __PHYSFS_platformGrabMutex(stateLock);
+    dv->generation = searchPathGeneration - 1;  /* force a resolve. */
+    if (!dirViewResolve(dv))
     {
-        memcpy(fh->buffer + fh->buffill, buffer, len);
-        fh->buffill += len;
-        return (PHYSFS_sint64) len;
+        __PHYSFS_platformReleaseMutex(stateLock);
+        goto openDirectory_failed;
     } /* if */
 
-    /* would overflow buffer. Flush and then write the new objects, too. */
-    BAIL_IF_ERRPASS(!PHYSFS_flush(handle), -1);
-    return fh->io->write(fh->io, buffer, len);
-} /* doBufferedWrite */
+    if ((dv->nummounts == 0) && (!dv->useFullPaths) && (dv->dirnamelen > 0))
+    {
+        __PHYSFS_platformReleaseMutex(stateLock);
+        PHYSFS_setErrorCode(PHYSFS_ERR_NOT_FOUND);
+        goto openDirectory_failed;
+    } /* if */
+    __PHYSFS_platformReleaseMutex(stateLock);
 
+    return (PHYSFS_Directory *) dv;
 
-PHYSFS_sint64 PHYSFS_write(PHYSFS_File *handle, const void *buffer,
-                           PHYSFS_uint32 size, PHYSFS_uint32 count)
+openDirectory_failed:
+    if (dv != NULL)
+    {
+        dirViewFreeMounts(dv);
+        allocator.Free(dv);
+    } /* if */
+    allocator.Free(dname);
+    return NULL;
+} /* PHYSFS_openDirectory */
+
+
+void PHYSFS_closeDirectory(PHYSFS_Directory *dir)
 {
-    const PHYSFS_uint64 len = ((PHYSFS_uint64) size) * ((PHYSFS_uint64) count);
-    const PHYSFS_sint64 retval = PHYSFS_writeBytes(handle, buffer, len);
-    return ( (retval <= 0) ? retval : (retval / ((PHYSFS_sint64) size)) );
-} /* PHYSFS_write */
+    DirView *dv = (DirView *) dir;
+    if (dv != NULL)
+    {
+        dirViewFreeMounts(dv);
+        allocator.Free(dv->dirname);
+        allocator.Free(dv);
+    } /* if */
+} /* PHYSFS_closeDirectory */
 
 
-PHYSFS_sint64 PHYSFS_writeBytes(PHYSFS_File *handle, const void *buffer,
-                                PHYSFS_uint64 _len)
+/* MAKE SURE you hold stateLock before calling this! Once you've released it,
+    pass (promo) to residentFinishPromotion(). */
+static PHYSFS_File *dirViewOpenRead(DirView *dv, char *fname, char *relname,
+                                    const size_t rellen,
+                                    ResidentPromotion *promo)
 {
-    const size_t len = (size_t) _len;
-    FileHandle *fh = (FileHandle *) handle;
+    FileHandle *fh = NULL;
+    PHYSFS_Io *io = NULL;
+    DirHandle *dh = NULL;
+    const int hashed = (*relname != '\0');
+    PHYSFS_uint32 hash = 0;
+    size_t i;
 
-#ifdef PHYSFS_NO_64BIT_SUPPORT
-    const PHYSFS_uint64 maxlen = __PHYSFS_UI64(0x7FFFFFFF);
-#else
-    const PHYSFS_uint64 maxlen = __PHYSFS_UI64(0x7FFFFFFFFFFFFFFF);
-#endif
+    BAIL_IF(dv->nummounts == 0, PHYSFS_ERR_NOT_FOUND, NULL);
 
-    if (!__PHYSFS_ui64FitsAddressSpace(_len))
-        BAIL(PHYSFS_ERR_INVALID_ARGUMENT, -1);
+    if (residentActive())
+        hash = __PHYSFS_hashString(fname, strlen(fname));
 
-    BAIL_IF(_len > maxlen, PHYSFS_ERR_INVALID_ARGUMENT, -1);
-    BAIL_IF(fh->forReading, PHYSFS_ERR_OPEN_FOR_READING, -1);
-    BAIL_IF_ERRPASS(len == 0, 0);
-    if (fh->buffer)
-        return doBufferedWrite(handle, buffer, len);
+    for (i = 0; i < dv->nummounts; i++)
+    {
+        const DirViewMount *m = &dv->mounts[i];
+        PHYSFS_uint32 archash = 0;
+        const char *arcfname = dirViewArcName(m, relname, rellen, &archash);
+        if (arcfname == NULL)
+            continue;
+
+        dh = m->dirHandle;
+        io = residentOpenRead(dh, fname, hash);
+        if (io)
+            break;
 
-    return fh->io->write(fh->io, buffer, len);
-} /* PHYSFS_write */
+        io = archiverOpenRead(dh, arcfname, hashed, archash);
+        if (io)
+        {
+            residentNoteOpen(dh, fname, hash, io, promo);
+            break;
+        } /* if */
+    } /* for */
+
+    if (io)
+    {
+        fh = (FileHandle *) allocator.Malloc(sizeof (FileHandle));
+        if (fh == NULL)
+        {
+            io->destroy(io);
+            BAIL(PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        } /* if */
+
+        memset(fh, '\0', sizeof (FileHandle));
+        fh->io = io;
+        fh->forReading = 1;
+        fh->dirHandle = dh;
+        fh->next = openReadList;
+        openReadList = fh;
+    } /* if */
+
+    return ((PHYSFS_File *) fh);
+} /* dirViewOpenRead */
 
 
-int PHYSFS_eof(PHYSFS_File *handle)
+PHYSFS_File *PHYSFS_openReadIn(PHYSFS_Directory *dir, const char *_fname)
 {
-    FileHandle *fh = (FileHandle *) handle;
+    DirView *dv = (DirView *) dir;
+    PHYSFS_File *retval = NULL;
+    ResidentPromotion promo;
+    char *scratch;
+    char *fname;
+    char *relname;
+    size_t rellen;
+    size_t len;
 
-    if (!fh->forReading)  /* never EOF on files opened for write/append. */
-        return 0;
+    BAIL_IF(!dv, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    memset(&promo, '\0', sizeof (promo));
 
-    /* can't be eof if buffer isn't empty */
-    if (fh->bufpos == fh->buffill)
+    __PHYSFS_platformGrabMutex(stateLock);
+    BAIL_IF_MUTEX_ERRPASS(!dirViewResolve(dv), stateLock, NULL);
+
+    len = strlen(_fname);
+    scratch = (char *) __PHYSFS_smallAlloc(dirViewScratchLen(dv, len));
+    BAIL_IF_MUTEX(!scratch, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, NULL);
+
+    if (dirViewPrepare(dv, scratch, _fname, len, &fname, &relname, &rellen))
     {
-        /* check the Io. */
-        PHYSFS_Io *io = fh->io;
-        const PHYSFS_sint64 pos = io->tell(io);
-        const PHYSFS_sint64 len = io->length(io);
-        if ((pos < 0) || (len < 0))
-            return 0;  /* beats me. */
-        return (pos >= len);
+        if ((dv->useFullPaths) || (rellen == 0))
+            retval = doOpenRead(fname, NULL, &promo);
+        else
+            retval = dirViewOpenRead(dv, fname, relname, rellen, &promo);
     } /* if */
 
-    return 0;
-} /* PHYSFS_eof */
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(scratch);
+    residentFinishPromotion(&promo, retval);
+    return retval;
+} /* PHYSFS_openReadIn */
 
 
-PHYSFS_sint64 PHYSFS_tell(PHYSFS_File *handle)
+/* MAKE SURE you hold stateLock before calling this! */
+static int dirViewStat(DirView *dv, char *relname, const size_t rellen,
+                       PHYSFS_Stat *stat)
 {
-    FileHandle *fh = (FileHandle *) handle;
-    const PHYSFS_sint64 pos = fh->io->tell(fh->io);
-    const PHYSFS_sint64 retval = fh->forReading ?
-                                 (pos - fh->buffill) + fh->bufpos :
-                                 (pos + fh->buffill);
+    const int hashed = (*relname != '\0');
+    int retval = 0;
+    size_t i;
+
+    /* set some sane defaults... */
+    stat->filesize = -1;
+    stat->modtime = -1;
+    stat->createtime = -1;
+    stat->accesstime = -1;
+    stat->filetype = PHYSFS_FILETYPE_OTHER;
+    stat->readonly = 1;
+
+    BAIL_IF(dv->nummounts == 0, PHYSFS_ERR_NOT_FOUND, 0);
+
+    for (i = 0; i < dv->nummounts; i++)
+    {
+        const DirViewMount *m = &dv->mounts[i];
+        PHYSFS_uint32 hash = 0;
+        const char *arcfname = dirViewArcName(m, relname, rellen, &hash);
+        if (arcfname == NULL)
+            continue;
+
+        retval = archiverStat(m->dirHandle, arcfname, hashed, hash, stat);
+        if ((retval) || (currentErrorCode() != PHYSFS_ERR_NOT_FOUND))
+            break;
+    } /* for */
+
     return retval;
-} /* PHYSFS_tell */
+} /* dirViewStat */
 
 
-int PHYSFS_seek(PHYSFS_File *handle, PHYSFS_uint64 pos)
+int PHYSFS_statIn(PHYSFS_Directory *dir, const char *_fname,
+                  PHYSFS_Stat *stat)
 {
-    FileHandle *fh = (FileHandle *) handle;
-    BAIL_IF_ERRPASS(!PHYSFS_flush(handle), 0);
+    DirView *dv = (DirView *) dir;
+    int retval = 0;
+    char *scratch;
+    char *fname;
+    char *relname;
+    size_t rellen;
+    size_t len;
 
-    if (fh->buffer && fh->forReading)
+    BAIL_IF(!dv, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!stat, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    BAIL_IF_MUTEX_ERRPASS(!dirViewResolve(dv), stateLock, 0);
+
+    len = strlen(_fname);
+    scratch = (char *) __PHYSFS_smallAlloc(dirViewScratchLen(dv, len));
+    BAIL_IF_MUTEX(!scratch, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+
+    if (dirViewPrepare(dv, scratch, _fname, len, &fname, &relname, &rellen))
     {
-        /* avoid throwing away our precious buffer if seeking within it. */
-        PHYSFS_sint64 offset = pos - PHYSFS_tell(handle);
-        if ( /* seeking within the already-buffered range? */
-             /* forward? */
-            ((offset >= 0) && (((size_t)offset) <= fh->buffill-fh->bufpos)) ||
-            /* backward? */
-            ((offset < 0) && (((size_t) -offset) <= fh->bufpos)) )
-        {
-            fh->bufpos = (size_t) (((PHYSFS_sint64) fh->bufpos) + offset);
-            return 1; /* successful seek */
-        } /* if */
+        if ((dv->useFullPaths) || (rellen == 0))
+            retval = doStat(fname, stat, NULL);
+        else
+            retval = dirViewStat(dv, relname, rellen, stat);
     } /* if */
 
-    /* we have to fall back to a 'raw' seek. */
-    fh->buffill = fh->bufpos = 0;
-    return fh->io->seek(fh->io, pos);
-} /* PHYSFS_seek */
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(scratch);
+    return retval;
+} /* PHYSFS_statIn */
 
 
-PHYSFS_sint64 PHYSFS_fileLength(PHYSFS_File *handle)
+int PHYSFS_enumerateIn(PHYSFS_Directory *dir, const char *_dname,
+                       PHYSFS_EnumerateCallback cb, void *data)
 {
-    PHYSFS_Io *io = ((FileHandle *) handle)->io;
-    return io->length(io);
-} /* PHYSFS_filelength */
-
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    DirView *dv = (DirView *) dir;
+    char *scratch;
+    char *fname;
+    char *relname;
+    size_t rellen;
+    size_t len;
+    size_t i;
 
-int PHYSFS_setBuffer(PHYSFS_File *handle, PHYSFS_uint64 _bufsize)
-{
-    FileHandle *fh = (FileHandle *) handle;
-    const size_t bufsize = (size_t) _bufsize;
+    BAIL_IF(!dv, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_dname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!cb, PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
-    if (!__PHYSFS_ui64FitsAddressSpace(_bufsize))
-        BAIL(PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    __PHYSFS_platformGrabMutex(stateLock);
+    BAIL_IF_MUTEX_ERRPASS(!dirViewResolve(dv), stateLock, 0);
 
-    BAIL_IF_ERRPASS(!PHYSFS_flush(handle), 0);
+    len = strlen(_dname);
+    scratch = (char *) __PHYSFS_smallAlloc(dirViewScratchLen(dv, len));
+    BAIL_IF_MUTEX(!scratch, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
 
-    /*
-     * For reads, we need to move the file pointer to where it would be
-     *  if we weren't buffering, so that the next read will get the
-     *  right chunk of stuff from the file. PHYSFS_flush() handles writes.
-     */
-    if ((fh->forReading) && (fh->buffill != fh->bufpos))
-    {
-        PHYSFS_uint64 pos;
-        const PHYSFS_sint64 curpos = fh->io->tell(fh->io);
-        BAIL_IF_ERRPASS(curpos == -1, 0);
-        pos = ((curpos - fh->buffill) + fh->bufpos);
-        BAIL_IF_ERRPASS(!fh->io->seek(fh->io, pos), 0);
-    } /* if */
+    if (!dirViewPrepare(dv, scratch, _dname, len, &fname, &relname, &rellen))
+        retval = PHYSFS_ENUM_STOP;
 
-    if (bufsize == 0)  /* delete existing buffer. */
+    else if (dv->useFullPaths)
     {
-        if (fh->buffer)
-        {
-            allocator.Free(fh->buffer);
-            fh->buffer = NULL;
-        } /* if */
-    } /* if */
+        /* callbacks get the full name, like PHYSFS_enumerate() gives them. */
+        retval = doEnumerate(fname, fname, cb, data);
+    } /* else if */
 
     else
     {
-        PHYSFS_uint8 *newbuf;
-        newbuf = (PHYSFS_uint8 *) allocator.Realloc(fh->buffer, bufsize);
-        BAIL_IF(!newbuf, PHYSFS_ERR_OUT_OF_MEMORY, 0);
-        fh->buffer = newbuf;
+        for (i = 0; (retval == PHYSFS_ENUM_OK) && (i < dv->nummounts); i++)
+        {
+            const DirViewMount *m = &dv->mounts[i];
+            const char *arcfname = dirViewArcName(m, relname, rellen, NULL);
+            if (arcfname != NULL)
+                retval = enumerateArchive(m->dirHandle, arcfname, cb, fname, data);
+        } /* for */
     } /* else */
 
-    fh->bufsize = bufsize;
-    fh->buffill = fh->bufpos = 0;
-    return 1;
-} /* PHYSFS_setBuffer */
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(scratch);
+
+    return (retval == PHYSFS_ENUM_ERROR) ? 0 : 1;
+} /* PHYSFS_enumerateIn */
 
 
-int PHYSFS_flush(PHYSFS_File *handle)
+/* MAKE SURE you hold stateLock before calling this! */
+static int fingerprintFile(DirHandle *dh, const char *arcfname,
+                           PHYSFS_uint64 *fp)
 {
-    FileHandle *fh = (FileHandle *) handle;
-    PHYSFS_Io *io;
-    PHYSFS_sint64 rc;
+    const PHYSFS_Archiver *funcs = dh->funcs;
+    PHYSFS_Stat statbuf;
 
-    if ((fh->forReading) || (fh->bufpos == fh->buffill))
-        return 1;  /* open for read or buffer empty are successful no-ops. */
+    if (funcs->fingerprint != NULL)
+    {
+        if (funcs->fingerprint(dh->opaque, arcfname, fp))
+            return 1;
+        else if (currentErrorCode() != PHYSFS_ERR_UNSUPPORTED)
+            return 0;
+    } /* if */
 
-    /* dump buffer to disk. */
-    io = fh->io;
-    rc = io->write(io, fh->buffer + fh->bufpos, fh->buffill - fh->bufpos);
-    BAIL_IF_ERRPASS(rc <= 0, 0);
-    fh->bufpos = fh->buffill = 0;
+    /* archiver can't do better, so go with what stat() knows. */
+    BAIL_IF_ERRPASS(!funcs->stat(dh->opaque, arcfname, &statbuf), 0);
+    BAIL_IF(statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY, PHYSFS_ERR_NOT_A_FILE, 0);
+    *fp = __PHYSFS_mixFingerprint(0, (PHYSFS_uint64) statbuf.filesize);
+    *fp = __PHYSFS_mixFingerprint(*fp, (PHYSFS_uint64) statbuf.modtime);
+    *fp = __PHYSFS_mixFingerprint(*fp, (PHYSFS_uint64) statbuf.createtime);
     return 1;
-} /* PHYSFS_flush */
+} /* fingerprintFile */
 
 
-int PHYSFS_stat(const char *_fname, PHYSFS_Stat *stat)
+int PHYSFS_getFingerprint(const char *_fname, PHYSFS_uint64 *fp)
 {
     int retval = 0;
     char *allocated_fname;
@@ -3077,15 +6354,7 @@ int PHYSFS_stat(const char *_fname, PHYSFS_Stat *stat)
     size_t len;
 
     BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!stat, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-
-    /* set some sane defaults... */
-    stat->filesize = -1;
-    stat->modtime = -1;
-    stat->createtime = -1;
-    stat->accesstime = -1;
-    stat->filetype = PHYSFS_FILETYPE_OTHER;
-    stat->readonly = 1;
+    BAIL_IF(!fp, PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
     __PHYSFS_platformGrabMutex(stateLock);
     len = strlen(_fname) + longest_root + 1;
@@ -3095,40 +6364,39 @@ int PHYSFS_stat(const char *_fname, PHYSFS_Stat *stat)
 
     if (sanitizePlatformIndependentPath(_fname, fname))
     {
+        DirHandle *i;
+        int found = 0;
+
         if (*fname == '\0')
         {
-            stat->filetype = PHYSFS_FILETYPE_DIRECTORY;
-            stat->readonly = !writeDir; /* Writeable if we have a writeDir */
-            retval = 1;
+            PHYSFS_setErrorCode(PHYSFS_ERR_NOT_A_FILE);
+            found = 1;
         } /* if */
-        else
+
+        for (i = searchPath; ((i != NULL) && (!found)); i = i->next)
         {
-            DirHandle *i;
-            int exists = 0;
-            for (i = searchPath; ((i != NULL) && (!exists)); i = i->next)
+            char *arcfname = fname;
+            if (partOfMountPoint(i, arcfname))
             {
-                char *arcfname = fname;
-                exists = partOfMountPoint(i, arcfname);
-                if (exists)
-                {
-                    stat->filetype = PHYSFS_FILETYPE_DIRECTORY;
-                    stat->readonly = 1;
-                    retval = 1;
-                } /* if */
-                else if (verifyPath(i, &arcfname, 0))
-                {
-                    retval = i->funcs->stat(i->opaque, arcfname, stat);
-                    if ((retval) || (currentErrorCode() != PHYSFS_ERR_NOT_FOUND))
-                        exists = 1;
-                } /* else if */
-            } /* for */
-        } /* else */
+                PHYSFS_setErrorCode(PHYSFS_ERR_NOT_A_FILE);
+                found = 1;
+            } /* if */
+            else if (verifyPath(i, &arcfname, 0))
+            {
+                retval = fingerprintFile(i, arcfname, fp);
+                if ((retval) || (currentErrorCode() != PHYSFS_ERR_NOT_FOUND))
+                    found = 1;
+            } /* else if */
+        } /* for */
+
+        if (!found)
+            PHYSFS_setErrorCode(PHYSFS_ERR_NOT_FOUND);
     } /* if */
 
     __PHYSFS_platformReleaseMutex(stateLock);
     __PHYSFS_smallFree(allocated_fname);
     return retval;
-} /* PHYSFS_stat */
+} /* PHYSFS_getFingerprint */
 
 
 int __PHYSFS_readAll(PHYSFS_Io *io, void *buf, const size_t _len)
@@ -3315,14 +6583,21 @@ void *__PHYSFS_DirTreeAdd(__PHYSFS_DirTree *dt, char *name, const int isdir)
 /* Find the __PHYSFS_DirTreeEntry for a path in platform-independent notation. */
 void *__PHYSFS_DirTreeFind(__PHYSFS_DirTree *dt, const char *path)
 {
-    PHYSFS_uint32 hashval;
+    return __PHYSFS_DirTreeFindHashed(dt, path,
+                                      __PHYSFS_hashString(path, strlen(path)));
+} /* __PHYSFS_DirTreeFind */
+
+
+void *__PHYSFS_DirTreeFindHashed(__PHYSFS_DirTree *dt, const char *path,
+                                 const PHYSFS_uint32 hash)
+{
+    const PHYSFS_uint32 hashval = hash % dt->hashBuckets;
     __PHYSFS_DirTreeEntry *prev = NULL;
     __PHYSFS_DirTreeEntry *retval;
 
     if (*path == '\0')
         return dt->root;
 
-    hashval = hashPathName(dt, path);
     for (retval = dt->hash[hashval]; retval; retval = retval->hashnext)
     {
         if (strcmp(retval->name, path) == 0)
@@ -3341,7 +6616,7 @@ void *__PHYSFS_DirTreeFind(__PHYSFS_DirTree *dt, const char *path)
     } /* for */
 
     BAIL(PHYSFS_ERR_NOT_FOUND, NULL);
-} /* __PHYSFS_DirTreeFind */
+} /* __PHYSFS_DirTreeFindHashed */
 
 PHYSFS_EnumerateCallbackResult __PHYSFS_DirTreeEnumerate(void *opaque,
                               const char *dname, PHYSFS_EnumerateCallback cb,
@@ -140,7 +140,7 @@
  *  type where possible.
  *
  * Currently supported archive types:
- *   - .ZIP (pkZip/WinZip/Info-ZIP compatible)
+ *   - .ZIP (pkZip/WinZip/Info-ZIP compatible, plus Zstandard entries)
  *   - .7Z  (7zip archives)
  *   - .ISO (ISO9660 files, CD-ROM images)
  *   - .GRP (Build Engine groupfile archives)
@@ -150,6 +150,9 @@
  *   - .WAD (DOOM engine archives)
  *   - .VDF (Gothic I/II engine archives)
  *   - .SLB (Independence War archives)
+ *   - .TAR (uncompressed ustar, pax and GNU tarballs)
+ *   - .CAS (manifests over a content-addressed chunk store; see
+ *           physfs_archiver_cas.c for the format)
  *
  * String policy for PhysicsFS 2.0 and later:
  *
@@ -3306,6 +3309,12 @@ PHYSFS_DECL int PHYSFS_mountMemory(const void *buf, PHYSFS_uint64 len,
  *          compress the contents of the inner archive and make sure the outer
  *          .zip file doesn't compress the inner archive too.
  *
+ * If (file) was opened from an archive that stores it uncompressed and
+ *  unencrypted (a stored .zip entry, or any entry in the simple formats
+ *  like .grp or .wad), the mounted archive reads straight from the outer
+ *  archive's data instead of going through (file), so it costs no more to
+ *  use than an archive mounted with PHYSFS_mount().
+ *
  * This function operates just like PHYSFS_mount(), but takes a PHYSFS_File
  *  handle instead of a pathname. This handle contains all the data of the
  *  archive, and is used instead of a real file in the physical filesystem.
@@ -3619,10 +3628,12 @@ typedef struct PHYSFS_Archiver
     /**
      * \brief Binary compatibility information.
      *
-     * This must be set to zero at this time. Future versions of this
-     *  struct will increment this field, so we know what a given
-     *  implementation supports. We'll presumably keep supporting older
-     *  versions as we offer new features, though.
+     * This must be set to 0, 1, 2 or 3 at this time. Version 1 added the
+     *  (fingerprint) method, version 2 added (refresh) and version 3 added
+     *  (sniff); older implementations simply stop before them. Future
+     *  versions of this struct will increment this field, so we know what a
+     *  given implementation supports. We'll presumably keep supporting
+     *  older versions as we offer new features, though.
      */
     PHYSFS_uint32 version;
 
@@ -3777,6 +3788,74 @@ typedef struct PHYSFS_Archiver
      *  there are still files open from this archive.
      */
     void (*closeArchive)(void *opaque);
+
+    /**
+     * \brief Fingerprint a file's contents without reading them.
+     *
+     * (This member is only looked at if (version) is 1 or greater, and may
+     *  be NULL.)
+     *
+     * Set (*fp) to a value that changes whenever the file's contents do,
+     *  using only metadata you already have: a stored checksum and size,
+     *  an inode number and modification time, etc. Don't read the file
+     *  data; if you can't do better than that, leave this NULL, or fail
+     *  with PHYSFS_ERR_UNSUPPORTED, and PhysicsFS will build a weaker
+     *  fingerprint from what your stat() method reports.
+     *
+     * Returns non-zero on success, zero on failure.
+     * This filename is in platform-independent notation.
+     * On failure, call PHYSFS_setErrorCode().
+     */
+    int (*fingerprint)(void *opaque, const char *fn, PHYSFS_uint64 *fp);
+
+    /**
+     * \brief Pick up changes to an open archive.
+     *
+     * (This member is only looked at if (version) is 2 or greater, and may
+     *  be NULL, in which case PHYSFS_refreshMount() fails with
+     *  PHYSFS_ERR_UNSUPPORTED.)
+     *
+     * The archive's data has changed underneath (opaque); make whatever new
+     *  files it has visible. Files that are already open from this archive
+     *  must keep working, so don't free or move anything they depend on.
+     *  It's fine to only handle some kinds of changes (files appended to
+     *  the end, say) and fail with PHYSFS_ERR_UNSUPPORTED otherwise.
+     *
+     * Returns non-zero on success (including if nothing changed), zero on
+     *  failure. On failure, call PHYSFS_setErrorCode().
+     */
+    int (*refresh)(void *opaque);
+
+    /**
+     * \brief Guess whether a file is in your format from a few of its bytes.
+     *
+     * (This member is only looked at if (version) is 3 or greater, and may
+     *  be NULL, in which case (openArchive) is always tried.)
+     *
+     * Before mounting a file, PhysicsFS reads the start and the end of it
+     *  once and shows them to every archiver, so it only has to call
+     *  (openArchive) on the ones that recognize it, instead of letting each
+     *  archiver seek around the file looking for its own signature.
+     *
+     * (head) is the first (headlen) bytes of the file: 34816 of them (enough
+     *  to reach sector 16 of a CD image), or all of it if the file is
+     *  shorter. (tail) is the last (taillen) bytes: 65557 of them (a ZIP
+     *  end-of-central-dir record and the longest possible comment), or all
+     *  of the file if it's shorter, in which case the two overlap. (taillen) is
+     *  zero if the end couldn't be read. (filelen) is the file's length, or
+     *  -1 if it isn't known. Don't keep pointers to these buffers after
+     *  returning.
+     *
+     * Return 1 if this looks like your format, 0 if it definitely isn't,
+     *  and -1 if you can't tell from these bytes (your signature is past
+     *  (headlen), say). Archivers that return 1 are tried before ones that
+     *  return -1, and ones that return 0 aren't tried at all, so only
+     *  return 0 when (openArchive) would certainly fail. This must not
+     *  have side effects, and must not set an error code.
+     */
+    int (*sniff)(const void *head, PHYSFS_uint64 headlen,
+                 const void *tail, PHYSFS_uint64 taillen,
+                 PHYSFS_sint64 filelen);
 } PHYSFS_Archiver;
 
 /**
@@ -3884,6 +3963,965 @@ PHYSFS_DECL int PHYSFS_setRoot(const char *archive, const char *subdir);
 /* Everything above this line is part of the PhysicsFS 3.1 API. */
 
 
+/**
+ * \struct PHYSFS_ResidentStats
+ * \brief What the resident-memory tier is doing.
+ *
+ * \sa PHYSFS_setResidentBudget
+ * \sa PHYSFS_getResidentStats
+ */
+typedef struct PHYSFS_ResidentStats
+{
+    PHYSFS_uint64 budget;  /**< bytes allowed, from PHYSFS_setResidentBudget(). */
+    PHYSFS_uint64 used;  /**< bytes of file data resident right now. */
+    PHYSFS_uint32 files;  /**< number of files resident right now. */
+    PHYSFS_uint32 pinned;  /**< how many of those are pinned. */
+    PHYSFS_uint64 hits;  /**< opens served from memory. */
+    PHYSFS_uint64 misses;  /**< opens that went to the archive instead. */
+    PHYSFS_uint64 promotions;  /**< times a file was loaded into memory. */
+    PHYSFS_uint64 evictions;  /**< times a file was dropped to make room. */
+} PHYSFS_ResidentStats;
+
+
+/**
+ * \fn int PHYSFS_setResidentBudget(PHYSFS_uint64 bytes, PHYSFS_uint32 promoteAfter)
+ * \brief Keep frequently-opened files in memory.
+ *
+ * With a nonzero budget, PhysicsFS counts how often each file is opened for
+ *  reading. Once a file has been opened (promoteAfter) times, its contents
+ *  are read (and decompressed, if it's in a compressed archive) into memory,
+ *  and later PHYSFS_openRead() calls for it are served from there without
+ *  touching the archive at all. Every handle to a resident file shares the
+ *  same buffer.
+ *
+ * When a new file needs room, the resident files opened least often are
+ *  dropped first; a file is only promoted if it has been opened more often
+ *  than what it would push out. Files bigger than the whole budget are
+ *  never promoted. Handles that are still open on a dropped file keep
+ *  working; the memory goes away when the last of them is closed, but it
+ *  no longer counts against the budget.
+ *
+ * Resident files are forgotten when their archive is unmounted or its root
+ *  changes, and when PhysicsFS opens the same path for writing or deletes
+ *  it. Changes made to files behind PhysicsFS's back are not noticed.
+ *
+ * The budget is zero (disabled) by default. Setting a smaller budget drops
+ *  files right away until the rest fit; setting zero drops everything that
+ *  isn't pinned and stops counting.
+ *
+ *   \param bytes Most file data to keep in memory, in bytes.
+ *   \param promoteAfter Opens before a file is loaded. Zero picks a default.
+ *  \return nonzero on success, zero on error. Use PHYSFS_getLastErrorCode()
+ *          to obtain the specific error.
+ *
+ * \sa PHYSFS_pinFile
+ * \sa PHYSFS_getResidentStats
+ */
+PHYSFS_DECL int PHYSFS_setResidentBudget(PHYSFS_uint64 bytes,
+                                         PHYSFS_uint32 promoteAfter);
+
+
+/**
+ * \fn int PHYSFS_pinFile(const char *filename)
+ * \brief Load a file into memory now and keep it there.
+ *
+ * (filename) is found in the search path just like PHYSFS_openRead() would
+ *  find it, read into memory right away, and served from memory until it's
+ *  unpinned, whatever the access counts say. Pinned files count against
+ *  the budget set with PHYSFS_setResidentBudget() and push other resident
+ *  files out to make room, but are loaded even if the budget is too small
+ *  (or zero).
+ *
+ * Pins nest: a file pinned twice needs unpinning twice.
+ *
+ *   \param filename File to pin, in platform-independent notation.
+ *  \return nonzero on success, zero on error. Use PHYSFS_getLastErrorCode()
+ *          to obtain the specific error.
+ *
+ * \sa PHYSFS_unpinFile
+ */
+PHYSFS_DECL int PHYSFS_pinFile(const char *filename);
+
+
+/**
+ * \fn int PHYSFS_unpinFile(const char *filename)
+ * \brief Undo one PHYSFS_pinFile().
+ *
+ * Once all its pins are gone, the file stays resident but can be dropped
+ *  like any other resident file.
+ *
+ *   \param filename File to unpin, in platform-independent notation.
+ *  \return nonzero on success, zero on error (including if the file isn't
+ *          pinned). Use PHYSFS_getLastErrorCode() to obtain the specific
+ *          error.
+ *
+ * \sa PHYSFS_pinFile
+ */
+PHYSFS_DECL int PHYSFS_unpinFile(const char *filename);
+
+
+/**
+ * \fn int PHYSFS_getResidentStats(PHYSFS_ResidentStats *stats)
+ * \brief Get the resident-memory tier's budget, usage and hit counts.
+ *
+ *   \param stats Filled in on success.
+ *  \return nonzero on success, zero on error. Use PHYSFS_getLastErrorCode()
+ *          to obtain the specific error.
+ *
+ * \sa PHYSFS_setResidentBudget
+ */
+PHYSFS_DECL int PHYSFS_getResidentStats(PHYSFS_ResidentStats *stats);
+
+
+/**
+ * \fn int PHYSFS_preload(const char *dir)
+ * \brief Read a whole directory tree into memory and mount it there.
+ *
+ * Everything under (dir), as the search path sees it right now, is read
+ *  (and decompressed) into one block of memory, which is then mounted at
+ *  (dir) in front of the rest of the search path. Until it's released,
+ *  opening any of those files is just a look at that block; the disk and
+ *  the original archives aren't touched.
+ *
+ * Each file is stored with the contents that PHYSFS_openRead() found for
+ *  it at preload time, so the snapshot looks exactly like the interpolated
+ *  tree did. Files added to (dir) later still show up from the archives
+ *  behind the snapshot; changes to files already in it don't.
+ *
+ * The snapshot shows up in the search path as "preload:" followed by
+ *  (dir) in sanitized form (for example, "preload:maps/e1m1"), which is
+ *  also what PHYSFS_getRealDir() reports for files in it. Preloading a
+ *  directory that's already preloaded does nothing and succeeds; release
+ *  it first if you want a fresh copy.
+ *
+ * This does all its reading on the calling thread before returning.
+ *
+ *   \param dir Directory to preload, in platform-independent notation.
+ *               "" or "/" preloads everything.
+ *  \return nonzero on success, zero on error. Use PHYSFS_getLastErrorCode()
+ *          to obtain the specific error.
+ *
+ * \sa PHYSFS_releasePreload
+ */
+PHYSFS_DECL int PHYSFS_preload(const char *dir);
+
+
+/**
+ * \fn int PHYSFS_releasePreload(const char *dir)
+ * \brief Unmount a snapshot made by PHYSFS_preload().
+ *
+ * This is PHYSFS_unmount() for the snapshot, and fails the same way if
+ *  files opened from it are still open. The memory is freed when the
+ *  snapshot is released.
+ *
+ *   \param dir The same directory that was passed to PHYSFS_preload().
+ *  \return nonzero on success, zero on error. Use PHYSFS_getLastErrorCode()
+ *          to obtain the specific error.
+ *
+ * \sa PHYSFS_preload
+ */
+PHYSFS_DECL int PHYSFS_releasePreload(const char *dir);
+
+
+/**
+ * \fn void PHYSFS_swapArrayLE16(PHYSFS_uint16 *vals, PHYSFS_uint64 count)
+ * \brief Convert an array of 16-bit littleendian values in place.
+ *
+ * Converts (count) 16-bit littleendian values to the platform's native
+ *  byte order, in place. This does nothing on littleendian platforms, and
+ *  uses vector instructions where the compiler targets them. Signed values
+ *  convert the same way; just cast the pointer.
+ *
+ *    \param vals array of values to convert.
+ *    \param count number of values (not bytes) in (vals).
+ */
+PHYSFS_DECL void PHYSFS_swapArrayLE16(PHYSFS_uint16 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn void PHYSFS_swapArrayBE16(PHYSFS_uint16 *vals, PHYSFS_uint64 count)
+ * \brief Convert an array of 16-bit bigendian values in place.
+ *
+ * Converts (count) 16-bit bigendian values to the platform's native
+ *  byte order, in place. This does nothing on bigendian platforms, and
+ *  uses vector instructions where the compiler targets them. Signed values
+ *  convert the same way; just cast the pointer.
+ *
+ *    \param vals array of values to convert.
+ *    \param count number of values (not bytes) in (vals).
+ */
+PHYSFS_DECL void PHYSFS_swapArrayBE16(PHYSFS_uint16 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn void PHYSFS_swapArrayLE32(PHYSFS_uint32 *vals, PHYSFS_uint64 count)
+ * \brief Convert an array of 32-bit littleendian values in place.
+ *
+ * Converts (count) 32-bit littleendian values to the platform's native
+ *  byte order, in place. This does nothing on littleendian platforms, and
+ *  uses vector instructions where the compiler targets them. Signed values
+ *  convert the same way; just cast the pointer.
+ *
+ *    \param vals array of values to convert.
+ *    \param count number of values (not bytes) in (vals).
+ */
+PHYSFS_DECL void PHYSFS_swapArrayLE32(PHYSFS_uint32 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn void PHYSFS_swapArrayBE32(PHYSFS_uint32 *vals, PHYSFS_uint64 count)
+ * \brief Convert an array of 32-bit bigendian values in place.
+ *
+ * Converts (count) 32-bit bigendian values to the platform's native
+ *  byte order, in place. This does nothing on bigendian platforms, and
+ *  uses vector instructions where the compiler targets them. Signed values
+ *  convert the same way; just cast the pointer.
+ *
+ *    \param vals array of values to convert.
+ *    \param count number of values (not bytes) in (vals).
+ */
+PHYSFS_DECL void PHYSFS_swapArrayBE32(PHYSFS_uint32 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn void PHYSFS_swapArrayLE64(PHYSFS_uint64 *vals, PHYSFS_uint64 count)
+ * \brief Convert an array of 64-bit littleendian values in place.
+ *
+ * Converts (count) 64-bit littleendian values to the platform's native
+ *  byte order, in place. This does nothing on littleendian platforms, and
+ *  uses vector instructions where the compiler targets them. Signed values
+ *  convert the same way; just cast the pointer.
+ *
+ *    \param vals array of values to convert.
+ *    \param count number of values (not bytes) in (vals).
+ */
+PHYSFS_DECL void PHYSFS_swapArrayLE64(PHYSFS_uint64 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn void PHYSFS_swapArrayBE64(PHYSFS_uint64 *vals, PHYSFS_uint64 count)
+ * \brief Convert an array of 64-bit bigendian values in place.
+ *
+ * Converts (count) 64-bit bigendian values to the platform's native
+ *  byte order, in place. This does nothing on bigendian platforms, and
+ *  uses vector instructions where the compiler targets them. Signed values
+ *  convert the same way; just cast the pointer.
+ *
+ *    \param vals array of values to convert.
+ *    \param count number of values (not bytes) in (vals).
+ */
+PHYSFS_DECL void PHYSFS_swapArrayBE64(PHYSFS_uint64 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArraySLE16(PHYSFS_File *file, PHYSFS_sint16 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of signed 16-bit littleendian values.
+ *
+ * Convenience function. Read (count) signed 16-bit littleendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readSLE16
+ */
+PHYSFS_DECL int PHYSFS_readArraySLE16(PHYSFS_File *file, PHYSFS_sint16 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArrayULE16(PHYSFS_File *file, PHYSFS_uint16 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of unsigned 16-bit littleendian values.
+ *
+ * Convenience function. Read (count) unsigned 16-bit littleendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readULE16
+ */
+PHYSFS_DECL int PHYSFS_readArrayULE16(PHYSFS_File *file, PHYSFS_uint16 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArraySBE16(PHYSFS_File *file, PHYSFS_sint16 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of signed 16-bit bigendian values.
+ *
+ * Convenience function. Read (count) signed 16-bit bigendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readSBE16
+ */
+PHYSFS_DECL int PHYSFS_readArraySBE16(PHYSFS_File *file, PHYSFS_sint16 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArrayUBE16(PHYSFS_File *file, PHYSFS_uint16 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of unsigned 16-bit bigendian values.
+ *
+ * Convenience function. Read (count) unsigned 16-bit bigendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readUBE16
+ */
+PHYSFS_DECL int PHYSFS_readArrayUBE16(PHYSFS_File *file, PHYSFS_uint16 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArraySLE32(PHYSFS_File *file, PHYSFS_sint32 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of signed 32-bit littleendian values.
+ *
+ * Convenience function. Read (count) signed 32-bit littleendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readSLE32
+ */
+PHYSFS_DECL int PHYSFS_readArraySLE32(PHYSFS_File *file, PHYSFS_sint32 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArrayULE32(PHYSFS_File *file, PHYSFS_uint32 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of unsigned 32-bit littleendian values.
+ *
+ * Convenience function. Read (count) unsigned 32-bit littleendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readULE32
+ */
+PHYSFS_DECL int PHYSFS_readArrayULE32(PHYSFS_File *file, PHYSFS_uint32 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArraySBE32(PHYSFS_File *file, PHYSFS_sint32 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of signed 32-bit bigendian values.
+ *
+ * Convenience function. Read (count) signed 32-bit bigendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readSBE32
+ */
+PHYSFS_DECL int PHYSFS_readArraySBE32(PHYSFS_File *file, PHYSFS_sint32 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArrayUBE32(PHYSFS_File *file, PHYSFS_uint32 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of unsigned 32-bit bigendian values.
+ *
+ * Convenience function. Read (count) unsigned 32-bit bigendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readUBE32
+ */
+PHYSFS_DECL int PHYSFS_readArrayUBE32(PHYSFS_File *file, PHYSFS_uint32 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArraySLE64(PHYSFS_File *file, PHYSFS_sint64 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of signed 64-bit littleendian values.
+ *
+ * Convenience function. Read (count) signed 64-bit littleendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readSLE64
+ */
+PHYSFS_DECL int PHYSFS_readArraySLE64(PHYSFS_File *file, PHYSFS_sint64 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArrayULE64(PHYSFS_File *file, PHYSFS_uint64 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of unsigned 64-bit littleendian values.
+ *
+ * Convenience function. Read (count) unsigned 64-bit littleendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readULE64
+ */
+PHYSFS_DECL int PHYSFS_readArrayULE64(PHYSFS_File *file, PHYSFS_uint64 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArraySBE64(PHYSFS_File *file, PHYSFS_sint64 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of signed 64-bit bigendian values.
+ *
+ * Convenience function. Read (count) signed 64-bit bigendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readSBE64
+ */
+PHYSFS_DECL int PHYSFS_readArraySBE64(PHYSFS_File *file, PHYSFS_sint64 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_readArrayUBE64(PHYSFS_File *file, PHYSFS_uint64 *vals, PHYSFS_uint64 count)
+ * \brief Read and convert an array of unsigned 64-bit bigendian values.
+ *
+ * Convenience function. Read (count) unsigned 64-bit bigendian values
+ *  from a file with a single PHYSFS_readBytes() and convert them to the
+ *  platform's native byte order.
+ *
+ *    \param file PhysicsFS file handle from which to read.
+ *    \param vals pointer to where the values should be stored.
+ *    \param count number of values (not bytes) to read.
+ *   \return zero on failure, non-zero on success. On failure, including a
+ *           short read, (vals) may hold partial data, and you can find out
+ *           what went wrong from PHYSFS_getLastErrorCode().
+ *
+ * \sa PHYSFS_readUBE64
+ */
+PHYSFS_DECL int PHYSFS_readArrayUBE64(PHYSFS_File *file, PHYSFS_uint64 *vals, PHYSFS_uint64 count);
+
+/**
+ * \fn int PHYSFS_utf8Valid(const char *str)
+ * \brief Check that a string is well-formed UTF-8.
+ *
+ * This uses the same rules the conversion functions do: if this returns
+ *  non-zero, converting (str) with PHYSFS_utf8ToUtf16() or friends won't
+ *  produce any '?' replacement characters for bogus sequences. Overlong
+ *  encodings, stray continuation bytes, truncated sequences, codepoints
+ *  above U+10FFFF, and the old five and six byte forms all fail.
+ *
+ * Runs of plain ASCII are checked many bytes at a time, so this is cheap
+ *  for the usual case of a mostly-ASCII path.
+ *
+ *   \param str Null-terminated string to check.
+ *  \return non-zero if (str) is valid UTF-8, zero otherwise.
+ *
+ * \sa PHYSFS_utf8ToUtf16
+ */
+PHYSFS_DECL int PHYSFS_utf8Valid(const char *str);
+
+/**
+ * \fn PHYSFS_uint32 PHYSFS_utf8CaseFoldHash(const char *str)
+ * \brief Hash a UTF-8 string, ignoring case.
+ *
+ * This hashes the same case-folded codepoints that PHYSFS_utf8stricmp()
+ *  compares, so any two strings that PHYSFS_utf8stricmp() considers equal
+ *  get the same hash. That lets you build a case-insensitive lookup table
+ *  (say, of every file in a directory) and only call PHYSFS_utf8stricmp()
+ *  on the entries in one bucket, instead of comparing against everything.
+ *
+ * Plain ASCII is folded many bytes at a time; only other characters go
+ *  through the full Unicode case folding tables.
+ *
+ * The hash isn't cryptographic, and it may change between releases of
+ *  PhysicsFS, so don't store it anywhere.
+ *
+ *   \param str Null-terminated UTF-8 string to hash.
+ *  \return The hash value.
+ *
+ * \sa PHYSFS_utf8stricmp
+ */
+PHYSFS_DECL PHYSFS_uint32 PHYSFS_utf8CaseFoldHash(const char *str);
+
+/**
+ * \fn int PHYSFS_getFingerprint(const char *fname, PHYSFS_uint64 *fp)
+ * \brief Get a cheap fingerprint of a file's contents.
+ *
+ * This gives you a 64-bit value that changes when the contents of (fname)
+ *  do, without reading any file data, so deciding whether something
+ *  derived from a file is stale is a metadata scan instead of a hash of
+ *  every byte.
+ *
+ * What goes into it depends on where the file lives:
+ *  - .zip and .7z archives: the CRC-32 and size stored in the archive's
+ *    directory.
+ *  - Native directories: the device and inode (or volume serial and file
+ *    index on Windows), modification time and size.
+ *  - Everything else: the size and timestamps PHYSFS_stat() reports.
+ *    Formats that don't store timestamps can only notice size changes this
+ *    way, so don't lean on it for them.
+ *
+ * As with PHYSFS_openRead(), the first match in the search path wins.
+ *
+ * Fingerprints are only comparable with other fingerprints of the same
+ *  file from the same kind of mount; they aren't hashes of the data. A file
+ *  in a native directory gets a new fingerprint if it's copied somewhere
+ *  else, even if its contents didn't change, and they are not guaranteed
+ *  to stay the same between releases of PhysicsFS.
+ *
+ *   \param fname filename to fingerprint, in platform-independent notation.
+ *   \param fp where to store the fingerprint.
+ *  \return non-zero on success, zero on failure (including if (fname) is a
+ *          directory). Use PHYSFS_getLastErrorCode() to find out why.
+ *
+ * \sa PHYSFS_stat
+ */
+PHYSFS_DECL int PHYSFS_getFingerprint(const char *fname, PHYSFS_uint64 *fp);
+
+/**
+ * \fn int PHYSFS_refreshMount(const char *dir)
+ * \brief Pick up files added to a mounted archive, without remounting.
+ *
+ * Remounting a big archive means PHYSFS_unmount(), which fails while any
+ *  of its files are open, and then parsing the whole thing again with
+ *  PHYSFS_mount(). If the archive only grew, this does much less: .zip
+ *  files that had entries appended (with the central directory rewritten
+ *  after them, the way "zip -g" and most append-mode writers work) get
+ *  only the new central directory records parsed and added. Existing
+ *  entries, and files already open from the archive, are left alone. The
+ *  archive is looked up by name again, so a grown copy that was renamed
+ *  over the original works too, as long as the old part is unchanged.
+ *
+ * If the archive changed in some other way (entries removed, replaced or
+ *  reordered, or the whole file rewritten), this fails with
+ *  PHYSFS_ERR_UNSUPPORTED and you need to unmount and mount it again. That
+ *  includes an append that adds a path the archive already has, which is
+ *  how most tools update a file; this is checked before anything is added,
+ *  so the mount is left as it was. A refresh that fails partway for other
+ *  reasons (i/o errors, out of memory) may have added some of the new
+ *  files already; calling it again continues from there.
+ *
+ * Native directories are always current, so refreshing one succeeds
+ *  without doing anything. Other archive types fail with
+ *  PHYSFS_ERR_UNSUPPORTED.
+ *
+ *   \param dir The name the archive was mounted with; the same string
+ *               you'd pass to PHYSFS_unmount().
+ *  \return nonzero on success (including if nothing changed), zero on
+ *          error. Use PHYSFS_getLastErrorCode() to obtain the specific
+ *          error.
+ *
+ * \sa PHYSFS_mount
+ * \sa PHYSFS_unmount
+ */
+PHYSFS_DECL int PHYSFS_refreshMount(const char *dir);
+
+/**
+ * \fn int PHYSFS_setArchiveIndexDir(const char *dir)
+ * \brief Share parsed archive directories between processes.
+ *
+ * Every process that mounts a big .zip file parses its whole central
+ *  directory and keeps its own copy of the result. If many processes on a
+ *  machine mount the same archives, that's the same work and the same
+ *  memory over and over.
+ *
+ * With an index directory set, the first process to mount a .zip file
+ *  (from a real file on disk) writes a compact, pointer-free index of it
+ *  to that directory, and then uses the index instead of its own copy.
+ *  Later mounts of the same archive, by this process or any other,
+ *  memory-map the index read-only instead of parsing anything, so they're
+ *  nearly instant and the operating system keeps one copy of it in memory
+ *  for everyone. A tmpfs like /dev/shm is a good place for it.
+ *
+ * Indexes are keyed by the archive's path and checked against its
+ *  fingerprint (see PHYSFS_getFingerprint()), so a changed archive is
+ *  reparsed and its index rewritten. If processes race to write the same
+ *  index, one of them wins and they all end up with a valid one. Anything
+ *  that goes wrong with the index (can't write it, can't map it) just
+ *  means the archive is mounted the usual way.
+ *
+ * Tarballs get an index, too. A .tar has no central directory at all, so
+ *  mounting one means reading every header in it; with an index, remounting
+ *  it reads one small file instead. Each process reads its own copy of a
+ *  tar index rather than mapping it.
+ *
+ * Archives mounted from an index can't be refreshed with
+ *  PHYSFS_refreshMount(); remount them instead. Other archive types, and
+ *  .zip files that aren't plain files on disk, are unaffected. Nothing
+ *  ever deletes old index files; that's up to you.
+ *
+ * This only affects archives mounted after the call, and is reset by
+ *  PHYSFS_deinit().
+ *
+ *   \param dir Directory to keep indexes in, in platform-dependent
+ *               notation. It must already exist, and be writable by any
+ *               process that might need to create an index. NULL stops
+ *               using indexes (the default).
+ *  \return nonzero on success, zero on error. Use PHYSFS_getLastErrorCode()
+ *          to obtain the specific error.
+ *
+ * \sa PHYSFS_mount
+ */
+PHYSFS_DECL int PHYSFS_setArchiveIndexDir(const char *dir);
+
+/**
+ * \fn int PHYSFS_setExtractCache(const char *dir, PHYSFS_uint64 budget)
+ * \brief Keep decompressed copies of archive entries on disk.
+ *
+ * Compressed files in a .zip are inflated again every time they're opened,
+ *  even across runs of your program. With an extraction cache, the first
+ *  open of a compressed entry inflates it into a file in (dir), and later
+ *  opens (from this process, or any other process using the same
+ *  directory, now or after a restart) read that file directly instead.
+ *
+ * Cached files are named by a key made from the archive's fingerprint (see
+ *  PHYSFS_getFingerprint()) and the entry's name, CRC and sizes, so a
+ *  changed archive never serves stale data; its old files just age out.
+ *  When a new file doesn't fit in (budget) bytes, the least recently used
+ *  files are deleted. Single entries bigger than a quarter of the budget
+ *  aren't cached at all. Files appear atomically, so several processes can
+ *  share the directory safely.
+ *
+ * This call looks over what's already in (dir), and from then on this
+ *  process keeps count of what it adds and uses, so later opens don't
+ *  have to. Files another process wrote are checked against the entry's
+ *  CRC the first time this process uses them; one that doesn't match is
+ *  deleted and the entry is decompressed again.
+ *
+ * Note that the first read from a newly opened entry decompresses all of
+ *  it, even if you only read a little. Stored (uncompressed) and encrypted
+ *  entries, and archives that aren't plain files on disk, are never cached.
+ *
+ * This is reset by PHYSFS_deinit().
+ *
+ *   \param dir Directory to keep the cache in, in platform-dependent
+ *               notation. It must already exist. NULL turns the cache off
+ *               (the default); files already in it are left alone.
+ *   \param budget Most bytes to keep in (dir). Zero turns the cache off.
+ *  \return nonzero on success, zero on error. Use PHYSFS_getLastErrorCode()
+ *          to obtain the specific error.
+ *
+ * \sa PHYSFS_setResidentBudget
+ */
+PHYSFS_DECL int PHYSFS_setExtractCache(const char *dir, PHYSFS_uint64 budget);
+
+
+/**
+ * \fn int PHYSFS_setMaxOpenFiles(PHYSFS_uint32 max)
+ * \brief Limit how many files PhysicsFS keeps open for reading.
+ *
+ * Every archive mounted from disk holds its file open, and so does every
+ *  file opened for reading from a directory. Files opened from inside an
+ *  archive share the archive's descriptor (reading from it at their own
+ *  offsets), so they don't add to the count, but thousands of mounted
+ *  archives can still run the process out of file descriptors.
+ *
+ * With a limit, the least recently used files beyond (max) are closed, and
+ *  quietly reopened by name the next time something reads from them. If
+ *  the file was replaced or modified in the meantime (see
+ *  PHYSFS_getFingerprint()), reading fails with PHYSFS_ERR_IO instead of
+ *  returning the new data. To pick up changes to an archive on purpose,
+ *  use PHYSFS_refreshMount(), which works whether or not the archive's
+ *  file was closed in the meantime.
+ *
+ * A file that's being read from right now is never closed, so with many
+ *  threads reading at once the count may briefly go over the limit. Files
+ *  opened for writing don't count and are never closed.
+ *
+ * Reopening costs an open() and a stat(), so set the limit comfortably
+ *  above the number of files you read from at any one time.
+ *
+ * There is no limit by default. This is reset by PHYSFS_deinit().
+ *
+ *   \param max Most files to keep open for reading. Zero means no limit.
+ *  \return nonzero on success, zero on error. Use PHYSFS_getLastErrorCode()
+ *          to obtain the specific error.
+ *
+ * \sa PHYSFS_mount
+ */
+PHYSFS_DECL int PHYSFS_setMaxOpenFiles(PHYSFS_uint32 max);
+
+
+/**
+ * \struct PHYSFS_Path
+ * \brief A path that has already been checked and hashed.
+ *
+ * Get one from PHYSFS_internPath(). Like PHYSFS_File, this is opaque data;
+ *  just pass the pointer you got to the PHYSFS_*Path() functions.
+ *
+ * \sa PHYSFS_internPath
+ * \sa PHYSFS_freePath
+ */
+typedef struct PHYSFS_Path
+{
+    void *opaque;  /**< That's all you get. Don't touch. */
+} PHYSFS_Path;
+
+
+/**
+ * \fn PHYSFS_Path *PHYSFS_internPath(const char *filename)
+ * \brief Prepare a path for fast repeated lookups.
+ *
+ * Every call that takes a filename measures it, copies it, checks it for
+ *  things like ".." and hashes it again for every archive in the search
+ *  path. If you look up the same paths over and over, do all of that once
+ *  here and pass the result to PHYSFS_openReadPath(), PHYSFS_statPath() or
+ *  PHYSFS_existsPath() instead.
+ *
+ * The result doesn't depend on the search path: it's still valid after
+ *  mounting and unmounting things, and these functions always see the
+ *  search path as it is when they're called. It can be used from any
+ *  number of threads at once. Free it with PHYSFS_freePath() before
+ *  calling PHYSFS_deinit().
+ *
+ * Lookups in archives mounted at a mount point that isn't a whole number
+ *  of path elements, or with a root set with PHYSFS_setRoot(), still work;
+ *  they just hash the part of the path they need again.
+ *
+ *   \param filename File or directory, in platform-independent notation.
+ *  \return the prepared path, or NULL on error (including a bad filename).
+ *          Use PHYSFS_getLastErrorCode() to obtain the specific error.
+ *
+ * \sa PHYSFS_freePath
+ */
+PHYSFS_DECL PHYSFS_Path *PHYSFS_internPath(const char *filename);
+
+
+/**
+ * \fn void PHYSFS_freePath(PHYSFS_Path *path)
+ * \brief Free a path from PHYSFS_internPath().
+ *
+ *   \param path Path to free. NULL is ignored.
+ *
+ * \sa PHYSFS_internPath
+ */
+PHYSFS_DECL void PHYSFS_freePath(PHYSFS_Path *path);
+
+
+/**
+ * \fn PHYSFS_File *PHYSFS_openReadPath(const PHYSFS_Path *path)
+ * \brief PHYSFS_openRead() for a path from PHYSFS_internPath().
+ *
+ *   \param path Path to open.
+ *  \return A valid PhysicsFS filehandle on success, NULL on error. Use
+ *          PHYSFS_getLastErrorCode() to obtain the specific error.
+ *
+ * \sa PHYSFS_openRead
+ */
+PHYSFS_DECL PHYSFS_File *PHYSFS_openReadPath(const PHYSFS_Path *path);
+
+
+/**
+ * \fn int PHYSFS_statPath(const PHYSFS_Path *path, PHYSFS_Stat *stat)
+ * \brief PHYSFS_stat() for a path from PHYSFS_internPath().
+ *
+ *   \param path Path to get information about.
+ *   \param stat Pointer to structure to fill in with data about (path).
+ *  \return non-zero on success, zero on failure. Use
+ *          PHYSFS_getLastErrorCode() to obtain the specific error.
+ *
+ * \sa PHYSFS_stat
+ */
+PHYSFS_DECL int PHYSFS_statPath(const PHYSFS_Path *path, PHYSFS_Stat *stat);
+
+
+/**
+ * \fn int PHYSFS_existsPath(const PHYSFS_Path *path)
+ * \brief PHYSFS_exists() for a path from PHYSFS_internPath().
+ *
+ *   \param path Path to check.
+ *  \return non-zero if the path exists, zero otherwise.
+ *
+ * \sa PHYSFS_exists
+ */
+PHYSFS_DECL int PHYSFS_existsPath(const PHYSFS_Path *path);
+
+
+/**
+ * \struct PHYSFS_Directory
+ * \brief A directory in the search path, found ahead of time.
+ *
+ * Get one from PHYSFS_openDirectory(). Like PHYSFS_File, this is opaque
+ *  data; just pass the pointer you got to the PHYSFS_*In() functions.
+ *
+ * \sa PHYSFS_openDirectory
+ * \sa PHYSFS_closeDirectory
+ */
+typedef struct PHYSFS_Directory
+{
+    void *opaque;  /**< That's all you get. Don't touch. */
+} PHYSFS_Directory;
+
+
+/**
+ * \fn PHYSFS_Directory *PHYSFS_openDirectory(const char *dirname)
+ * \brief Find a directory once, for lots of lookups inside it.
+ *
+ * Loading everything in "maps/e1m1" with PHYSFS_openRead() means working
+ *  out, for every file, which archives "maps/e1m1" is in and where, skipping
+ *  their mount points and adding their roots. This works that out once;
+ *  PHYSFS_openReadIn(), PHYSFS_statIn() and PHYSFS_enumerateIn() then only
+ *  look for names inside the directory, and only in the archives that have
+ *  it.
+ *
+ * Results are the same as using the full path. The handle keeps up with
+ *  the search path: after mounts, unmounts, PHYSFS_setRoot(),
+ *  PHYSFS_mkdir() or PHYSFS_delete(), the next lookup finds the directory
+ *  again. A directory created behind PhysicsFS's back, in an archive that
+ *  didn't have it when the handle last looked, isn't seen until then. If
+ *  other archives are mounted somewhere inside the directory, lookups
+ *  just use full paths.
+ *
+ * A handle can be used from several threads at once. Close it with
+ *  PHYSFS_closeDirectory() before calling PHYSFS_deinit().
+ *
+ *   \param dirname Directory to open, in platform-independent notation.
+ *  \return the directory, or NULL on error (including if it doesn't exist
+ *          in the search path). Use PHYSFS_getLastErrorCode() to obtain
+ *          the specific error.
+ *
+ * \sa PHYSFS_closeDirectory
+ */
+PHYSFS_DECL PHYSFS_Directory *PHYSFS_openDirectory(const char *dirname);
+
+
+/**
+ * \fn void PHYSFS_closeDirectory(PHYSFS_Directory *dir)
+ * \brief Free a directory from PHYSFS_openDirectory().
+ *
+ * Files opened through it stay open.
+ *
+ *   \param dir Directory to close. NULL is ignored.
+ *
+ * \sa PHYSFS_openDirectory
+ */
+PHYSFS_DECL void PHYSFS_closeDirectory(PHYSFS_Directory *dir);
+
+
+/**
+ * \fn PHYSFS_File *PHYSFS_openReadIn(PHYSFS_Directory *dir, const char *filename)
+ * \brief PHYSFS_openRead() for a file inside a directory.
+ *
+ *   \param dir Directory from PHYSFS_openDirectory().
+ *   \param filename File to open, relative to (dir), in platform-independent
+ *                   notation. It may have subdirectories in it.
+ *  \return A valid PhysicsFS filehandle on success, NULL on error. Use
+ *          PHYSFS_getLastErrorCode() to obtain the specific error.
+ *
+ * \sa PHYSFS_openRead
+ */
+PHYSFS_DECL PHYSFS_File *PHYSFS_openReadIn(PHYSFS_Directory *dir,
+                                           const char *filename);
+
+
+/**
+ * \fn int PHYSFS_statIn(PHYSFS_Directory *dir, const char *filename, PHYSFS_Stat *stat)
+ * \brief PHYSFS_stat() for a file inside a directory.
+ *
+ *   \param dir Directory from PHYSFS_openDirectory().
+ *   \param filename File to look at, relative to (dir).
+ *   \param stat Pointer to structure to fill in with data about (filename).
+ *  \return non-zero on success, zero on failure. Use
+ *          PHYSFS_getLastErrorCode() to obtain the specific error.
+ *
+ * \sa PHYSFS_stat
+ */
+PHYSFS_DECL int PHYSFS_statIn(PHYSFS_Directory *dir, const char *filename,
+                              PHYSFS_Stat *stat);
+
+
+/**
+ * \fn int PHYSFS_enumerateIn(PHYSFS_Directory *dir, const char *dirname, PHYSFS_EnumerateCallback c, void *d)
+ * \brief PHYSFS_enumerate() for a directory inside a directory.
+ *
+ * The callback's (origdir) is the full path of what's being enumerated,
+ *  not (dirname).
+ *
+ *   \param dir Directory from PHYSFS_openDirectory().
+ *   \param dirname Directory to enumerate, relative to (dir). Use "" for
+ *                  (dir) itself.
+ *   \param c Callback function to notify about search path elements.
+ *   \param d Application-defined data passed to callback. Can be NULL.
+ *  \return non-zero on success, zero on failure. Use
+ *          PHYSFS_getLastErrorCode() to obtain the specific error.
+ *
+ * \sa PHYSFS_enumerate
+ */
+PHYSFS_DECL int PHYSFS_enumerateIn(PHYSFS_Directory *dir, const char *dirname,
+                                   PHYSFS_EnumerateCallback c, void *d);
+
+
+/**
+ * \fn int PHYSFS_statMany(const char * const *fnames, PHYSFS_uint32 count, PHYSFS_Stat *stats, PHYSFS_ErrorCode *errors)
+ * \brief PHYSFS_stat() a whole list of files at once.
+ *
+ * This gives the same answers as calling PHYSFS_stat() on each element of
+ *  (fnames), but does it with one trip through the library's lock, one
+ *  set of scratch buffers and one pass over the search path, probing each
+ *  archive for every name still unresolved before moving on to the next.
+ *  If you have to check thousands of files at startup, this is much
+ *  cheaper.
+ *
+ * Each name gets its own result: (errors)[i] is PHYSFS_ERR_OK if
+ *  (fnames)[i] exists, and (stats)[i] is filled in, or the reason it
+ *  couldn't be stat'd (usually PHYSFS_ERR_NOT_FOUND), in which case
+ *  (stats)[i]'s contents are undefined. This also makes it a batched
+ *  PHYSFS_exists().
+ *
+ *   \param fnames Array of (count) filenames, in platform-independent
+ *                 notation.
+ *   \param count Number of elements in (fnames), (stats) and (errors).
+ *   \param stats Array of (count) structures to fill in.
+ *   \param errors Array of (count) per-file error codes to fill in.
+ *  \return number of files that exist, or -1 if the batch couldn't be run
+ *          at all (bad arguments, out of memory). Use
+ *          PHYSFS_getLastErrorCode() to obtain the specific error in that
+ *          case.
+ *
+ * \sa PHYSFS_stat
+ * \sa PHYSFS_exists
+ */
+PHYSFS_DECL PHYSFS_sint64 PHYSFS_statMany(const char * const *fnames,
+                                          PHYSFS_uint32 count,
+                                          PHYSFS_Stat *stats,
+                                          PHYSFS_ErrorCode *errors);
+
+
 #ifdef __cplusplus
 }
 #endif
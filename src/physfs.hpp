@@ -0,0 +1,720 @@
+/**
+ * \file physfs.hpp
+ *
+ * Header-only C++17 layer over physfs.h.
+ */
+
+/*
+ * This wraps the C API in move-only RAII types, so files get closed and
+ *  mounts get removed when they go out of scope, and hands back results as
+ *  values instead of making you ask PHYSFS_getLastErrorCode() later.
+ *
+ * Nothing here needs to be compiled into the library; just include it
+ *  (after, or instead of, physfs.h) and link against PhysicsFS as usual.
+ *  The C library itself stays plain C.
+ *
+ * A quick example:
+ *
+ * \code
+ * physfs::Init init(argv[0]);
+ * auto data = physfs::Mount::mount("data.zip");
+ * if (!data) { complain(data.error().message()); return; }
+ *
+ * auto f = physfs::File::openRead("maps/e1m1.bsp");
+ * std::byte header[64];
+ * if (f && f->read(header)) { ... }
+ *
+ * physfs::enumerate("maps", [](std::string_view dir, std::string_view name) {
+ *     printf("%.*s\n", (int) name.size(), name.data());
+ * });
+ * \endcode
+ *
+ * (f, data and init all clean up after themselves, in that order.)
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ */
+
+#ifndef _INCLUDE_PHYSFS_HPP_
+#define _INCLUDE_PHYSFS_HPP_
+
+#include "physfs.h"
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if (__cplusplus >= 202002L) && defined(__has_include)
+#if __has_include(<span>)
+#include <span>
+#endif
+#endif
+
+namespace physfs
+{
+
+/**
+ * \brief A contiguous range of bytes (or whatever) for reads and writes.
+ *
+ * This is std::span when the compiler has it, and a minimal stand-in with
+ *  the same spelling for the parts we use when it doesn't, so C++17 code
+ *  and C++20 code can both say physfs::Span<std::byte>.
+ */
+#if defined(__cpp_lib_span)
+template <typename T> using Span = std::span<T>;
+#else
+template <typename T>
+class Span
+{
+public:
+    constexpr Span() noexcept : ptr(nullptr), len(0) {}
+    constexpr Span(T *p, std::size_t n) noexcept : ptr(p), len(n) {}
+    template <std::size_t N>
+    constexpr Span(T (&arr)[N]) noexcept : ptr(arr), len(N) {}
+    template <typename C, typename = decltype(std::declval<C &>().data()),
+              typename = std::enable_if_t<std::is_convertible_v<
+                  decltype(std::declval<C &>().data()), T *>>>
+    constexpr Span(C &c) noexcept : ptr(c.data()), len(c.size()) {}
+    template <typename U, typename = std::enable_if_t<
+                  std::is_convertible_v<U (*)[], T (*)[]>>>
+    constexpr Span(const Span<U> &s) noexcept : ptr(s.data()), len(s.size()) {}
+
+    constexpr T *data() const noexcept { return ptr; }
+    constexpr std::size_t size() const noexcept { return len; }
+    constexpr std::size_t size_bytes() const noexcept { return len * sizeof (T); }
+    constexpr bool empty() const noexcept { return len == 0; }
+    constexpr T *begin() const noexcept { return ptr; }
+    constexpr T *end() const noexcept { return ptr + len; }
+    constexpr T &operator[](std::size_t i) const noexcept { return ptr[i]; }
+    constexpr Span subspan(std::size_t off) const noexcept { return Span(ptr + off, len - off); }
+    constexpr Span subspan(std::size_t off, std::size_t n) const noexcept { return Span(ptr + off, n); }
+    constexpr Span first(std::size_t n) const noexcept { return Span(ptr, n); }
+
+private:
+    T *ptr;
+    std::size_t len;
+};
+#endif
+
+
+/**
+ * \brief A PhysicsFS error code, captured at the moment something failed.
+ *
+ * Every failing call in this header grabs PHYSFS_getLastErrorCode() right
+ *  away (which also clears it) and carries the code in its Result, so you
+ *  never have to go back to the per-thread error state yourself, and a
+ *  later call can't overwrite the reason before you look at it.
+ */
+class Error
+{
+public:
+    constexpr Error() noexcept : errcode(PHYSFS_ERR_OK) {}
+    constexpr explicit Error(PHYSFS_ErrorCode c) noexcept : errcode(c) {}
+
+    /* Take ownership of whatever the last call on this thread reported. */
+    static Error last() noexcept
+    {
+        const PHYSFS_ErrorCode c = PHYSFS_getLastErrorCode();
+        return Error((c == PHYSFS_ERR_OK) ? PHYSFS_ERR_OTHER_ERROR : c);
+    }
+
+    constexpr PHYSFS_ErrorCode code() const noexcept { return errcode; }
+    const char *message() const noexcept
+    {
+        const char *str = PHYSFS_getErrorByCode(errcode);
+        return str ? str : "unknown error";
+    }
+
+    friend constexpr bool operator==(Error a, Error b) noexcept { return a.errcode == b.errcode; }
+    friend constexpr bool operator!=(Error a, Error b) noexcept { return a.errcode != b.errcode; }
+
+private:
+    PHYSFS_ErrorCode errcode;
+};
+
+
+/**
+ * \brief Either a value or an Error, in the spirit of std::expected.
+ *
+ * Test it like a bool, then use value() / operator* / operator-> on
+ *  success or error() on failure. Calling value() on a failed Result is a
+ *  programming error (it's not checked in release builds).
+ */
+template <typename T>
+class Result
+{
+public:
+    Result(const T &v) : val(v) {}
+    Result(T &&v) : val(std::move(v)) {}
+    Result(Error e) : err(e) {}
+
+    constexpr bool has_value() const noexcept { return val.has_value(); }
+    constexpr explicit operator bool() const noexcept { return val.has_value(); }
+
+    T &value() & { return *val; }
+    const T &value() const & { return *val; }
+    T &&value() && { return std::move(*val); }
+    T &operator*() & { return *val; }
+    const T &operator*() const & { return *val; }
+    T &&operator*() && { return std::move(*val); }
+    T *operator->() { return &*val; }
+    const T *operator->() const { return &*val; }
+
+    template <typename U> T value_or(U &&other) const &
+    {
+        return val ? *val : static_cast<T>(std::forward<U>(other));
+    }
+
+    constexpr Error error() const noexcept { return err; }
+
+private:
+    std::optional<T> val;
+    Error err;
+};
+
+template <>
+class Result<void>
+{
+public:
+    Result() noexcept : ok(true) {}
+    Result(Error e) noexcept : ok(false), err(e) {}
+
+    constexpr bool has_value() const noexcept { return ok; }
+    constexpr explicit operator bool() const noexcept { return ok; }
+    constexpr void value() const noexcept {}
+    constexpr Error error() const noexcept { return err; }
+
+private:
+    bool ok;
+    Error err;
+};
+
+
+namespace detail
+{
+
+/*
+ * The C API wants NUL-terminated strings. A std::string_view might not be
+ *  one, so copy it into a stack buffer (or, for long paths, the heap) just
+ *  long enough for the call. C strings and std::strings are passed through
+ *  without a copy.
+ */
+class PathArg
+{
+public:
+    PathArg(const char *s) noexcept : str(s ? s : "") {}
+    PathArg(const std::string &s) noexcept : str(s.c_str()) {}
+    PathArg(std::string_view s)
+    {
+        if (s.size() < sizeof (buf))
+        {
+            std::memcpy(buf, s.data(), s.size());
+            buf[s.size()] = '\0';
+            str = buf;
+        }
+        else
+        {
+            heap.assign(s.data(), s.size());
+            str = heap.c_str();
+        }
+    }
+
+    PathArg(const PathArg &) = delete;
+    PathArg &operator=(const PathArg &) = delete;
+
+    const char *c_str() const noexcept { return str; }
+
+private:
+    const char *str;
+    char buf[256];
+    std::string heap;
+};
+
+} /* namespace detail */
+
+using PathArg = detail::PathArg;
+
+
+/**
+ * \brief Scoped PHYSFS_init()/PHYSFS_deinit().
+ *
+ * Check ok() (or error()) after constructing; deinit only happens if init
+ *  succeeded. Make sure every File and Mount is gone before this is.
+ */
+class Init
+{
+public:
+    explicit Init(const char *argv0) noexcept
+        : inited(PHYSFS_init(argv0) != 0), err(inited ? Error() : Error::last()) {}
+    ~Init() { if (inited) PHYSFS_deinit(); }
+
+    Init(const Init &) = delete;
+    Init &operator=(const Init &) = delete;
+
+    bool ok() const noexcept { return inited; }
+    Error error() const noexcept { return err; }
+
+private:
+    bool inited;
+    Error err;
+};
+
+
+/**
+ * \brief Move-only owner of a PHYSFS_File.
+ *
+ * The file is closed when this is destroyed. Use close() instead if you
+ *  care whether the final flush worked.
+ */
+class File
+{
+public:
+    File() noexcept : handle(nullptr) {}
+    explicit File(PHYSFS_File *h) noexcept : handle(h) {}
+    File(File &&other) noexcept : handle(other.release()) {}
+    File &operator=(File &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            handle = other.release();
+        }
+        return *this;
+    }
+    File(const File &) = delete;
+    File &operator=(const File &) = delete;
+    ~File() { reset(); }
+
+    static Result<File> openRead(const PathArg &path)
+    {
+        return wrap(PHYSFS_openRead(path.c_str()));
+    }
+
+    static Result<File> openWrite(const PathArg &path)
+    {
+        return wrap(PHYSFS_openWrite(path.c_str()));
+    }
+
+    static Result<File> openAppend(const PathArg &path)
+    {
+        return wrap(PHYSFS_openAppend(path.c_str()));
+    }
+
+    explicit operator bool() const noexcept { return handle != nullptr; }
+    PHYSFS_File *get() const noexcept { return handle; }
+
+    /* Give up ownership without closing. */
+    PHYSFS_File *release() noexcept
+    {
+        PHYSFS_File *retval = handle;
+        handle = nullptr;
+        return retval;
+    }
+
+    /*
+     * Close now, reporting failure. If the final flush fails, the handle is
+     *  still open (that's how PHYSFS_close() works), so you can try again;
+     *  otherwise the destructor will.
+     */
+    Result<void> close() noexcept
+    {
+        if (handle)
+        {
+            if (!PHYSFS_close(handle))
+                return Error::last();
+            handle = nullptr;
+        }
+        return Result<void>();
+    }
+
+    /* Returns bytes read; short counts mean EOF, not an error. */
+    Result<std::size_t> read(void *buffer, std::size_t len) noexcept
+    {
+        const PHYSFS_sint64 rc = PHYSFS_readBytes(handle, buffer, (PHYSFS_uint64) len);
+        if (rc < 0)
+            return Error::last();
+        return (std::size_t) rc;
+    }
+
+    Result<std::size_t> read(Span<std::byte> buffer) noexcept
+    {
+        return read(buffer.data(), buffer.size());
+    }
+
+    /* Read exactly buffer.size() bytes, or fail with PHYSFS_ERR_PAST_EOF. */
+    Result<void> readExact(Span<std::byte> buffer) noexcept
+    {
+        Result<std::size_t> rc = read(buffer);
+        if (!rc)
+            return rc.error();
+        else if (*rc != buffer.size())
+            return Error(PHYSFS_ERR_PAST_EOF);
+        return Result<void>();
+    }
+
+    Result<std::size_t> write(const void *buffer, std::size_t len) noexcept
+    {
+        const PHYSFS_sint64 rc = PHYSFS_writeBytes(handle, buffer, (PHYSFS_uint64) len);
+        if (rc < 0)
+            return Error::last();
+        return (std::size_t) rc;
+    }
+
+    Result<std::size_t> write(Span<const std::byte> buffer) noexcept
+    {
+        return write(buffer.data(), buffer.size());
+    }
+
+    Result<void> seek(PHYSFS_uint64 pos) noexcept
+    {
+        if (!PHYSFS_seek(handle, pos))
+            return Error::last();
+        return Result<void>();
+    }
+
+    Result<PHYSFS_uint64> tell() const noexcept
+    {
+        const PHYSFS_sint64 rc = PHYSFS_tell(handle);
+        if (rc < 0)
+            return Error::last();
+        return (PHYSFS_uint64) rc;
+    }
+
+    Result<PHYSFS_uint64> length() const noexcept
+    {
+        const PHYSFS_sint64 rc = PHYSFS_fileLength(handle);
+        if (rc < 0)
+            return Error::last();
+        return (PHYSFS_uint64) rc;
+    }
+
+    bool eof() const noexcept { return PHYSFS_eof(handle) != 0; }
+
+    Result<void> setBuffer(PHYSFS_uint64 bufsize) noexcept
+    {
+        if (!PHYSFS_setBuffer(handle, bufsize))
+            return Error::last();
+        return Result<void>();
+    }
+
+    Result<void> flush() noexcept
+    {
+        if (!PHYSFS_flush(handle))
+            return Error::last();
+        return Result<void>();
+    }
+
+private:
+    static Result<File> wrap(PHYSFS_File *h)
+    {
+        if (!h)
+            return Error::last();
+        return File(h);
+    }
+
+    void reset() noexcept
+    {
+        if (handle)
+            PHYSFS_close(handle);
+        handle = nullptr;
+    }
+
+    PHYSFS_File *handle;
+};
+
+
+/**
+ * \brief Move-only owner of an entry in the search path.
+ *
+ * The archive or directory is unmounted when this is destroyed. As with
+ *  PHYSFS_unmount(), that fails if files from it are still open, so destroy
+ *  your Files first. Use unmount() if you want to know about that.
+ *
+ * If the same archive was already mounted, PHYSFS_mount() succeeds without
+ *  doing anything; the Mount you get back still unmounts it on destruction.
+ */
+class Mount
+{
+public:
+    Mount() noexcept {}
+    Mount(Mount &&other) noexcept : name(std::move(other.name)) { other.name.clear(); }
+    Mount &operator=(Mount &&other) noexcept
+    {
+        if (this != &other)
+        {
+            (void) unmount();
+            name = std::move(other.name);
+            other.name.clear();
+        }
+        return *this;
+    }
+    Mount(const Mount &) = delete;
+    Mount &operator=(const Mount &) = delete;
+    ~Mount() { (void) unmount(); }
+
+    static Result<Mount> mount(const PathArg &newDir, const PathArg &mountPoint = "/",
+                               bool appendToPath = true)
+    {
+        if (!PHYSFS_mount(newDir.c_str(), mountPoint.c_str(), appendToPath ? 1 : 0))
+            return Error::last();
+        return Mount(newDir.c_str());
+    }
+
+    /* (buf) must outlive the Mount; (del) is called when PhysicsFS is done. */
+    static Result<Mount> mountMemory(const void *buf, PHYSFS_uint64 len,
+                                     void (*del)(void *), const PathArg &newDir,
+                                     const PathArg &mountPoint = "/",
+                                     bool appendToPath = true)
+    {
+        if (!PHYSFS_mountMemory(buf, len, del, newDir.c_str(), mountPoint.c_str(), appendToPath ? 1 : 0))
+            return Error::last();
+        return Mount(newDir.c_str());
+    }
+
+    /* Mount an open file; on success the mount owns it. */
+    static Result<Mount> mountHandle(File &&file, const PathArg &newDir,
+                                     const PathArg &mountPoint = "/",
+                                     bool appendToPath = true)
+    {
+        if (!PHYSFS_mountHandle(file.get(), newDir.c_str(), mountPoint.c_str(), appendToPath ? 1 : 0))
+            return Error::last();
+        (void) file.release();
+        return Mount(newDir.c_str());
+    }
+
+    explicit operator bool() const noexcept { return !name.empty(); }
+
+    /* The name this was mounted under (what PHYSFS_getSearchPath reports). */
+    const std::string &dirName() const noexcept { return name; }
+
+    Result<void> unmount() noexcept
+    {
+        if (!name.empty())
+        {
+            if (!PHYSFS_unmount(name.c_str()))
+                return Error::last();
+            name.clear();
+        }
+        return Result<void>();
+    }
+
+    /* see PHYSFS_refreshMount(): pick up files appended to the archive. */
+    Result<void> refresh() noexcept
+    {
+        if (!PHYSFS_refreshMount(name.c_str()))
+            return Error::last();
+        return Result<void>();
+    }
+
+    /* Stop managing this mount; it stays in the search path. */
+    void release() noexcept { name.clear(); }
+
+private:
+    explicit Mount(const char *n) : name(n) {}
+    std::string name;
+};
+
+
+/**
+ * \brief Owner of a list from PHYSFS_enumerateFiles() and friends.
+ *
+ * Iterating yields std::string_views that point straight into the list
+ *  PhysicsFS returned; nothing is copied. They're valid as long as the
+ *  List is.
+ */
+class List
+{
+public:
+    class iterator
+    {
+    public:
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::string_view;
+        using iterator_category = std::forward_iterator_tag;
+
+        explicit iterator(char **p) noexcept : ptr(p) {}
+        std::string_view operator*() const noexcept { return std::string_view(*ptr); }
+        iterator &operator++() noexcept { ++ptr; return *this; }
+        iterator operator++(int) noexcept { iterator tmp(*this); ++ptr; return tmp; }
+        bool operator==(const iterator &o) const noexcept { return ptr == o.ptr; }
+        bool operator!=(const iterator &o) const noexcept { return ptr != o.ptr; }
+
+    private:
+        char **ptr;
+    };
+
+    List() noexcept : list(nullptr), count(0) {}
+    explicit List(char **l) noexcept : list(l), count(0)
+    {
+        if (list)
+        {
+            while (list[count])
+                count++;
+        }
+    }
+    List(List &&other) noexcept : list(other.list), count(other.count)
+    {
+        other.list = nullptr;
+        other.count = 0;
+    }
+    List &operator=(List &&other) noexcept
+    {
+        if (this != &other)
+        {
+            PHYSFS_freeList(list);
+            list = other.list;
+            count = other.count;
+            other.list = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+    List(const List &) = delete;
+    List &operator=(const List &) = delete;
+    ~List() { PHYSFS_freeList(list); }
+
+    iterator begin() const noexcept { return iterator(list); }
+    iterator end() const noexcept { return iterator(list + count); }
+    std::size_t size() const noexcept { return count; }
+    bool empty() const noexcept { return count == 0; }
+    std::string_view operator[](std::size_t i) const noexcept { return list[i]; }
+    char **get() const noexcept { return list; }
+
+private:
+    char **list;
+    std::size_t count;
+};
+
+
+/* Sorted, de-duplicated listing of a directory, like PHYSFS_enumerateFiles(). */
+inline Result<List> enumerateFiles(const PathArg &dir)
+{
+    char **list = PHYSFS_enumerateFiles(dir.c_str());
+    if (!list)
+        return Error::last();
+    return List(list);
+}
+
+inline Result<List> getSearchPath()
+{
+    char **list = PHYSFS_getSearchPath();
+    if (!list)
+        return Error::last();
+    return List(list);
+}
+
+
+namespace detail
+{
+
+template <typename F>
+struct EnumerateData
+{
+    F *fn;
+};
+
+template <typename F>
+PHYSFS_EnumerateCallbackResult enumerateThunk(void *data, const char *origdir,
+                                              const char *fname)
+{
+    F &fn = *static_cast<EnumerateData<F> *>(data)->fn;
+    using R = decltype(fn(std::string_view(), std::string_view()));
+    if constexpr (std::is_same_v<R, PHYSFS_EnumerateCallbackResult>)
+        return fn(std::string_view(origdir), std::string_view(fname));
+    else if constexpr (std::is_same_v<R, bool>)
+        return fn(std::string_view(origdir), std::string_view(fname)) ? PHYSFS_ENUM_OK : PHYSFS_ENUM_STOP;
+    else
+    {
+        fn(std::string_view(origdir), std::string_view(fname));
+        return PHYSFS_ENUM_OK;
+    }
+}
+
+} /* namespace detail */
+
+
+/**
+ * \brief Enumerate a directory without building a list.
+ *
+ * (fn) is called as fn(std::string_view origdir, std::string_view name) for
+ *  each entry, straight from the archivers, so there's no allocation and no
+ *  sorting; you may get duplicates if several archives have the same name.
+ *  It can return void (keep going), bool (false stops), or a
+ *  PHYSFS_EnumerateCallbackResult. The views are only valid during the call.
+ *
+ * Exceptions must not escape (fn); they'd have to unwind through C.
+ */
+template <typename F>
+Result<void> enumerate(const PathArg &dir, F &&fn)
+{
+    using Fn = std::remove_reference_t<F>;
+    detail::EnumerateData<Fn> data = { &fn };
+    if (!PHYSFS_enumerate(dir.c_str(), detail::enumerateThunk<Fn>, &data))
+        return Error::last();
+    return Result<void>();
+}
+
+
+inline Result<PHYSFS_Stat> stat(const PathArg &path) noexcept
+{
+    PHYSFS_Stat st;
+    if (!PHYSFS_stat(path.c_str(), &st))
+        return Error::last();
+    return st;
+}
+
+/* see PHYSFS_getFingerprint(): changes when the contents do, no data read. */
+inline Result<PHYSFS_uint64> fingerprint(const PathArg &path) noexcept
+{
+    PHYSFS_uint64 fp;
+    if (!PHYSFS_getFingerprint(path.c_str(), &fp))
+        return Error::last();
+    return fp;
+}
+
+inline bool exists(const PathArg &path) noexcept
+{
+    return PHYSFS_exists(path.c_str()) != 0;
+}
+
+inline Result<void> mkdir(const PathArg &path) noexcept
+{
+    if (!PHYSFS_mkdir(path.c_str()))
+        return Error::last();
+    return Result<void>();
+}
+
+inline Result<void> remove(const PathArg &path) noexcept
+{
+    if (!PHYSFS_delete(path.c_str()))
+        return Error::last();
+    return Result<void>();
+}
+
+inline Result<void> setWriteDir(const PathArg &path) noexcept
+{
+    if (!PHYSFS_setWriteDir(path.c_str()))
+        return Error::last();
+    return Result<void>();
+}
+
+/* NULL if (path) isn't found; this doesn't touch the error state either way. */
+inline const char *getRealDir(const PathArg &path) noexcept
+{
+    const char *retval = PHYSFS_getRealDir(path.c_str());
+    if (!retval)
+        (void) PHYSFS_getLastErrorCode();  /* don't leave it lying around. */
+    return retval;
+}
+
+} /* namespace physfs */
+
+#endif  /* include-once blocker. */
+
+/* end of physfs.hpp ... */
@@ -212,6 +212,16 @@ static void SZIP_closeArchive(void *opaque)
 } /* SZIP_closeArchive */
 
 
+static int SZIP_sniff(const void *head, PHYSFS_uint64 headlen,
+                      const void *tail, PHYSFS_uint64 taillen,
+                      PHYSFS_sint64 filelen)
+{
+    static const PHYSFS_uint8 wantedsig[] = { '7','z',0xBC,0xAF,0x27,0x1C };
+    (void) tail; (void) taillen; (void) filelen;
+    return (headlen >= 6) && (memcmp(head, wantedsig, 6) == 0);
+} /* SZIP_sniff */
+
+
 static void *SZIP_openArchive(PHYSFS_Io *io, const char *name,
                               int forWriting, int *claimed)
 {
@@ -390,6 +400,26 @@ static int SZIP_stat(void *opaque, const char *path, PHYSFS_Stat *stat)
 } /* SZIP_stat */
 
 
+static int SZIP_fingerprint(void *opaque, const char *path, PHYSFS_uint64 *fp)
+{
+    SZIPinfo *info = (SZIPinfo *) opaque;
+    SZIPentry *entry;
+    PHYSFS_uint32 idx;
+
+    entry = (SZIPentry *) __PHYSFS_DirTreeFind(&info->tree, path);
+    BAIL_IF_ERRPASS(!entry, 0);
+    BAIL_IF(entry->tree.isdir, PHYSFS_ERR_NOT_A_FILE, 0);
+    idx = entry->dbidx;
+
+    /* empty files (and some odd archives) don't store a crc. */
+    BAIL_IF(!SzBitWithVals_Check(&info->db.CRCs, idx), PHYSFS_ERR_UNSUPPORTED, 0);
+
+    *fp = __PHYSFS_mixFingerprint(0, info->db.CRCs.Vals[idx]);
+    *fp = __PHYSFS_mixFingerprint(*fp, SzArEx_GetFileSize(&info->db, idx));
+    return 1;
+} /* SZIP_fingerprint */
+
+
 void SZIP_global_init(void)
 {
     /* this just needs to calculate some things, so it only ever
@@ -421,7 +451,10 @@ const PHYSFS_Archiver __PHYSFS_Archiver_7Z =
     SZIP_remove,
     SZIP_mkdir,
     SZIP_stat,
-    SZIP_closeArchive
+    SZIP_closeArchive,
+    SZIP_fingerprint,
+    NULL,  /* refresh */
+    SZIP_sniff
 };
 
 #endif  /* defined PHYSFS_SUPPORTS_7Z */
@@ -0,0 +1,853 @@
+/*
+ * Content-addressed chunk store support routines for PhysicsFS.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ *
+ *  This file written by the PhysicsFS contributors.
+ */
+
+/*
+ * A CAS "archive" is just a manifest: a list of files, each of which is a
+ *  list of chunks. The chunks themselves live as loose files in a store
+ *  directory, named for a hash of their contents, so a chunk that shows up
+ *  in several files, several versions of a game, or several mounted
+ *  manifests is only stored once. A patch is a new manifest plus whatever
+ *  chunks the store doesn't have yet.
+ *
+ * Chunks are loaded whole into a cache that all mounted manifests share,
+ *  so identical chunks are also only read and kept in memory once. The
+ *  cache holds at most CAS_CACHE_BYTES of chunks nobody is reading right
+ *  now, dropping the least recently used first. Cached chunks are matched
+ *  on id, size and CRC-32, so manifests that disagree about a chunk never
+ *  get each other's data.
+ *
+ * The manifest, all values littleendian:
+ *
+ *   char     magic[8] = "PHYSFSCA"
+ *   uint32   version = 1
+ *   uint32   chunk count
+ *   uint32   file count
+ *   uint32   store path length, then the store path (no null terminator)
+ *   chunks:  { uint8 id[16]; uint32 size; uint32 crc32; } per chunk
+ *   files:   { uint32 namelen; char name[namelen]; sint64 mtime;
+ *              uint32 numchunks; uint32 chunkidx[numchunks]; } per file
+ *
+ * The store path is in platform-independent notation. If it's relative,
+ *  it's relative to the directory the manifest is in, which means the
+ *  manifest has to be a real file on disk in that case. Chunk (id) is read
+ *  from "store/ab/abcdef...", the 32 lowercase hex digits of the id with
+ *  the first two as a subdirectory. What hash makes the id is up to
+ *  whatever built the store (truncated SHA-256 is a fine choice); we only
+ *  check each chunk's size and CRC-32 when it's loaded. File names are
+ *  full paths in platform-independent notation; directories are implied.
+ */
+
+#define __PHYSICSFS_INTERNAL__
+#include "physfs_internal.h"
+
+#if PHYSFS_SUPPORTS_CAS
+
+#define CAS_VERSION 1
+#define CAS_ID_LEN 16
+#define CAS_MAX_CHUNK_SIZE (64 * 1024 * 1024)
+#define CAS_CACHE_BYTES (16 * 1024 * 1024)
+#define CAS_CACHE_BUCKETS 256
+
+/* One CASchunkinfo is kept for each chunk a manifest lists. */
+typedef struct
+{
+    PHYSFS_uint8 id[CAS_ID_LEN];
+    PHYSFS_uint32 size;
+    PHYSFS_uint32 crc;
+} CASchunkinfo;
+
+/* One CASentry is kept for each file in a mounted manifest. */
+typedef struct
+{
+    __PHYSFS_DirTreeEntry tree;   /* manages directory tree.          */
+    PHYSFS_sint64 mtime;          /* modtime, in Unix epoch seconds.  */
+    PHYSFS_uint64 size;           /* sum of this file's chunk sizes.  */
+    PHYSFS_uint32 firstref;       /* index of first chunk in (refs).  */
+    PHYSFS_uint32 numrefs;        /* number of chunks in this file.   */
+} CASentry;
+
+/* One CASinfo is kept for each mounted manifest. */
+typedef struct
+{
+    __PHYSFS_DirTree tree;        /* manages directory tree.          */
+    PHYSFS_Io *io;                /* the manifest.                    */
+    char *store;                  /* native store dir, with separator. */
+    size_t storelen;
+    CASchunkinfo *chunks;         /* every chunk this manifest uses.  */
+    PHYSFS_uint32 numchunks;
+    PHYSFS_uint32 *refs;          /* every file's chunk list, in a row. */
+    PHYSFS_uint64 *offsets;       /* where refs[i] starts in its file. */
+    PHYSFS_uint32 numrefs;
+} CASinfo;
+
+/* A chunk's data, shared by every mount and open file that wants it. */
+typedef struct CASchunk
+{
+    PHYSFS_uint8 id[CAS_ID_LEN];
+    PHYSFS_uint32 size;
+    PHYSFS_uint32 crc;
+    PHYSFS_uint32 refcount;       /* open files reading this chunk.   */
+    struct CASchunk *hashnext;
+    struct CASchunk *prev;        /* LRU list; (casMru) is the head.  */
+    struct CASchunk *next;
+    PHYSFS_uint8 *data;           /* points just past this struct.    */
+} CASchunk;
+
+/* One CASfileinfo is kept for each open file in a mounted manifest. */
+typedef struct
+{
+    CASinfo *arc;
+    CASentry *entry;
+    PHYSFS_uint64 pos;
+    PHYSFS_uint32 curref;         /* index into entry's chunks of (cur). */
+    CASchunk *cur;                /* chunk we're reading, or NULL.    */
+} CASfileinfo;
+
+/* The shared chunk cache. Mounting and unmounting happen under PhysicsFS's
+   state lock, so (casArchives) and the lock's lifetime don't need one. */
+static void *casLock = NULL;
+static PHYSFS_uint32 casArchives = 0;
+static CASchunk *casHash[CAS_CACHE_BUCKETS];
+static CASchunk *casMru = NULL;
+static CASchunk *casLru = NULL;
+static PHYSFS_uint64 casIdleBytes = 0;  /* cached chunks with refcount 0. */
+
+static inline int readui32(PHYSFS_Io *io, PHYSFS_uint32 *val)
+{
+    PHYSFS_uint32 v;
+    BAIL_IF_ERRPASS(!__PHYSFS_readAll(io, &v, sizeof (v)), 0);
+    *val = PHYSFS_swapULE32(v);
+    return 1;
+} /* readui32 */
+
+
+static inline int readsi64(PHYSFS_Io *io, PHYSFS_sint64 *val)
+{
+    PHYSFS_sint64 v;
+    BAIL_IF_ERRPASS(!__PHYSFS_readAll(io, &v, sizeof (v)), 0);
+    *val = PHYSFS_swapSLE64(v);
+    return 1;
+} /* readsi64 */
+
+
+static PHYSFS_uint32 casBucket(const PHYSFS_uint8 *id)
+{
+    /* the id is already a hash of the contents; any byte of it will do. */
+    return ((PHYSFS_uint32) id[0]) % CAS_CACHE_BUCKETS;
+} /* casBucket */
+
+
+static void casUnlinkLru(CASchunk *chunk)
+{
+    if (chunk->prev)
+        chunk->prev->next = chunk->next;
+    else
+        casMru = chunk->next;
+
+    if (chunk->next)
+        chunk->next->prev = chunk->prev;
+    else
+        casLru = chunk->prev;
+
+    chunk->prev = chunk->next = NULL;
+} /* casUnlinkLru */
+
+
+static void casLinkMru(CASchunk *chunk)
+{
+    chunk->prev = NULL;
+    chunk->next = casMru;
+    if (casMru)
+        casMru->prev = chunk;
+    casMru = chunk;
+    if (casLru == NULL)
+        casLru = chunk;
+} /* casLinkMru */
+
+
+/* Drop idle chunks, oldest first, until we're within budget. Only idle
+   chunks are on the LRU list; chunks being read are off it. */
+static void casTrimCache(const PHYSFS_uint64 budget)
+{
+    while ((casIdleBytes > budget) && (casLru != NULL))
+    {
+        CASchunk *chunk = casLru;
+        CASchunk **prev = &casHash[casBucket(chunk->id)];
+        while (*prev != chunk)
+            prev = &(*prev)->hashnext;
+        *prev = chunk->hashnext;
+        casUnlinkLru(chunk);
+        casIdleBytes -= chunk->size;
+        allocator.Free(chunk);
+    } /* while */
+} /* casTrimCache */
+
+
+static void casReleaseChunk(CASchunk *chunk)
+{
+    __PHYSFS_platformGrabMutex(casLock);
+    assert(chunk->refcount > 0);
+    if (--chunk->refcount == 0)
+    {
+        casLinkMru(chunk);
+        casIdleBytes += chunk->size;
+        casTrimCache(CAS_CACHE_BYTES);
+    } /* if */
+    __PHYSFS_platformReleaseMutex(casLock);
+} /* casReleaseChunk */
+
+
+/* Returns a referenced chunk from the cache, or NULL if it isn't there. */
+static CASchunk *casFindChunk(const CASchunkinfo *ci)
+{
+    CASchunk *chunk;
+    for (chunk = casHash[casBucket(ci->id)]; chunk; chunk = chunk->hashnext)
+    {
+        if ((chunk->size == ci->size) && (chunk->crc == ci->crc) &&
+            (memcmp(chunk->id, ci->id, CAS_ID_LEN) == 0))
+        {
+            if (chunk->refcount++ == 0)
+            {
+                casUnlinkLru(chunk);
+                casIdleBytes -= chunk->size;
+            } /* if */
+            return chunk;
+        } /* if */
+    } /* for */
+
+    return NULL;
+} /* casFindChunk */
+
+
+static CASchunk *casLoadChunk(const CASinfo *info, const CASchunkinfo *ci)
+{
+    static const char hex[] = "0123456789abcdef";
+    const size_t pathlen = info->storelen + 3 + (CAS_ID_LEN * 2) + 1;
+    CASchunk *chunk = NULL;
+    PHYSFS_Io *io = NULL;
+    PHYSFS_sint64 len;
+    char *path;
+    char *ptr;
+    int i;
+
+    path = (char *) __PHYSFS_smallAlloc(pathlen);
+    BAIL_IF(!path, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    memcpy(path, info->store, info->storelen);
+    ptr = path + info->storelen;
+    *(ptr++) = hex[ci->id[0] >> 4];
+    *(ptr++) = hex[ci->id[0] & 0xF];
+    *(ptr++) = __PHYSFS_platformDirSeparator;
+    for (i = 0; i < CAS_ID_LEN; i++)
+    {
+        *(ptr++) = hex[ci->id[i] >> 4];
+        *(ptr++) = hex[ci->id[i] & 0xF];
+    } /* for */
+    *ptr = '\0';
+
+    io = __PHYSFS_createNativeIo(path, 'r');
+    __PHYSFS_smallFree(path);
+    BAIL_IF_ERRPASS(!io, NULL);
+
+    len = io->length(io);
+    GOTO_IF_ERRPASS(len < 0, failed);
+    GOTO_IF(len != (PHYSFS_sint64) ci->size, PHYSFS_ERR_CORRUPT, failed);
+
+    chunk = (CASchunk *) allocator.Malloc(sizeof (CASchunk) + ci->size);
+    GOTO_IF(!chunk, PHYSFS_ERR_OUT_OF_MEMORY, failed);
+    memset(chunk, '\0', sizeof (*chunk));
+    chunk->data = (PHYSFS_uint8 *) (chunk + 1);
+    GOTO_IF_ERRPASS(!__PHYSFS_readAll(io, chunk->data, ci->size), failed);
+    GOTO_IF(__PHYSFS_crc32(0, chunk->data, ci->size) != ci->crc, PHYSFS_ERR_CORRUPT, failed);
+
+    io->destroy(io);
+    memcpy(chunk->id, ci->id, CAS_ID_LEN);
+    chunk->size = ci->size;
+    chunk->crc = ci->crc;
+    return chunk;
+
+failed:
+    if (chunk)
+        allocator.Free(chunk);
+    io->destroy(io);
+    return NULL;
+} /* casLoadChunk */
+
+
+/* Get a referenced chunk, from the cache if we can. The disk read happens
+   without the lock held, so other files keep reading while we wait. */
+static CASchunk *casGetChunk(const CASinfo *info, const CASchunkinfo *ci)
+{
+    CASchunk *chunk;
+    CASchunk *other;
+
+    __PHYSFS_platformGrabMutex(casLock);
+    chunk = casFindChunk(ci);
+    __PHYSFS_platformReleaseMutex(casLock);
+
+    if (chunk != NULL)
+        return chunk;
+
+    chunk = casLoadChunk(info, ci);
+    BAIL_IF_ERRPASS(!chunk, NULL);
+
+    __PHYSFS_platformGrabMutex(casLock);
+    other = casFindChunk(ci);  /* someone else may have loaded it, too. */
+    if (other != NULL)
+    {
+        __PHYSFS_platformReleaseMutex(casLock);
+        allocator.Free(chunk);
+        return other;
+    } /* if */
+
+    chunk->refcount = 1;
+    chunk->hashnext = casHash[casBucket(chunk->id)];
+    casHash[casBucket(chunk->id)] = chunk;
+    __PHYSFS_platformReleaseMutex(casLock);
+    return chunk;
+} /* casGetChunk */
+
+
+/* Which of (entry)'s chunks holds (pos)? (pos) must be less than the size. */
+static PHYSFS_uint32 casFindRef(const CASinfo *info, const CASentry *entry,
+                                const PHYSFS_uint64 pos)
+{
+    const PHYSFS_uint64 *offsets = info->offsets + entry->firstref;
+    PHYSFS_uint32 lo = 0;
+    PHYSFS_uint32 hi = entry->numrefs - 1;
+
+    while (lo < hi)  /* find the last chunk that starts at or before (pos). */
+    {
+        const PHYSFS_uint32 mid = lo + ((hi - lo + 1) / 2);
+        if (offsets[mid] <= pos)
+            lo = mid;
+        else
+            hi = mid - 1;
+    } /* while */
+
+    return lo;
+} /* casFindRef */
+
+
+static PHYSFS_sint64 CAS_read(PHYSFS_Io *io, void *_buf, PHYSFS_uint64 len)
+{
+    CASfileinfo *finfo = (CASfileinfo *) io->opaque;
+    const CASinfo *info = finfo->arc;
+    const CASentry *entry = finfo->entry;
+    PHYSFS_uint8 *buf = (PHYSFS_uint8 *) _buf;
+    PHYSFS_sint64 retval = 0;
+
+    if (len > entry->size - finfo->pos)
+        len = entry->size - finfo->pos;
+
+    while (len > 0)
+    {
+        PHYSFS_uint64 offset;
+        PHYSFS_uint64 cpy;
+        PHYSFS_uint32 ref;
+
+        /* still in the current chunk, or (for sequential reads) the next? */
+        ref = finfo->curref;
+        if ((finfo->cur == NULL) ||
+            (finfo->pos < info->offsets[entry->firstref + ref]) ||
+            (finfo->pos >= info->offsets[entry->firstref + ref] + finfo->cur->size))
+        {
+            ref = casFindRef(info, entry, finfo->pos);
+            if (finfo->cur != NULL)
+            {
+                casReleaseChunk(finfo->cur);
+                finfo->cur = NULL;
+            } /* if */
+
+            finfo->cur = casGetChunk(info, &info->chunks[info->refs[entry->firstref + ref]]);
+            if (finfo->cur == NULL)
+                return (retval == 0) ? -1 : retval;
+            finfo->curref = ref;
+        } /* if */
+
+        offset = finfo->pos - info->offsets[entry->firstref + ref];
+        cpy = finfo->cur->size - offset;
+        if (cpy > len)
+            cpy = len;
+
+        memcpy(buf, finfo->cur->data + offset, (size_t) cpy);
+        buf += cpy;
+        len -= cpy;
+        finfo->pos += cpy;
+        retval += (PHYSFS_sint64) cpy;
+    } /* while */
+
+    return retval;
+} /* CAS_read */
+
+
+static PHYSFS_sint64 CAS_write(PHYSFS_Io *io, const void *b, PHYSFS_uint64 len)
+{
+    BAIL(PHYSFS_ERR_READ_ONLY, -1);
+} /* CAS_write */
+
+
+static int CAS_seek(PHYSFS_Io *io, PHYSFS_uint64 offset)
+{
+    CASfileinfo *finfo = (CASfileinfo *) io->opaque;
+    BAIL_IF(offset > finfo->entry->size, PHYSFS_ERR_PAST_EOF, 0);
+    finfo->pos = offset;  /* CAS_read() switches chunks if it has to. */
+    return 1;
+} /* CAS_seek */
+
+
+static PHYSFS_sint64 CAS_tell(PHYSFS_Io *io)
+{
+    return (PHYSFS_sint64) ((CASfileinfo *) io->opaque)->pos;
+} /* CAS_tell */
+
+
+static PHYSFS_sint64 CAS_length(PHYSFS_Io *io)
+{
+    return (PHYSFS_sint64) ((CASfileinfo *) io->opaque)->entry->size;
+} /* CAS_length */
+
+
+static PHYSFS_Io *casOpenEntry(CASinfo *info, CASentry *entry);
+
+static PHYSFS_Io *CAS_duplicate(PHYSFS_Io *io)
+{
+    CASfileinfo *finfo = (CASfileinfo *) io->opaque;
+    return casOpenEntry(finfo->arc, finfo->entry);
+} /* CAS_duplicate */
+
+
+static int CAS_flush(PHYSFS_Io *io) { return 1;  /* no write support. */ }
+
+
+static void CAS_destroy(PHYSFS_Io *io)
+{
+    CASfileinfo *finfo = (CASfileinfo *) io->opaque;
+    if (finfo->cur != NULL)
+        casReleaseChunk(finfo->cur);
+    allocator.Free(finfo);
+    allocator.Free(io);
+} /* CAS_destroy */
+
+
+static const PHYSFS_Io CAS_Io =
+{
+    CURRENT_PHYSFS_IO_API_VERSION, NULL,
+    CAS_read,
+    CAS_write,
+    CAS_seek,
+    CAS_tell,
+    CAS_length,
+    CAS_duplicate,
+    CAS_flush,
+    CAS_destroy
+};
+
+
+static PHYSFS_Io *casOpenEntry(CASinfo *info, CASentry *entry)
+{
+    PHYSFS_Io *retval = (PHYSFS_Io *) allocator.Malloc(sizeof (PHYSFS_Io));
+    CASfileinfo *finfo = (CASfileinfo *) allocator.Malloc(sizeof (CASfileinfo));
+
+    if (!retval || !finfo)
+    {
+        if (retval)
+            allocator.Free(retval);
+        if (finfo)
+            allocator.Free(finfo);
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    } /* if */
+
+    memset(finfo, '\0', sizeof (*finfo));
+    finfo->arc = info;
+    finfo->entry = entry;
+
+    memcpy(retval, &CAS_Io, sizeof (*retval));
+    retval->opaque = finfo;
+    return retval;
+} /* casOpenEntry */
+
+
+/* Turn the manifest's store path into a native directory name, with a
+   trailing separator, relative to the manifest's own directory if needed. */
+static char *casStorePath(PHYSFS_Io *io, const char *store, size_t *_len)
+{
+    const char dirsep = __PHYSFS_platformDirSeparator;
+    const char *base = NULL;
+    size_t baselen = 0;
+    size_t storelen = strlen(store);
+    int absolute = (store[0] == '/');
+    char *retval;
+    char *ptr;
+
+    #ifdef PHYSFS_PLATFORM_WINDOWS
+    if ((storelen >= 2) && (store[1] == ':'))
+        absolute = 1;  /* drive letter. */
+    #endif
+
+    if (!absolute)
+    {
+        const char *sep;
+        base = __PHYSFS_nativeIoPath(io);
+        BAIL_IF(!base, PHYSFS_ERR_UNSUPPORTED, NULL);  /* relative to what? */
+        sep = strrchr(base, dirsep);
+        baselen = sep ? (size_t) ((sep - base) + 1) : 0;
+    } /* if */
+
+    while ((storelen > 0) && (store[storelen - 1] == '/'))
+        storelen--;
+
+    retval = (char *) allocator.Malloc(baselen + storelen + 2);
+    BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    if (baselen)
+        memcpy(retval, base, baselen);
+    memcpy(retval + baselen, store, storelen);
+    ptr = retval + baselen + storelen;
+    *(ptr++) = dirsep;
+    *ptr = '\0';
+
+    for (ptr = retval + baselen; *ptr; ptr++)
+    {
+        if (*ptr == '/')
+            *ptr = dirsep;
+    } /* for */
+
+    *_len = baselen + storelen + 1;
+    return retval;
+} /* casStorePath */
+
+
+static int casLoadFiles(PHYSFS_Io *io, CASinfo *info, const PHYSFS_uint32 count)
+{
+    const PHYSFS_uint64 iolen = (PHYSFS_uint64) io->length(io);
+    PHYSFS_uint32 allocated = 0;
+    PHYSFS_uint32 refcap = 0;
+    char *name = NULL;
+    PHYSFS_uint32 i;
+
+    for (i = 0; i < count; i++)
+    {
+        PHYSFS_uint32 namelen;
+        PHYSFS_uint32 numrefs;
+        PHYSFS_sint64 mtime;
+        PHYSFS_uint64 size = 0;
+        CASentry *entry;
+        PHYSFS_uint32 j;
+
+        GOTO_IF_ERRPASS(!readui32(io, &namelen), failed);
+        GOTO_IF(namelen == 0, PHYSFS_ERR_CORRUPT, failed);
+        GOTO_IF(namelen > iolen, PHYSFS_ERR_CORRUPT, failed);
+        if (namelen >= allocated)
+        {
+            char *ptr = (char *) allocator.Realloc(name, namelen + 1);
+            GOTO_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, failed);
+            name = ptr;
+            allocated = namelen + 1;
+        } /* if */
+
+        GOTO_IF_ERRPASS(!__PHYSFS_readAll(io, name, namelen), failed);
+        name[namelen] = '\0';
+        GOTO_IF(strlen(name) != namelen, PHYSFS_ERR_CORRUPT, failed);
+        GOTO_IF_ERRPASS(!readsi64(io, &mtime), failed);
+        GOTO_IF_ERRPASS(!readui32(io, &numrefs), failed);
+        GOTO_IF(numrefs > iolen / sizeof (PHYSFS_uint32), PHYSFS_ERR_CORRUPT, failed);
+
+        if (info->numrefs + numrefs > refcap)
+        {
+            PHYSFS_uint32 *refs;
+            PHYSFS_uint64 *offsets;
+            PHYSFS_uint32 want = refcap ? refcap : 64;
+            GOTO_IF(info->numrefs + numrefs < info->numrefs, PHYSFS_ERR_CORRUPT, failed);
+            while (want < info->numrefs + numrefs)
+            {
+                GOTO_IF(want > 0x7FFFFFFF, PHYSFS_ERR_CORRUPT, failed);
+                want *= 2;
+            } /* while */
+
+            refs = (PHYSFS_uint32 *) allocator.Realloc(info->refs, sizeof (PHYSFS_uint32) * want);
+            GOTO_IF(!refs, PHYSFS_ERR_OUT_OF_MEMORY, failed);
+            info->refs = refs;
+            offsets = (PHYSFS_uint64 *) allocator.Realloc(info->offsets, sizeof (PHYSFS_uint64) * want);
+            GOTO_IF(!offsets, PHYSFS_ERR_OUT_OF_MEMORY, failed);
+            info->offsets = offsets;
+            refcap = want;
+        } /* if */
+
+        for (j = 0; j < numrefs; j++)
+        {
+            PHYSFS_uint32 idx;
+            GOTO_IF_ERRPASS(!readui32(io, &idx), failed);
+            GOTO_IF(idx >= info->numchunks, PHYSFS_ERR_CORRUPT, failed);
+            info->refs[info->numrefs + j] = idx;
+            info->offsets[info->numrefs + j] = size;
+            size += info->chunks[idx].size;
+        } /* for */
+
+        entry = (CASentry *) __PHYSFS_DirTreeAdd(&info->tree, name, 0);
+        GOTO_IF_ERRPASS(!entry, failed);
+        GOTO_IF(entry->tree.isdir, PHYSFS_ERR_CORRUPT, failed);
+        entry->mtime = mtime;
+        entry->size = size;
+        entry->firstref = info->numrefs;
+        entry->numrefs = numrefs;
+        info->numrefs += numrefs;
+    } /* for */
+
+    allocator.Free(name);
+    return 1;
+
+failed:
+    allocator.Free(name);
+    return 0;
+} /* casLoadFiles */
+
+
+static int casLoadChunkTable(PHYSFS_Io *io, CASinfo *info)
+{
+    PHYSFS_uint32 i;
+
+    info->chunks = (CASchunkinfo *) allocator.Malloc(sizeof (CASchunkinfo) * (info->numchunks ? info->numchunks : 1));
+    BAIL_IF(!info->chunks, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+
+    for (i = 0; i < info->numchunks; i++)
+    {
+        CASchunkinfo *ci = &info->chunks[i];
+        BAIL_IF_ERRPASS(!__PHYSFS_readAll(io, ci->id, CAS_ID_LEN), 0);
+        BAIL_IF_ERRPASS(!readui32(io, &ci->size), 0);
+        BAIL_IF_ERRPASS(!readui32(io, &ci->crc), 0);
+        BAIL_IF(ci->size == 0, PHYSFS_ERR_CORRUPT, 0);
+        BAIL_IF(ci->size > CAS_MAX_CHUNK_SIZE, PHYSFS_ERR_CORRUPT, 0);
+    } /* for */
+
+    return 1;
+} /* casLoadChunkTable */
+
+
+static void CAS_closeArchive(void *opaque)
+{
+    CASinfo *info = (CASinfo *) opaque;
+
+    if (!info)
+        return;
+
+    if (info->io)
+        info->io->destroy(info->io);
+    __PHYSFS_DirTreeDeinit(&info->tree);
+    allocator.Free(info->store);
+    allocator.Free(info->chunks);
+    allocator.Free(info->refs);
+    allocator.Free(info->offsets);
+    allocator.Free(info);
+
+    /* last manifest gone? No open files can be left, so drop the cache. */
+    assert(casArchives > 0);
+    if (--casArchives == 0)
+    {
+        casTrimCache(0);
+        assert(casMru == NULL);
+        __PHYSFS_platformDestroyMutex(casLock);
+        casLock = NULL;
+    } /* if */
+} /* CAS_closeArchive */
+
+
+static int CAS_sniff(const void *head, PHYSFS_uint64 headlen,
+                     const void *tail, PHYSFS_uint64 taillen,
+                     PHYSFS_sint64 filelen)
+{
+    (void) tail; (void) taillen; (void) filelen;
+    return (headlen >= 8) && (memcmp(head, "PHYSFSCA", 8) == 0);
+} /* CAS_sniff */
+
+
+static void *CAS_openArchive(PHYSFS_Io *io, const char *name,
+                             int forWriting, int *claimed)
+{
+    PHYSFS_uint8 magic[8];
+    PHYSFS_uint32 version, numfiles, storelen;
+    CASinfo *info = NULL;
+    char *store = NULL;
+
+    assert(io != NULL);  /* shouldn't ever happen. */
+
+    BAIL_IF(forWriting, PHYSFS_ERR_READ_ONLY, NULL);
+    BAIL_IF_ERRPASS(!__PHYSFS_readAll(io, magic, sizeof (magic)), NULL);
+    BAIL_IF(memcmp(magic, "PHYSFSCA", 8) != 0, PHYSFS_ERR_UNSUPPORTED, NULL);
+    *claimed = 1;
+
+    BAIL_IF_ERRPASS(!readui32(io, &version), NULL);
+    BAIL_IF(version != CAS_VERSION, PHYSFS_ERR_UNSUPPORTED, NULL);
+
+    if (casArchives == 0)  /* first one in; set up the shared cache. */
+    {
+        casLock = __PHYSFS_platformCreateMutex();
+        BAIL_IF_ERRPASS(!casLock, NULL);
+    } /* if */
+    casArchives++;  /* CAS_closeArchive() undoes this, even on failure. */
+
+    info = (CASinfo *) allocator.Malloc(sizeof (CASinfo));
+    GOTO_IF(!info, PHYSFS_ERR_OUT_OF_MEMORY, failed);
+    memset(info, '\0', sizeof (*info));
+    GOTO_IF_ERRPASS(!__PHYSFS_DirTreeInit(&info->tree, sizeof (CASentry)), failed);
+
+    GOTO_IF_ERRPASS(!readui32(io, &info->numchunks), failed);
+    GOTO_IF_ERRPASS(!readui32(io, &numfiles), failed);
+    GOTO_IF_ERRPASS(!readui32(io, &storelen), failed);
+    GOTO_IF(storelen == 0, PHYSFS_ERR_CORRUPT, failed);
+    GOTO_IF(storelen > (PHYSFS_uint64) io->length(io), PHYSFS_ERR_CORRUPT, failed);
+    GOTO_IF(info->numchunks > (PHYSFS_uint64) io->length(io) / (CAS_ID_LEN + 8), PHYSFS_ERR_CORRUPT, failed);
+
+    store = (char *) __PHYSFS_smallAlloc(storelen + 1);
+    GOTO_IF(!store, PHYSFS_ERR_OUT_OF_MEMORY, failed);
+    GOTO_IF_ERRPASS(!__PHYSFS_readAll(io, store, storelen), failed);
+    store[storelen] = '\0';
+    GOTO_IF(strlen(store) != storelen, PHYSFS_ERR_CORRUPT, failed);
+    info->store = casStorePath(io, store, &info->storelen);
+    __PHYSFS_smallFree(store);
+    store = NULL;
+    GOTO_IF_ERRPASS(!info->store, failed);
+
+    GOTO_IF_ERRPASS(!casLoadChunkTable(io, info), failed);
+    GOTO_IF_ERRPASS(!casLoadFiles(io, info, numfiles), failed);
+
+    info->io = io;
+    return info;
+
+failed:
+    if (store)
+        __PHYSFS_smallFree(store);
+
+    if (info)
+        CAS_closeArchive(info);
+    else if (--casArchives == 0)
+    {
+        __PHYSFS_platformDestroyMutex(casLock);
+        casLock = NULL;
+    } /* else if */
+
+    return NULL;
+} /* CAS_openArchive */
+
+
+static PHYSFS_Io *CAS_openRead(void *opaque, const char *name)
+{
+    CASinfo *info = (CASinfo *) opaque;
+    CASentry *entry = (CASentry *) __PHYSFS_DirTreeFind(&info->tree, name);
+    BAIL_IF_ERRPASS(!entry, NULL);
+    BAIL_IF(entry->tree.isdir, PHYSFS_ERR_NOT_A_FILE, NULL);
+    return casOpenEntry(info, entry);
+} /* CAS_openRead */
+
+
+static PHYSFS_Io *CAS_openWrite(void *opaque, const char *name)
+{
+    BAIL(PHYSFS_ERR_READ_ONLY, NULL);
+} /* CAS_openWrite */
+
+
+static PHYSFS_Io *CAS_openAppend(void *opaque, const char *name)
+{
+    BAIL(PHYSFS_ERR_READ_ONLY, NULL);
+} /* CAS_openAppend */
+
+
+static int CAS_remove(void *opaque, const char *name)
+{
+    BAIL(PHYSFS_ERR_READ_ONLY, 0);
+} /* CAS_remove */
+
+
+static int CAS_mkdir(void *opaque, const char *name)
+{
+    BAIL(PHYSFS_ERR_READ_ONLY, 0);
+} /* CAS_mkdir */
+
+
+static int CAS_stat(void *opaque, const char *name, PHYSFS_Stat *stat)
+{
+    CASinfo *info = (CASinfo *) opaque;
+    const CASentry *entry = (CASentry *) __PHYSFS_DirTreeFind(&info->tree, name);
+    BAIL_IF_ERRPASS(!entry, 0);
+
+    if (entry->tree.isdir)
+    {
+        stat->filetype = PHYSFS_FILETYPE_DIRECTORY;
+        stat->filesize = 0;
+        stat->modtime = stat->createtime = -1;
+    } /* if */
+    else
+    {
+        stat->filetype = PHYSFS_FILETYPE_REGULAR;
+        stat->filesize = (PHYSFS_sint64) entry->size;
+        stat->modtime = stat->createtime = entry->mtime;
+    } /* else */
+
+    stat->accesstime = -1;
+    stat->readonly = 1;
+    return 1;
+} /* CAS_stat */
+
+
+/* The chunk ids are hashes of the contents, so this is a content hash. */
+static int CAS_fingerprint(void *opaque, const char *name, PHYSFS_uint64 *fp)
+{
+    CASinfo *info = (CASinfo *) opaque;
+    const CASentry *entry = (CASentry *) __PHYSFS_DirTreeFind(&info->tree, name);
+    PHYSFS_uint64 retval;
+    PHYSFS_uint32 i;
+
+    BAIL_IF_ERRPASS(!entry, 0);
+    BAIL_IF(entry->tree.isdir, PHYSFS_ERR_NOT_A_FILE, 0);
+
+    retval = __PHYSFS_mixFingerprint(0, entry->size);
+    for (i = 0; i < entry->numrefs; i++)
+    {
+        const PHYSFS_uint8 *id = info->chunks[info->refs[entry->firstref + i]].id;
+        PHYSFS_uint64 lo = 0;
+        PHYSFS_uint64 hi = 0;
+        int j;
+        for (j = 0; j < 8; j++)
+        {
+            lo = (lo << 8) | id[j];
+            hi = (hi << 8) | id[j + 8];
+        } /* for */
+        retval = __PHYSFS_mixFingerprint(retval, lo);
+        retval = __PHYSFS_mixFingerprint(retval, hi);
+    } /* for */
+
+    *fp = retval;
+    return 1;
+} /* CAS_fingerprint */
+
+
+const PHYSFS_Archiver __PHYSFS_Archiver_CAS =
+{
+    CURRENT_PHYSFS_ARCHIVER_API_VERSION,
+    {
+        "CAS",
+        "Content-addressed chunk store manifests",
+        "The PhysicsFS contributors",
+        "https://icculus.org/physfs/",
+        0,  /* supportsSymlinks */
+    },
+    CAS_openArchive,
+    __PHYSFS_DirTreeEnumerate,
+    CAS_openRead,
+    CAS_openWrite,
+    CAS_openAppend,
+    CAS_remove,
+    CAS_mkdir,
+    CAS_stat,
+    CAS_closeArchive,
+    CAS_fingerprint,
+    NULL,  /* refresh */
+    CAS_sniff
+};
+
+#endif  /* defined PHYSFS_SUPPORTS_CAS */
+
+/* end of physfs_archiver_cas.c ... */
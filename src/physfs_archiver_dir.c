@@ -171,6 +171,25 @@ static int DIR_stat(void *opaque, const char *name, PHYSFS_Stat *stat)
 } /* DIR_stat */
 
 
+static int DIR_fingerprint(void *opaque, const char *name, PHYSFS_uint64 *fp)
+{
+    int retval = 0;
+    char *d;
+
+    CVT_TO_DEPENDENT(d, opaque, name);
+    BAIL_IF_ERRPASS(!d, 0);
+    retval = __PHYSFS_platformFingerprint(d, fp);
+    __PHYSFS_smallFree(d);
+    return retval;
+} /* DIR_fingerprint */
+
+
+static int DIR_refresh(void *opaque)
+{
+    return 1;  /* we always read the live directory; nothing to pick up. */
+} /* DIR_refresh */
+
+
 const PHYSFS_Archiver __PHYSFS_Archiver_DIR =
 {
     CURRENT_PHYSFS_ARCHIVER_API_VERSION,
@@ -189,7 +208,10 @@ const PHYSFS_Archiver __PHYSFS_Archiver_DIR =
     DIR_remove,
     DIR_mkdir,
     DIR_stat,
-    DIR_closeArchive
+    DIR_closeArchive,
+    DIR_fingerprint,
+    DIR_refresh,
+    NULL   /* sniff */
 };
 
 /* end of physfs_archiver_dir.c ... */
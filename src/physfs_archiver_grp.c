@@ -56,6 +56,15 @@ static int grpLoadEntries(PHYSFS_Io *io, const PHYSFS_uint32 count, void *arc)
 } /* grpLoadEntries */
 
 
+static int GRP_sniff(const void *head, PHYSFS_uint64 headlen,
+                     const void *tail, PHYSFS_uint64 taillen,
+                     PHYSFS_sint64 filelen)
+{
+    (void) tail; (void) taillen; (void) filelen;
+    return (headlen >= 12) && (memcmp(head, "KenSilverman", 12) == 0);
+} /* GRP_sniff */
+
+
 static void *GRP_openArchive(PHYSFS_Io *io, const char *name,
                              int forWriting, int *claimed)
 {
@@ -107,7 +116,10 @@ const PHYSFS_Archiver __PHYSFS_Archiver_GRP =
     UNPK_remove,
     UNPK_mkdir,
     UNPK_stat,
-    UNPK_closeArchive
+    UNPK_closeArchive,
+    NULL,  /* fingerprint */
+    NULL,  /* refresh */
+    GRP_sniff
 };
 
 #endif  /* defined PHYSFS_SUPPORTS_GRP */
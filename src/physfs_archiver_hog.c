@@ -61,6 +61,15 @@ static int hogLoadEntries(PHYSFS_Io *io, void *arc)
 } /* hogLoadEntries */
 
 
+static int HOG_sniff(const void *head, PHYSFS_uint64 headlen,
+                     const void *tail, PHYSFS_uint64 taillen,
+                     PHYSFS_sint64 filelen)
+{
+    (void) tail; (void) taillen; (void) filelen;
+    return (headlen >= 3) && (memcmp(head, "DHF", 3) == 0);
+} /* HOG_sniff */
+
+
 static void *HOG_openArchive(PHYSFS_Io *io, const char *name,
                              int forWriting, int *claimed)
 {
@@ -105,7 +114,10 @@ const PHYSFS_Archiver __PHYSFS_Archiver_HOG =
     UNPK_remove,
     UNPK_mkdir,
     UNPK_stat,
-    UNPK_closeArchive
+    UNPK_closeArchive,
+    NULL,  /* fingerprint */
+    NULL,  /* refresh */
+    HOG_sniff
 };
 
 #endif  /* defined PHYSFS_SUPPORTS_HOG */
@@ -212,10 +212,11 @@ static int iso9660LoadEntries(PHYSFS_Io *io, const int joliet,
         extent += extattrlen;  /* skip extended attribute record. */
 
         /* infinite loop, corrupt file? */
-        BAIL_IF((extent * 2048) == dirstart, PHYSFS_ERR_CORRUPT, 0);
+        BAIL_IF((((PHYSFS_uint64) extent) * 2048) == dirstart, PHYSFS_ERR_CORRUPT, 0);
 
         if (!iso9660AddEntry(io, joliet, isdir, base, fname, fnamelen,
-                             timestamp, extent * 2048, datalen, unpkarc))
+                             timestamp, ((PHYSFS_uint64) extent) * 2048,
+                             datalen, unpkarc))
         {
             return 0;
         } /* if */
@@ -302,7 +303,7 @@ static int parseVolumeDescriptor(PHYSFS_Io *io, PHYSFS_uint64 *_rootpos,
             case 2:  /* Supplementary Volume Descriptor */
                 if (found < type)
                 {
-                    *_rootpos = PHYSFS_swapULE32(extent) * 2048;
+                    *_rootpos = ((PHYSFS_uint64) PHYSFS_swapULE32(extent)) * 2048;
                     *_rootlen = PHYSFS_swapULE32(datalen);
                     found = type;
 
@@ -331,6 +332,18 @@ static int parseVolumeDescriptor(PHYSFS_Io *io, PHYSFS_uint64 *_rootpos,
 } /* parseVolumeDescriptor */
 
 
+static int ISO9660_sniff(const void *head, PHYSFS_uint64 headlen,
+                         const void *tail, PHYSFS_uint64 taillen,
+                         PHYSFS_sint64 filelen)
+{
+    /* the Primary Volume Descriptor's id is at byte 1 of sector 16. */
+    (void) tail; (void) taillen; (void) filelen;
+    if (headlen < 32768 + 6)
+        return 0;
+    return (memcmp(((const PHYSFS_uint8 *) head) + 32769, "CD001", 5) == 0);
+} /* ISO9660_sniff */
+
+
 static void *ISO9660_openArchive(PHYSFS_Io *io, const char *filename,
                                  int forWriting, int *claimed)
 {
@@ -377,7 +390,10 @@ const PHYSFS_Archiver __PHYSFS_Archiver_ISO9660 =
     UNPK_remove,
     UNPK_mkdir,
     UNPK_stat,
-    UNPK_closeArchive
+    UNPK_closeArchive,
+    NULL,  /* fingerprint */
+    NULL,  /* refresh */
+    ISO9660_sniff
 };
 
 #endif  /* defined PHYSFS_SUPPORTS_ISO9660 */
@@ -53,6 +53,15 @@ static int mvlLoadEntries(PHYSFS_Io *io, const PHYSFS_uint32 count, void *arc)
 } /* mvlLoadEntries */
 
 
+static int MVL_sniff(const void *head, PHYSFS_uint64 headlen,
+                     const void *tail, PHYSFS_uint64 taillen,
+                     PHYSFS_sint64 filelen)
+{
+    (void) tail; (void) taillen; (void) filelen;
+    return (headlen >= 4) && (memcmp(head, "DMVL", 4) == 0);
+} /* MVL_sniff */
+
+
 static void *MVL_openArchive(PHYSFS_Io *io, const char *name,
                              int forWriting, int *claimed)
 {
@@ -101,7 +110,10 @@ const PHYSFS_Archiver __PHYSFS_Archiver_MVL =
     UNPK_remove,
     UNPK_mkdir,
     UNPK_stat,
-    UNPK_closeArchive
+    UNPK_closeArchive,
+    NULL,  /* fingerprint */
+    NULL,  /* refresh */
+    MVL_sniff
 };
 
 #endif  /* defined PHYSFS_SUPPORTS_MVL */
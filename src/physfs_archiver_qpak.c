@@ -56,6 +56,15 @@ static int qpakLoadEntries(PHYSFS_Io *io, const PHYSFS_uint32 count, void *arc)
 } /* qpakLoadEntries */
 
 
+static int QPAK_sniff(const void *head, PHYSFS_uint64 headlen,
+                      const void *tail, PHYSFS_uint64 taillen,
+                      PHYSFS_sint64 filelen)
+{
+    (void) tail; (void) taillen; (void) filelen;
+    return (headlen >= 4) && (memcmp(head, "PACK", 4) == 0);
+} /* QPAK_sniff */
+
+
 static void *QPAK_openArchive(PHYSFS_Io *io, const char *name,
                               int forWriting, int *claimed)
 {
@@ -117,7 +126,10 @@ const PHYSFS_Archiver __PHYSFS_Archiver_QPAK =
     UNPK_remove,
     UNPK_mkdir,
     UNPK_stat,
-    UNPK_closeArchive
+    UNPK_closeArchive,
+    NULL,  /* fingerprint */
+    NULL,  /* refresh */
+    QPAK_sniff
 };
 
 #endif  /* defined PHYSFS_SUPPORTS_QPAK */
@@ -59,6 +59,29 @@ static int slbLoadEntries(PHYSFS_Io *io, const PHYSFS_uint32 count, void *arc)
 } /* slbLoadEntries */
 
 
+static int SLB_sniff(const void *head, PHYSFS_uint64 headlen,
+                     const void *tail, PHYSFS_uint64 taillen,
+                     PHYSFS_sint64 filelen)
+{
+    /* no signature, so the best we can do is rule out obvious non-SLBs. */
+    const PHYSFS_uint8 *ptr = (const PHYSFS_uint8 *) head;
+    PHYSFS_uint32 val[3];
+    (void) tail; (void) taillen;
+    if (headlen < sizeof (val))
+        return 0;
+    memcpy(val, ptr, sizeof (val));
+    if (PHYSFS_swapULE32(val[0]) != 0)  /* version */
+        return 0;
+    else if (PHYSFS_swapULE32(val[1]) == 0)  /* file count */
+        return 0;
+    else if (PHYSFS_swapULE32(val[2]) == 0)  /* tocPos */
+        return 0;
+    else if ((filelen >= 0) && (PHYSFS_swapULE32(val[2]) >= filelen))
+        return 0;
+    return -1;
+} /* SLB_sniff */
+
+
 static void *SLB_openArchive(PHYSFS_Io *io, const char *name,
                              int forWriting, int *claimed)
 {
@@ -127,7 +150,10 @@ const PHYSFS_Archiver __PHYSFS_Archiver_SLB =
     UNPK_remove,
     UNPK_mkdir,
     UNPK_stat,
-    UNPK_closeArchive
+    UNPK_closeArchive,
+    NULL,  /* fingerprint */
+    NULL,  /* refresh */
+    SLB_sniff
 };
 
 #endif  /* defined PHYSFS_SUPPORTS_SLB */
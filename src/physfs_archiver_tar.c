@@ -0,0 +1,669 @@
+/*
+ * tar support routines for PhysicsFS.
+ *
+ * This driver handles uncompressed tarballs: POSIX ustar and pax archives,
+ *  GNU tar's long names and base-256 sizes, and plain old v7 tarfiles.
+ *
+ * A tarfile has no central directory; every file is a 512 byte header
+ *  followed by its data, padded to 512 bytes. So mounting one means
+ *  reading every header in the file, which for a big tarball is a seek
+ *  and a small read per entry. If PHYSFS_setArchiveIndexDir() is in
+ *  effect, we write the list of entries we found to an index file in that
+ *  directory, and the next mount of the same (unchanged) tarball reads
+ *  that instead, in one go.
+ *
+ * Not supported:
+ * - Compressed tarballs (.tar.gz, etc). Decompress them first.
+ * - Symlinks and hard links, device nodes, fifos, etc. They're skipped.
+ * - Sparse files.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ *
+ *  This file written by the PhysicsFS contributors.
+ */
+
+#define __PHYSICSFS_INTERNAL__
+#include "physfs_internal.h"
+
+#if PHYSFS_SUPPORTS_TAR
+
+#define TAR_BLOCKSIZE 512
+#define TAR_MAX_EXTENDED_HEADER (1024 * 1024)
+
+#define TAR_INDEX_MAGIC "PHYSFSTI"
+#define TAR_INDEX_VERSION 1
+
+/* The index is only ever read by the machine that wrote it, so it's in
+   native byte order, and (endian) makes sure of that. Each entry is a
+   TARindexentry followed by its name, null-terminated and padded to 8. */
+typedef struct
+{
+    char magic[8];
+    PHYSFS_uint32 version;
+    PHYSFS_uint32 endian;         /* 0x01020304 when written.         */
+    PHYSFS_uint64 fingerprint;    /* of the tarball, when indexed.    */
+    PHYSFS_uint64 archive_len;    /* of the tarball, when indexed.    */
+    PHYSFS_uint64 total_len;      /* of this index file.              */
+    PHYSFS_uint32 namelen;        /* tarball's path, null included.   */
+    PHYSFS_uint32 entry_count;
+} TARindexheader;
+
+typedef struct
+{
+    PHYSFS_uint64 pos;
+    PHYSFS_uint64 size;
+    PHYSFS_sint64 mtime;
+    PHYSFS_uint32 namelen;        /* null included, padding not.      */
+    PHYSFS_uint32 isdir;
+} TARindexentry;
+
+/* What a scan has collected for the index so far. */
+typedef struct
+{
+    PHYSFS_uint8 *buf;
+    size_t len;
+    size_t allocated;
+    PHYSFS_uint32 count;
+} TARindexbuf;
+
+/* pax and GNU headers that describe the next real entry. */
+typedef struct
+{
+    char *path;
+    int has_size;
+    PHYSFS_uint64 size;
+    int has_mtime;
+    PHYSFS_sint64 mtime;
+} TARpending;
+
+
+static int tarChecksumOkay(const PHYSFS_uint8 *hdr)
+{
+    PHYSFS_uint32 usum = 0;
+    PHYSFS_sint32 ssum = 0;
+    PHYSFS_uint32 want = 0;
+    const PHYSFS_uint8 *ptr = hdr + 148;
+    int i;
+
+    for (i = 0; i < TAR_BLOCKSIZE; i++)
+    {
+        /* the checksum field itself counts as spaces. */
+        const PHYSFS_uint8 ch = ((i >= 148) && (i < 156)) ? ' ' : hdr[i];
+        usum += ch;
+        ssum += (PHYSFS_sint8) ch;  /* some old tars got this wrong. */
+    } /* for */
+
+    while ((ptr < hdr + 156) && (*ptr == ' '))
+        ptr++;
+    if ((ptr == hdr + 156) || (*ptr < '0') || (*ptr > '7'))
+        return 0;
+    while ((ptr < hdr + 156) && (*ptr >= '0') && (*ptr <= '7'))
+        want = (want << 3) | (PHYSFS_uint32) (*(ptr++) - '0');
+
+    return ((want == usum) || (want == (PHYSFS_uint32) ssum));
+} /* tarChecksumOkay */
+
+
+/* Octal, space or null terminated, or GNU's base-256 for big values. */
+static int tarParseNumber(const PHYSFS_uint8 *field, const size_t len,
+                          PHYSFS_sint64 *_val)
+{
+    PHYSFS_uint64 val = 0;
+    size_t i = 0;
+
+    if (field[0] & 0x80)
+    {
+        BAIL_IF(field[0] == 0xFF, PHYSFS_ERR_UNSUPPORTED, 0);  /* negative. */
+        val = field[0] & 0x7F;
+        for (i = 1; i < len; i++)
+        {
+            BAIL_IF(val > (__PHYSFS_UI64(0x7FFFFFFFFFFFFFFF) >> 8), PHYSFS_ERR_CORRUPT, 0);
+            val = (val << 8) | field[i];
+        } /* for */
+        *_val = (PHYSFS_sint64) val;
+        return 1;
+    } /* if */
+
+    while ((i < len) && (field[i] == ' '))
+        i++;
+
+    for (; (i < len) && (field[i] >= '0') && (field[i] <= '7'); i++)
+    {
+        BAIL_IF(val > (__PHYSFS_UI64(0x7FFFFFFFFFFFFFFF) >> 3), PHYSFS_ERR_CORRUPT, 0);
+        val = (val << 3) | (PHYSFS_uint64) (field[i] - '0');
+    } /* for */
+
+    BAIL_IF((i < len) && (field[i] != ' ') && (field[i] != '\0'), PHYSFS_ERR_CORRUPT, 0);
+    *_val = (PHYSFS_sint64) val;
+    return 1;
+} /* tarParseNumber */
+
+
+static void tarClearPending(TARpending *pending)
+{
+    if (pending->path)
+        allocator.Free(pending->path);
+    memset(pending, '\0', sizeof (*pending));
+} /* tarClearPending */
+
+
+static char *tarReadString(PHYSFS_Io *io, const PHYSFS_uint64 size)
+{
+    char *retval;
+    BAIL_IF(size > TAR_MAX_EXTENDED_HEADER, PHYSFS_ERR_CORRUPT, NULL);
+    retval = (char *) allocator.Malloc((size_t) size + 1);
+    BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    if (!__PHYSFS_readAll(io, retval, (size_t) size))
+    {
+        allocator.Free(retval);
+        return NULL;
+    } /* if */
+    retval[size] = '\0';
+    return retval;
+} /* tarReadString */
+
+
+/* pax extended header: lines of "<length> <key>=<value>\n". */
+static int tarParsePax(PHYSFS_Io *io, const PHYSFS_uint64 size,
+                       TARpending *pending)
+{
+    char *data = tarReadString(io, size);
+    char *ptr = data;
+    char *end = data + size;
+
+    BAIL_IF_ERRPASS(!data, 0);
+
+    while (ptr < end)
+    {
+        char *rec = ptr;
+        char *key;
+        char *val;
+        PHYSFS_uint64 reclen = 0;
+
+        while ((ptr < end) && (*ptr >= '0') && (*ptr <= '9') && (reclen < size))
+            reclen = (reclen * 10) + (PHYSFS_uint64) (*(ptr++) - '0');
+
+        if ((ptr >= end) || (*ptr != ' ') || (reclen == 0) ||
+            (reclen > (PHYSFS_uint64) (end - rec)) || (rec[reclen - 1] != '\n'))
+        {
+            allocator.Free(data);
+            BAIL(PHYSFS_ERR_CORRUPT, 0);
+        } /* if */
+
+        key = ptr + 1;
+        rec[reclen - 1] = '\0';  /* chop the newline. */
+        ptr = rec + reclen;      /* next record. */
+
+        val = strchr(key, '=');
+        if (val == NULL)
+            continue;
+        *(val++) = '\0';
+
+        if (strcmp(key, "path") == 0)
+        {
+            const size_t len = strlen(val);
+            if (pending->path)
+                allocator.Free(pending->path);
+            pending->path = (char *) allocator.Malloc(len + 1);
+            if (!pending->path)
+            {
+                allocator.Free(data);
+                BAIL(PHYSFS_ERR_OUT_OF_MEMORY, 0);
+            } /* if */
+            memcpy(pending->path, val, len + 1);
+        } /* if */
+
+        else if (strcmp(key, "size") == 0)
+        {
+            PHYSFS_uint64 v = 0;
+            for (; (*val >= '0') && (*val <= '9'); val++)
+            {
+                if (v > (__PHYSFS_UI64(0x7FFFFFFFFFFFFFFF) / 10))
+                    break;
+                v = (v * 10) + (PHYSFS_uint64) (*val - '0');
+            } /* for */
+
+            if (*val != '\0')
+            {
+                allocator.Free(data);
+                BAIL(PHYSFS_ERR_CORRUPT, 0);
+            } /* if */
+
+            pending->has_size = 1;
+            pending->size = v;
+        } /* else if */
+
+        else if (strcmp(key, "mtime") == 0)  /* might have a fraction. */
+        {
+            const int negative = (*val == '-');
+            PHYSFS_sint64 v = 0;
+            if (negative)
+                val++;
+            for (; (*val >= '0') && (*val <= '9') && (v < __PHYSFS_SI64(0x7FFFFFFFFFFF)); val++)
+                v = (v * 10) + (PHYSFS_sint64) (*val - '0');
+            pending->has_mtime = 1;
+            pending->mtime = negative ? -v : v;
+        } /* else if */
+    } /* while */
+
+    allocator.Free(data);
+    return 1;
+} /* tarParsePax */
+
+
+/* Make a tar name into a PhysicsFS path in place. Returns zero if it's
+   something we can't represent ("..", etc), so the entry gets skipped. */
+static int tarCleanName(char *name)
+{
+    char *src = name;
+    char *dst = name;
+
+    while (*src)
+    {
+        const char *elem;
+        size_t len;
+
+        while (*src == '/')
+            src++;
+        if (*src == '\0')
+            break;
+
+        elem = src;
+        while ((*src != '/') && (*src != '\0'))
+            src++;
+        len = (size_t) (src - elem);
+
+        if ((len == 1) && (elem[0] == '.'))
+            continue;  /* "./" is everywhere in tarballs; drop it. */
+        else if ((len == 2) && (elem[0] == '.') && (elem[1] == '.'))
+            return 0;
+
+        if (dst != name)
+            *(dst++) = '/';
+        memmove(dst, elem, len);
+        dst += len;
+    } /* while */
+
+    *dst = '\0';
+    return (*name != '\0');
+} /* tarCleanName */
+
+
+static int tarIndexAppend(TARindexbuf *ib, const char *name, const int isdir,
+                          const PHYSFS_sint64 mtime, const PHYSFS_uint64 pos,
+                          const PHYSFS_uint64 size)
+{
+    const size_t namelen = strlen(name) + 1;
+    const size_t padded = (namelen + 7) & ~((size_t) 7);
+    const size_t needed = sizeof (TARindexentry) + padded;
+    TARindexentry ie;
+
+    if (ib->len + needed > ib->allocated)
+    {
+        size_t newlen = ib->allocated ? ib->allocated * 2 : 64 * 1024;
+        PHYSFS_uint8 *ptr;
+        while (newlen < ib->len + needed)
+            newlen *= 2;
+        ptr = (PHYSFS_uint8 *) allocator.Realloc(ib->buf, newlen);
+        BAIL_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        ib->buf = ptr;
+        ib->allocated = newlen;
+    } /* if */
+
+    ie.pos = pos;
+    ie.size = size;
+    ie.mtime = mtime;
+    ie.namelen = (PHYSFS_uint32) namelen;
+    ie.isdir = isdir ? 1 : 0;
+    memcpy(ib->buf + ib->len, &ie, sizeof (ie));
+    memset(ib->buf + ib->len + sizeof (ie), '\0', padded);
+    memcpy(ib->buf + ib->len + sizeof (ie), name, namelen);
+    ib->len += needed;
+    ib->count++;
+    return 1;
+} /* tarIndexAppend */
+
+
+/* Read every header in the tarball. (ib) is NULL if we aren't indexing. */
+static int tarLoadEntries(PHYSFS_Io *io, const PHYSFS_uint64 archive_len,
+                          void *arc, TARindexbuf *ib)
+{
+    PHYSFS_uint8 hdr[TAR_BLOCKSIZE];
+    TARpending pending;
+    PHYSFS_uint64 pos = 0;
+
+    memset(&pending, '\0', sizeof (pending));
+
+    while (pos + TAR_BLOCKSIZE <= archive_len)
+    {
+        char fullname[256 + 1];  /* prefix + '/' + name + null */
+        const PHYSFS_uint64 datapos = pos + TAR_BLOCKSIZE;
+        PHYSFS_sint64 hdrsize, mtime;
+        PHYSFS_uint64 size;
+        char *name;
+        char type;
+        int i;
+
+        GOTO_IF_ERRPASS(!io->seek(io, pos), failed);
+        GOTO_IF_ERRPASS(!__PHYSFS_readAll(io, hdr, sizeof (hdr)), failed);
+
+        for (i = 0; i < TAR_BLOCKSIZE; i++)
+        {
+            if (hdr[i] != 0)
+                break;
+        } /* for */
+
+        if (i == TAR_BLOCKSIZE)
+            break;  /* a zero block marks the end. */
+
+        GOTO_IF(!tarChecksumOkay(hdr), PHYSFS_ERR_CORRUPT, failed);
+        GOTO_IF_ERRPASS(!tarParseNumber(hdr + 124, 12, &hdrsize), failed);
+        if (!tarParseNumber(hdr + 136, 12, &mtime))
+            mtime = -1;  /* not worth failing the whole archive over. */
+
+        type = (char) hdr[156];
+        size = pending.has_size ? pending.size : (PHYSFS_uint64) hdrsize;
+        if ((type == 'x') || (type == 'g') || (type == 'L') || (type == 'K'))
+            size = (PHYSFS_uint64) hdrsize;  /* these describe the next one. */
+
+        GOTO_IF(size > archive_len - datapos, PHYSFS_ERR_CORRUPT, failed);
+
+        if (type == 'x')
+            GOTO_IF_ERRPASS(!tarParsePax(io, size, &pending), failed);
+
+        else if (type == 'L')  /* GNU long name. */
+        {
+            if (pending.path)
+                allocator.Free(pending.path);
+            pending.path = tarReadString(io, size);
+            GOTO_IF_ERRPASS(!pending.path, failed);
+        } /* else if */
+
+        else if ((type == 'g') || (type == 'K'))
+        {
+            /* global pax header, GNU long link name: nothing we use. */
+        } /* else if */
+
+        else
+        {
+            const int isdir = (type == '5');
+            const int isfile = ((type == '0') || (type == '\0') || (type == '7'));
+
+            if (pending.path != NULL)
+                name = pending.path;
+            else
+            {
+                /* ustar splits long names into prefix and name. (Old GNU
+                   tars say "ustar " and put other things there.) */
+                size_t len = 0;
+                if ((memcmp(hdr + 257, "ustar", 6) == 0) && (hdr[345] != '\0'))
+                {
+                    memcpy(fullname, hdr + 345, 155);
+                    fullname[155] = '\0';
+                    len = strlen(fullname);
+                    fullname[len++] = '/';
+                } /* if */
+                memcpy(fullname + len, hdr, 100);
+                fullname[len + 100] = '\0';
+                name = fullname;
+            } /* else */
+
+            if (pending.has_mtime)
+                mtime = pending.mtime;
+
+            /* v7 tars mark directories with a trailing slash. */
+            if (isfile && (*name) && (name[strlen(name) - 1] == '/'))
+            {
+                if (tarCleanName(name))
+                {
+                    GOTO_IF_ERRPASS(!UNPK_addEntry(arc, name, 1, mtime, mtime, 0, 0), failed);
+                    if (ib)
+                        GOTO_IF_ERRPASS(!tarIndexAppend(ib, name, 1, mtime, 0, 0), failed);
+                } /* if */
+            } /* if */
+
+            else if ((isdir || isfile) && tarCleanName(name))
+            {
+                GOTO_IF_ERRPASS(!UNPK_addEntry(arc, name, isdir, mtime, mtime, datapos, size), failed);
+                if (ib)
+                    GOTO_IF_ERRPASS(!tarIndexAppend(ib, name, isdir, mtime, datapos, size), failed);
+            } /* else if */
+
+            tarClearPending(&pending);
+        } /* else */
+
+        /* data is padded out to a full block. */
+        pos = datapos + ((size + (TAR_BLOCKSIZE - 1)) & ~((PHYSFS_uint64) (TAR_BLOCKSIZE - 1)));
+    } /* while */
+
+    tarClearPending(&pending);
+    return 1;
+
+failed:
+    tarClearPending(&pending);
+    return 0;
+} /* tarLoadEntries */
+
+
+/* Use the index at (path) instead of scanning, if it's good. */
+static int tarLoadIndex(const char *path, const char *fname,
+                        const PHYSFS_uint64 fp, const PHYSFS_uint64 archive_len,
+                        void *arc)
+{
+    PHYSFS_Io *io = __PHYSFS_createNativeIo(path, 'r');
+    const TARindexheader *hdr;
+    PHYSFS_uint8 *buf = NULL;
+    PHYSFS_sint64 len;
+    size_t ofs;
+    PHYSFS_uint32 i;
+
+    BAIL_IF_ERRPASS(!io, 0);
+    len = io->length(io);
+    GOTO_IF_ERRPASS(len < 0, failed);
+    GOTO_IF(len < (PHYSFS_sint64) sizeof (TARindexheader), PHYSFS_ERR_CORRUPT, failed);
+    GOTO_IF(len > 0x7FFFFFFF, PHYSFS_ERR_CORRUPT, failed);
+
+    buf = (PHYSFS_uint8 *) allocator.Malloc((size_t) len);
+    GOTO_IF(!buf, PHYSFS_ERR_OUT_OF_MEMORY, failed);
+    GOTO_IF_ERRPASS(!__PHYSFS_readAll(io, buf, (size_t) len), failed);
+    io->destroy(io);
+    io = NULL;
+
+    hdr = (const TARindexheader *) buf;
+    GOTO_IF(memcmp(hdr->magic, TAR_INDEX_MAGIC, 8) != 0, PHYSFS_ERR_CORRUPT, failed);
+    GOTO_IF(hdr->version != TAR_INDEX_VERSION, PHYSFS_ERR_CORRUPT, failed);
+    GOTO_IF(hdr->endian != 0x01020304, PHYSFS_ERR_CORRUPT, failed);
+    GOTO_IF(hdr->total_len != (PHYSFS_uint64) len, PHYSFS_ERR_CORRUPT, failed);
+    GOTO_IF(hdr->fingerprint != fp, PHYSFS_ERR_CORRUPT, failed);
+    GOTO_IF(hdr->archive_len != archive_len, PHYSFS_ERR_CORRUPT, failed);
+    GOTO_IF(hdr->namelen != strlen(fname) + 1, PHYSFS_ERR_CORRUPT, failed);
+
+    ofs = sizeof (TARindexheader);
+    GOTO_IF(hdr->namelen > (size_t) len - ofs, PHYSFS_ERR_CORRUPT, failed);
+    GOTO_IF(memcmp(buf + ofs, fname, hdr->namelen) != 0, PHYSFS_ERR_CORRUPT, failed);
+    ofs += (hdr->namelen + 7) & ~((size_t) 7);
+
+    for (i = 0; i < hdr->entry_count; i++)
+    {
+        TARindexentry ie;
+        char *name;
+        size_t padded;
+
+        GOTO_IF(ofs > (size_t) len - sizeof (ie), PHYSFS_ERR_CORRUPT, failed);
+        memcpy(&ie, buf + ofs, sizeof (ie));
+        ofs += sizeof (ie);
+        padded = ((size_t) ie.namelen + 7) & ~((size_t) 7);
+        GOTO_IF((ie.namelen < 2) || (padded > (size_t) len - ofs), PHYSFS_ERR_CORRUPT, failed);
+        name = (char *) (buf + ofs);
+        GOTO_IF(name[ie.namelen - 1] != '\0', PHYSFS_ERR_CORRUPT, failed);
+        GOTO_IF(strlen(name) != ie.namelen - 1, PHYSFS_ERR_CORRUPT, failed);
+        GOTO_IF(ie.size > archive_len, PHYSFS_ERR_CORRUPT, failed);
+        GOTO_IF(ie.pos > archive_len - ie.size, PHYSFS_ERR_CORRUPT, failed);
+        ofs += padded;
+
+        GOTO_IF_ERRPASS(!UNPK_addEntry(arc, name, ie.isdir != 0, ie.mtime,
+                                       ie.mtime, ie.pos, ie.size), failed);
+    } /* for */
+
+    GOTO_IF(ofs != (size_t) len, PHYSFS_ERR_CORRUPT, failed);
+
+    allocator.Free(buf);
+    return 1;
+
+failed:
+    if (io)
+        io->destroy(io);
+    if (buf)
+        allocator.Free(buf);
+    return 0;
+} /* tarLoadIndex */
+
+
+static void tarSaveIndex(const char *path, const char *fname,
+                         const PHYSFS_uint64 fp, const PHYSFS_uint64 archive_len,
+                         TARindexbuf *ib)
+{
+    const size_t namelen = strlen(fname) + 1;
+    const size_t padded = (namelen + 7) & ~((size_t) 7);
+    const size_t total = sizeof (TARindexheader) + padded + ib->len;
+    PHYSFS_uint8 *buf = (PHYSFS_uint8 *) allocator.Malloc(total);
+    TARindexheader hdr;
+
+    if (!buf)
+        return;  /* oh well, no index this time. */
+
+    memset(&hdr, '\0', sizeof (hdr));
+    memcpy(hdr.magic, TAR_INDEX_MAGIC, 8);
+    hdr.version = TAR_INDEX_VERSION;
+    hdr.endian = 0x01020304;
+    hdr.fingerprint = fp;
+    hdr.archive_len = archive_len;
+    hdr.total_len = (PHYSFS_uint64) total;
+    hdr.namelen = (PHYSFS_uint32) namelen;
+    hdr.entry_count = ib->count;
+
+    memcpy(buf, &hdr, sizeof (hdr));
+    memset(buf + sizeof (hdr), '\0', padded);
+    memcpy(buf + sizeof (hdr), fname, namelen);
+    if (ib->len)
+        memcpy(buf + sizeof (hdr) + padded, ib->buf, ib->len);
+
+    (void) __PHYSFS_platformPublishFile(path, buf, total);
+    allocator.Free(buf);
+} /* tarSaveIndex */
+
+
+static int TAR_sniff(const void *head, PHYSFS_uint64 headlen,
+                     const void *tail, PHYSFS_uint64 taillen,
+                     PHYSFS_sint64 filelen)
+{
+    (void) tail; (void) taillen; (void) filelen;
+    if (headlen < TAR_BLOCKSIZE)
+        return 0;
+    return tarChecksumOkay((const PHYSFS_uint8 *) head);
+} /* TAR_sniff */
+
+
+static void *TAR_openArchive(PHYSFS_Io *io, const char *name,
+                             int forWriting, int *claimed)
+{
+    const char *native = __PHYSFS_nativeIoPath(io);
+    PHYSFS_uint8 hdr[TAR_BLOCKSIZE];
+    TARindexbuf ib;
+    char *indexpath = NULL;
+    char *indexkey = NULL;
+    PHYSFS_uint64 fp = 0;
+    PHYSFS_sint64 len;
+    void *unpkarc = NULL;
+
+    assert(io != NULL);  /* shouldn't ever happen. */
+
+    BAIL_IF(forWriting, PHYSFS_ERR_READ_ONLY, NULL);
+
+    len = io->length(io);
+    BAIL_IF_ERRPASS(len < 0, NULL);
+    BAIL_IF(len < TAR_BLOCKSIZE, PHYSFS_ERR_UNSUPPORTED, NULL);
+    BAIL_IF_ERRPASS(!__PHYSFS_readAll(io, hdr, sizeof (hdr)), NULL);
+    BAIL_IF(!tarChecksumOkay(hdr), PHYSFS_ERR_UNSUPPORTED, NULL);
+
+    *claimed = 1;
+
+    unpkarc = UNPK_openArchive(io);
+    BAIL_IF_ERRPASS(!unpkarc, NULL);
+
+    /* a file on disk that we've indexed before? */
+    if ((native != NULL) && __PHYSFS_platformFingerprint(native, &fp))
+    {
+        indexpath = __PHYSFS_archiveIndexPath(native, "taridx", &indexkey);
+        if (indexpath != NULL)
+        {
+            if (tarLoadIndex(indexpath, indexkey, fp, (PHYSFS_uint64) len, unpkarc))
+            {
+                allocator.Free(indexpath);
+                allocator.Free(indexkey);
+                return unpkarc;  /* no scan needed! */
+            } /* if */
+
+            /* a bad index might have added some entries; start over. */
+            UNPK_abandonArchive(unpkarc);
+            unpkarc = UNPK_openArchive(io);
+            GOTO_IF_ERRPASS(!unpkarc, failed);
+        } /* if */
+    } /* if */
+
+    memset(&ib, '\0', sizeof (ib));
+    if (!tarLoadEntries(io, (PHYSFS_uint64) len, unpkarc, indexpath ? &ib : NULL))
+    {
+        allocator.Free(ib.buf);
+        goto failed;
+    } /* if */
+
+    if (indexpath != NULL)
+    {
+        tarSaveIndex(indexpath, indexkey, fp, (PHYSFS_uint64) len, &ib);
+        allocator.Free(indexpath);
+        allocator.Free(indexkey);
+        allocator.Free(ib.buf);
+    } /* if */
+
+    return unpkarc;
+
+failed:
+    if (indexpath)
+    {
+        allocator.Free(indexpath);
+        allocator.Free(indexkey);
+    } /* if */
+    if (unpkarc)
+        UNPK_abandonArchive(unpkarc);
+    return NULL;
+} /* TAR_openArchive */
+
+
+const PHYSFS_Archiver __PHYSFS_Archiver_TAR =
+{
+    CURRENT_PHYSFS_ARCHIVER_API_VERSION,
+    {
+        "TAR",
+        "POSIX tar archives",
+        "The PhysicsFS contributors",
+        "https://icculus.org/physfs/",
+        0,  /* supportsSymlinks */
+    },
+    TAR_openArchive,
+    UNPK_enumerate,
+    UNPK_openRead,
+    UNPK_openWrite,
+    UNPK_openAppend,
+    UNPK_remove,
+    UNPK_mkdir,
+    UNPK_stat,
+    UNPK_closeArchive,
+    NULL,  /* fingerprint */
+    NULL,  /* refresh */
+    TAR_sniff
+};
+
+#endif  /* defined PHYSFS_SUPPORTS_TAR */
+
+/* end of physfs_archiver_tar.c ... */
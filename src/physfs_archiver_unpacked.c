@@ -31,13 +31,6 @@ typedef struct
     PHYSFS_sint64 mtime;
 } UNPKentry;
 
-typedef struct
-{
-    PHYSFS_Io *io;
-    UNPKentry *entry;
-    PHYSFS_uint32 curPos;
-} UNPKfileinfo;
-
 
 void UNPK_closeArchive(void *opaque)
 {
@@ -63,156 +56,42 @@ void UNPK_abandonArchive(void *opaque)
     } /* if */
 } /* UNPK_abandonArchive */
 
-static PHYSFS_sint64 UNPK_read(PHYSFS_Io *io, void *buffer, PHYSFS_uint64 len)
-{
-    UNPKfileinfo *finfo = (UNPKfileinfo *) io->opaque;
-    const UNPKentry *entry = finfo->entry;
-    const PHYSFS_uint64 bytesLeft = (PHYSFS_uint64)(entry->size-finfo->curPos);
-    PHYSFS_sint64 rc;
-
-    if (bytesLeft < len)
-        len = bytesLeft;
-
-    rc = finfo->io->read(finfo->io, buffer, len);
-    if (rc > 0)
-        finfo->curPos += (PHYSFS_uint32) rc;
-
-    return rc;
-} /* UNPK_read */
-
-
-static PHYSFS_sint64 UNPK_write(PHYSFS_Io *io, const void *b, PHYSFS_uint64 len)
-{
-    BAIL(PHYSFS_ERR_READ_ONLY, -1);
-} /* UNPK_write */
-
 
-static PHYSFS_sint64 UNPK_tell(PHYSFS_Io *io)
+static inline UNPKentry *findEntry(UNPKinfo *info, const char *path,
+                                   const PHYSFS_uint32 hash)
 {
-    return ((UNPKfileinfo *) io->opaque)->curPos;
-} /* UNPK_tell */
-
-
-static int UNPK_seek(PHYSFS_Io *io, PHYSFS_uint64 offset)
-{
-    UNPKfileinfo *finfo = (UNPKfileinfo *) io->opaque;
-    const UNPKentry *entry = finfo->entry;
-    int rc;
-
-    BAIL_IF(offset >= entry->size, PHYSFS_ERR_PAST_EOF, 0);
-    rc = finfo->io->seek(finfo->io, entry->startPos + offset);
-    if (rc)
-        finfo->curPos = (PHYSFS_uint32) offset;
-
-    return rc;
-} /* UNPK_seek */
-
-
-static PHYSFS_sint64 UNPK_length(PHYSFS_Io *io)
-{
-    const UNPKfileinfo *finfo = (UNPKfileinfo *) io->opaque;
-    return ((PHYSFS_sint64) finfo->entry->size);
-} /* UNPK_length */
-
-
-static PHYSFS_Io *UNPK_duplicate(PHYSFS_Io *_io)
-{
-    UNPKfileinfo *origfinfo = (UNPKfileinfo *) _io->opaque;
-    PHYSFS_Io *io = NULL;
-    PHYSFS_Io *retval = (PHYSFS_Io *) allocator.Malloc(sizeof (PHYSFS_Io));
-    UNPKfileinfo *finfo = (UNPKfileinfo *) allocator.Malloc(sizeof (UNPKfileinfo));
-    GOTO_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, UNPK_duplicate_failed);
-    GOTO_IF(!finfo, PHYSFS_ERR_OUT_OF_MEMORY, UNPK_duplicate_failed);
-
-    io = origfinfo->io->duplicate(origfinfo->io);
-    if (!io) goto UNPK_duplicate_failed;
-    finfo->io = io;
-    finfo->entry = origfinfo->entry;
-    finfo->curPos = 0;
-    memcpy(retval, _io, sizeof (PHYSFS_Io));
-    retval->opaque = finfo;
-    return retval;
-
-UNPK_duplicate_failed:
-    if (finfo != NULL) allocator.Free(finfo);
-    if (retval != NULL) allocator.Free(retval);
-    if (io != NULL) io->destroy(io);
-    return NULL;
-} /* UNPK_duplicate */
-
-static int UNPK_flush(PHYSFS_Io *io) { return 1;  /* no write support. */ }
-
-static void UNPK_destroy(PHYSFS_Io *io)
-{
-    UNPKfileinfo *finfo = (UNPKfileinfo *) io->opaque;
-    finfo->io->destroy(finfo->io);
-    allocator.Free(finfo);
-    allocator.Free(io);
-} /* UNPK_destroy */
+    return (UNPKentry *) __PHYSFS_DirTreeFindHashed(&info->tree, path, hash);
+} /* findEntry */
 
 
-static const PHYSFS_Io UNPK_Io =
-{
-    CURRENT_PHYSFS_IO_API_VERSION, NULL,
-    UNPK_read,
-    UNPK_write,
-    UNPK_seek,
-    UNPK_tell,
-    UNPK_length,
-    UNPK_duplicate,
-    UNPK_flush,
-    UNPK_destroy
-};
-
-
-static inline UNPKentry *findEntry(UNPKinfo *info, const char *path)
+PHYSFS_Io *UNPK_openRead(void *opaque, const char *name)
 {
-    return (UNPKentry *) __PHYSFS_DirTreeFind(&info->tree, path);
-} /* findEntry */
+    return UNPK_openReadHashed(opaque, name,
+                               __PHYSFS_hashString(name, strlen(name)));
+} /* UNPK_openRead */
 
 
-PHYSFS_Io *UNPK_openRead(void *opaque, const char *name)
+PHYSFS_Io *UNPK_openReadHashed(void *opaque, const char *name,
+                               const PHYSFS_uint32 hash)
 {
     PHYSFS_Io *retval = NULL;
     UNPKinfo *info = (UNPKinfo *) opaque;
-    UNPKfileinfo *finfo = NULL;
-    UNPKentry *entry = findEntry(info, name);
+    UNPKentry *entry = findEntry(info, name, hash);
+    PHYSFS_Io *io = NULL;
 
     BAIL_IF_ERRPASS(!entry, NULL);
     BAIL_IF(entry->tree.isdir, PHYSFS_ERR_NOT_A_FILE, NULL);
 
-    retval = (PHYSFS_Io *) allocator.Malloc(sizeof (PHYSFS_Io));
-    GOTO_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, UNPK_openRead_failed);
-
-    finfo = (UNPKfileinfo *) allocator.Malloc(sizeof (UNPKfileinfo));
-    GOTO_IF(!finfo, PHYSFS_ERR_OUT_OF_MEMORY, UNPK_openRead_failed);
-
-    finfo->io = info->io->duplicate(info->io);
-    GOTO_IF_ERRPASS(!finfo->io, UNPK_openRead_failed);
+    io = info->io->duplicate(info->io);
+    BAIL_IF_ERRPASS(!io, NULL);
 
-    if (!finfo->io->seek(finfo->io, entry->startPos))
-        goto UNPK_openRead_failed;
+    /* entries are stored as-is, so a window of the archive is all we need. */
+    retval = __PHYSFS_createSubIo(io, entry->startPos, entry->size);
+    if (!retval)
+        io->destroy(io);
 
-    finfo->curPos = 0;
-    finfo->entry = entry;
-
-    memcpy(retval, &UNPK_Io, sizeof (*retval));
-    retval->opaque = finfo;
     return retval;
-
-UNPK_openRead_failed:
-    if (finfo != NULL)
-    {
-        if (finfo->io != NULL)
-            finfo->io->destroy(finfo->io);
-        allocator.Free(finfo);
-    } /* if */
-
-    if (retval != NULL)
-        allocator.Free(retval);
-
-    return NULL;
-} /* UNPK_openRead */
+} /* UNPK_openReadHashed */
 
 
 PHYSFS_Io *UNPK_openWrite(void *opaque, const char *name)
@@ -240,9 +119,17 @@ int UNPK_mkdir(void *opaque, const char *name)
 
 
 int UNPK_stat(void *opaque, const char *path, PHYSFS_Stat *stat)
+{
+    return UNPK_statHashed(opaque, path,
+                           __PHYSFS_hashString(path, strlen(path)), stat);
+} /* UNPK_stat */
+
+
+int UNPK_statHashed(void *opaque, const char *path, const PHYSFS_uint32 hash,
+                    PHYSFS_Stat *stat)
 {
     UNPKinfo *info = (UNPKinfo *) opaque;
-    const UNPKentry *entry = findEntry(info, path);
+    const UNPKentry *entry = findEntry(info, path, hash);
 
     BAIL_IF_ERRPASS(!entry, 0);
 
@@ -263,7 +150,7 @@ int UNPK_stat(void *opaque, const char *path, PHYSFS_Stat *stat)
     stat->readonly = 1;
 
     return 1;
-} /* UNPK_stat */
+} /* UNPK_statHashed */
 
 
 void *UNPK_addEntry(void *opaque, char *name, const int isdir,
@@ -93,6 +93,19 @@ static int vdfLoadEntries(PHYSFS_Io *io, const PHYSFS_uint32 count,
 } /* vdfLoadEntries */
 
 
+static int VDF_sniff(const void *head, PHYSFS_uint64 headlen,
+                     const void *tail, PHYSFS_uint64 taillen,
+                     PHYSFS_sint64 filelen)
+{
+    const PHYSFS_uint8 *sig = ((const PHYSFS_uint8 *) head) + VDF_COMMENT_LENGTH;
+    (void) tail; (void) taillen; (void) filelen;
+    if (headlen < VDF_COMMENT_LENGTH + VDF_SIGNATURE_LENGTH)
+        return 0;
+    return (memcmp(sig, VDF_SIGNATURE_G1, VDF_SIGNATURE_LENGTH) == 0) ||
+           (memcmp(sig, VDF_SIGNATURE_G2, VDF_SIGNATURE_LENGTH) == 0);
+} /* VDF_sniff */
+
+
 static void *VDF_openArchive(PHYSFS_Io *io, const char *name,
                              int forWriting, int *claimed)
 {
@@ -160,7 +173,10 @@ const PHYSFS_Archiver __PHYSFS_Archiver_VDF =
     UNPK_remove,
     UNPK_mkdir,
     UNPK_stat,
-    UNPK_closeArchive
+    UNPK_closeArchive,
+    NULL,  /* fingerprint */
+    NULL,  /* refresh */
+    VDF_sniff
 };
 
 #endif /* defined PHYSFS_SUPPORTS_VDF */
@@ -70,6 +70,17 @@ static int wadLoadEntries(PHYSFS_Io *io, const PHYSFS_uint32 count, void *arc)
 } /* wadLoadEntries */
 
 
+static int WAD_sniff(const void *head, PHYSFS_uint64 headlen,
+                     const void *tail, PHYSFS_uint64 taillen,
+                     PHYSFS_sint64 filelen)
+{
+    (void) tail; (void) taillen; (void) filelen;
+    if (headlen < 4)
+        return 0;
+    return (memcmp(head, "IWAD", 4) == 0) || (memcmp(head, "PWAD", 4) == 0);
+} /* WAD_sniff */
+
+
 static void *WAD_openArchive(PHYSFS_Io *io, const char *name,
                              int forWriting, int *claimed)
 {
@@ -126,7 +137,10 @@ const PHYSFS_Archiver __PHYSFS_Archiver_WAD =
     UNPK_remove,
     UNPK_mkdir,
     UNPK_stat,
-    UNPK_closeArchive
+    UNPK_closeArchive,
+    NULL,  /* fingerprint */
+    NULL,  /* refresh */
+    WAD_sniff
 };
 
 #endif  /* defined PHYSFS_SUPPORTS_WAD */
@@ -7,6 +7,18 @@
  *   by Gilles Vollant.
  */
 
+/* zstd's vector headers may use malloc(), which physfs_internal.h won't allow. */
+#if !defined(PHYSFS_SUPPORTS_ZIP_ZSTD) || PHYSFS_SUPPORTS_ZIP_ZSTD
+#if defined(__AVX2__) || defined(__BMI__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
+#endif
+
 #define __PHYSICSFS_INTERNAL__
 #include "physfs_internal.h"
 
@@ -17,6 +29,10 @@
 
 #include "physfs_miniz.h"
 
+#if PHYSFS_SUPPORTS_ZIP_ZSTD
+#include "physfs_zstd.h"
+#endif
+
 /*
  * A buffer of ZIP_READBUFSIZE is allocated for each compressed file opened,
  *  and is freed when you close the file; compressed data is read into
@@ -70,8 +86,63 @@ typedef struct _ZIPentry
     PHYSFS_uint64 uncompressed_size;    /* uncompressed size              */
     PHYSFS_sint64 last_mod_time;        /* last file mod time             */
     PHYSFS_uint32 dos_mod_time;         /* original MS-DOS style mod time */
+    PHYSFS_uint32 aes_strength;         /* WinZip AES: 1-3, 0 if not AES  */
 } ZIPentry;
 
+/*
+ * A shared index (see PHYSFS_setArchiveIndexDir()) is one file that gets
+ *  mapped read-only into every process that mounts the archive: a
+ *  ZIPindexheader, the archive's path, a hash table, an array of
+ *  ZIPindexentry (the root first) and a block of entry names. Entries
+ *  refer to each other by array index instead of by pointer, so the same
+ *  bytes work wherever they're mapped. Everything in an index is already
+ *  resolved, since nobody can write to it later.
+ */
+#define ZIP_INDEX_MAGIC "PHYSFSZI"
+#define ZIP_INDEX_VERSION 2
+#define ZIP_INDEX_NONE 0xFFFFFFFF
+
+typedef struct
+{
+    char magic[8];                      /* ZIP_INDEX_MAGIC                */
+    PHYSFS_uint32 version;              /* ZIP_INDEX_VERSION              */
+    PHYSFS_uint32 endian;               /* 0x01020304, native order       */
+    PHYSFS_uint32 entrylen;             /* sizeof (ZIPindexentry)         */
+    PHYSFS_uint32 namelen;              /* archive path, with the null    */
+    PHYSFS_uint64 fingerprint;          /* the archive's, when indexed    */
+    PHYSFS_uint64 archive_len;          /* the archive's size, ditto      */
+    PHYSFS_uint64 total_len;            /* size of this whole file        */
+    PHYSFS_uint32 zip64;                /* ZIPinfo::zip64                 */
+    PHYSFS_uint32 has_crypto;           /* ZIPinfo::has_crypto            */
+    PHYSFS_uint32 entry_count;          /* entries, including the root    */
+    PHYSFS_uint32 bucket_count;         /* hash table size                */
+    PHYSFS_uint64 buckets_ofs;          /* where the hash table starts    */
+    PHYSFS_uint64 entries_ofs;          /* where the entries start        */
+    PHYSFS_uint64 names_ofs;            /* where the names start          */
+} ZIPindexheader;
+
+typedef struct
+{
+    PHYSFS_uint32 name;                 /* offset in the name block       */
+    PHYSFS_uint32 hashnext;             /* next entry in the same bucket  */
+    PHYSFS_uint32 children;             /* first child, if a directory    */
+    PHYSFS_uint32 sibling;              /* next entry in same directory   */
+    PHYSFS_uint32 symlink;              /* final target, if a symlink     */
+    PHYSFS_uint32 resolved;             /* ZipResolveType                 */
+    PHYSFS_uint32 isdir;                /* non-zero for directories       */
+    PHYSFS_uint32 crc;                  /* crc-32                         */
+    PHYSFS_uint64 offset;               /* offset of data in archive      */
+    PHYSFS_uint64 compressed_size;      /* compressed size                */
+    PHYSFS_uint64 uncompressed_size;    /* uncompressed size              */
+    PHYSFS_sint64 last_mod_time;        /* last file mod time             */
+    PHYSFS_uint32 dos_mod_time;         /* original MS-DOS style mod time */
+    PHYSFS_uint16 version;              /* version made by                */
+    PHYSFS_uint16 version_needed;       /* version needed to extract      */
+    PHYSFS_uint16 general_bits;         /* general purpose bits           */
+    PHYSFS_uint16 compression_method;   /* compression method             */
+    PHYSFS_uint32 aes_strength;         /* WinZip AES: 1-3, 0 if not AES  */
+} ZIPindexentry;
+
 /*
  * One ZIPinfo is kept for each open ZIP archive.
  */
@@ -81,6 +152,17 @@ typedef struct
     PHYSFS_Io *io;            /* the i/o interface for this archive.    */
     int zip64;                /* non-zero if this is a Zip64 archive.   */
     int has_crypto;           /* non-zero if any entry uses encryption. */
+    PHYSFS_uint64 data_start;     /* bytes of junk before the zip data. */
+    PHYSFS_uint64 cdir_ofs;       /* where the central directory is.    */
+    PHYSFS_uint64 cdir_loaded;    /* bytes of it we've made entries of. */
+    PHYSFS_uint64 entries_loaded; /* number of records we've loaded.    */
+    PHYSFS_uint64 append_ofs;     /* new entries' data must start here. */
+    PHYSFS_uint64 last_record;    /* where the last record we have is.  */
+    PHYSFS_uint32 last_hash;      /* hash of that record's bytes.       */
+    const ZIPindexheader *index;  /* shared index, if (tree) is unused. */
+    PHYSFS_uint64 index_len;      /* bytes mapped at (index).           */
+    int has_fingerprint;          /* non-zero if it's a file on disk.   */
+    PHYSFS_uint64 fingerprint;    /* the archive file's, if so.         */
 } ZIPinfo;
 
 /*
@@ -90,12 +172,22 @@ typedef struct
 {
     ZIPentry *entry;                      /* Info on file.              */
     PHYSFS_Io *io;                        /* physical file handle.      */
-    PHYSFS_uint32 compressed_position;    /* offset in compressed data. */
-    PHYSFS_uint32 uncompressed_position;  /* tell() position.           */
+    PHYSFS_uint64 compressed_position;    /* offset in compressed data. */
+    PHYSFS_uint64 uncompressed_position;  /* tell() position.           */
     PHYSFS_uint8 *buffer;                 /* decompression buffer.      */
     PHYSFS_uint32 crypto_keys[3];         /* for "traditional" crypto.  */
     PHYSFS_uint32 initial_crypto_keys[3]; /* for "traditional" crypto.  */
+    __PHYSFS_AESContext aes;              /* for WinZip AES crypto.     */
+    __PHYSFS_HMACSHA1Context hmac;        /* authenticates AES data.    */
+    PHYSFS_uint64 crypt_pos;              /* AES data offset of (io).   */
+    PHYSFS_uint64 mac_pos;                /* AES data authenticated.    */
+    int mac_state;                 /* 1 if it all was, -1 if bad. */
     z_stream stream;                      /* zlib stream state.         */
+#if PHYSFS_SUPPORTS_ZIP_ZSTD
+    ZSTD_DStream *zstream;                /* zstd stream state.         */
+    ZSTD_inBuffer zin;                    /* zstd's view of (buffer).   */
+#endif
+    ZIPentry entrycopy;                   /* (entry) if from an index.  */
 } ZIPfileinfo;
 
 
@@ -106,9 +198,12 @@ typedef struct
 #define ZIP64_END_OF_CENTRAL_DIR_SIG                0x06064b50
 #define ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIG  0x07064b50
 #define ZIP64_EXTENDED_INFO_EXTRA_FIELD_SIG         0x0001
+#define ZIP_AES_EXTRA_FIELD_SIG                     0x9901
 
 /* compression methods... */
 #define COMPMETH_NONE 0
+#define COMPMETH_ZSTD 93
+#define COMPMETH_AES 99  /* WinZip AES; the real method is in an extra field. */
 /* ...and others... */
 
 
@@ -118,12 +213,30 @@ typedef struct
 #define ZIP_GENERAL_BITS_TRADITIONAL_CRYPTO   (1 << 0)
 #define ZIP_GENERAL_BITS_IGNORE_LOCAL_HEADER  (1 << 3)
 
+static int zip_entry_is_zstd(const ZIPentry *entry)
+{
+    return (entry->compression_method == COMPMETH_ZSTD);
+} /* zip_entry_is_zstd */
+
+/* WinZip AES entries set the encryption bit, too. */
+static int zip_entry_is_aes(const ZIPentry *entry)
+{
+    return (entry->aes_strength != 0);
+} /* zip_entry_is_aes */
+
 /* support for "traditional" PKWARE encryption. */
 static int zip_entry_is_tradional_crypto(const ZIPentry *entry)
 {
+    if (zip_entry_is_aes(entry))
+        return 0;
     return (entry->general_bits & ZIP_GENERAL_BITS_TRADITIONAL_CRYPTO) != 0;
 } /* zip_entry_is_traditional_crypto */
 
+static int zip_entry_is_encrypted(const ZIPentry *entry)
+{
+    return zip_entry_is_tradional_crypto(entry) || zip_entry_is_aes(entry);
+} /* zip_entry_is_encrypted */
+
 static int zip_entry_ignore_local_header(const ZIPentry *entry)
 {
     return (entry->general_bits & ZIP_GENERAL_BITS_IGNORE_LOCAL_HEADER) != 0;
@@ -152,13 +265,156 @@ static PHYSFS_uint8 zip_decrypt_byte(const PHYSFS_uint32 *keys)
     return (PHYSFS_uint8) ((tmp * (tmp ^ 1)) >> 8);
 } /* zip_decrypt_byte */
 
+/*
+ * Support for WinZip AES encryption (AE-1 and AE-2). An entry's data is a
+ *  salt, a two byte password verifier, the encrypted data and a ten byte
+ *  HMAC-SHA1 of the encrypted data; the keys come from the password and
+ *  salt with PBKDF2. The data is AES in counter mode, so we can start
+ *  decrypting anywhere without touching what comes before it. The HMAC is
+ *  kept up as the data goes by: a read that picks up where the
+ *  authenticated part ends extends it, and the read that completes it
+ *  fails if the result doesn't match. Reads that skip ahead are returned
+ *  unauthenticated until something reads the part they skipped.
+ */
+#define ZIP_AES_VERIFIER_LEN 2
+#define ZIP_AES_MAC_LEN 10
+#define ZIP_AES_PBKDF2_ITERATIONS 1000
+
+static size_t zip_aes_key_len(const ZIPentry *entry)
+{
+    return (size_t) (8 * (entry->aes_strength + 1));  /* 16, 24 or 32. */
+} /* zip_aes_key_len */
+
+static size_t zip_aes_salt_len(const ZIPentry *entry)
+{
+    return zip_aes_key_len(entry) / 2;
+} /* zip_aes_salt_len */
+
+/* bytes between the start of an entry's data and what we decrypt. */
+static PHYSFS_uint64 zip_crypto_header_len(const ZIPentry *entry)
+{
+    if (zip_entry_is_aes(entry))
+        return zip_aes_salt_len(entry) + ZIP_AES_VERIFIER_LEN;
+    else if (zip_entry_is_tradional_crypto(entry))
+        return 12;
+    return 0;
+} /* zip_crypto_header_len */
+
+/* bytes of (possibly encrypted) compressed data to read for an entry. */
+static PHYSFS_uint64 zip_compressed_data_len(const ZIPentry *entry)
+{
+    if (zip_entry_is_aes(entry))
+    {
+        const PHYSFS_uint64 extra = zip_crypto_header_len(entry) + ZIP_AES_MAC_LEN;
+        if (entry->compressed_size < extra)
+            return 0;
+        return entry->compressed_size - extra;
+    } /* if */
+
+    return entry->compressed_size;
+} /* zip_compressed_data_len */
+
+/* Everything has gone through the HMAC; compare it to the stored one. */
+static int zip_aes_check_mac(ZIPfileinfo *finfo)
+{
+    const ZIPentry *entry = finfo->entry;
+    PHYSFS_Io *io = finfo->io;
+    const PHYSFS_sint64 pos = io->tell(io);
+    PHYSFS_uint8 stored[ZIP_AES_MAC_LEN];
+    PHYSFS_uint8 digest[20];
+
+    BAIL_IF_ERRPASS(pos == -1, 0);
+    BAIL_IF_ERRPASS(!io->seek(io, entry->offset + zip_crypto_header_len(entry)
+                                  + zip_compressed_data_len(entry)), 0);
+    BAIL_IF_ERRPASS(!__PHYSFS_readAll(io, stored, sizeof (stored)), 0);
+    BAIL_IF_ERRPASS(!io->seek(io, (PHYSFS_uint64) pos), 0);
+
+    __PHYSFS_HMACSHA1Final(&finfo->hmac, digest);
+    finfo->mac_state = (memcmp(digest, stored, sizeof (stored)) == 0) ? 1 : -1;
+    BAIL_IF(finfo->mac_state < 0, PHYSFS_ERR_CORRUPT, 0);
+    return 1;
+} /* zip_aes_check_mac */
+
+static int zip_prep_aes(ZIPfileinfo *finfo, const PHYSFS_uint8 *password)
+{
+    const ZIPentry *entry = finfo->entry;
+    const size_t keylen = zip_aes_key_len(entry);
+    const size_t saltlen = zip_aes_salt_len(entry);
+    PHYSFS_uint8 salt[16];
+    PHYSFS_uint8 verifier[ZIP_AES_VERIFIER_LEN];
+    PHYSFS_uint8 keys[(32 * 2) + ZIP_AES_VERIFIER_LEN];
+    int okay;
+
+    BAIL_IF(entry->compressed_size < zip_crypto_header_len(entry) + ZIP_AES_MAC_LEN,
+            PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF((entry->compression_method == COMPMETH_NONE) &&
+            (entry->uncompressed_size != zip_compressed_data_len(entry)),
+            PHYSFS_ERR_CORRUPT, 0);
+
+    BAIL_IF_ERRPASS(!__PHYSFS_readAll(finfo->io, salt, saltlen), 0);
+    BAIL_IF_ERRPASS(!__PHYSFS_readAll(finfo->io, verifier, sizeof (verifier)), 0);
+
+    /* one key for AES, one for the HMAC, then the password verifier. */
+    __PHYSFS_PBKDF2SHA1(password, strlen((const char *) password),
+                        salt, saltlen, ZIP_AES_PBKDF2_ITERATIONS,
+                        keys, (keylen * 2) + ZIP_AES_VERIFIER_LEN);
+
+    okay = (memcmp(keys + (keylen * 2), verifier, sizeof (verifier)) == 0);
+    if (okay)
+    {
+        __PHYSFS_AESInit(&finfo->aes, keys, keylen);
+        __PHYSFS_HMACSHA1Init(&finfo->hmac, keys + keylen, keylen);
+    } /* if */
+    memset(keys, '\0', sizeof (keys));
+
+    /* you have a 1/65536 chance of passing this test incorrectly. */
+    BAIL_IF(!okay, PHYSFS_ERR_BAD_PASSWORD, 0);
+
+    finfo->crypt_pos = finfo->mac_pos = 0;
+    finfo->mac_state = 0;
+    if (zip_compressed_data_len(entry) == 0)  /* nothing to wait for. */
+        return zip_aes_check_mac(finfo);
+
+    return 1;
+} /* zip_prep_aes */
+
 static PHYSFS_sint64 zip_read_decrypt(ZIPfileinfo *finfo, void *buf, PHYSFS_uint64 len)
 {
     PHYSFS_Io *io = finfo->io;
-    const PHYSFS_sint64 br = io->read(io, buf, len);
+    PHYSFS_sint64 br;
+
+    BAIL_IF(finfo->mac_state < 0, PHYSFS_ERR_CORRUPT, -1);
+
+    br = io->read(io, buf, len);
+
+    if (zip_entry_is_aes(finfo->entry) && (br > 0))
+    {
+        PHYSFS_uint8 *ptr = (PHYSFS_uint8 *) buf;
+        const PHYSFS_uint64 pos = finfo->crypt_pos;
+        const PHYSFS_uint64 end = pos + (PHYSFS_uint64) br;
+
+        /* the HMAC covers the encrypted bytes, so feed it before decrypting. */
+        if ((finfo->mac_state == 0) && (pos <= finfo->mac_pos) &&
+            (end > finfo->mac_pos))
+        {
+            const size_t skip = (size_t) (finfo->mac_pos - pos);
+            __PHYSFS_HMACSHA1Update(&finfo->hmac, ptr + skip,
+                                    ((size_t) br) - skip);
+            finfo->mac_pos = end;
+        } /* if */
+
+        __PHYSFS_AESCTRWinZip(&finfo->aes, pos, ptr, (size_t) br);
+        finfo->crypt_pos = end;
+
+        if ((finfo->mac_state == 0) &&
+            (finfo->mac_pos == zip_compressed_data_len(finfo->entry)))
+        {
+            BAIL_IF_ERRPASS(!zip_aes_check_mac(finfo), -1);
+        } /* if */
+    } /* if */
 
     /* Decompression the new data if necessary. */
-    if (zip_entry_is_tradional_crypto(finfo->entry) && (br > 0))
+    else if (zip_entry_is_tradional_crypto(finfo->entry) && (br > 0))
     {
         PHYSFS_uint32 *keys = finfo->crypto_keys;
         PHYSFS_uint8 *ptr = (PHYSFS_uint8 *) buf;
@@ -264,6 +520,39 @@ static int zlib_err(const int rc)
     return rc;
 } /* zlib_err */
 
+
+#if PHYSFS_SUPPORTS_ZIP_ZSTD
+/*
+ * Bridge physfs allocation functions to zstd's format...
+ */
+static void *zstdPhysfsAlloc(void *opaque, size_t size)
+{
+    return ((PHYSFS_Allocator *) opaque)->Malloc((PHYSFS_uint64) size);
+} /* zstdPhysfsAlloc */
+
+static void zstdPhysfsFree(void *opaque, void *address)
+{
+    ((PHYSFS_Allocator *) opaque)->Free(address);
+} /* zstdPhysfsFree */
+
+static const ZSTD_customMem zstdPhysfsMem =
+{
+    zstdPhysfsAlloc, zstdPhysfsFree, &allocator
+};
+
+
+static PHYSFS_ErrorCode zstd_error_code(const size_t rc)
+{
+    switch (ZSTD_getErrorCode(rc))
+    {
+        case ZSTD_error_no_error: return PHYSFS_ERR_OK;
+        case ZSTD_error_memory_allocation: return PHYSFS_ERR_OUT_OF_MEMORY;
+        case ZSTD_error_frameParameter_windowTooLarge: return PHYSFS_ERR_UNSUPPORTED;
+        default: return PHYSFS_ERR_CORRUPT;
+    } /* switch */
+} /* zstd_error_code */
+#endif
+
 /*
  * Read an unsigned 64-bit int and swap to native byte order.
  */
@@ -299,6 +588,156 @@ static int readui16(PHYSFS_Io *io, PHYSFS_uint16 *val)
 } /* readui16 */
 
 
+/*
+ * Set up (finfo) to decompress its entry: a buffer for the compressed data,
+ *  and a zlib or zstd stream, depending on the compression method.
+ */
+static int zip_init_decompressor(ZIPfileinfo *finfo)
+{
+    initializeZStream(&finfo->stream);
+    if (finfo->entry->compression_method == COMPMETH_NONE)
+        return 1;  /* nothing to do. */
+
+    finfo->buffer = (PHYSFS_uint8 *) allocator.Malloc(ZIP_READBUFSIZE);
+    BAIL_IF(!finfo->buffer, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+
+#if PHYSFS_SUPPORTS_ZIP_ZSTD
+    if (zip_entry_is_zstd(finfo->entry))
+    {
+        finfo->zstream = ZSTD_createDStream_advanced(zstdPhysfsMem);
+        BAIL_IF(!finfo->zstream, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        finfo->zin.src = finfo->buffer;
+        finfo->zin.size = finfo->zin.pos = 0;
+        return 1;
+    } /* if */
+#else
+    BAIL_IF(zip_entry_is_zstd(finfo->entry), PHYSFS_ERR_UNSUPPORTED, 0);
+#endif
+
+    return (zlib_err(inflateInit2(&finfo->stream, -MAX_WBITS)) == Z_OK);
+} /* zip_init_decompressor */
+
+
+/* Undo zip_init_decompressor(); safe on a partially-initialized (finfo). */
+static void zip_free_decompressor(ZIPfileinfo *finfo)
+{
+#if PHYSFS_SUPPORTS_ZIP_ZSTD
+    if (finfo->zstream != NULL)
+        ZSTD_freeDStream(finfo->zstream);
+#endif
+
+    if (finfo->buffer != NULL)
+    {
+        allocator.Free(finfo->buffer);
+        inflateEnd(&finfo->stream);
+    } /* if */
+} /* zip_free_decompressor */
+
+
+/*
+ * Seek (finfo->io) back to the start of the compressed data, and reset
+ *  the decompressor to match. Leaves things alone if this fails.
+ */
+static int zip_rewind_decompressor(ZIPfileinfo *finfo)
+{
+    PHYSFS_Io *io = finfo->io;
+    const ZIPentry *entry = finfo->entry;
+    const PHYSFS_uint64 pos = entry->offset + zip_crypto_header_len(entry);
+
+#if PHYSFS_SUPPORTS_ZIP_ZSTD
+    if (finfo->zstream != NULL)
+    {
+        BAIL_IF_ERRPASS(!io->seek(io, pos), 0);
+        ZSTD_DCtx_reset(finfo->zstream, ZSTD_reset_session_only);
+        finfo->zin.size = finfo->zin.pos = 0;
+    } /* if */
+    else
+#endif
+    {
+        /* we do a copy so state is sane if inflateInit2() fails. */
+        z_stream str;
+        initializeZStream(&str);
+        if (zlib_err(inflateInit2(&str, -MAX_WBITS)) != Z_OK)
+            return 0;
+
+        if (!io->seek(io, pos))
+        {
+            inflateEnd(&str);
+            return 0;
+        } /* if */
+
+        inflateEnd(&finfo->stream);
+        memcpy(&finfo->stream, &str, sizeof (z_stream));
+    } /* else */
+
+    return 1;
+} /* zip_rewind_decompressor */
+
+
+#if PHYSFS_SUPPORTS_ZIP_ZSTD
+static PHYSFS_sint64 zip_read_zstd(ZIPfileinfo *finfo, void *buf,
+                                   PHYSFS_sint64 maxread)
+{
+    const PHYSFS_uint64 complen = zip_compressed_data_len(finfo->entry);
+    ZSTD_outBuffer out;
+
+    out.dst = buf;
+    out.size = (size_t) maxread;
+    out.pos = 0;
+
+    while (out.pos < out.size)
+    {
+        const size_t before = out.pos;
+        size_t rc;
+
+        if (finfo->zin.pos == finfo->zin.size)
+        {
+            PHYSFS_sint64 br = complen - finfo->compressed_position;
+            if (br > 0)
+            {
+                if (br > ZIP_READBUFSIZE)
+                    br = ZIP_READBUFSIZE;
+
+                br = zip_read_decrypt(finfo, finfo->buffer, (PHYSFS_uint64) br);
+                if (br <= 0)
+                {
+                    if ((br < 0) && (out.pos == 0))
+                        return -1;  /* don't look like EOF. */
+                    break;
+                } /* if */
+
+                finfo->compressed_position += (PHYSFS_uint64) br;
+                finfo->zin.size = (size_t) br;
+                finfo->zin.pos = 0;
+            } /* if */
+        } /* if */
+
+        /* this also flushes output zstd buffered when (buf) was full. */
+        rc = ZSTD_decompressStream(finfo->zstream, &out, &finfo->zin);
+        if (ZSTD_isError(rc))
+        {
+            PHYSFS_setErrorCode(zstd_error_code(rc));
+            if (out.pos == 0)
+                return -1;
+            break;
+        } /* if */
+
+        /* no output, no input left, but not at the end: truncated data. */
+        if ( (out.pos == before) && (finfo->zin.pos == finfo->zin.size) &&
+             (finfo->compressed_position >= complen) )
+        {
+            PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+            if (out.pos == 0)
+                return -1;
+            break;
+        } /* if */
+    } /* while */
+
+    return (PHYSFS_sint64) out.pos;
+} /* zip_read_zstd */
+#endif
+
+
 static PHYSFS_sint64 ZIP_read(PHYSFS_Io *_io, void *buf, PHYSFS_uint64 len)
 {
     ZIPfileinfo *finfo = (ZIPfileinfo *) _io->opaque;
@@ -315,21 +754,26 @@ static PHYSFS_sint64 ZIP_read(PHYSFS_Io *_io, void *buf, PHYSFS_uint64 len)
 
     if (entry->compression_method == COMPMETH_NONE)
         retval = zip_read_decrypt(finfo, buf, maxread);
+#if PHYSFS_SUPPORTS_ZIP_ZSTD
+    else if (finfo->zstream != NULL)
+        retval = zip_read_zstd(finfo, buf, maxread);
+#endif
     else
     {
         finfo->stream.next_out = buf;
-        finfo->stream.avail_out = (uInt) maxread;
 
         while (retval < maxread)
         {
-            const PHYSFS_uint32 before = (PHYSFS_uint32) finfo->stream.total_out;
+            /* zlib counts in 32 bits; feed it huge reads a piece at a time. */
+            const PHYSFS_uint64 want = (PHYSFS_uint64) (maxread - retval);
+            const uInt chunk = (want > 0xFFFFFFFF) ? 0xFFFFFFFF : (uInt) want;
             int rc;
 
             if (finfo->stream.avail_in == 0)
             {
                 PHYSFS_sint64 br;
 
-                br = entry->compressed_size - finfo->compressed_position;
+                br = zip_compressed_data_len(entry) - finfo->compressed_position;
                 if (br > 0)
                 {
                     if (br > ZIP_READBUFSIZE)
@@ -337,16 +781,21 @@ static PHYSFS_sint64 ZIP_read(PHYSFS_Io *_io, void *buf, PHYSFS_uint64 len)
 
                     br = zip_read_decrypt(finfo, finfo->buffer, (PHYSFS_uint64) br);
                     if (br <= 0)
+                    {
+                        if ((br < 0) && (retval == 0))
+                            retval = -1;  /* don't look like EOF. */
                         break;
+                    } /* if */
 
-                    finfo->compressed_position += (PHYSFS_uint32) br;
+                    finfo->compressed_position += (PHYSFS_uint64) br;
                     finfo->stream.next_in = finfo->buffer;
                     finfo->stream.avail_in = (unsigned int) br;
                 } /* if */
             } /* if */
 
+            finfo->stream.avail_out = chunk;
             rc = zlib_err(inflate(&finfo->stream, Z_SYNC_FLUSH));
-            retval += (finfo->stream.total_out - before);
+            retval += (chunk - finfo->stream.avail_out);
 
             if (rc != Z_OK)
                 break;
@@ -354,7 +803,7 @@ static PHYSFS_sint64 ZIP_read(PHYSFS_Io *_io, void *buf, PHYSFS_uint64 len)
     } /* else */
 
     if (retval > 0)
-        finfo->uncompressed_position += (PHYSFS_uint32) retval;
+        finfo->uncompressed_position += (PHYSFS_uint64) retval;
 
     return retval;
 } /* ZIP_read */
@@ -381,11 +830,13 @@ static int ZIP_seek(PHYSFS_Io *_io, PHYSFS_uint64 offset)
 
     BAIL_IF(offset > entry->uncompressed_size, PHYSFS_ERR_PAST_EOF, 0);
 
+    /* stored data with no crypto, or AES (which can start anywhere). */
     if (!encrypted && (entry->compression_method == COMPMETH_NONE))
     {
-        PHYSFS_sint64 newpos = offset + entry->offset;
+        PHYSFS_sint64 newpos = offset + entry->offset + zip_crypto_header_len(entry);
         BAIL_IF_ERRPASS(!io->seek(io, newpos), 0);
-        finfo->uncompressed_position = (PHYSFS_uint32) offset;
+        finfo->uncompressed_position = offset;
+        finfo->crypt_pos = offset;
     } /* if */
 
     else
@@ -398,18 +849,11 @@ static int ZIP_seek(PHYSFS_Io *_io, PHYSFS_uint64 offset)
          */
         if (offset < finfo->uncompressed_position)
         {
-            /* we do a copy so state is sane if inflateInit2() fails. */
-            z_stream str;
-            initializeZStream(&str);
-            if (zlib_err(inflateInit2(&str, -MAX_WBITS)) != Z_OK)
-                return 0;
-
-            if (!io->seek(io, entry->offset + (encrypted ? 12 : 0)))
+            if (!zip_rewind_decompressor(finfo))
                 return 0;
 
-            inflateEnd(&finfo->stream);
-            memcpy(&finfo->stream, &str, sizeof (z_stream));
             finfo->uncompressed_position = finfo->compressed_position = 0;
+            finfo->crypt_pos = 0;
 
             if (encrypted)
                 memcpy(finfo->crypto_keys, finfo->initial_crypto_keys, 12);
@@ -418,13 +862,13 @@ static int ZIP_seek(PHYSFS_Io *_io, PHYSFS_uint64 offset)
         while (finfo->uncompressed_position != offset)
         {
             PHYSFS_uint8 buf[512];
-            PHYSFS_uint32 maxread;
+            PHYSFS_uint64 maxread;
 
-            maxread = (PHYSFS_uint32) (offset - finfo->uncompressed_position);
+            maxread = offset - finfo->uncompressed_position;
             if (maxread > sizeof (buf))
                 maxread = sizeof (buf);
 
-            if (ZIP_read(_io, buf, maxread) != maxread)
+            if (ZIP_read(_io, buf, maxread) != (PHYSFS_sint64) maxread)
                 return 0;
         } /* while */
     } /* else */
@@ -451,19 +895,34 @@ static PHYSFS_Io *ZIP_duplicate(PHYSFS_Io *io)
     GOTO_IF(!finfo, PHYSFS_ERR_OUT_OF_MEMORY, failed);
     memset(finfo, '\0', sizeof (*finfo));
 
-    finfo->entry = origfinfo->entry;
+    if (origfinfo->entry != &origfinfo->entrycopy)
+        finfo->entry = origfinfo->entry;
+    else  /* from a shared index; each file has its own copy. */
+    {
+        memcpy(&finfo->entrycopy, &origfinfo->entrycopy, sizeof (ZIPentry));
+        finfo->entry = &finfo->entrycopy;
+    } /* else */
+
     finfo->io = zip_get_io(origfinfo->io, NULL, finfo->entry);
     GOTO_IF_ERRPASS(!finfo->io, failed);
 
-    initializeZStream(&finfo->stream);
-    if (finfo->entry->compression_method != COMPMETH_NONE)
+    /* same keys, starting over at the beginning of the data. */
+    if (zip_entry_is_encrypted(finfo->entry))
     {
-        finfo->buffer = (PHYSFS_uint8 *) allocator.Malloc(ZIP_READBUFSIZE);
-        GOTO_IF(!finfo->buffer, PHYSFS_ERR_OUT_OF_MEMORY, failed);
-        if (zlib_err(inflateInit2(&finfo->stream, -MAX_WBITS)) != Z_OK)
-            goto failed;
+        const PHYSFS_uint64 pos = finfo->entry->offset +
+                                  zip_crypto_header_len(finfo->entry);
+        memcpy(finfo->crypto_keys, origfinfo->initial_crypto_keys, 12);
+        memcpy(finfo->initial_crypto_keys, origfinfo->initial_crypto_keys, 12);
+        memcpy(&finfo->aes, &origfinfo->aes, sizeof (finfo->aes));
+        memcpy(&finfo->hmac, &origfinfo->hmac, sizeof (finfo->hmac));
+        finfo->mac_pos = origfinfo->mac_pos;
+        finfo->mac_state = origfinfo->mac_state;
+        GOTO_IF_ERRPASS(!finfo->io->seek(finfo->io, pos), failed);
     } /* if */
 
+    if (!zip_init_decompressor(finfo))
+        goto failed;
+
     memcpy(retval, io, sizeof (PHYSFS_Io));
     retval->opaque = finfo;
     return retval;
@@ -474,12 +933,7 @@ failed:
         if (finfo->io != NULL)
             finfo->io->destroy(finfo->io);
 
-        if (finfo->buffer != NULL)
-        {
-            allocator.Free(finfo->buffer);
-            inflateEnd(&finfo->stream);
-        } /* if */
-
+        zip_free_decompressor(finfo);
         allocator.Free(finfo);
     } /* if */
 
@@ -495,13 +949,7 @@ static void ZIP_destroy(PHYSFS_Io *io)
 {
     ZIPfileinfo *finfo = (ZIPfileinfo *) io->opaque;
     finfo->io->destroy(finfo->io);
-
-    if (finfo->entry->compression_method != COMPMETH_NONE)
-        inflateEnd(&finfo->stream);
-
-    if (finfo->buffer != NULL)
-        allocator.Free(finfo->buffer);
-
+    zip_free_decompressor(finfo);
     allocator.Free(finfo);
     allocator.Free(io);
 } /* ZIP_destroy */
@@ -636,6 +1084,33 @@ static int isZip(PHYSFS_Io *io)
 } /* isZip */
 
 
+/* isZip(), but from bytes openDirectory() already read, without any I/O. */
+static int ZIP_sniff(const void *head, PHYSFS_uint64 headlen,
+                     const void *tail, PHYSFS_uint64 taillen,
+                     PHYSFS_sint64 filelen)
+{
+    const PHYSFS_uint8 *ptr = (const PHYSFS_uint8 *) tail;
+    PHYSFS_uint64 i;
+
+    if ((headlen >= 4) && (memcmp(head, "PK\003\004", 4) == 0))
+        return 1;
+    else if (taillen == 0)  /* don't know where the end is. */
+        return -1;
+
+    /* the end-of-central-dir record is 22 bytes plus the zipfile comment. */
+    for (i = taillen; i >= 22; i--)
+    {
+        if (memcmp(ptr + i - 22, "PK\005\006", 4) == 0)
+            return 1;
+    } /* for */
+
+    /* if we weren't shown the whole file or the longest comment, dunno. */
+    if ((taillen < 0xFFFF + 22) && (filelen > (PHYSFS_sint64) taillen))
+        return -1;
+    return 0;
+} /* ZIP_sniff */
+
+
 /* Convert paths from old, buggy DOS zippers... */
 static void zip_convert_dos_path(const PHYSFS_uint16 entryversion, char *path)
 {
@@ -711,11 +1186,133 @@ static void zip_expand_symlink_path(char *path)
 } /* zip_expand_symlink_path */
 
 
-static inline ZIPentry *zip_find_entry(ZIPinfo *info, const char *path)
+/* (hash) is __PHYSFS_hashString() of all of (path). */
+static inline ZIPentry *zip_find_entry(ZIPinfo *info, const char *path,
+                                       const PHYSFS_uint32 hash)
 {
-    return (ZIPentry *) __PHYSFS_DirTreeFind(&info->tree, path);
+    return (ZIPentry *) __PHYSFS_DirTreeFindHashed(&info->tree, path, hash);
 } /* zip_find_entry */
 
+
+/* Entry (idx) of a shared index, or NULL if it's out of range. */
+static const ZIPindexentry *zip_index_entry(const ZIPindexheader *hdr,
+                                            const PHYSFS_uint32 idx)
+{
+    const PHYSFS_uint8 *base = (const PHYSFS_uint8 *) hdr;
+    if (idx >= hdr->entry_count)
+        return NULL;
+    return ((const ZIPindexentry *) (base + hdr->entries_ofs)) + idx;
+} /* zip_index_entry */
+
+
+/* Name of an entry in a shared index, or NULL if the index is bogus. */
+static const char *zip_index_name(const ZIPindexheader *hdr,
+                                  const ZIPindexentry *ie)
+{
+    const char *names = ((const char *) hdr) + hdr->names_ofs;
+    if (ie->name >= (hdr->total_len - hdr->names_ofs))
+        return NULL;
+    return names + ie->name;  /* the name block ends with a null. */
+} /* zip_index_name */
+
+
+/* The shared index's version of zip_find_entry(). */
+static const ZIPindexentry *zip_index_find(const ZIPindexheader *hdr,
+                                           const char *path,
+                                           const PHYSFS_uint32 hash)
+{
+    const PHYSFS_uint8 *base = (const PHYSFS_uint8 *) hdr;
+    const PHYSFS_uint32 *buckets;
+    const ZIPindexentry *ie;
+    PHYSFS_uint32 idx;
+    PHYSFS_uint32 seen = 0;
+
+    if (*path == '\0')
+        return zip_index_entry(hdr, 0);  /* the root. */
+
+    buckets = (const PHYSFS_uint32 *) (base + hdr->buckets_ofs);
+    idx = buckets[hash % hdr->bucket_count];
+    while (idx != ZIP_INDEX_NONE)
+    {
+        const char *name;
+        ie = zip_index_entry(hdr, idx);
+        BAIL_IF(!ie, PHYSFS_ERR_CORRUPT, NULL);
+        BAIL_IF(++seen > hdr->entry_count, PHYSFS_ERR_CORRUPT, NULL);  /* loop? */
+        name = zip_index_name(hdr, ie);
+        BAIL_IF(!name, PHYSFS_ERR_CORRUPT, NULL);
+        if (strcmp(name, path) == 0)
+            return ie;
+        idx = ie->hashnext;
+    } /* while */
+
+    BAIL(PHYSFS_ERR_NOT_FOUND, NULL);
+} /* zip_index_find */
+
+
+/*
+ * Copy a shared index entry into (entry), which the rest of this file can
+ *  use like any other ZIPentry; it's already resolved, so nothing will try
+ *  to update it. A symlink's target goes into (link).
+ */
+static ZIPentry *zip_index_load(const ZIPindexheader *hdr,
+                                const ZIPindexentry *ie,
+                                ZIPentry *entry, ZIPentry *link)
+{
+    const char *name = zip_index_name(hdr, ie);
+    const ZipResolveType resolved = (ZipResolveType) ie->resolved;
+
+    BAIL_IF(!name, PHYSFS_ERR_CORRUPT, NULL);
+    BAIL_IF((resolved != ZIP_RESOLVED) && (resolved != ZIP_DIRECTORY) &&
+            (resolved != ZIP_BROKEN_FILE) && (resolved != ZIP_BROKEN_SYMLINK),
+            PHYSFS_ERR_CORRUPT, NULL);
+
+    memset(entry, '\0', sizeof (*entry));
+    entry->tree.name = (char *) name;
+    entry->tree.isdir = (ie->isdir != 0);
+    entry->resolved = resolved;
+    entry->offset = ie->offset;
+    entry->version = ie->version;
+    entry->version_needed = ie->version_needed;
+    entry->general_bits = ie->general_bits;
+    entry->compression_method = ie->compression_method;
+    entry->crc = ie->crc;
+    entry->compressed_size = ie->compressed_size;
+    entry->uncompressed_size = ie->uncompressed_size;
+    entry->last_mod_time = ie->last_mod_time;
+    entry->dos_mod_time = ie->dos_mod_time;
+    entry->aes_strength = ie->aes_strength;
+
+    if (ie->symlink != ZIP_INDEX_NONE)
+    {
+        const ZIPindexentry *target = zip_index_entry(hdr, ie->symlink);
+        BAIL_IF(!target || !link, PHYSFS_ERR_CORRUPT, NULL);
+        BAIL_IF(target->symlink != ZIP_INDEX_NONE, PHYSFS_ERR_CORRUPT, NULL);
+        BAIL_IF_ERRPASS(!zip_index_load(hdr, target, link, NULL), NULL);
+        entry->symlink = link;
+    } /* if */
+
+    return entry;
+} /* zip_index_load */
+
+
+/*
+ * Find (path), in the shared index if there is one. Entries from the index
+ *  are copied into (buf), and what a symlink points to into (linkbuf).
+ */
+static ZIPentry *zip_lookup(ZIPinfo *info, const char *path,
+                            const PHYSFS_uint32 hash,
+                            ZIPentry *buf, ZIPentry *linkbuf)
+{
+    const ZIPindexentry *ie;
+
+    if (info->index == NULL)
+        return zip_find_entry(info, path, hash);
+
+    ie = zip_index_find(info->index, path, hash);
+    BAIL_IF_ERRPASS(!ie, NULL);
+    return zip_index_load(info->index, ie, buf, linkbuf);
+} /* zip_lookup */
+
 /* (forward reference: zip_follow_symlink and zip_resolve call each other.) */
 static int zip_resolve(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry);
 
@@ -730,7 +1327,7 @@ static ZIPentry *zip_follow_symlink(PHYSFS_Io *io, ZIPinfo *info, char *path)
     ZIPentry *entry;
 
     zip_expand_symlink_path(path);
-    entry = zip_find_entry(info, path);
+    entry = zip_find_entry(info, path, __PHYSFS_hashString(path, strlen(path)));
     if (entry != NULL)
     {
         if (!zip_resolve(io, info, entry))  /* recursive! */
@@ -773,7 +1370,26 @@ static int zip_resolve_symlink(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry)
         PHYSFS_uint8 *compressed = (PHYSFS_uint8*) __PHYSFS_smallAlloc(complen);
         if (compressed != NULL)
         {
-            if (__PHYSFS_readAll(io, compressed, complen))
+            if (!__PHYSFS_readAll(io, compressed, complen))
+                rc = 0;  /* error code is already set. */
+#if PHYSFS_SUPPORTS_ZIP_ZSTD
+            else if (zip_entry_is_zstd(entry))
+            {
+                ZSTD_DCtx *dctx = ZSTD_createDCtx_advanced(zstdPhysfsMem);
+                if (!dctx)
+                    PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+                else
+                {
+                    const size_t br = ZSTD_decompressDCtx(dctx, path, size,
+                                                          compressed, complen);
+                    if (ZSTD_isError(br))
+                        PHYSFS_setErrorCode(zstd_error_code(br));
+                    rc = (br == size);
+                    ZSTD_freeDCtx(dctx);
+                } /* else */
+            } /* else if */
+#endif
+            else
             {
                 initializeZStream(&stream);
                 stream.next_in = compressed;
@@ -788,7 +1404,7 @@ static int zip_resolve_symlink(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry)
                     /* both are acceptable outcomes... */
                     rc = ((rc == Z_OK) || (rc == Z_STREAM_END));
                 } /* if */
-            } /* if */
+            } /* else */
             __PHYSFS_smallFree(compressed);
         } /* if */
     } /* else */
@@ -836,7 +1452,10 @@ static int zip_parse_local(PHYSFS_Io *io, ZIPentry *entry)
     BAIL_IF(ui16 != entry->version_needed, PHYSFS_ERR_CORRUPT, 0);
     BAIL_IF_ERRPASS(!readui16(io, &ui16), 0);  /* general bits. */
     BAIL_IF_ERRPASS(!readui16(io, &ui16), 0);
-    BAIL_IF(ui16 != entry->compression_method, PHYSFS_ERR_CORRUPT, 0);
+    if (zip_entry_is_aes(entry))
+        BAIL_IF(ui16 != COMPMETH_AES, PHYSFS_ERR_CORRUPT, 0);
+    else
+        BAIL_IF(ui16 != entry->compression_method, PHYSFS_ERR_CORRUPT, 0);
     BAIL_IF_ERRPASS(!readui32(io, &ui32), 0);  /* date/time */
     BAIL_IF_ERRPASS(!readui32(io, &ui32), 0);
     BAIL_IF(ui32 && (ui32 != entry->crc), PHYSFS_ERR_CORRUPT, 0);
@@ -985,8 +1604,54 @@ static PHYSFS_sint64 zip_dos_time_to_physfs_time(PHYSFS_uint32 dostime)
 } /* zip_dos_time_to_physfs_time */
 
 
+/*
+ * WinZip AES entries claim compression method 99 and keep the real one in
+ *  an extra field, with the key size. If that field is missing or makes no
+ *  sense, we leave the entry alone, and opening it fails like opening any
+ *  other entry with a compression method we don't know.
+ */
+static int zip_parse_aes_extra(PHYSFS_Io *io, ZIPentry *entry,
+                               PHYSFS_uint64 pos, const PHYSFS_uint16 extralen)
+{
+    const PHYSFS_uint64 end = pos + extralen;
+
+    BAIL_IF_ERRPASS(!io->seek(io, pos), 0);
+    while (pos + 4 <= end)
+    {
+        PHYSFS_uint16 sig, len;
+        BAIL_IF_ERRPASS(!readui16(io, &sig), 0);
+        BAIL_IF_ERRPASS(!readui16(io, &len), 0);
+        pos += 4;
+
+        if ((sig == ZIP_AES_EXTRA_FIELD_SIG) && (len == 7) && (pos + len <= end))
+        {
+            PHYSFS_uint16 vendorver, vendorid, method;
+            PHYSFS_uint8 strength;
+            BAIL_IF_ERRPASS(!readui16(io, &vendorver), 0);  /* AE-1 or AE-2 */
+            BAIL_IF_ERRPASS(!readui16(io, &vendorid), 0);
+            BAIL_IF_ERRPASS(!__PHYSFS_readAll(io, &strength, 1), 0);
+            BAIL_IF_ERRPASS(!readui16(io, &method), 0);
+            if ( ((vendorver == 1) || (vendorver == 2)) &&
+                 (vendorid == 0x4541) /* "AE" */ &&
+                 (strength >= 1) && (strength <= 3) )
+            {
+                entry->aes_strength = strength;
+                entry->compression_method = method;
+            } /* if */
+            return 1;
+        } /* if */
+
+        pos += len;
+        BAIL_IF_ERRPASS(!io->seek(io, pos), 0);
+    } /* while */
+
+    return 1;
+} /* zip_parse_aes_extra */
+
+
 static ZIPentry *zip_load_entry(ZIPinfo *info, const int zip64,
-                                const PHYSFS_uint64 ofs_fixup)
+                                const PHYSFS_uint64 ofs_fixup,
+                                PHYSFS_uint64 *next)
 {
     PHYSFS_Io *io = info->io;
     ZIPentry entry;
@@ -995,6 +1660,8 @@ static ZIPentry *zip_load_entry(ZIPinfo *info, const int zip64,
     PHYSFS_uint32 external_attr;
     PHYSFS_uint32 starting_disk;
     PHYSFS_uint64 offset;
+    PHYSFS_uint64 extrapos;
+    PHYSFS_uint16 extratotal;
     PHYSFS_uint16 ui16;
     PHYSFS_uint32 ui32;
     PHYSFS_sint64 si64;
@@ -1073,13 +1740,18 @@ static ZIPentry *zip_load_entry(ZIPinfo *info, const int zip64,
     si64 = io->tell(io);
     BAIL_IF_ERRPASS(si64 == -1, NULL);
 
+    extrapos = (PHYSFS_uint64) si64;
+    extratotal = extralen;
+
     /* If the actual sizes didn't fit in 32-bits, look for the Zip64
-        extended information extra field... */
-    if ( (zip64) &&
-         ((offset == 0xFFFFFFFF) ||
-          (starting_disk == 0xFFFFFFFF) ||
-          (retval->compressed_size == 0xFFFFFFFF) ||
-          (retval->uncompressed_size == 0xFFFFFFFF)) )
+        extended information extra field. Writers add it per entry, so a
+        >4GB file can turn up in an archive without a Zip64 end record.
+        Such archives never promised the field, so there we take it when
+        it's present and big enough, and otherwise keep the 32-bit values. */
+    if ( (offset == 0xFFFFFFFF) ||
+         (starting_disk == 0xFFFFFFFF) ||
+         (retval->compressed_size == 0xFFFFFFFF) ||
+         (retval->uncompressed_size == 0xFFFFFFFF) )
     {
         int found = 0;
         PHYSFS_uint16 sig = 0;
@@ -1101,51 +1773,91 @@ static ZIPentry *zip_load_entry(ZIPinfo *info, const int zip64,
             break;
         } /* while */
 
-        BAIL_IF(!found, PHYSFS_ERR_CORRUPT, NULL);
+        BAIL_IF(!found && zip64, PHYSFS_ERR_CORRUPT, NULL);
 
-        if (retval->uncompressed_size == 0xFFFFFFFF)
+        if ((found) && (!zip64))
         {
-            BAIL_IF(len < 8, PHYSFS_ERR_CORRUPT, NULL);
-            BAIL_IF_ERRPASS(!readui64(io, &retval->uncompressed_size), NULL);
-            len -= 8;
+            const PHYSFS_uint16 needed =
+                ((retval->uncompressed_size == 0xFFFFFFFF) ? 8 : 0) +
+                ((retval->compressed_size == 0xFFFFFFFF) ? 8 : 0) +
+                ((offset == 0xFFFFFFFF) ? 8 : 0) +
+                ((starting_disk == 0xFFFFFFFF) ? 4 : 0);
+            found = (len >= needed);
         } /* if */
 
-        if (retval->compressed_size == 0xFFFFFFFF)
+        if (found)
         {
-            BAIL_IF(len < 8, PHYSFS_ERR_CORRUPT, NULL);
-            BAIL_IF_ERRPASS(!readui64(io, &retval->compressed_size), NULL);
-            len -= 8;
-        } /* if */
+            if (retval->uncompressed_size == 0xFFFFFFFF)
+            {
+                BAIL_IF(len < 8, PHYSFS_ERR_CORRUPT, NULL);
+                BAIL_IF_ERRPASS(!readui64(io, &retval->uncompressed_size), NULL);
+                len -= 8;
+            } /* if */
 
-        if (offset == 0xFFFFFFFF)
-        {
-            BAIL_IF(len < 8, PHYSFS_ERR_CORRUPT, NULL);
-            BAIL_IF_ERRPASS(!readui64(io, &offset), NULL);
-            len -= 8;
-        } /* if */
+            if (retval->compressed_size == 0xFFFFFFFF)
+            {
+                BAIL_IF(len < 8, PHYSFS_ERR_CORRUPT, NULL);
+                BAIL_IF_ERRPASS(!readui64(io, &retval->compressed_size), NULL);
+                len -= 8;
+            } /* if */
 
-        if (starting_disk == 0xFFFFFFFF)
-        {
-            BAIL_IF(len < 8, PHYSFS_ERR_CORRUPT, NULL);
-            BAIL_IF_ERRPASS(!readui32(io, &starting_disk), NULL);
-            len -= 4;
-        } /* if */
+            if (offset == 0xFFFFFFFF)
+            {
+                BAIL_IF(len < 8, PHYSFS_ERR_CORRUPT, NULL);
+                BAIL_IF_ERRPASS(!readui64(io, &offset), NULL);
+                len -= 8;
+            } /* if */
+
+            if (starting_disk == 0xFFFFFFFF)
+            {
+                BAIL_IF(len < 8, PHYSFS_ERR_CORRUPT, NULL);
+                BAIL_IF_ERRPASS(!readui32(io, &starting_disk), NULL);
+                len -= 4;
+            } /* if */
 
-        BAIL_IF(len != 0, PHYSFS_ERR_CORRUPT, NULL);
+            BAIL_IF((zip64) && (len != 0), PHYSFS_ERR_CORRUPT, NULL);
+        } /* if */
     } /* if */
 
+    if (retval->compression_method == COMPMETH_AES)
+        BAIL_IF_ERRPASS(!zip_parse_aes_extra(io, retval, extrapos, extratotal), NULL);
+
     BAIL_IF(starting_disk != 0, PHYSFS_ERR_CORRUPT, NULL);
 
     retval->offset = offset + ofs_fixup;
 
     /* seek to the start of the next entry in the central directory... */
-    BAIL_IF_ERRPASS(!io->seek(io, si64 + extralen + commentlen), NULL);
+    si64 += extralen + commentlen;
+    BAIL_IF_ERRPASS(!io->seek(io, si64), NULL);
+    *next = (PHYSFS_uint64) si64;
 
     return retval;  /* success. */
 } /* zip_load_entry */
 
 
-/* This leaves things allocated on error; the caller will clean up the mess. */
+/* Hash the central directory record at (ofs), (len) bytes long. */
+static int zip_hash_record(PHYSFS_Io *io, const PHYSFS_uint64 ofs,
+                           const PHYSFS_uint64 len, PHYSFS_uint32 *hash)
+{
+    char *buf;
+    int rc;
+
+    BAIL_IF(len > 0x30000, PHYSFS_ERR_CORRUPT, 0);  /* 46 + 3 * 0xFFFF max */
+    buf = (char *) allocator.Malloc((size_t) len + 1);
+    BAIL_IF(!buf, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    rc = io->seek(io, ofs) && __PHYSFS_readAll(io, buf, (size_t) len);
+    if (rc)
+        *hash = __PHYSFS_hashString(buf, (size_t) len);
+    allocator.Free(buf);
+    return rc;
+} /* zip_hash_record */
+
+
+/*
+ * This leaves things allocated on error; the caller will clean up the mess.
+ *  It picks up after the records earlier calls already loaded, so
+ *  ZIP_refresh() only has to read the ones that were appended.
+ */
 static int zip_load_entries(ZIPinfo *info,
                             const PHYSFS_uint64 data_ofs,
                             const PHYSFS_uint64 central_ofs,
@@ -1153,17 +1865,32 @@ static int zip_load_entries(ZIPinfo *info,
 {
     PHYSFS_Io *io = info->io;
     const int zip64 = info->zip64;
-    PHYSFS_uint64 i;
 
-    BAIL_IF_ERRPASS(!io->seek(io, central_ofs), 0);
+    BAIL_IF_ERRPASS(!io->seek(io, central_ofs + info->cdir_loaded), 0);
 
-    for (i = 0; i < entry_count; i++)
+    while (info->entries_loaded < entry_count)
     {
-        ZIPentry *entry = zip_load_entry(info, zip64, data_ofs);
+        PHYSFS_uint64 next = 0;
+        ZIPentry *entry = zip_load_entry(info, zip64, data_ofs, &next);
         BAIL_IF_ERRPASS(!entry, 0);
-        if (zip_entry_is_tradional_crypto(entry))
+
+        /* anything new has to live past where the old data ended. */
+        BAIL_IF(entry->offset < info->append_ofs, PHYSFS_ERR_UNSUPPORTED, 0);
+
+        if (zip_entry_is_encrypted(entry))
             info->has_crypto = 1;
-    } /* for */
+        info->last_record = info->cdir_loaded;
+        info->cdir_loaded = next - central_ofs;
+        info->entries_loaded++;
+    } /* while */
+
+    /* remember what the last record looked like, for ZIP_refresh(). */
+    if (info->entries_loaded > 0)
+    {
+        const PHYSFS_uint64 len = info->cdir_loaded - info->last_record;
+        BAIL_IF_ERRPASS(!zip_hash_record(io, central_ofs + info->last_record,
+                                         len, &info->last_hash), 0);
+    } /* if */
 
     return 1;
 } /* zip_load_entries */
@@ -1261,6 +1988,7 @@ static PHYSFS_sint64 zip64_find_end_of_central_dir(PHYSFS_Io *io,
 static int zip64_parse_end_of_central_dir(ZIPinfo *info,
                                           PHYSFS_uint64 *data_start,
                                           PHYSFS_uint64 *dir_ofs,
+                                          PHYSFS_uint64 *dir_size,
                                           PHYSFS_uint64 *entry_count,
                                           PHYSFS_sint64 pos)
 {
@@ -1336,7 +2064,7 @@ static int zip64_parse_end_of_central_dir(ZIPinfo *info,
     BAIL_IF(ui64 != *entry_count, PHYSFS_ERR_CORRUPT, 0);
 
     /* size of the central directory */
-    BAIL_IF_ERRPASS(!readui64(io, &ui64), 0);
+    BAIL_IF_ERRPASS(!readui64(io, dir_size), 0);
 
     /* offset of central directory */
     BAIL_IF_ERRPASS(!readui64(io, dir_ofs), 0);
@@ -1356,6 +2084,7 @@ static int zip64_parse_end_of_central_dir(ZIPinfo *info,
 static int zip_parse_end_of_central_dir(ZIPinfo *info,
                                         PHYSFS_uint64 *data_start,
                                         PHYSFS_uint64 *dir_ofs,
+                                        PHYSFS_uint64 *dir_size,
                                         PHYSFS_uint64 *entry_count)
 {
     PHYSFS_Io *io = info->io;
@@ -1378,7 +2107,7 @@ static int zip_parse_end_of_central_dir(ZIPinfo *info,
 
     /* Seek back to see if "Zip64 end of central directory locator" exists. */
     /* this record is 20 bytes before end-of-central-dir */
-    rc = zip64_parse_end_of_central_dir(info, data_start, dir_ofs,
+    rc = zip64_parse_end_of_central_dir(info, data_start, dir_ofs, dir_size,
                                         entry_count, pos - 20);
 
     /* Error or success? Bounce out of here. Keep going if not zip64. */
@@ -1409,6 +2138,7 @@ static int zip_parse_end_of_central_dir(ZIPinfo *info,
 
     /* size of the central directory */
     BAIL_IF_ERRPASS(!readui32(io, &ui32), 0);
+    *dir_size = (PHYSFS_uint64) ui32;
 
     /* offset of central directory */
     BAIL_IF_ERRPASS(!readui32(io, &offset32), 0);
@@ -1452,12 +2182,267 @@ static void ZIP_closeArchive(void *opaque)
     if (info->io)
         info->io->destroy(info->io);
 
+    if (info->index)
+        __PHYSFS_platformUnmapFile((void *) info->index, info->index_len);
+
     __PHYSFS_DirTreeDeinit(&info->tree);
 
     allocator.Free(info);
 } /* ZIP_closeArchive */
 
 
+/*
+ * Check that a mapped index is for this version of this archive, and that
+ *  its tables fit in the file. Links between entries are range-checked as
+ *  they're followed, so a broken index fails lookups instead of crashing,
+ *  and attaching doesn't have to touch every page.
+ */
+static int zip_index_valid(const ZIPindexheader *hdr, const PHYSFS_uint64 len,
+                           const char *fname, const PHYSFS_uint64 fp,
+                           const PHYSFS_uint64 archive_len)
+{
+    const char *base = (const char *) hdr;
+    const char *name = base + sizeof (ZIPindexheader);
+    const PHYSFS_uint64 buckets_len = ((PHYSFS_uint64) hdr->bucket_count) * 4;
+    const PHYSFS_uint64 entries_len = ((PHYSFS_uint64) hdr->entry_count) *
+                                      sizeof (ZIPindexentry);
+
+    BAIL_IF(len < sizeof (ZIPindexheader), PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(memcmp(hdr->magic, ZIP_INDEX_MAGIC, 8) != 0, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->version != ZIP_INDEX_VERSION, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->endian != 0x01020304, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->entrylen != sizeof (ZIPindexentry), PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->total_len != len, PHYSFS_ERR_CORRUPT, 0);
+
+    /* is it for this archive, as it is right now? */
+    BAIL_IF(hdr->namelen == 0, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->namelen > len - sizeof (ZIPindexheader), PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(name[hdr->namelen - 1] != '\0', PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(strcmp(name, fname) != 0, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->fingerprint != fp, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->archive_len != archive_len, PHYSFS_ERR_CORRUPT, 0);
+
+    /*
+     * Do the tables fit, in order, and does the name block end cleanly?
+     *  Every offset is checked against len before anything is added to it,
+     *  and the table lengths are at most 2^32 * entrylen, so none of these
+     *  sums can wrap.
+     */
+    BAIL_IF((hdr->entry_count == 0) || (hdr->bucket_count == 0), PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF((hdr->buckets_ofs % 4) || (hdr->entries_ofs % 8), PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->buckets_ofs > len, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->entries_ofs > len, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->names_ofs >= len, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(sizeof (ZIPindexheader) + hdr->namelen > hdr->buckets_ofs, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->buckets_ofs + buckets_len > hdr->entries_ofs, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(hdr->entries_ofs + entries_len > hdr->names_ofs, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(base[len - 1] != '\0', PHYSFS_ERR_CORRUPT, 0);
+
+    return 1;
+} /* zip_index_valid */
+
+
+/* Map the shared index at (path) and use it instead of parsing. */
+static int zip_index_attach(ZIPinfo *info, const char *path,
+                            const char *fname, const PHYSFS_uint64 fp,
+                            const PHYSFS_uint64 archive_len)
+{
+    PHYSFS_uint64 len = 0;
+    void *ptr = __PHYSFS_platformMapFile(path, &len);
+    const ZIPindexheader *hdr = (const ZIPindexheader *) ptr;
+
+    BAIL_IF_ERRPASS(!ptr, 0);
+
+    if (!zip_index_valid(hdr, len, fname, fp, archive_len))
+    {
+        __PHYSFS_platformUnmapFile(ptr, len);
+        return 0;
+    } /* if */
+
+    info->index = hdr;
+    info->index_len = len;
+    info->zip64 = (hdr->zip64 != 0);
+    info->has_crypto = (hdr->has_crypto != 0);
+    return 1;
+} /* zip_index_attach */
+
+
+/*
+ * Write the archive we just parsed out as a shared index at (path), then
+ *  switch this mount over to it, freeing our private tree. Every entry is
+ *  resolved first, since nobody can update the index later. On failure,
+ *  the mount carries on with its own tree.
+ */
+static int zip_index_build(ZIPinfo *info, const char *path,
+                           const char *fname, const PHYSFS_uint64 fp,
+                           const PHYSFS_uint64 archive_len)
+{
+    const size_t namelen = strlen(fname) + 1;
+    __PHYSFS_DirTree *tree = &info->tree;
+    ZIPentry **order = NULL;
+    PHYSFS_uint8 *buf = NULL;
+    ZIPindexheader *hdr;
+    ZIPindexentry *entries;
+    PHYSFS_uint32 *buckets;
+    char *names;
+    PHYSFS_uint64 count = 1;  /* the root isn't in the hash. */
+    PHYSFS_uint64 nameslen = 1;  /* the root's name is "". */
+    PHYSFS_uint64 total;
+    PHYSFS_uint64 nameofs;
+    PHYSFS_uint32 i, n;
+    size_t b;
+    int rc;
+
+    for (b = 0; b < tree->hashBuckets; b++)
+    {
+        __PHYSFS_DirTreeEntry *e;
+        for (e = tree->hash[b]; e != NULL; e = e->hashnext)
+        {
+            count++;
+            nameslen += strlen(e->name) + 1;
+        } /* for */
+    } /* for */
+
+    BAIL_IF(count >= ZIP_INDEX_NONE, PHYSFS_ERR_UNSUPPORTED, 0);
+    BAIL_IF(nameslen >= ZIP_INDEX_NONE, PHYSFS_ERR_UNSUPPORTED, 0);
+
+    order = (ZIPentry **) allocator.Malloc(sizeof (ZIPentry *) * (size_t) count);
+    BAIL_IF(!order, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+
+    /*
+     * Number the entries breadth-first, so each directory's children are
+     *  consecutive: a child's sibling is just the next entry.
+     */
+    order[0] = (ZIPentry *) tree->root;
+    for (i = 0, n = 1; i < n; i++)
+    {
+        __PHYSFS_DirTreeEntry *kid;
+        for (kid = order[i]->tree.children; kid != NULL; kid = kid->sibling)
+        {
+            assert(n < count);
+            order[n++] = (ZIPentry *) kid;
+        } /* for */
+    } /* for */
+    assert(n == count);
+
+    total = sizeof (ZIPindexheader) + namelen;
+    total = (total + 7) & ~((PHYSFS_uint64) 7);
+    total += count * 4;  /* the hash table has as many buckets as entries. */
+    total = (total + 7) & ~((PHYSFS_uint64) 7);
+    total += count * sizeof (ZIPindexentry);
+    total += nameslen;
+
+    if (__PHYSFS_ui64FitsAddressSpace(total))
+        buf = (PHYSFS_uint8 *) allocator.Malloc((size_t) total);
+    if (!buf)
+    {
+        allocator.Free(order);
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    } /* if */
+    memset(buf, '\0', (size_t) total);
+
+    hdr = (ZIPindexheader *) buf;
+    memcpy(hdr->magic, ZIP_INDEX_MAGIC, 8);
+    hdr->version = ZIP_INDEX_VERSION;
+    hdr->endian = 0x01020304;
+    hdr->entrylen = sizeof (ZIPindexentry);
+    hdr->namelen = (PHYSFS_uint32) namelen;
+    hdr->fingerprint = fp;
+    hdr->archive_len = archive_len;
+    hdr->total_len = total;
+    hdr->zip64 = (PHYSFS_uint32) info->zip64;
+    hdr->has_crypto = (PHYSFS_uint32) info->has_crypto;
+    hdr->entry_count = (PHYSFS_uint32) count;
+    hdr->bucket_count = (PHYSFS_uint32) count;
+    hdr->buckets_ofs = (sizeof (ZIPindexheader) + namelen + 7) & ~((PHYSFS_uint64) 7);
+    hdr->entries_ofs = (hdr->buckets_ofs + (count * 4) + 7) & ~((PHYSFS_uint64) 7);
+    hdr->names_ofs = hdr->entries_ofs + (count * sizeof (ZIPindexentry));
+    memcpy(buf + sizeof (ZIPindexheader), fname, namelen);
+
+    buckets = (PHYSFS_uint32 *) (buf + hdr->buckets_ofs);
+    entries = (ZIPindexentry *) (buf + hdr->entries_ofs);
+    names = (char *) (buf + hdr->names_ofs);
+    memset(buckets, 0xFF, (size_t) (count * 4));  /* all ZIP_INDEX_NONE. */
+
+    nameofs = 1;  /* names[0] is the root's empty name. */
+    for (i = 0, n = 1; i < count; i++)
+    {
+        ZIPentry *entry = order[i];
+        ZIPindexentry *ie = &entries[i];
+        __PHYSFS_DirTreeEntry *kid;
+
+        /* failures just leave the entry marked broken, like a lazy open. */
+        if (!entry->tree.isdir)
+            (void) zip_resolve(info->io, info, entry);
+
+        ie->hashnext = ZIP_INDEX_NONE;
+        ie->symlink = ZIP_INDEX_NONE;
+        ie->children = ZIP_INDEX_NONE;
+        ie->sibling = ((i > 0) && (entry->tree.sibling)) ? i + 1 : ZIP_INDEX_NONE;
+        ie->isdir = (PHYSFS_uint32) (entry->tree.isdir != 0);
+        ie->resolved = (PHYSFS_uint32) (ie->isdir ? ZIP_DIRECTORY : entry->resolved);
+        ie->offset = entry->offset;
+        ie->version = entry->version;
+        ie->version_needed = entry->version_needed;
+        ie->general_bits = entry->general_bits;
+        ie->compression_method = entry->compression_method;
+        ie->crc = entry->crc;
+        ie->compressed_size = entry->compressed_size;
+        ie->uncompressed_size = entry->uncompressed_size;
+        ie->last_mod_time = entry->last_mod_time;
+        ie->dos_mod_time = entry->dos_mod_time;
+        ie->aes_strength = entry->aes_strength;
+
+        for (kid = entry->tree.children; kid != NULL; kid = kid->sibling)
+        {
+            if (ie->children == ZIP_INDEX_NONE)
+                ie->children = n;
+            n++;
+        } /* for */
+
+        if (i > 0)
+        {
+            const size_t len = strlen(entry->tree.name) + 1;
+            const PHYSFS_uint32 h = __PHYSFS_hashString(entry->tree.name, len - 1)
+                                        % hdr->bucket_count;
+            ie->name = (PHYSFS_uint32) nameofs;
+            memcpy(names + nameofs, entry->tree.name, len);
+            nameofs += len;
+            ie->hashnext = buckets[h];
+            buckets[h] = i;
+        } /* if */
+    } /* for */
+
+    /* now that every name is in the table, point symlinks at their targets. */
+    for (i = 0; i < count; i++)
+    {
+        const ZIPentry *target = order[i]->symlink;
+        if ((target != NULL) && (order[i]->resolved == ZIP_RESOLVED))
+        {
+            const char *name = target->tree.name;
+            const PHYSFS_uint32 hash = __PHYSFS_hashString(name, strlen(name));
+            const ZIPindexentry *ie = zip_index_find(hdr, name, hash);
+            if (ie != NULL)
+                entries[i].symlink = (PHYSFS_uint32) (ie - entries);
+            else
+                entries[i].resolved = ZIP_BROKEN_SYMLINK;
+        } /* if */
+    } /* for */
+
+    allocator.Free(order);
+
+    rc = __PHYSFS_platformPublishFile(path, buf, total);
+    allocator.Free(buf);
+    BAIL_IF_ERRPASS(!rc, 0);
+
+    /* map what we wrote (or what someone racing us wrote) and drop ours. */
+    BAIL_IF_ERRPASS(!zip_index_attach(info, path, fname, fp, archive_len), 0);
+    __PHYSFS_DirTreeDeinit(&info->tree);
+    memset(&info->tree, '\0', sizeof (info->tree));
+    return 1;
+} /* zip_index_build */
+
+
 static void *ZIP_openArchive(PHYSFS_Io *io, const char *name,
                              int forWriting, int *claimed)
 {
@@ -1465,7 +2450,13 @@ static void *ZIP_openArchive(PHYSFS_Io *io, const char *name,
     ZIPentry *root = NULL;
     PHYSFS_uint64 dstart = 0;  /* data start */
     PHYSFS_uint64 cdir_ofs;  /* central dir offset */
+    PHYSFS_uint64 cdir_size;  /* central dir size */
     PHYSFS_uint64 count;
+    const char *native = __PHYSFS_nativeIoPath(io);
+    char *indexpath = NULL;
+    char *indexkey = NULL;
+    PHYSFS_uint64 archive_len = 0;
+    PHYSFS_uint64 fp = 0;
 
     assert(io != NULL);  /* shouldn't ever happen. */
 
@@ -1480,7 +2471,30 @@ static void *ZIP_openArchive(PHYSFS_Io *io, const char *name,
 
     info->io = io;
 
-    if (!zip_parse_end_of_central_dir(info, &dstart, &cdir_ofs, &count))
+    /* a file on disk? Its fingerprint keys shared indexes and cached data. */
+    if ((native != NULL) && __PHYSFS_platformFingerprint(native, &fp))
+        info->has_fingerprint = 1;
+    info->fingerprint = fp;
+
+    /* ...and it might have a shared index already. */
+    if (info->has_fingerprint)
+    {
+        const PHYSFS_sint64 len = io->length(io);
+        if (len >= 0)
+        {
+            archive_len = (PHYSFS_uint64) len;
+            indexpath = __PHYSFS_archiveIndexPath(native, "zipidx", &indexkey);
+        } /* if */
+    } /* if */
+
+    if (indexpath && zip_index_attach(info, indexpath, indexkey, fp, archive_len))
+    {
+        allocator.Free(indexpath);
+        allocator.Free(indexkey);
+        return info;  /* nothing to parse! */
+    } /* if */
+
+    if (!zip_parse_end_of_central_dir(info, &dstart, &cdir_ofs, &cdir_size, &count))
         goto ZIP_openarchive_failed;
     else if (!__PHYSFS_DirTreeInit(&info->tree, sizeof (ZIPentry)))
         goto ZIP_openarchive_failed;
@@ -1491,16 +2505,71 @@ static void *ZIP_openArchive(PHYSFS_Io *io, const char *name,
     if (!zip_load_entries(info, dstart, cdir_ofs, count))
         goto ZIP_openarchive_failed;
 
+    info->data_start = dstart;
+    info->cdir_ofs = cdir_ofs;
+    info->append_ofs = cdir_ofs;
+
     assert(info->tree.root->sibling == NULL);
+
+    if (indexpath != NULL)  /* first one here; share what we parsed. */
+    {
+        (void) zip_index_build(info, indexpath, indexkey, fp, archive_len);
+        allocator.Free(indexpath);
+        allocator.Free(indexkey);
+    } /* if */
+
     return info;
 
 ZIP_openarchive_failed:
+    if (indexpath != NULL)
+    {
+        allocator.Free(indexpath);
+        allocator.Free(indexkey);
+    } /* if */
     info->io = NULL;  /* don't let ZIP_closeArchive destroy (io). */
     ZIP_closeArchive(info);
     return NULL;
 } /* ZIP_openArchive */
 
 
+static PHYSFS_EnumerateCallbackResult ZIP_enumerate(void *opaque,
+                              const char *dname, PHYSFS_EnumerateCallback cb,
+                              const char *origdir, void *callbackdata)
+{
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    ZIPinfo *info = (ZIPinfo *) opaque;
+    const ZIPindexheader *hdr = info->index;
+    const ZIPindexentry *ie;
+    PHYSFS_uint32 idx;
+    PHYSFS_uint32 seen = 0;
+
+    if (hdr == NULL)
+        return __PHYSFS_DirTreeEnumerate(&info->tree, dname, cb, origdir, callbackdata);
+
+    /* same as __PHYSFS_DirTreeEnumerate(), but over the shared index. */
+    ie = zip_index_find(hdr, dname, __PHYSFS_hashString(dname, strlen(dname)));
+    BAIL_IF(!ie, PHYSFS_ERR_NOT_FOUND, PHYSFS_ENUM_ERROR);
+
+    idx = ie->children;
+    while ((idx != ZIP_INDEX_NONE) && (retval == PHYSFS_ENUM_OK))
+    {
+        const char *name;
+        const char *ptr;
+        ie = zip_index_entry(hdr, idx);
+        BAIL_IF(!ie, PHYSFS_ERR_CORRUPT, PHYSFS_ENUM_ERROR);
+        BAIL_IF(++seen > hdr->entry_count, PHYSFS_ERR_CORRUPT, PHYSFS_ENUM_ERROR);
+        name = zip_index_name(hdr, ie);
+        BAIL_IF(!name, PHYSFS_ERR_CORRUPT, PHYSFS_ENUM_ERROR);
+        ptr = strrchr(name, '/');
+        retval = cb(callbackdata, origdir, ptr ? ptr + 1 : name);
+        BAIL_IF(retval == PHYSFS_ENUM_ERROR, PHYSFS_ERR_APP_CALLBACK, retval);
+        idx = ie->sibling;
+    } /* while */
+
+    return retval;
+} /* ZIP_enumerate */
+
+
 static PHYSFS_Io *zip_get_io(PHYSFS_Io *io, ZIPinfo *inf, ZIPentry *entry)
 {
     int success;
@@ -1528,14 +2597,48 @@ static PHYSFS_Io *zip_get_io(PHYSFS_Io *io, ZIPinfo *inf, ZIPentry *entry)
 } /* zip_get_io */
 
 
+/*
+ * Key for (entry)'s data in the extraction cache, or zero if it shouldn't
+ *  be cached: only compressed, unencrypted entries in archives on disk.
+ */
+static PHYSFS_uint64 zip_extract_cache_key(const ZIPinfo *info,
+                                           const ZIPentry *entry)
+{
+    const char *name = entry->tree.name;
+    PHYSFS_uint64 key;
+
+    if ((!info->has_fingerprint) || (entry->compression_method == COMPMETH_NONE))
+        return 0;
+    else if (zip_entry_is_encrypted(entry))
+        return 0;
+
+    key = __PHYSFS_mixFingerprint(info->fingerprint, entry->crc);
+    key = __PHYSFS_mixFingerprint(key, entry->compressed_size);
+    key = __PHYSFS_mixFingerprint(key, entry->uncompressed_size);
+    key = __PHYSFS_mixFingerprint(key, __PHYSFS_hashString(name, strlen(name)));
+    return key ? key : 1;
+} /* zip_extract_cache_key */
+
+
 static PHYSFS_Io *ZIP_openRead(void *opaque, const char *filename)
+{
+    return ZIP_openReadHashed(opaque, filename,
+                              __PHYSFS_hashString(filename, strlen(filename)));
+} /* ZIP_openRead */
+
+
+PHYSFS_Io *ZIP_openReadHashed(void *opaque, const char *filename,
+                              const PHYSFS_uint32 hash)
 {
     PHYSFS_Io *retval = NULL;
     ZIPinfo *info = (ZIPinfo *) opaque;
-    ZIPentry *entry = zip_find_entry(info, filename);
+    ZIPentry buf, linkbuf;
+    ZIPentry *entry = zip_lookup(info, filename, hash, &buf, &linkbuf);
+    ZIPentry *target = NULL;
     ZIPfileinfo *finfo = NULL;
     PHYSFS_Io *io = NULL;
     PHYSFS_uint8 *password = NULL;
+    PHYSFS_uint64 cachekey = 0;
 
     /* if not found, see if maybe "$PASSWORD" is appended. */
     if ((!entry) && (info->has_crypto))
@@ -1548,7 +2651,8 @@ static PHYSFS_Io *ZIP_openRead(void *opaque, const char *filename)
             BAIL_IF(!str, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
             memcpy(str, filename, len);
             str[len] = '\0';
-            entry = zip_find_entry(info, str);
+            entry = zip_lookup(info, str, __PHYSFS_hashString(str, len),
+                               &buf, &linkbuf);
             __PHYSFS_smallFree(str);
             password = (PHYSFS_uint8 *) (ptr + 1);
         } /* if */
@@ -1560,6 +2664,25 @@ static PHYSFS_Io *ZIP_openRead(void *opaque, const char *filename)
 
     BAIL_IF(entry->tree.isdir, PHYSFS_ERR_NOT_A_FILE, NULL);
 
+    /* stored and not encrypted? It's just a window of the archive, then. */
+    target = ((entry->symlink != NULL) ? entry->symlink : entry);
+    if ( (target->compression_method == COMPMETH_NONE) &&
+         (!zip_entry_is_encrypted(entry)) &&
+         (!zip_entry_is_encrypted(target)) )
+    {
+        BAIL_IF(password != NULL, PHYSFS_ERR_BAD_PASSWORD, NULL);
+        io = zip_get_io(info->io, info, entry);
+        BAIL_IF_ERRPASS(!io, NULL);
+        retval = __PHYSFS_createSubIo(io, target->offset,
+                                      target->uncompressed_size);
+        if (!retval)
+            io->destroy(io);
+        return retval;
+    } /* if */
+
+    if ((password == NULL) && (!zip_entry_is_encrypted(entry)))
+        cachekey = zip_extract_cache_key(info, target);
+
     retval = (PHYSFS_Io *) allocator.Malloc(sizeof (PHYSFS_Io));
     GOTO_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, ZIP_openRead_failed);
 
@@ -1570,19 +2693,23 @@ static PHYSFS_Io *ZIP_openRead(void *opaque, const char *filename)
     io = zip_get_io(info->io, info, entry);
     GOTO_IF_ERRPASS(!io, ZIP_openRead_failed);
     finfo->io = io;
-    finfo->entry = ((entry->symlink != NULL) ? entry->symlink : entry);
-    initializeZStream(&finfo->stream);
+    finfo->entry = target;
+    if (info->index != NULL)  /* (target) is on the stack; keep a copy. */
+    {
+        memcpy(&finfo->entrycopy, target, sizeof (ZIPentry));
+        finfo->entry = &finfo->entrycopy;
+    } /* if */
 
-    if (finfo->entry->compression_method != COMPMETH_NONE)
+    if (!zip_init_decompressor(finfo))
+        goto ZIP_openRead_failed;
+
+    if (zip_entry_is_aes(finfo->entry))
     {
-        finfo->buffer = (PHYSFS_uint8 *) allocator.Malloc(ZIP_READBUFSIZE);
-        if (!finfo->buffer)
-            GOTO(PHYSFS_ERR_OUT_OF_MEMORY, ZIP_openRead_failed);
-        else if (zlib_err(inflateInit2(&finfo->stream, -MAX_WBITS)) != Z_OK)
+        GOTO_IF(password == NULL, PHYSFS_ERR_BAD_PASSWORD, ZIP_openRead_failed);
+        if (!zip_prep_aes(finfo, password))
             goto ZIP_openRead_failed;
     } /* if */
-
-    if (!zip_entry_is_tradional_crypto(entry))
+    else if (!zip_entry_is_tradional_crypto(entry))
         GOTO_IF(password != NULL, PHYSFS_ERR_BAD_PASSWORD, ZIP_openRead_failed);
     else
     {
@@ -1597,6 +2724,11 @@ static PHYSFS_Io *ZIP_openRead(void *opaque, const char *filename)
     memcpy(retval, &ZIP_Io, sizeof (PHYSFS_Io));
     retval->opaque = finfo;
 
+    /* inflated this one before, maybe in another process? Or keep it. */
+    if (cachekey != 0)
+        retval = __PHYSFS_extractCacheWrap(cachekey, target->crc, retval,
+                                           target->uncompressed_size);
+
     return retval;
 
 ZIP_openRead_failed:
@@ -1605,12 +2737,7 @@ ZIP_openRead_failed:
         if (finfo->io != NULL)
             finfo->io->destroy(finfo->io);
 
-        if (finfo->buffer != NULL)
-        {
-            allocator.Free(finfo->buffer);
-            inflateEnd(&finfo->stream);
-        } /* if */
-
+        zip_free_decompressor(finfo);
         allocator.Free(finfo);
     } /* if */
 
@@ -1618,7 +2745,7 @@ ZIP_openRead_failed:
         allocator.Free(retval);
 
     return NULL;
-} /* ZIP_openRead */
+} /* ZIP_openReadHashed */
 
 
 static PHYSFS_Io *ZIP_openWrite(void *opaque, const char *filename)
@@ -1646,9 +2773,18 @@ static int ZIP_mkdir(void *opaque, const char *name)
 
 
 static int ZIP_stat(void *opaque, const char *filename, PHYSFS_Stat *stat)
+{
+    return ZIP_statHashed(opaque, filename,
+                          __PHYSFS_hashString(filename, strlen(filename)), stat);
+} /* ZIP_stat */
+
+
+int ZIP_statHashed(void *opaque, const char *filename,
+                   const PHYSFS_uint32 hash, PHYSFS_Stat *stat)
 {
     ZIPinfo *info = (ZIPinfo *) opaque;
-    ZIPentry *entry = zip_find_entry(info, filename);
+    ZIPentry buf, linkbuf;
+    ZIPentry *entry = zip_lookup(info, filename, hash, &buf, &linkbuf);
 
     if (entry == NULL)
         return 0;
@@ -1680,7 +2816,196 @@ static int ZIP_stat(void *opaque, const char *filename, PHYSFS_Stat *stat)
     stat->readonly = 1; /* .zip files are always read only */
 
     return 1;
-} /* ZIP_stat */
+} /* ZIP_statHashed */
+
+
+static int ZIP_fingerprint(void *opaque, const char *filename, PHYSFS_uint64 *fp)
+{
+    ZIPinfo *info = (ZIPinfo *) opaque;
+    const PHYSFS_uint32 hash = __PHYSFS_hashString(filename, strlen(filename));
+    ZIPentry buf, linkbuf;
+    ZIPentry *entry = zip_lookup(info, filename, hash, &buf, &linkbuf);
+
+    BAIL_IF_ERRPASS(!entry, 0);
+    BAIL_IF(entry->tree.isdir, PHYSFS_ERR_NOT_A_FILE, 0);
+
+    /*
+     * The central directory already gave us the crc and size; only a
+     *  symlink needs its local header read, to find the entry it points to.
+     */
+    if (zip_entry_is_symlink(entry))
+    {
+        BAIL_IF_ERRPASS(!zip_resolve(info->io, info, entry), 0);
+        entry = entry->symlink;
+        BAIL_IF(entry->tree.isdir, PHYSFS_ERR_NOT_A_FILE, 0);
+    } /* if */
+
+    *fp = __PHYSFS_mixFingerprint(0, entry->crc);
+    *fp = __PHYSFS_mixFingerprint(*fp, entry->uncompressed_size);
+    return 1;
+} /* ZIP_fingerprint */
+
+
+/*
+ * An append that re-adds a path the archive already has (what most tools
+ *  do to "update" a file) would mean replacing an entry that open files
+ *  might still be reading. We don't do that; instead, every new record's
+ *  name is checked before anything touches the tree, so such a refresh
+ *  fails cleanly rather than leaving the mount half updated. The new names
+ *  go into a scratch tree first, so they get the same treatment the real
+ *  one would give them: duplicates, and files used as directories.
+ */
+typedef struct
+{
+    __PHYSFS_DirTreeEntry tree;
+    int hasRecord;  /* zero if only implied by something inside it. */
+} ZIPnewname;
+
+static int zip_check_new_names(ZIPinfo *info, const PHYSFS_uint64 central_ofs,
+                               const PHYSFS_uint64 entry_count)
+{
+    PHYSFS_Io *io = info->io;
+    __PHYSFS_DirTree names;
+    PHYSFS_uint64 pos = central_ofs + info->cdir_loaded;
+    PHYSFS_uint64 i;
+    char *name = NULL;
+    int retval = 0;
+
+    BAIL_IF_ERRPASS(!__PHYSFS_DirTreeInit(&names, sizeof (ZIPnewname)), 0);
+    name = (char *) allocator.Malloc(0xFFFF + 1);
+    GOTO_IF(!name, PHYSFS_ERR_OUT_OF_MEMORY, check_done);
+
+    for (i = info->entries_loaded; i < entry_count; i++)
+    {
+        PHYSFS_uint32 ui32;
+        PHYSFS_uint16 version, fnamelen, extralen, commentlen;
+        const ZIPentry *old;
+        ZIPnewname *added;
+        char *ptr;
+        int isdir = 0;
+
+        GOTO_IF_ERRPASS(!io->seek(io, pos), check_done);
+        GOTO_IF_ERRPASS(!readui32(io, &ui32), check_done);
+        GOTO_IF(ui32 != ZIP_CENTRAL_DIR_SIG, PHYSFS_ERR_CORRUPT, check_done);
+        GOTO_IF_ERRPASS(!readui16(io, &version), check_done);
+        GOTO_IF_ERRPASS(!io->seek(io, pos + 28), check_done);
+        GOTO_IF_ERRPASS(!readui16(io, &fnamelen), check_done);
+        GOTO_IF_ERRPASS(!readui16(io, &extralen), check_done);
+        GOTO_IF_ERRPASS(!readui16(io, &commentlen), check_done);
+        GOTO_IF_ERRPASS(!io->seek(io, pos + 46), check_done);
+        GOTO_IF_ERRPASS(!__PHYSFS_readAll(io, name, fnamelen), check_done);
+        pos += 46 + fnamelen + extralen + commentlen;
+
+        name[fnamelen] = '\0';
+        if ((fnamelen > 0) && (name[fnamelen - 1] == '/'))
+        {
+            name[fnamelen - 1] = '\0';
+            isdir = 1;
+        } /* if */
+        zip_convert_dos_path(version, name);
+
+        /* already in the archive, or a new record uses an old file as a dir? */
+        old = (const ZIPentry *) __PHYSFS_DirTreeFind(&info->tree, name);
+        GOTO_IF(old && ((old->last_mod_time != 0) || (!old->tree.isdir != !isdir)),
+                PHYSFS_ERR_UNSUPPORTED, check_done);
+        for (ptr = strchr(name, '/'); ptr != NULL; ptr = strchr(ptr + 1, '/'))
+        {
+            *ptr = '\0';
+            old = (const ZIPentry *) __PHYSFS_DirTreeFind(&info->tree, name);
+            *ptr = '/';
+            GOTO_IF(old && !old->tree.isdir, PHYSFS_ERR_UNSUPPORTED, check_done);
+        } /* for */
+
+        /* ...or twice among the new records? (the scratch tree checks parents.) */
+        added = (ZIPnewname *) __PHYSFS_DirTreeAdd(&names, name, isdir);
+        GOTO_IF_ERRPASS(!added, check_done);
+        GOTO_IF(added->hasRecord || (!added->tree.isdir != !isdir),
+                PHYSFS_ERR_UNSUPPORTED, check_done);
+        added->hasRecord = 1;
+    } /* for */
+
+    retval = 1;
+
+check_done:
+    if (name != NULL)
+        allocator.Free(name);
+    __PHYSFS_DirTreeDeinit(&names);
+    return retval;
+} /* zip_check_new_names */
+
+
+/*
+ * Pick up entries that were appended since we opened the archive. Writers
+ *  that append put the new data where the old central directory was and
+ *  write a new central directory after it, with the old records first in
+ *  their original order. So the records we already have are a prefix of
+ *  the new central directory, and we only parse what follows it. Existing
+ *  entries aren't touched, so files that are open stay valid. Anything
+ *  that doesn't look like an append, including an append that replaces an
+ *  existing path, fails, and needs a real remount.
+ */
+static int zip_refresh(ZIPinfo *info)
+{
+    PHYSFS_uint64 dstart = 0;
+    PHYSFS_uint64 cdir_ofs = 0;
+    PHYSFS_uint64 cdir_size = 0;
+    PHYSFS_uint64 count = 0;
+
+    BAIL_IF_ERRPASS(!zip_parse_end_of_central_dir(info, &dstart, &cdir_ofs,
+                                                  &cdir_size, &count), 0);
+
+    BAIL_IF(dstart != info->data_start, PHYSFS_ERR_UNSUPPORTED, 0);
+    BAIL_IF(cdir_ofs < info->append_ofs, PHYSFS_ERR_UNSUPPORTED, 0);
+    BAIL_IF(count < info->entries_loaded, PHYSFS_ERR_UNSUPPORTED, 0);
+    BAIL_IF(cdir_size < info->cdir_loaded, PHYSFS_ERR_UNSUPPORTED, 0);
+
+    /*
+     * Make sure the old records really are still a prefix: the last one we
+     *  loaded has to be where we left it, byte for byte. Records hold the
+     *  name, CRC and data offset, so a rewritten archive won't match.
+     */
+    if (info->entries_loaded > 0)
+    {
+        const PHYSFS_uint64 len = info->cdir_loaded - info->last_record;
+        PHYSFS_uint32 hash = 0;
+        BAIL_IF_ERRPASS(!zip_hash_record(info->io, cdir_ofs + info->last_record,
+                                         len, &hash), 0);
+        BAIL_IF(hash != info->last_hash, PHYSFS_ERR_UNSUPPORTED, 0);
+    } /* if */
+
+    if ((cdir_ofs == info->cdir_ofs) && (count == info->entries_loaded))
+        return 1;  /* nothing new. */
+
+    BAIL_IF_ERRPASS(!zip_check_new_names(info, cdir_ofs, count), 0);
+
+    /*
+     * If this fails partway (i/o error, out of memory), what we loaded
+     *  stays loaded and counted, so another refresh later picks up where
+     *  this one stopped.
+     */
+    info->cdir_ofs = cdir_ofs;
+    BAIL_IF_ERRPASS(!zip_load_entries(info, dstart, cdir_ofs, count), 0);
+
+    info->append_ofs = cdir_ofs;
+    return 1;
+} /* zip_refresh */
+
+static int ZIP_refresh(void *opaque)
+{
+    ZIPinfo *info = (ZIPinfo *) opaque;
+    const PHYSFS_uint64 cdir_ofs = info->cdir_ofs;
+    int retval;
+
+    /* a shared index is read-only; remount to pick up a new one. */
+    BAIL_IF(info->index != NULL, PHYSFS_ERR_UNSUPPORTED, 0);
+
+    /* see the file as it is now, even if our handle to it was closed. If
+       we loaded anything from it, even after failing partway, keep it. */
+    BAIL_IF_ERRPASS(!__PHYSFS_nativeIoBeginRefresh(info->io), 0);
+    retval = zip_refresh(info);
+    __PHYSFS_nativeIoEndRefresh(info->io, retval || (info->cdir_ofs != cdir_ofs));
+    return retval;
+} /* ZIP_refresh */
 
 
 const PHYSFS_Archiver __PHYSFS_Archiver_ZIP =
@@ -1694,14 +3019,17 @@ const PHYSFS_Archiver __PHYSFS_Archiver_ZIP =
         1,  /* supportsSymlinks */
     },
     ZIP_openArchive,
-    __PHYSFS_DirTreeEnumerate,
+    ZIP_enumerate,
     ZIP_openRead,
     ZIP_openWrite,
     ZIP_openAppend,
     ZIP_remove,
     ZIP_mkdir,
     ZIP_stat,
-    ZIP_closeArchive
+    ZIP_closeArchive,
+    ZIP_fingerprint,
+    ZIP_refresh,
+    ZIP_sniff
 };
 
 #endif  /* defined PHYSFS_SUPPORTS_ZIP */
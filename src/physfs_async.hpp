@@ -0,0 +1,435 @@
+/**
+ * \file physfs_async.hpp
+ *
+ * Header-only C++20 coroutine interface to PhysicsFS.
+ */
+
+/*
+ * This lets coroutines co_await file loads instead of blocking in
+ *  PHYSFS_readBytes(). A small pool of worker threads does the actual
+ *  PhysicsFS calls; a coroutine that awaits a load is just a suspended frame
+ *  sitting in a queue, so you can have thousands of loads in flight on a
+ *  handful of OS threads.
+ *
+ * \code
+ * physfs::AsyncIo io(4);   // four worker threads.
+ *
+ * MyTask loadLevel(physfs::AsyncIo &io)
+ * {
+ *     auto bytes = co_await io.read_file("maps/e1m1.bsp");
+ *     if (!bytes) co_return;  // bytes.error() says why.
+ *
+ *     auto file = co_await io.open("maps/e1m1.lit");
+ *     std::byte header[32];
+ *     auto got = co_await file->read_at(128, header);
+ * }
+ *
+ * // ... in the main loop, if you constructed with Resume::OnPoll ...
+ * io.poll();  // resumes finished coroutines right here.
+ * \endcode
+ *
+ * Where a coroutine resumes is up to you: by default it resumes on the
+ *  worker that finished its request, but with Resume::OnPoll finished
+ *  requests go into a completion queue and resume on whatever thread calls
+ *  poll(), which is usually what a game loop wants.
+ *
+ * The awaitables work with any coroutine type; this header doesn't impose
+ *  a task type of its own.
+ *
+ * Everything here goes through the regular, blocking PhysicsFS API on the
+ *  worker threads, so it works with every archiver. (There's no io_uring
+ *  backend: archive entries are read through PHYSFS_Io, which might be
+ *  inflating a zip entry or reading from memory, not a raw descriptor.)
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ */
+
+#ifndef _INCLUDE_PHYSFS_ASYNC_HPP_
+#define _INCLUDE_PHYSFS_ASYNC_HPP_
+
+#if (__cplusplus < 202002L) && !(defined(_MSVC_LANG) && (_MSVC_LANG >= 202002L))
+#error physfs_async.hpp needs C++20 coroutines.
+#endif
+
+#include "physfs.hpp"
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace physfs
+{
+
+class AsyncIo;
+
+namespace detail
+{
+
+/*
+ * One queued request. Awaitables derive from this and live in the awaiting
+ *  coroutine's frame, so nothing is allocated per request; the frame can't
+ *  go away while it's suspended waiting on us.
+ */
+struct AsyncOp
+{
+    virtual void run() = 0;  /* called on a worker thread. */
+    std::coroutine_handle<> waiter;
+protected:
+    ~AsyncOp() = default;
+};
+
+} /* namespace detail */
+
+
+/**
+ * \brief Worker pool and completion queue for coroutine file i/o.
+ *
+ * Create one after PHYSFS_init() and destroy it before PHYSFS_deinit().
+ *  The destructor waits for queued requests to finish; with Resume::OnPoll,
+ *  coroutines still waiting in the completion queue at that point are
+ *  resumed by the destructor on the calling thread.
+ */
+class AsyncIo
+{
+public:
+    enum class Resume
+    {
+        OnWorker,  /* resume on the worker thread that finished the request. */
+        OnPoll     /* queue the completion; poll() resumes it. */
+    };
+
+    explicit AsyncIo(unsigned threads = 2, Resume how = Resume::OnWorker)
+        : resumeMode(how), stopping(false)
+    {
+        if (threads == 0)
+            threads = 1;
+        workers.reserve(threads);
+        for (unsigned i = 0; i < threads; i++)
+            workers.emplace_back([this] { workerMain(); });
+    }
+
+    ~AsyncIo()
+    {
+        {
+            std::lock_guard<std::mutex> guard(queueLock);
+            stopping = true;
+        }
+        queueCond.notify_all();
+        for (std::thread &t : workers)
+            t.join();
+        while (poll() > 0) { /* drain. */ }
+    }
+
+    AsyncIo(const AsyncIo &) = delete;
+    AsyncIo &operator=(const AsyncIo &) = delete;
+
+    /*
+     * Resume every coroutine whose request has finished, on this thread.
+     *  Returns how many were resumed. Only useful with Resume::OnPoll.
+     */
+    std::size_t poll()
+    {
+        std::deque<std::coroutine_handle<>> ready;
+        {
+            std::lock_guard<std::mutex> guard(doneLock);
+            ready.swap(completed);
+        }
+        for (std::coroutine_handle<> h : ready)
+            h.resume();
+        return ready.size();
+    }
+
+    /* Number of requests queued or running right now. */
+    std::size_t pending() const
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        return queue.size() + busy;
+    }
+
+    class ReadFileOp;
+    class OpenOp;
+
+    /* co_await: Result<std::vector<std::byte>> with the whole file. */
+    inline ReadFileOp read_file(std::string path);
+
+    /* co_await: Result<AsyncFile> opened for reading. */
+    inline OpenOp open(std::string path);
+
+private:
+    friend class AsyncFile;
+
+    void submit(detail::AsyncOp *op, std::coroutine_handle<> h)
+    {
+        op->waiter = h;
+        {
+            std::lock_guard<std::mutex> guard(queueLock);
+            queue.push_back(op);
+        }
+        queueCond.notify_one();
+    }
+
+    void complete(detail::AsyncOp *op)
+    {
+        std::coroutine_handle<> h = op->waiter;  /* op may die on resume. */
+        if (resumeMode == Resume::OnWorker)
+            h.resume();
+        else
+        {
+            std::lock_guard<std::mutex> guard(doneLock);
+            completed.push_back(h);
+        }
+    }
+
+    void workerMain()
+    {
+        while (true)
+        {
+            detail::AsyncOp *op = nullptr;
+            {
+                std::unique_lock<std::mutex> guard(queueLock);
+                queueCond.wait(guard, [this] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;  /* stopping, and nothing left to do. */
+                op = queue.front();
+                queue.pop_front();
+                busy++;
+            }
+
+            op->run();
+
+            {
+                std::lock_guard<std::mutex> guard(queueLock);
+                busy--;
+            }
+            complete(op);
+        }
+    }
+
+    const Resume resumeMode;
+    mutable std::mutex queueLock;
+    std::condition_variable queueCond;
+    std::deque<detail::AsyncOp *> queue;
+    std::size_t busy = 0;
+    bool stopping;
+    std::mutex doneLock;
+    std::deque<std::coroutine_handle<>> completed;
+    std::vector<std::thread> workers;
+};
+
+
+/**
+ * \brief A file open for reading, with positional coroutine reads.
+ *
+ * A PHYSFS_File has one file pointer and isn't safe to use from two threads
+ *  at once, so reads on the same AsyncFile are serialized (seek+read under
+ *  a lock); reads on different files run in parallel. If you want parallel
+ *  reads of one file, open it more than once.
+ *
+ * Movable; destroy it (or close it) before its AsyncIo goes away. A read
+ *  that's in flight keeps the underlying file open until it finishes, so
+ *  moving or destroying the AsyncFile meanwhile is safe.
+ */
+class AsyncFile
+{
+    /* Shared with in-flight reads, so it outlives a moved-from AsyncFile. */
+    struct State
+    {
+        explicit State(File &&f) : file(std::move(f)) {}
+        std::mutex lock;
+        File file;
+    };
+
+public:
+    AsyncFile() = default;
+    AsyncFile(AsyncIo *_io, File &&f) : io(_io), state(std::make_shared<State>(std::move(f))) {}
+
+    explicit operator bool() const noexcept { return state && state->file; }
+    File &file() noexcept { return state->file; }
+
+    class ReadAtOp final : public detail::AsyncOp
+    {
+    public:
+        ReadAtOp(AsyncIo *_io, std::shared_ptr<State> _state, PHYSFS_uint64 _off, Span<std::byte> _buf)
+            : io(_io), state(std::move(_state)), off(_off), buf(_buf), result(Error(PHYSFS_ERR_OTHER_ERROR))
+        {
+            if (!usable())  /* default-constructed AsyncFile: fail right away. */
+                result = Error(PHYSFS_ERR_INVALID_ARGUMENT);
+        }
+
+        bool await_ready() const noexcept { return !usable(); }
+        void await_suspend(std::coroutine_handle<> h) { io->submit(this, h); }
+        Result<std::size_t> await_resume() { return std::move(result); }
+
+        void run() override
+        {
+            std::lock_guard<std::mutex> guard(state->lock);
+            File &file = state->file;
+            Result<void> rc = file.seek(off);
+            if (!rc)
+                result = rc.error();
+            else
+                result = file.read(buf);
+        }
+
+    private:
+        bool usable() const noexcept { return (io != nullptr) && state; }
+
+        AsyncIo *io;
+        std::shared_ptr<State> state;  /* not the AsyncFile, which can move. */
+        PHYSFS_uint64 off;
+        Span<std::byte> buf;
+        Result<std::size_t> result;
+    };
+
+    /* co_await: Result<std::size_t>, bytes read at (offset); short at EOF. */
+    ReadAtOp read_at(PHYSFS_uint64 offset, Span<std::byte> buffer)
+    {
+        return ReadAtOp(io, state, offset, buffer);
+    }
+
+    Result<void> close()
+    {
+        if (!state)
+            return Result<void>();
+        std::lock_guard<std::mutex> guard(state->lock);
+        return state->file.close();
+    }
+
+private:
+    AsyncIo *io = nullptr;
+    std::shared_ptr<State> state;
+};
+
+
+class AsyncIo::ReadFileOp final : public detail::AsyncOp
+{
+public:
+    ReadFileOp(AsyncIo *_io, std::string _path)
+        : io(_io), path(std::move(_path)), result(Error(PHYSFS_ERR_OTHER_ERROR)) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { io->submit(this, h); }
+    Result<std::vector<std::byte>> await_resume() { return std::move(result); }
+
+    void run() override
+    {
+        /* don't let a huge (or lying) length take the worker thread down. */
+        try
+        {
+            load();
+        }
+        catch (const std::bad_alloc &)
+        {
+            result = Error(PHYSFS_ERR_OUT_OF_MEMORY);
+        }
+    }
+
+private:
+    void load()
+    {
+        Result<File> f = File::openRead(path);
+        if (!f)
+        {
+            result = f.error();
+            return;
+        }
+
+        std::vector<std::byte> data;
+        Result<PHYSFS_uint64> len = f->length();
+        if (len)  /* known length: one big read. */
+        {
+            if (*len > (PHYSFS_uint64) data.max_size())
+            {
+                result = Error(PHYSFS_ERR_OUT_OF_MEMORY);
+                return;
+            }
+            data.resize((std::size_t) *len);
+            Result<void> rc = f->readExact(data);
+            if (!rc)
+            {
+                result = rc.error();
+                return;
+            }
+        }
+        else  /* length unknown (some Ios can't tell); read until EOF. */
+        {
+            std::byte chunk[64 * 1024];
+            while (true)
+            {
+                Result<std::size_t> rc = f->read(chunk);
+                if (!rc)
+                {
+                    result = rc.error();
+                    return;
+                }
+                else if (*rc == 0)
+                    break;
+                data.insert(data.end(), chunk, chunk + *rc);
+            }
+        }
+
+        result = std::move(data);
+    }
+
+    AsyncIo *io;
+    std::string path;
+    Result<std::vector<std::byte>> result;
+};
+
+
+class AsyncIo::OpenOp final : public detail::AsyncOp
+{
+public:
+    OpenOp(AsyncIo *_io, std::string _path)
+        : io(_io), path(std::move(_path)), result(Error(PHYSFS_ERR_OTHER_ERROR)) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { io->submit(this, h); }
+    Result<AsyncFile> await_resume() { return std::move(result); }
+
+    void run() override
+    {
+        Result<File> f = File::openRead(path);
+        if (!f)
+            result = f.error();
+        else
+        {
+            try
+            {
+                result = AsyncFile(io, std::move(*f));
+            }
+            catch (const std::bad_alloc &)
+            {
+                result = Error(PHYSFS_ERR_OUT_OF_MEMORY);
+            }
+        }
+    }
+
+private:
+    AsyncIo *io;
+    std::string path;
+    Result<AsyncFile> result;
+};
+
+
+inline AsyncIo::ReadFileOp AsyncIo::read_file(std::string path)
+{
+    return ReadFileOp(this, std::move(path));
+}
+
+inline AsyncIo::OpenOp AsyncIo::open(std::string path)
+{
+    return OpenOp(this, std::move(path));
+}
+
+} /* namespace physfs */
+
+#endif  /* include-once blocker. */
+
+/* end of physfs_async.hpp ... */
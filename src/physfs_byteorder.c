@@ -8,6 +8,21 @@
  *  This file written by Ryan C. Gordon.
  */
 
+/* vector headers may use malloc(), which physfs_internal.h won't allow. */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PHYSFS_SWAP_AVX2 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define PHYSFS_SWAP_SSSE3 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define PHYSFS_SWAP_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PHYSFS_SWAP_NEON 1
+#endif
+
 #define __PHYSICSFS_INTERNAL__
 #include "physfs_internal.h"
 
@@ -80,6 +95,156 @@ PHYSFS_uint64 PHYSFS_swapUBE64(PHYSFS_uint64 x) { return x; }
 PHYSFS_sint64 PHYSFS_swapSBE64(PHYSFS_sint64 x) { return x; }
 #endif
 
+/*
+ * Bulk byteswapping. These use whatever vector unit the compiler is
+ *  allowed to target (no runtime dispatch, so build with -mavx2 or similar
+ *  if you want more than SSE2 on x86_64), and finish the tail one at a time.
+ */
+#if PHYSFS_SWAP_AVX2
+#define SWAP_SHUFFLE_KERNEL(name, bits, ...) \
+    static PHYSFS_uint64 name(PHYSFS_uint8 *p, PHYSFS_uint64 count) { \
+        const __m256i mask = _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__); \
+        const PHYSFS_uint64 perloop = 32 / (bits / 8); \
+        PHYSFS_uint64 i; \
+        for (i = 0; i + perloop <= count; i += perloop, p += 32) { \
+            const __m256i v = _mm256_loadu_si256((const __m256i *) p); \
+            _mm256_storeu_si256((__m256i *) p, _mm256_shuffle_epi8(v, mask)); \
+        } \
+        return i; \
+    }
+#elif PHYSFS_SWAP_SSSE3
+#define SWAP_SHUFFLE_KERNEL(name, bits, ...) \
+    static PHYSFS_uint64 name(PHYSFS_uint8 *p, PHYSFS_uint64 count) { \
+        const __m128i mask = _mm_setr_epi8(__VA_ARGS__); \
+        const PHYSFS_uint64 perloop = 16 / (bits / 8); \
+        PHYSFS_uint64 i; \
+        for (i = 0; i + perloop <= count; i += perloop, p += 16) { \
+            const __m128i v = _mm_loadu_si128((const __m128i *) p); \
+            _mm_storeu_si128((__m128i *) p, _mm_shuffle_epi8(v, mask)); \
+        } \
+        return i; \
+    }
+#endif
+
+#if defined(SWAP_SHUFFLE_KERNEL)
+SWAP_SHUFFLE_KERNEL(swapVec16, 16, 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14)
+SWAP_SHUFFLE_KERNEL(swapVec32, 32, 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12)
+SWAP_SHUFFLE_KERNEL(swapVec64, 64, 7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8)
+#undef SWAP_SHUFFLE_KERNEL
+
+#elif PHYSFS_SWAP_SSE2
+/* no byte shuffle in plain SSE2, but shifts within lanes get us there. */
+static inline __m128i swapLanes16(const __m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+} /* swapLanes16 */
+
+static inline __m128i swapLanes32(const __m128i v)
+{
+    return swapLanes16(_mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16)));
+} /* swapLanes32 */
+
+static PHYSFS_uint64 swapVec16(PHYSFS_uint8 *p, PHYSFS_uint64 count)
+{
+    PHYSFS_uint64 i;
+    for (i = 0; i + 8 <= count; i += 8, p += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *) p);
+        _mm_storeu_si128((__m128i *) p, swapLanes16(v));
+    } /* for */
+    return i;
+} /* swapVec16 */
+
+static PHYSFS_uint64 swapVec32(PHYSFS_uint8 *p, PHYSFS_uint64 count)
+{
+    PHYSFS_uint64 i;
+    for (i = 0; i + 4 <= count; i += 4, p += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *) p);
+        _mm_storeu_si128((__m128i *) p, swapLanes32(v));
+    } /* for */
+    return i;
+} /* swapVec32 */
+
+static PHYSFS_uint64 swapVec64(PHYSFS_uint8 *p, PHYSFS_uint64 count)
+{
+    PHYSFS_uint64 i;
+    for (i = 0; i + 2 <= count; i += 2, p += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *) p);
+        const __m128i halves = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128((__m128i *) p, swapLanes32(halves));
+    } /* for */
+    return i;
+} /* swapVec64 */
+
+#elif PHYSFS_SWAP_NEON
+#define SWAP_NEON_KERNEL(name, bytes, rev) \
+    static PHYSFS_uint64 name(PHYSFS_uint8 *p, PHYSFS_uint64 count) { \
+        const PHYSFS_uint64 perloop = 16 / bytes; \
+        PHYSFS_uint64 i; \
+        for (i = 0; i + perloop <= count; i += perloop, p += 16) \
+            vst1q_u8(p, rev(vld1q_u8(p))); \
+        return i; \
+    }
+SWAP_NEON_KERNEL(swapVec16, 2, vrev16q_u8)
+SWAP_NEON_KERNEL(swapVec32, 4, vrev32q_u8)
+SWAP_NEON_KERNEL(swapVec64, 8, vrev64q_u8)
+#undef SWAP_NEON_KERNEL
+
+#else
+#define swapVec16(p, count) (0)
+#define swapVec32(p, count) (0)
+#define swapVec64(p, count) (0)
+#endif
+
+static void swapArray16(PHYSFS_uint16 *vals, PHYSFS_uint64 count)
+{
+    PHYSFS_uint64 i = swapVec16((PHYSFS_uint8 *) vals, count);
+    for (; i < count; i++)
+        vals[i] = PHYSFS_Swap16(vals[i]);
+} /* swapArray16 */
+
+static void swapArray32(PHYSFS_uint32 *vals, PHYSFS_uint64 count)
+{
+    PHYSFS_uint64 i = swapVec32((PHYSFS_uint8 *) vals, count);
+    for (; i < count; i++)
+        vals[i] = PHYSFS_Swap32(vals[i]);
+} /* swapArray32 */
+
+static void swapArray64(PHYSFS_uint64 *vals, PHYSFS_uint64 count)
+{
+    PHYSFS_uint64 i = swapVec64((PHYSFS_uint8 *) vals, count);
+    for (; i < count; i++)
+        vals[i] = PHYSFS_Swap64(vals[i]);
+} /* swapArray64 */
+
+static void swapArrayNone(void *vals, PHYSFS_uint64 count) { /* native. */ }
+
+#if PHYSFS_BYTEORDER == PHYSFS_LIL_ENDIAN
+#define swapArrayLE16(v, c) swapArrayNone(v, c)
+#define swapArrayLE32(v, c) swapArrayNone(v, c)
+#define swapArrayLE64(v, c) swapArrayNone(v, c)
+#define swapArrayBE16(v, c) swapArray16((PHYSFS_uint16 *) (v), c)
+#define swapArrayBE32(v, c) swapArray32((PHYSFS_uint32 *) (v), c)
+#define swapArrayBE64(v, c) swapArray64((PHYSFS_uint64 *) (v), c)
+#else
+#define swapArrayLE16(v, c) swapArray16((PHYSFS_uint16 *) (v), c)
+#define swapArrayLE32(v, c) swapArray32((PHYSFS_uint32 *) (v), c)
+#define swapArrayLE64(v, c) swapArray64((PHYSFS_uint64 *) (v), c)
+#define swapArrayBE16(v, c) swapArrayNone(v, c)
+#define swapArrayBE32(v, c) swapArrayNone(v, c)
+#define swapArrayBE64(v, c) swapArrayNone(v, c)
+#endif
+
+void PHYSFS_swapArrayLE16(PHYSFS_uint16 *v, PHYSFS_uint64 c) { swapArrayLE16(v, c); }
+void PHYSFS_swapArrayLE32(PHYSFS_uint32 *v, PHYSFS_uint64 c) { swapArrayLE32(v, c); }
+void PHYSFS_swapArrayLE64(PHYSFS_uint64 *v, PHYSFS_uint64 c) { swapArrayLE64(v, c); }
+void PHYSFS_swapArrayBE16(PHYSFS_uint16 *v, PHYSFS_uint64 c) { swapArrayBE16(v, c); }
+void PHYSFS_swapArrayBE32(PHYSFS_uint32 *v, PHYSFS_uint64 c) { swapArrayBE32(v, c); }
+void PHYSFS_swapArrayBE64(PHYSFS_uint64 *v, PHYSFS_uint64 c) { swapArrayBE64(v, c); }
+
+
 static inline int readAll(PHYSFS_File *file, void *val, const size_t len)
 {
     return (PHYSFS_readBytes(file, val, len) == len);
@@ -108,6 +273,34 @@ PHYSFS_BYTEORDER_READ(sint64, SBE64)
 PHYSFS_BYTEORDER_READ(uint64, UBE64)
 
 
+/* one read for the whole array, then swap it where it landed. */
+#define PHYSFS_BYTEORDER_READ_ARRAY(datatype, sign, order, bits) \
+    int PHYSFS_readArray##sign##order##bits(PHYSFS_File *file, \
+                                            PHYSFS_##datatype *vals, \
+                                            PHYSFS_uint64 count) { \
+        const PHYSFS_uint64 len = count * sizeof (PHYSFS_##datatype); \
+        BAIL_IF((vals == NULL) && (count > 0), PHYSFS_ERR_INVALID_ARGUMENT, 0); \
+        BAIL_IF(count > (~((PHYSFS_uint64) 0) >> 1) / sizeof (PHYSFS_##datatype), \
+                PHYSFS_ERR_INVALID_ARGUMENT, 0); \
+        BAIL_IF_ERRPASS(PHYSFS_readBytes(file, vals, len) != (PHYSFS_sint64) len, 0); \
+        swapArray##order##bits(vals, count); \
+        return 1; \
+    }
+
+PHYSFS_BYTEORDER_READ_ARRAY(sint16, S, LE, 16)
+PHYSFS_BYTEORDER_READ_ARRAY(uint16, U, LE, 16)
+PHYSFS_BYTEORDER_READ_ARRAY(sint16, S, BE, 16)
+PHYSFS_BYTEORDER_READ_ARRAY(uint16, U, BE, 16)
+PHYSFS_BYTEORDER_READ_ARRAY(sint32, S, LE, 32)
+PHYSFS_BYTEORDER_READ_ARRAY(uint32, U, LE, 32)
+PHYSFS_BYTEORDER_READ_ARRAY(sint32, S, BE, 32)
+PHYSFS_BYTEORDER_READ_ARRAY(uint32, U, BE, 32)
+PHYSFS_BYTEORDER_READ_ARRAY(sint64, S, LE, 64)
+PHYSFS_BYTEORDER_READ_ARRAY(uint64, U, LE, 64)
+PHYSFS_BYTEORDER_READ_ARRAY(sint64, S, BE, 64)
+PHYSFS_BYTEORDER_READ_ARRAY(uint64, U, BE, 64)
+
+
 static inline int writeAll(PHYSFS_File *f, const void *val, const size_t len)
 {
     return (PHYSFS_writeBytes(f, val, len) == len);
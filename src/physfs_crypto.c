@@ -0,0 +1,588 @@
+/**
+ * PhysicsFS; a portable, flexible file i/o abstraction.
+ *
+ * Documentation is in physfs.h. It's verbose, honest.  :)
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ *
+ *  This file written by the PhysicsFS contributors.
+ */
+
+/*
+ * Just enough crypto to read WinZip AES encrypted ZIP entries: AES
+ *  encryption (counter mode only needs that direction), SHA-1, HMAC-SHA1
+ *  and PBKDF2. AES uses AES-NI on x86 CPUs that have it (checked at
+ *  runtime) and the ARMv8 crypto extensions when the compiler targets
+ *  them, and falls back to plain C everywhere else.
+ *
+ * None of this makes any attempt to resist timing attacks; it's for
+ *  reading your own data files, not for talking to strangers.
+ */
+
+/* vector headers may use malloc(), which physfs_internal.h won't allow. */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 5)))
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#include <cpuid.h>
+#define PHYSFS_AES_NI 1
+#define PHYSFS_AES_NI_TARGET __attribute__((target("aes,sse2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#include <intrin.h>
+#define PHYSFS_AES_NI 1
+#define PHYSFS_AES_NI_TARGET
+#elif defined(__aarch64__) && \
+      (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#include <arm_neon.h>
+#define PHYSFS_AES_ARMV8 1
+#endif
+
+#define __PHYSICSFS_INTERNAL__
+#include "physfs_internal.h"
+
+static const PHYSFS_uint8 aesSbox[256] = {
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5,
+    0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0,
+    0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC,
+    0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A,
+    0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0,
+    0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B,
+    0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85,
+    0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5,
+    0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17,
+    0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88,
+    0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C,
+    0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9,
+    0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6,
+    0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E,
+    0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94,
+    0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68,
+    0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+static PHYSFS_uint8 aesXtime(const PHYSFS_uint8 x)
+{
+    return (PHYSFS_uint8) ((x << 1) ^ ((x & 0x80) ? 0x1B : 0x00));
+} /* aesXtime */
+
+
+static int aesHaveCpuSupport(void)
+{
+#if defined(PHYSFS_AES_NI) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 1);
+    return ((regs[2] & (1 << 25)) != 0) && ((regs[3] & (1 << 26)) != 0);
+#elif defined(PHYSFS_AES_NI)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    return ((ecx & bit_AES) != 0) && ((edx & bit_SSE2) != 0);
+#elif defined(PHYSFS_AES_ARMV8)
+    return 1;  /* we wouldn't have been built for this CPU otherwise. */
+#else
+    return 0;
+#endif
+} /* aesHaveCpuSupport */
+
+
+int __PHYSFS_AESInit(__PHYSFS_AESContext *ctx, const PHYSFS_uint8 *key,
+                     const size_t keylen)
+{
+    const size_t nk = keylen / 4;
+    const size_t words = 4 * (nk + 7);  /* 4 * (rounds + 1) */
+    PHYSFS_uint8 *w = ctx->roundkeys;
+    PHYSFS_uint8 rcon = 0x01;
+    size_t i;
+
+    if ((keylen != 16) && (keylen != 24) && (keylen != 32))
+        return 0;
+
+    ctx->rounds = (int) (nk + 6);
+    ctx->accel = aesHaveCpuSupport();
+
+    /* the accelerated paths load all 15 round keys; zero the unused ones. */
+    memset(ctx->roundkeys, '\0', sizeof (ctx->roundkeys));
+    memcpy(w, key, keylen);
+    for (i = nk; i < words; i++)
+    {
+        PHYSFS_uint8 t[4];
+        memcpy(t, w + ((i - 1) * 4), 4);
+        if ((i % nk) == 0)
+        {
+            const PHYSFS_uint8 t0 = t[0];
+            t[0] = aesSbox[t[1]] ^ rcon;
+            t[1] = aesSbox[t[2]];
+            t[2] = aesSbox[t[3]];
+            t[3] = aesSbox[t0];
+            rcon = aesXtime(rcon);
+        } /* if */
+        else if ((nk > 6) && ((i % nk) == 4))
+        {
+            t[0] = aesSbox[t[0]];
+            t[1] = aesSbox[t[1]];
+            t[2] = aesSbox[t[2]];
+            t[3] = aesSbox[t[3]];
+        } /* else if */
+
+        w[(i * 4) + 0] = w[((i - nk) * 4) + 0] ^ t[0];
+        w[(i * 4) + 1] = w[((i - nk) * 4) + 1] ^ t[1];
+        w[(i * 4) + 2] = w[((i - nk) * 4) + 2] ^ t[2];
+        w[(i * 4) + 3] = w[((i - nk) * 4) + 3] ^ t[3];
+    } /* for */
+
+    return 1;
+} /* __PHYSFS_AESInit */
+
+
+static void aesEncryptBlockC(const __PHYSFS_AESContext *ctx,
+                             const PHYSFS_uint8 *in, PHYSFS_uint8 *out)
+{
+    const PHYSFS_uint8 *rk = ctx->roundkeys;
+    PHYSFS_uint8 s[16];
+    PHYSFS_uint8 t[16];
+    int round, i;
+
+    for (i = 0; i < 16; i++)
+        s[i] = in[i] ^ rk[i];
+
+    for (round = 1; round <= ctx->rounds; round++)
+    {
+        /* SubBytes and ShiftRows together; the state is column-major. */
+        for (i = 0; i < 16; i++)
+            t[i] = aesSbox[s[(i + ((i % 4) * 4)) % 16]];
+
+        if (round == ctx->rounds)
+            memcpy(s, t, 16);  /* no MixColumns in the last round. */
+        else
+        {
+            for (i = 0; i < 16; i += 4)
+            {
+                const PHYSFS_uint8 a0 = t[i], a1 = t[i+1];
+                const PHYSFS_uint8 a2 = t[i+2], a3 = t[i+3];
+                const PHYSFS_uint8 all = a0 ^ a1 ^ a2 ^ a3;
+                s[i+0] = a0 ^ all ^ aesXtime(a0 ^ a1);
+                s[i+1] = a1 ^ all ^ aesXtime(a1 ^ a2);
+                s[i+2] = a2 ^ all ^ aesXtime(a2 ^ a3);
+                s[i+3] = a3 ^ all ^ aesXtime(a3 ^ a0);
+            } /* for */
+        } /* else */
+
+        rk += 16;
+        for (i = 0; i < 16; i++)
+            s[i] ^= rk[i];
+    } /* for */
+
+    memcpy(out, s, 16);
+} /* aesEncryptBlockC */
+
+
+static void aesWinZipCounter(PHYSFS_uint64 block, PHYSFS_uint8 *ctr)
+{
+    int i;
+    block++;  /* WinZip counts from one. */
+    for (i = 0; i < 8; i++, block >>= 8)
+        ctr[i] = (PHYSFS_uint8) (block & 0xFF);
+    memset(ctr + 8, '\0', 8);
+} /* aesWinZipCounter */
+
+
+static void aesCtrBlocksC(const __PHYSFS_AESContext *ctx,
+                          PHYSFS_uint64 block, PHYSFS_uint8 *buf,
+                          size_t blocks)
+{
+    PHYSFS_uint8 ctr[16];
+    PHYSFS_uint8 ks[16];
+    int i;
+
+    for (; blocks > 0; blocks--, block++, buf += 16)
+    {
+        aesWinZipCounter(block, ctr);
+        aesEncryptBlockC(ctx, ctr, ks);
+        for (i = 0; i < 16; i++)
+            buf[i] ^= ks[i];
+    } /* for */
+} /* aesCtrBlocksC */
+
+
+#if PHYSFS_AES_NI
+/* four blocks at a time, so the AES unit's pipeline stays full. */
+static PHYSFS_AES_NI_TARGET void aesCtrBlocksNI(const __PHYSFS_AESContext *ctx,
+                                                PHYSFS_uint64 block,
+                                                PHYSFS_uint8 *buf,
+                                                size_t blocks)
+{
+    const int rounds = ctx->rounds;
+    __m128i rk[15];
+    int i;
+
+    for (i = 0; i < 15; i++)
+        rk[i] = _mm_loadu_si128((const __m128i *) (ctx->roundkeys + (i * 16)));
+
+    /* the counter's low 64 bits come first, in little-endian order. */
+    for (; blocks >= 4; blocks -= 4, block += 4, buf += 64)
+    {
+        __m128i *p = (__m128i *) buf;
+        __m128i b0 = _mm_set_epi64x(0, (long long) (block + 1));
+        __m128i b1 = _mm_set_epi64x(0, (long long) (block + 2));
+        __m128i b2 = _mm_set_epi64x(0, (long long) (block + 3));
+        __m128i b3 = _mm_set_epi64x(0, (long long) (block + 4));
+        b0 = _mm_xor_si128(b0, rk[0]);
+        b1 = _mm_xor_si128(b1, rk[0]);
+        b2 = _mm_xor_si128(b2, rk[0]);
+        b3 = _mm_xor_si128(b3, rk[0]);
+        for (i = 1; i < rounds; i++)
+        {
+            b0 = _mm_aesenc_si128(b0, rk[i]);
+            b1 = _mm_aesenc_si128(b1, rk[i]);
+            b2 = _mm_aesenc_si128(b2, rk[i]);
+            b3 = _mm_aesenc_si128(b3, rk[i]);
+        } /* for */
+        b0 = _mm_aesenclast_si128(b0, rk[rounds]);
+        b1 = _mm_aesenclast_si128(b1, rk[rounds]);
+        b2 = _mm_aesenclast_si128(b2, rk[rounds]);
+        b3 = _mm_aesenclast_si128(b3, rk[rounds]);
+        _mm_storeu_si128(p + 0, _mm_xor_si128(b0, _mm_loadu_si128(p + 0)));
+        _mm_storeu_si128(p + 1, _mm_xor_si128(b1, _mm_loadu_si128(p + 1)));
+        _mm_storeu_si128(p + 2, _mm_xor_si128(b2, _mm_loadu_si128(p + 2)));
+        _mm_storeu_si128(p + 3, _mm_xor_si128(b3, _mm_loadu_si128(p + 3)));
+    } /* for */
+
+    for (; blocks > 0; blocks--, block++, buf += 16)
+    {
+        __m128i *p = (__m128i *) buf;
+        __m128i b = _mm_set_epi64x(0, (long long) (block + 1));
+        b = _mm_xor_si128(b, rk[0]);
+        for (i = 1; i < rounds; i++)
+            b = _mm_aesenc_si128(b, rk[i]);
+        b = _mm_aesenclast_si128(b, rk[rounds]);
+        _mm_storeu_si128(p, _mm_xor_si128(b, _mm_loadu_si128(p)));
+    } /* for */
+} /* aesCtrBlocksNI */
+#endif
+
+
+#if PHYSFS_AES_ARMV8
+static void aesCtrBlocksARMv8(const __PHYSFS_AESContext *ctx,
+                              PHYSFS_uint64 block, PHYSFS_uint8 *buf,
+                              size_t blocks)
+{
+    const int rounds = ctx->rounds;
+    uint8x16_t rk[15];
+    PHYSFS_uint8 ctr[16];
+    int i;
+
+    for (i = 0; i < 15; i++)
+        rk[i] = vld1q_u8(ctx->roundkeys + (i * 16));
+
+    /* AESE does AddRoundKey first, so the round keys are one step ahead. */
+    for (; blocks > 0; blocks--, block++, buf += 16)
+    {
+        uint8x16_t b;
+        aesWinZipCounter(block, ctr);
+        b = vld1q_u8(ctr);
+        for (i = 0; i < rounds - 1; i++)
+            b = vaesmcq_u8(vaeseq_u8(b, rk[i]));
+        b = vaeseq_u8(b, rk[rounds - 1]);
+        b = veorq_u8(b, rk[rounds]);
+        vst1q_u8(buf, veorq_u8(b, vld1q_u8(buf)));
+    } /* for */
+} /* aesCtrBlocksARMv8 */
+#endif
+
+
+static void aesCtrBlocks(const __PHYSFS_AESContext *ctx,
+                         const PHYSFS_uint64 block, PHYSFS_uint8 *buf,
+                         const size_t blocks)
+{
+#if PHYSFS_AES_NI
+    if (ctx->accel)
+    {
+        aesCtrBlocksNI(ctx, block, buf, blocks);
+        return;
+    } /* if */
+#elif PHYSFS_AES_ARMV8
+    if (ctx->accel)
+    {
+        aesCtrBlocksARMv8(ctx, block, buf, blocks);
+        return;
+    } /* if */
+#endif
+    aesCtrBlocksC(ctx, block, buf, blocks);
+} /* aesCtrBlocks */
+
+
+void __PHYSFS_AESCTRWinZip(const __PHYSFS_AESContext *ctx,
+                           const PHYSFS_uint64 pos, PHYSFS_uint8 *buf,
+                           size_t len)
+{
+    PHYSFS_uint64 block = pos / 16;
+    const size_t skip = (size_t) (pos % 16);
+    PHYSFS_uint8 tmp[16];
+    size_t full;
+
+    if ((skip != 0) || (len < 16))  /* partial block at the start. */
+    {
+        const size_t avail = 16 - skip;
+        const size_t cpy = (len < avail) ? len : avail;
+        memset(tmp, '\0', sizeof (tmp));
+        memcpy(tmp + skip, buf, cpy);
+        aesCtrBlocks(ctx, block, tmp, 1);
+        memcpy(buf, tmp + skip, cpy);
+        buf += cpy;
+        len -= cpy;
+        block++;
+    } /* if */
+
+    full = len / 16;
+    if (full > 0)
+    {
+        aesCtrBlocks(ctx, block, buf, full);
+        buf += full * 16;
+        len -= full * 16;
+        block += full;
+    } /* if */
+
+    if (len > 0)  /* partial block at the end. */
+    {
+        memset(tmp, '\0', sizeof (tmp));
+        memcpy(tmp, buf, len);
+        aesCtrBlocks(ctx, block, tmp, 1);
+        memcpy(buf, tmp, len);
+    } /* if */
+} /* __PHYSFS_AESCTRWinZip */
+
+
+#define SHA1_ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1Transform(PHYSFS_uint32 *state, const PHYSFS_uint8 *data)
+{
+    PHYSFS_uint32 w[80];
+    PHYSFS_uint32 a = state[0], b = state[1], c = state[2];
+    PHYSFS_uint32 d = state[3], e = state[4];
+    int i;
+
+    for (i = 0; i < 16; i++, data += 4)
+    {
+        w[i] = (((PHYSFS_uint32) data[0]) << 24) |
+               (((PHYSFS_uint32) data[1]) << 16) |
+               (((PHYSFS_uint32) data[2]) << 8) |
+               (((PHYSFS_uint32) data[3]));
+    } /* for */
+
+    for (; i < 80; i++)
+        w[i] = SHA1_ROL(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+
+    for (i = 0; i < 80; i++)
+    {
+        PHYSFS_uint32 f, k, tmp;
+        if (i < 20)
+        {
+            f = (b & c) | ((~b) & d);
+            k = 0x5A827999;
+        } /* if */
+        else if (i < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } /* else if */
+        else if (i < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } /* else if */
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        } /* else */
+
+        tmp = SHA1_ROL(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = SHA1_ROL(b, 30);
+        b = a;
+        a = tmp;
+    } /* for */
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+} /* sha1Transform */
+
+#undef SHA1_ROL
+
+
+void __PHYSFS_SHA1Init(__PHYSFS_SHA1Context *ctx)
+{
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xEFCDAB89;
+    ctx->state[2] = 0x98BADCFE;
+    ctx->state[3] = 0x10325476;
+    ctx->state[4] = 0xC3D2E1F0;
+    ctx->count = 0;
+} /* __PHYSFS_SHA1Init */
+
+
+void __PHYSFS_SHA1Update(__PHYSFS_SHA1Context *ctx, const void *_data,
+                         size_t len)
+{
+    const PHYSFS_uint8 *data = (const PHYSFS_uint8 *) _data;
+    size_t used = (size_t) (ctx->count % 64);
+
+    ctx->count += len;
+
+    if (used > 0)
+    {
+        const size_t cpy = ((64 - used) < len) ? (64 - used) : len;
+        memcpy(ctx->buffer + used, data, cpy);
+        data += cpy;
+        len -= cpy;
+        used += cpy;
+        if (used < 64)
+            return;
+        sha1Transform(ctx->state, ctx->buffer);
+    } /* if */
+
+    for (; len >= 64; len -= 64, data += 64)
+        sha1Transform(ctx->state, data);
+
+    memcpy(ctx->buffer, data, len);
+} /* __PHYSFS_SHA1Update */
+
+
+void __PHYSFS_SHA1Final(__PHYSFS_SHA1Context *ctx, PHYSFS_uint8 *digest)
+{
+    const PHYSFS_uint64 bits = ctx->count * 8;
+    static const PHYSFS_uint8 pad = 0x80;
+    static const PHYSFS_uint8 zeroes[64] = { 0 };
+    PHYSFS_uint8 lenbytes[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+        lenbytes[i] = (PHYSFS_uint8) ((bits >> (56 - (i * 8))) & 0xFF);
+
+    __PHYSFS_SHA1Update(ctx, &pad, 1);
+    __PHYSFS_SHA1Update(ctx, zeroes, (size_t) ((120 - (ctx->count % 64)) % 64));
+    __PHYSFS_SHA1Update(ctx, lenbytes, 8);
+
+    for (i = 0; i < 20; i++)
+        digest[i] = (PHYSFS_uint8) ((ctx->state[i / 4] >> (24 - ((i % 4) * 8))) & 0xFF);
+} /* __PHYSFS_SHA1Final */
+
+
+void __PHYSFS_HMACSHA1Init(__PHYSFS_HMACSHA1Context *ctx,
+                           const PHYSFS_uint8 *key, size_t keylen)
+{
+    PHYSFS_uint8 keyblock[64];
+    PHYSFS_uint8 pad[64];
+    int i;
+
+    memset(keyblock, '\0', sizeof (keyblock));
+    if (keylen <= sizeof (keyblock))
+        memcpy(keyblock, key, keylen);
+    else
+    {
+        __PHYSFS_SHA1Context keyctx;
+        __PHYSFS_SHA1Init(&keyctx);
+        __PHYSFS_SHA1Update(&keyctx, key, keylen);
+        __PHYSFS_SHA1Final(&keyctx, keyblock);
+    } /* else */
+
+    for (i = 0; i < 64; i++)
+        pad[i] = keyblock[i] ^ 0x36;
+    __PHYSFS_SHA1Init(&ctx->inner);
+    __PHYSFS_SHA1Update(&ctx->inner, pad, sizeof (pad));
+
+    for (i = 0; i < 64; i++)
+        pad[i] = keyblock[i] ^ 0x5C;
+    __PHYSFS_SHA1Init(&ctx->outer);
+    __PHYSFS_SHA1Update(&ctx->outer, pad, sizeof (pad));
+} /* __PHYSFS_HMACSHA1Init */
+
+
+void __PHYSFS_HMACSHA1Update(__PHYSFS_HMACSHA1Context *ctx,
+                             const void *data, size_t len)
+{
+    __PHYSFS_SHA1Update(&ctx->inner, data, len);
+} /* __PHYSFS_HMACSHA1Update */
+
+
+void __PHYSFS_HMACSHA1Final(__PHYSFS_HMACSHA1Context *ctx,
+                            PHYSFS_uint8 *digest)
+{
+    PHYSFS_uint8 innerdigest[20];
+    __PHYSFS_SHA1Final(&ctx->inner, innerdigest);
+    __PHYSFS_SHA1Update(&ctx->outer, innerdigest, sizeof (innerdigest));
+    __PHYSFS_SHA1Final(&ctx->outer, digest);
+} /* __PHYSFS_HMACSHA1Final */
+
+
+void __PHYSFS_PBKDF2SHA1(const PHYSFS_uint8 *password, size_t passwordlen,
+                         const PHYSFS_uint8 *salt, size_t saltlen,
+                         PHYSFS_uint32 iterations, PHYSFS_uint8 *out,
+                         size_t outlen)
+{
+    __PHYSFS_HMACSHA1Context keyed;
+    PHYSFS_uint32 blocknum = 1;
+
+    /* the keyed state is the same for every HMAC, so only make it once. */
+    __PHYSFS_HMACSHA1Init(&keyed, password, passwordlen);
+
+    while (outlen > 0)
+    {
+        __PHYSFS_HMACSHA1Context hmac;
+        PHYSFS_uint8 u[20];
+        PHYSFS_uint8 t[20];
+        PHYSFS_uint8 be[4];
+        const size_t cpy = (outlen < sizeof (t)) ? outlen : sizeof (t);
+        PHYSFS_uint32 i;
+        int j;
+
+        be[0] = (PHYSFS_uint8) ((blocknum >> 24) & 0xFF);
+        be[1] = (PHYSFS_uint8) ((blocknum >> 16) & 0xFF);
+        be[2] = (PHYSFS_uint8) ((blocknum >> 8) & 0xFF);
+        be[3] = (PHYSFS_uint8) (blocknum & 0xFF);
+
+        memcpy(&hmac, &keyed, sizeof (hmac));
+        __PHYSFS_HMACSHA1Update(&hmac, salt, saltlen);
+        __PHYSFS_HMACSHA1Update(&hmac, be, sizeof (be));
+        __PHYSFS_HMACSHA1Final(&hmac, u);
+        memcpy(t, u, sizeof (t));
+
+        for (i = 1; i < iterations; i++)
+        {
+            memcpy(&hmac, &keyed, sizeof (hmac));
+            __PHYSFS_HMACSHA1Update(&hmac, u, sizeof (u));
+            __PHYSFS_HMACSHA1Final(&hmac, u);
+            for (j = 0; j < 20; j++)
+                t[j] ^= u[j];
+        } /* for */
+
+        memcpy(out, t, cpy);
+        out += cpy;
+        outlen -= cpy;
+        blocknum++;
+    } /* while */
+} /* __PHYSFS_PBKDF2SHA1 */
+
+/* end of physfs_crypto.c ... */
+
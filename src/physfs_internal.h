@@ -91,6 +91,8 @@ extern const PHYSFS_Archiver __PHYSFS_Archiver_WAD;
 extern const PHYSFS_Archiver __PHYSFS_Archiver_SLB;
 extern const PHYSFS_Archiver __PHYSFS_Archiver_ISO9660;
 extern const PHYSFS_Archiver __PHYSFS_Archiver_VDF;
+extern const PHYSFS_Archiver __PHYSFS_Archiver_CAS;
+extern const PHYSFS_Archiver __PHYSFS_Archiver_TAR;
 
 /* a real C99-compliant snprintf() is in Visual Studio 2015,
    but just use this everywhere for binary compatibility. */
@@ -114,8 +116,8 @@ __PHYSFS_COMPILE_TIME_ASSERT(LongEqualsInt, sizeof (int) == sizeof (long));
 #define __PHYSFS_ATOMIC_INCR(ptrval) _InterlockedIncrement((long*)(ptrval))
 #define __PHYSFS_ATOMIC_DECR(ptrval) _InterlockedDecrement((long*)(ptrval))
 #elif defined(__clang__) || (defined(__GNUC__) && (((__GNUC__ * 10000) + (__GNUC_MINOR__ * 100)) >= 40100))
-#define __PHYSFS_ATOMIC_INCR(ptrval) __sync_fetch_and_add(ptrval, 1)
-#define __PHYSFS_ATOMIC_DECR(ptrval) __sync_fetch_and_add(ptrval, -1)
+#define __PHYSFS_ATOMIC_INCR(ptrval) __sync_add_and_fetch(ptrval, 1)
+#define __PHYSFS_ATOMIC_DECR(ptrval) __sync_sub_and_fetch(ptrval, 1)
 #else
 #define PHYSFS_NEED_ATOMIC_OP_FALLBACK 1
 int __PHYSFS_ATOMIC_INCR(int *ptrval);
@@ -165,6 +167,9 @@ void __PHYSFS_smallFree(void *ptr);
 #ifndef PHYSFS_SUPPORTS_ZIP
 #define PHYSFS_SUPPORTS_ZIP 1
 #endif
+#ifndef PHYSFS_SUPPORTS_ZIP_ZSTD
+#define PHYSFS_SUPPORTS_ZIP_ZSTD 1
+#endif
 #ifndef PHYSFS_SUPPORTS_7Z
 #define PHYSFS_SUPPORTS_7Z 1
 #endif
@@ -192,6 +197,12 @@ void __PHYSFS_smallFree(void *ptr);
 #ifndef PHYSFS_SUPPORTS_VDF
 #define PHYSFS_SUPPORTS_VDF 1
 #endif
+#ifndef PHYSFS_SUPPORTS_CAS
+#define PHYSFS_SUPPORTS_CAS 1
+#endif
+#ifndef PHYSFS_SUPPORTS_TAR
+#define PHYSFS_SUPPORTS_TAR 1
+#endif
 
 #if PHYSFS_SUPPORTS_7Z
 /* 7zip support needs a global init function called at startup (no deinit). */
@@ -202,7 +213,7 @@ extern void SZIP_global_init(void);
 #define CURRENT_PHYSFS_IO_API_VERSION 0
 
 /* The latest supported PHYSFS_Archiver::version value. */
-#define CURRENT_PHYSFS_ARCHIVER_API_VERSION 0
+#define CURRENT_PHYSFS_ARCHIVER_API_VERSION 3
 
 /* This byteorder stuff was lifted from SDL. https://www.libsdl.org/ */
 #define PHYSFS_LIL_ENDIAN  1234
@@ -305,6 +316,54 @@ char *__PHYSFS_strdup(const char *str);
  */
 PHYSFS_uint32 __PHYSFS_hashString(const char *str, size_t len);
 
+/*
+ * Fold (val) into fingerprint (fp) and return the result. Start with zero.
+ *  Archivers use this to build PHYSFS_getFingerprint() values.
+ */
+PHYSFS_uint64 __PHYSFS_mixFingerprint(PHYSFS_uint64 fp, const PHYSFS_uint64 val);
+
+/*
+ * Update a CRC-32 (the one zlib and .zip files use) with (len) bytes of
+ *  (buf), and return the result. Start with zero.
+ */
+PHYSFS_uint32 __PHYSFS_crc32(PHYSFS_uint32 crc, const void *buf, size_t len);
+
+/*
+ * The directory set with PHYSFS_setArchiveIndexDir(), with a trailing
+ *  separator, or NULL if archive indexes aren't being shared. Only valid
+ *  while holding the state lock, which is the case in openArchive().
+ */
+const char *__PHYSFS_getArchiveIndexDir(void);
+
+/*
+ * Where the index for the archive at native path (fname) goes in the
+ *  archive index directory, as "<hash>.<ext>". The hash is of the archive's
+ *  canonical path, so processes that name it differently (say, relative to
+ *  different working directories) agree; that path goes in (*key), for the
+ *  index to record and check. Returns an allocated string, and sets (*key)
+ *  to another, both to free with allocator.Free(); or NULL if there's no
+ *  index directory (or on failure), leaving (*key) NULL. Same locking rules
+ *  as above.
+ */
+char *__PHYSFS_archiveIndexPath(const char *fname, const char *ext, char **key);
+
+/*
+ * The extraction cache (see PHYSFS_setExtractCache()), for archivers that
+ *  decompress. (io) is a freshly-opened i/o that decompresses an entry;
+ *  this returns an i/o that reads the same thing, which on its first read
+ *  or seek switches to the cached copy (after checking it against (crc)),
+ *  or reads all of (io) into a new one. Either way it takes ownership of
+ *  (io). If there's no cache, or (len) is too big for it, or anything goes
+ *  wrong, it just returns (io). (key) must identify the decompressed
+ *  contents: mix in the archive's fingerprint and the entry's name, CRC and
+ *  sizes. (crc) is the CRC-32 of the decompressed contents, and (len) is
+ *  their size. Call this only while holding the state lock, which is the
+ *  case in openRead(); reading the result doesn't need it.
+ */
+PHYSFS_Io *__PHYSFS_extractCacheWrap(const PHYSFS_uint64 key,
+                                     const PHYSFS_uint32 crc,
+                                     PHYSFS_Io *io, const PHYSFS_uint64 len);
+
 
 /*
  * The current allocator. Not valid before PHYSFS_init is called!
@@ -321,6 +380,26 @@ extern PHYSFS_Allocator __PHYSFS_AllocatorHooks;
  */
 PHYSFS_Io *__PHYSFS_createNativeIo(const char *path, const int mode);
 
+/*
+ * If (io) came from __PHYSFS_createNativeIo(), return the path it was
+ *  opened with. Otherwise (memory, subarchives, app-supplied i/o), NULL.
+ */
+const char *__PHYSFS_nativeIoPath(PHYSFS_Io *io);
+
+/*
+ * An archiver's refresh method calls these around looking at its file
+ *  again. While a file is closed to stay under PHYSFS_setMaxOpenFiles(), a
+ *  changed file normally fails to reopen, so between these, (io) and its
+ *  duplicates read whatever file is at its path now instead. Pass nonzero
+ *  (keep) to __PHYSFS_nativeIoEndRefresh() if the refresh worked, to stick
+ *  with that file; zero goes back to the old one. They do nothing for i/o
+ *  that didn't come from __PHYSFS_createNativeIo().
+ *  __PHYSFS_nativeIoBeginRefresh() returns zero on error, in which case
+ *  don't call the other one.
+ */
+int __PHYSFS_nativeIoBeginRefresh(PHYSFS_Io *io);
+void __PHYSFS_nativeIoEndRefresh(PHYSFS_Io *io, const int keep);
+
 /*
  * Create a PHYSFS_Io for a buffer of memory (READ-ONLY). If you already
  *  have one of these, just use its duplicate() method, and it'll increment
@@ -329,6 +408,18 @@ PHYSFS_Io *__PHYSFS_createNativeIo(const char *path, const int mode);
 PHYSFS_Io *__PHYSFS_createMemoryIo(const void *buf, PHYSFS_uint64 len,
                                    void (*destruct)(void *));
 
+/*
+ * Create a PHYSFS_Io for (len) bytes of (io), starting at (offset)
+ *  (READ-ONLY). This is for archivers that store an entry's bytes as-is
+ *  inside the archive. It takes ownership of (io), which must be a
+ *  private duplicate; destroying the new Io destroys (io), too. If (io) is
+ *  already one of these, the new window is made over its parent instead,
+ *  so archives inside archives read from the outermost Io directly.
+ *  On failure, (io) is left for the caller to destroy.
+ */
+PHYSFS_Io *__PHYSFS_createSubIo(PHYSFS_Io *io, PHYSFS_uint64 offset,
+                                PHYSFS_uint64 len);
+
 
 /*
  * Read (len) bytes from (io) into (buf). Returns non-zero on success,
@@ -353,6 +444,21 @@ int UNPK_mkdir(void *opaque, const char *name);
 int UNPK_stat(void *opaque, const char *fn, PHYSFS_Stat *st);
 #define UNPK_enumerate __PHYSFS_DirTreeEnumerate
 
+/*
+ * Versions of openRead() and stat() that take __PHYSFS_hashString() of all
+ *  of the name, so physfs.c can hand over the hash a PHYSFS_Path already
+ *  has instead of the archiver working it out again. (The ZIP ones, like
+ *  __PHYSFS_Archiver_ZIP, only exist if PHYSFS_SUPPORTS_ZIP.)
+ */
+PHYSFS_Io *UNPK_openReadHashed(void *opaque, const char *name,
+                               const PHYSFS_uint32 hash);
+int UNPK_statHashed(void *opaque, const char *fn, const PHYSFS_uint32 hash,
+                    PHYSFS_Stat *st);
+PHYSFS_Io *ZIP_openReadHashed(void *opaque, const char *name,
+                              const PHYSFS_uint32 hash);
+int ZIP_statHashed(void *opaque, const char *fn, const PHYSFS_uint32 hash,
+                   PHYSFS_Stat *st);
+
 
 
 /* Optional API many archivers use this to manage their directory tree. */
@@ -379,6 +485,9 @@ typedef struct __PHYSFS_DirTree
 int __PHYSFS_DirTreeInit(__PHYSFS_DirTree *dt, const size_t entrylen);
 void *__PHYSFS_DirTreeAdd(__PHYSFS_DirTree *dt, char *name, const int isdir);
 void *__PHYSFS_DirTreeFind(__PHYSFS_DirTree *dt, const char *path);
+/* (hash) is __PHYSFS_hashString() of all of (path). */
+void *__PHYSFS_DirTreeFindHashed(__PHYSFS_DirTree *dt, const char *path,
+                                 const PHYSFS_uint32 hash);
 PHYSFS_EnumerateCallbackResult __PHYSFS_DirTreeEnumerate(void *opaque,
                               const char *dname, PHYSFS_EnumerateCallback cb,
                               const char *origdir, void *callbackdata);
@@ -386,6 +495,62 @@ void __PHYSFS_DirTreeDeinit(__PHYSFS_DirTree *dt);
 
 
 
+/* Crypto for WinZip AES encrypted ZIP entries. See physfs_crypto.c. */
+
+typedef struct __PHYSFS_AESContext
+{
+    PHYSFS_uint8 roundkeys[15 * 16];  /* expanded key, FIPS-197 order.  */
+    int rounds;                       /* 10, 12 or 14.                  */
+    int accel;               /* non-zero to use the CPU's AES opcodes.  */
+} __PHYSFS_AESContext;
+
+typedef struct __PHYSFS_SHA1Context
+{
+    PHYSFS_uint32 state[5];
+    PHYSFS_uint64 count;     /* bytes hashed so far.                    */
+    PHYSFS_uint8 buffer[64]; /* partial block, (count % 64) bytes.      */
+} __PHYSFS_SHA1Context;
+
+typedef struct __PHYSFS_HMACSHA1Context
+{
+    __PHYSFS_SHA1Context inner;
+    __PHYSFS_SHA1Context outer;
+} __PHYSFS_HMACSHA1Context;
+
+/* (keylen) is 16, 24 or 32. Returns zero for any other length. */
+int __PHYSFS_AESInit(__PHYSFS_AESContext *ctx, const PHYSFS_uint8 *key,
+                     const size_t keylen);
+
+/*
+ * En/decrypt (len) bytes of (buf) in place with AES in counter mode, as
+ *  WinZip does it: the counter for the 16-byte block at byte (pos) of the
+ *  stream is that block's number plus one, as a little-endian integer. So
+ *  any part of the stream can be decrypted without the parts before it.
+ */
+void __PHYSFS_AESCTRWinZip(const __PHYSFS_AESContext *ctx,
+                           const PHYSFS_uint64 pos, PHYSFS_uint8 *buf,
+                           size_t len);
+
+void __PHYSFS_SHA1Init(__PHYSFS_SHA1Context *ctx);
+void __PHYSFS_SHA1Update(__PHYSFS_SHA1Context *ctx, const void *data,
+                         size_t len);
+void __PHYSFS_SHA1Final(__PHYSFS_SHA1Context *ctx, PHYSFS_uint8 *digest);
+
+void __PHYSFS_HMACSHA1Init(__PHYSFS_HMACSHA1Context *ctx,
+                           const PHYSFS_uint8 *key, size_t keylen);
+void __PHYSFS_HMACSHA1Update(__PHYSFS_HMACSHA1Context *ctx,
+                             const void *data, size_t len);
+void __PHYSFS_HMACSHA1Final(__PHYSFS_HMACSHA1Context *ctx,
+                            PHYSFS_uint8 *digest);
+
+/* PBKDF2 (RFC 2898) with HMAC-SHA1, writing (outlen) bytes to (out). */
+void __PHYSFS_PBKDF2SHA1(const PHYSFS_uint8 *password, size_t passwordlen,
+                         const PHYSFS_uint8 *salt, size_t saltlen,
+                         PHYSFS_uint32 iterations, PHYSFS_uint8 *out,
+                         size_t outlen);
+
+
+
 /*--------------------------------------------------------------------------*/
 /*--------------------------------------------------------------------------*/
 /*------------                                              ----------------*/
@@ -492,6 +657,18 @@ void *__PHYSFS_platformOpenAppend(const char *filename);
  */
 PHYSFS_sint64 __PHYSFS_platformRead(void *opaque, void *buf, PHYSFS_uint64 len);
 
+/*
+ * Read up to (len) bytes at byte offset (pos) from a handle opened with
+ *  __PHYSFS_platformOpenRead(), like __PHYSFS_platformRead(), but without
+ *  using the handle's file pointer: several threads may read the same
+ *  handle at different offsets at once. The file pointer is left
+ *  undefined afterwards. Return the number of bytes read, zero at (or past)
+ *  the end of the file, or (-1) on error, having called
+ *  PHYSFS_setErrorCode().
+ */
+PHYSFS_sint64 __PHYSFS_platformReadAt(void *opaque, void *buf,
+                                      PHYSFS_uint64 len, PHYSFS_uint64 pos);
+
 /*
  * Write more data to a platform-specific file handle. (opaque) should be
  *  cast to whatever data type your platform uses. Write a maximum of (len)
@@ -556,6 +733,63 @@ PHYSFS_sint64 __PHYSFS_platformFileLength(void *handle);
  */
 int __PHYSFS_platformStat(const char *fn, PHYSFS_Stat *stat, const int follow);
 
+/*
+ * Fingerprint file (fn) from its metadata, for PHYSFS_getFingerprint():
+ *  build (*fp) with __PHYSFS_mixFingerprint() from whatever identifies this
+ *  version of the file (device/inode, modification time, size...). Symlinks
+ *  are followed. Fail with PHYSFS_ERR_NOT_A_FILE for directories, and with
+ *  PHYSFS_ERR_UNSUPPORTED if the platform can't do better than
+ *  __PHYSFS_platformStat().
+ *
+ *  Return zero on failure, non-zero on success.
+ */
+int __PHYSFS_platformFingerprint(const char *fn, PHYSFS_uint64 *fp);
+
+/*
+ * Map file (fn) into memory, read-only and shared, so every process that
+ *  maps it uses the same physical pages. Set (*len) to its size. Fail with
+ *  PHYSFS_ERR_UNSUPPORTED if the platform can't map files.
+ *
+ *  Return NULL on failure, the mapping on success.
+ */
+void *__PHYSFS_platformMapFile(const char *fn, PHYSFS_uint64 *len);
+
+/*
+ * Undo __PHYSFS_platformMapFile(). (len) is what it reported. Never fails.
+ */
+void __PHYSFS_platformUnmapFile(void *ptr, PHYSFS_uint64 len);
+
+/*
+ * Get the absolute, canonical form of native path (fn), which must exist,
+ *  so every process names the same file the same way, whatever its working
+ *  directory. Resolve symlinks and "." and ".." if the platform can.
+ *
+ *  Return NULL on failure, the path (allocated with allocator.Malloc())
+ *  on success.
+ */
+char *__PHYSFS_platformCanonicalPath(const char *fn);
+
+/*
+ * Write (len) bytes from (data) to a new file (fn), atomically: other
+ *  processes either see no file, the old one, or the complete new one,
+ *  never a partial write. Write to a freshly named temporary file next to
+ *  (fn), then rename it over (fn); a temporary file left behind by a
+ *  process that died mustn't stop this from working. The file must be
+ *  readable by other processes of the same user.
+ *
+ *  Return zero on failure, non-zero on success.
+ */
+int __PHYSFS_platformPublishFile(const char *fn, const void *data,
+                                 PHYSFS_uint64 len);
+
+/*
+ * Set file (fn)'s modification time to now, without changing its contents.
+ *  Fail with PHYSFS_ERR_UNSUPPORTED if the platform can't.
+ *
+ *  Return zero on failure, non-zero on success.
+ */
+int __PHYSFS_platformTouch(const char *fn);
+
 /*
  * Flush any pending writes to disk. (opaque) should be cast to whatever data
  *  type your platform uses. Be sure to check for errors; the caller expects
@@ -295,12 +295,20 @@ static void prepUnicodeSupport(void)
 int __PHYSFS_platformInit(void)
 {
     prepUnicodeSupport();
+    if (DosCreateMutexSem(NULL, &readAtMutex, 0, 0) != NO_ERROR)
+        readAtMutex = 0;  /* positional reads will fail; everything else works. */
     return 1;  /* ready to go! */
 } /* __PHYSFS_platformInit */
 
 
 void __PHYSFS_platformDeinit(void)
 {
+    if (readAtMutex)
+    {
+        DosCloseMutexSem(readAtMutex);
+        readAtMutex = 0;
+    } /* if */
+
     if (uconvdll)
     {
         pUniFreeUconvObject(uconv);
@@ -621,6 +629,22 @@ PHYSFS_sint64 __PHYSFS_platformRead(void *opaque, void *buf, PHYSFS_uint64 len)
 } /* __PHYSFS_platformRead */
 
 
+/* OS/2 has no positional reads, so seek-and-read pairs are serialized. */
+static HMTX readAtMutex = 0;
+
+PHYSFS_sint64 __PHYSFS_platformReadAt(void *opaque, void *buf,
+                                      PHYSFS_uint64 len, PHYSFS_uint64 pos)
+{
+    PHYSFS_sint64 retval = -1;
+    BAIL_IF(readAtMutex == 0, PHYSFS_ERR_NOT_INITIALIZED, -1);
+    DosRequestMutexSem(readAtMutex, SEM_INDEFINITE_WAIT);
+    if (__PHYSFS_platformSeek(opaque, pos))
+        retval = __PHYSFS_platformRead(opaque, buf, len);
+    DosReleaseMutexSem(readAtMutex);
+    return retval;
+} /* __PHYSFS_platformReadAt */
+
+
 PHYSFS_sint64 __PHYSFS_platformWrite(void *opaque, const void *buf,
                                      PHYSFS_uint64 len)
 {
@@ -765,6 +789,52 @@ done:
 } /* __PHYSFS_platformStat */
 
 
+int __PHYSFS_platformFingerprint(const char *filename, PHYSFS_uint64 *fp)
+{
+    /* no file ids on OS/2; the caller falls back to __PHYSFS_platformStat. */
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+} /* __PHYSFS_platformFingerprint */
+
+
+void *__PHYSFS_platformMapFile(const char *fname, PHYSFS_uint64 *len)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* no shared file mappings here. */
+} /* __PHYSFS_platformMapFile */
+
+
+void __PHYSFS_platformUnmapFile(void *ptr, PHYSFS_uint64 len)
+{
+    /* never mapped anything, so nothing to do. */
+} /* __PHYSFS_platformUnmapFile */
+
+
+char *__PHYSFS_platformCanonicalPath(const char *fname)
+{
+    char *cpstr = cvtUtf8ToCodepage(fname);
+    char buf[CCHMAXPATH];
+    APIRET rc;
+
+    BAIL_IF_ERRPASS(!cpstr, NULL);
+    rc = DosQueryPathInfo(cpstr, FIL_QUERYFULLNAME, buf, sizeof (buf));
+    allocator.Free(cpstr);
+    BAIL_IF(rc != NO_ERROR, errcodeFromAPIRET(rc), NULL);
+    return cvtCodepageToUtf8(buf);
+} /* __PHYSFS_platformCanonicalPath */
+
+
+int __PHYSFS_platformPublishFile(const char *fname, const void *data,
+                                 PHYSFS_uint64 len)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+} /* __PHYSFS_platformPublishFile */
+
+
+int __PHYSFS_platformTouch(const char *fname)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);  /* !!! FIXME: DosSetPathInfo? */
+} /* __PHYSFS_platformTouch */
+
+
 void *__PHYSFS_platformGetThreadID(void)
 {
     PTIB ptib;
@@ -17,10 +17,13 @@
 #include <ctype.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <pwd.h>
+#include <utime.h>
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <pthread.h>
 
 #include "physfs_internal.h"
@@ -227,6 +230,24 @@ PHYSFS_sint64 __PHYSFS_platformRead(void *opaque, void *buffer,
 } /* __PHYSFS_platformRead */
 
 
+PHYSFS_sint64 __PHYSFS_platformReadAt(void *opaque, void *buffer,
+                                      PHYSFS_uint64 len, PHYSFS_uint64 pos)
+{
+    const int fd = *((int *) opaque);
+    ssize_t rc = 0;
+
+    if (!__PHYSFS_ui64FitsAddressSpace(len))
+        BAIL(PHYSFS_ERR_INVALID_ARGUMENT, -1);
+    BAIL_IF(((PHYSFS_sint64) pos) < 0, PHYSFS_ERR_INVALID_ARGUMENT, -1);
+
+    rc = pread(fd, buffer, (size_t) len, (off_t) pos);
+    BAIL_IF(rc == -1, errcodeFromErrno(), -1);
+    assert(rc >= 0);
+    assert(rc <= len);
+    return (PHYSFS_sint64) rc;
+} /* __PHYSFS_platformReadAt */
+
+
 PHYSFS_sint64 __PHYSFS_platformWrite(void *opaque, const void *buffer,
                                      PHYSFS_uint64 len)
 {
@@ -335,6 +356,156 @@ int __PHYSFS_platformStat(const char *fname, PHYSFS_Stat *st, const int follow)
 } /* __PHYSFS_platformStat */
 
 
+int __PHYSFS_platformFingerprint(const char *fname, PHYSFS_uint64 *fp)
+{
+    struct stat statbuf;
+    PHYSFS_uint64 nsec = 0;
+
+    BAIL_IF(stat(fname, &statbuf) == -1, errcodeFromErrno(), 0);
+    BAIL_IF(S_ISDIR(statbuf.st_mode), PHYSFS_ERR_NOT_A_FILE, 0);
+
+    /* sub-second times catch a rewrite that keeps the size. */
+    #if defined(__APPLE__)
+    nsec = (PHYSFS_uint64) statbuf.st_mtimespec.tv_nsec;
+    #elif defined(__linux__)
+    nsec = (PHYSFS_uint64) statbuf.st_mtim.tv_nsec;
+    #endif
+
+    *fp = __PHYSFS_mixFingerprint(0, (PHYSFS_uint64) statbuf.st_dev);
+    *fp = __PHYSFS_mixFingerprint(*fp, (PHYSFS_uint64) statbuf.st_ino);
+    *fp = __PHYSFS_mixFingerprint(*fp, (PHYSFS_uint64) statbuf.st_size);
+    *fp = __PHYSFS_mixFingerprint(*fp, (PHYSFS_uint64) statbuf.st_mtime);
+    *fp = __PHYSFS_mixFingerprint(*fp, nsec);
+    *fp = __PHYSFS_mixFingerprint(*fp, (PHYSFS_uint64) statbuf.st_ctime);
+    return 1;
+} /* __PHYSFS_platformFingerprint */
+
+
+void *__PHYSFS_platformMapFile(const char *fname, PHYSFS_uint64 *len)
+{
+    struct stat statbuf;
+    void *retval;
+    int err;
+    int fd;
+
+    fd = open(fname, O_RDONLY);
+    BAIL_IF(fd < 0, errcodeFromErrno(), NULL);
+
+    if (fstat(fd, &statbuf) == -1)
+    {
+        err = errno;
+        close(fd);
+        BAIL(errcodeFromErrnoError(err), NULL);
+    } /* if */
+
+    if ((statbuf.st_size <= 0) ||
+        (!__PHYSFS_ui64FitsAddressSpace((PHYSFS_uint64) statbuf.st_size)))
+    {
+        close(fd);
+        BAIL(PHYSFS_ERR_CORRUPT, NULL);
+    } /* if */
+
+    retval = mmap(NULL, (size_t) statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    err = errno;
+    close(fd);  /* the mapping keeps the file alive. */
+    BAIL_IF(retval == MAP_FAILED, errcodeFromErrnoError(err), NULL);
+
+    *len = (PHYSFS_uint64) statbuf.st_size;
+    return retval;
+} /* __PHYSFS_platformMapFile */
+
+
+void __PHYSFS_platformUnmapFile(void *ptr, PHYSFS_uint64 len)
+{
+    (void) munmap(ptr, (size_t) len);
+} /* __PHYSFS_platformUnmapFile */
+
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+char *__PHYSFS_platformCanonicalPath(const char *fname)
+{
+    char buf[PATH_MAX];
+    char *retval;
+
+    BAIL_IF(realpath(fname, buf) == NULL, errcodeFromErrno(), NULL);
+    retval = (char *) allocator.Malloc(strlen(buf) + 1);
+    BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    strcpy(retval, buf);
+    return retval;
+} /* __PHYSFS_platformCanonicalPath */
+
+
+int __PHYSFS_platformPublishFile(const char *fname, const void *data,
+                                 PHYSFS_uint64 len)
+{
+    const size_t tmplen = strlen(fname) + 32;
+    const PHYSFS_uint8 *ptr = (const PHYSFS_uint8 *) data;
+    char *tmp;
+    int err = 0;
+    int fd;
+
+    BAIL_IF(!__PHYSFS_ui64FitsAddressSpace(len), PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    tmp = (char *) __PHYSFS_smallAlloc(tmplen);
+    BAIL_IF(!tmp, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    snprintf(tmp, tmplen, "%s.XXXXXX", fname);
+
+    /* a fresh name every time, so a stale temp file can't get in the way. */
+    fd = mkstemp(tmp);
+    if (fd < 0)
+    {
+        err = errno;
+        __PHYSFS_smallFree(tmp);
+        BAIL(errcodeFromErrnoError(err), 0);
+    } /* if */
+
+    /* mkstemp() makes it private; other processes need to read it. */
+    if (fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) == -1)
+        err = errno;
+
+    while ((len > 0) && (!err))
+    {
+        const ssize_t rc = write(fd, ptr, (size_t) len);
+        if (rc > 0)
+        {
+            ptr += rc;
+            len -= (PHYSFS_uint64) rc;
+        } /* if */
+        else if (rc == 0)  /* no progress, and no errno to say why. */
+        {
+            err = EIO;
+        } /* else if */
+        else if (errno != EINTR)
+        {
+            err = errno;
+        } /* else if */
+    } /* while */
+
+    if (close(fd) == -1)
+        err = err ? err : errno;
+
+    if ((!err) && (rename(tmp, fname) == -1))
+        err = errno;
+
+    if (err)
+        (void) unlink(tmp);
+
+    __PHYSFS_smallFree(tmp);
+    BAIL_IF(err, errcodeFromErrnoError(err), 0);
+    return 1;
+} /* __PHYSFS_platformPublishFile */
+
+
+int __PHYSFS_platformTouch(const char *fname)
+{
+    BAIL_IF(utime(fname, NULL) == -1, errcodeFromErrno(), 0);
+    return 1;
+} /* __PHYSFS_platformTouch */
+
+
 typedef struct
 {
     pthread_mutex_t mutex;
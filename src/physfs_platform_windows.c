@@ -771,6 +771,41 @@ PHYSFS_sint64 __PHYSFS_platformRead(void *opaque, void *buf, PHYSFS_uint64 len)
 } /* __PHYSFS_platformRead */
 
 
+PHYSFS_sint64 __PHYSFS_platformReadAt(void *opaque, void *buf,
+                                      PHYSFS_uint64 len, PHYSFS_uint64 pos)
+{
+    HANDLE h = (HANDLE) opaque;
+    PHYSFS_sint64 totalRead = 0;
+
+    if (!__PHYSFS_ui64FitsAddressSpace(len))
+        BAIL(PHYSFS_ERR_INVALID_ARGUMENT, -1);
+
+    while (len > 0)
+    {
+        const DWORD thislen = (len > 0xFFFFFFFF) ? 0xFFFFFFFF : (DWORD) len;
+        DWORD numRead = 0;
+        OVERLAPPED ov;
+        memset(&ov, '\0', sizeof (ov));
+        ov.Offset = (DWORD) (pos & 0xFFFFFFFF);
+        ov.OffsetHigh = (DWORD) (pos >> 32);
+        if (!ReadFile(h, buf, thislen, &numRead, &ov))
+        {
+            if (GetLastError() == ERROR_HANDLE_EOF)
+                break;  /* reading at or past the end isn't an error. */
+            BAIL(errcodeFromWinApi(), -1);
+        } /* if */
+        len -= (PHYSFS_uint64) numRead;
+        pos += (PHYSFS_uint64) numRead;
+        buf = ((PHYSFS_uint8 *) buf) + numRead;
+        totalRead += (PHYSFS_sint64) numRead;
+        if (numRead != thislen)
+            break;
+    } /* while */
+
+    return totalRead;
+} /* __PHYSFS_platformReadAt */
+
+
 PHYSFS_sint64 __PHYSFS_platformWrite(void *opaque, const void *buffer,
                                      PHYSFS_uint64 len)
 {
@@ -1012,6 +1047,237 @@ int __PHYSFS_platformStat(const char *filename, PHYSFS_Stat *st, const int follo
     return 1;
 } /* __PHYSFS_platformStat */
 
+
+int __PHYSFS_platformFingerprint(const char *filename, PHYSFS_uint64 *fp)
+{
+    int isdir = 0;
+    DWORD err = 0;
+    HANDLE h;
+    BOOL rc;
+
+    /* no access rights needed just to query the file's information. */
+    h = doOpen(filename, 0, OPEN_EXISTING);
+    BAIL_IF_ERRPASS(h == INVALID_HANDLE_VALUE, 0);
+
+    #ifdef PHYSFS_PLATFORM_WINRT
+    {
+        FILE_ID_INFO id;
+        FILE_BASIC_INFO basic;
+        FILE_STANDARD_INFO standard;
+        PHYSFS_uint64 fileid[2];
+
+        rc = GetFileInformationByHandleEx(h, FileIdInfo, &id, sizeof (id)) &&
+             GetFileInformationByHandleEx(h, FileBasicInfo, &basic, sizeof (basic)) &&
+             GetFileInformationByHandleEx(h, FileStandardInfo, &standard, sizeof (standard));
+        if (!rc)
+            err = GetLastError();
+        else
+        {
+            memcpy(fileid, &id.FileId, sizeof (fileid));
+            *fp = __PHYSFS_mixFingerprint(0, id.VolumeSerialNumber);
+            *fp = __PHYSFS_mixFingerprint(*fp, fileid[0]);
+            *fp = __PHYSFS_mixFingerprint(*fp, fileid[1]);
+            *fp = __PHYSFS_mixFingerprint(*fp, (PHYSFS_uint64) standard.EndOfFile.QuadPart);
+            *fp = __PHYSFS_mixFingerprint(*fp, (PHYSFS_uint64) basic.LastWriteTime.QuadPart);
+            isdir = (standard.Directory != 0);
+        } /* else */
+    }
+    #else
+    {
+        BY_HANDLE_FILE_INFORMATION info;
+        rc = GetFileInformationByHandle(h, &info);
+        if (!rc)
+            err = GetLastError();
+        else
+        {
+            const FILETIME *mtime = &info.ftLastWriteTime;
+            *fp = __PHYSFS_mixFingerprint(0, info.dwVolumeSerialNumber);
+            *fp = __PHYSFS_mixFingerprint(*fp, (((PHYSFS_uint64) info.nFileIndexHigh) << 32) | info.nFileIndexLow);
+            *fp = __PHYSFS_mixFingerprint(*fp, (((PHYSFS_uint64) info.nFileSizeHigh) << 32) | info.nFileSizeLow);
+            *fp = __PHYSFS_mixFingerprint(*fp, (((PHYSFS_uint64) mtime->dwHighDateTime) << 32) | mtime->dwLowDateTime);
+            isdir = ((info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0);
+        } /* else */
+    }
+    #endif
+
+    CloseHandle(h);
+    BAIL_IF(!rc, errcodeFromWinApiError(err), 0);
+    BAIL_IF(isdir, PHYSFS_ERR_NOT_A_FILE, 0);
+    return 1;
+} /* __PHYSFS_platformFingerprint */
+
+
+void *__PHYSFS_platformMapFile(const char *filename, PHYSFS_uint64 *len)
+{
+    #ifdef PHYSFS_PLATFORM_WINRT
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* !!! FIXME: CreateFileMappingFromApp */
+    #else
+    void *retval = NULL;
+    PHYSFS_sint64 size;
+    HANDLE maph;
+    DWORD err = 0;
+    HANDLE h;
+
+    h = doOpen(filename, GENERIC_READ, OPEN_EXISTING);
+    BAIL_IF_ERRPASS(h == INVALID_HANDLE_VALUE, NULL);
+
+    size = __PHYSFS_platformFileLength((void *) h);
+    if ((size <= 0) || (!__PHYSFS_ui64FitsAddressSpace((PHYSFS_uint64) size)))
+    {
+        CloseHandle(h);
+        BAIL_IF_ERRPASS(size < 0, NULL);
+        BAIL(PHYSFS_ERR_CORRUPT, NULL);
+    } /* if */
+
+    maph = CreateFileMappingW(h, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (maph == NULL)
+        err = GetLastError();
+    else
+    {
+        retval = MapViewOfFile(maph, FILE_MAP_READ, 0, 0, 0);
+        if (retval == NULL)
+            err = GetLastError();
+        CloseHandle(maph);  /* the view keeps the mapping alive. */
+    } /* else */
+
+    CloseHandle(h);
+    BAIL_IF(retval == NULL, errcodeFromWinApiError(err), NULL);
+
+    *len = (PHYSFS_uint64) size;
+    return retval;
+    #endif
+} /* __PHYSFS_platformMapFile */
+
+
+void __PHYSFS_platformUnmapFile(void *ptr, PHYSFS_uint64 len)
+{
+    #ifndef PHYSFS_PLATFORM_WINRT
+    UnmapViewOfFile(ptr);
+    #endif
+} /* __PHYSFS_platformUnmapFile */
+
+
+char *__PHYSFS_platformCanonicalPath(const char *filename)
+{
+    WCHAR *wfname = NULL;
+    WCHAR *wfull = NULL;
+    char *retval = NULL;
+    DWORD len;
+
+    UTF8_TO_UNICODE_STACK(wfname, filename);
+    BAIL_IF(!wfname, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+
+    len = GetFullPathNameW(wfname, 0, NULL, NULL);
+    if (len == 0)
+    {
+        __PHYSFS_smallFree(wfname);
+        BAIL(errcodeFromWinApi(), NULL);
+    } /* if */
+
+    wfull = (WCHAR *) allocator.Malloc(len * sizeof (WCHAR));
+    if (!wfull)
+    {
+        __PHYSFS_smallFree(wfname);
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    } /* if */
+
+    if (GetFullPathNameW(wfname, len, wfull, NULL) == 0)
+        PHYSFS_setErrorCode(errcodeFromWinApi());
+    else
+        retval = unicodeToUtf8Heap(wfull);
+
+    allocator.Free(wfull);
+    __PHYSFS_smallFree(wfname);
+    return retval;
+} /* __PHYSFS_platformCanonicalPath */
+
+
+int __PHYSFS_platformPublishFile(const char *filename, const void *data,
+                                 PHYSFS_uint64 len)
+{
+    const size_t tmplen = strlen(filename) + 32;
+    const PHYSFS_uint8 *ptr = (const PHYSFS_uint8 *) data;
+    PHYSFS_ErrorCode err = PHYSFS_ERR_OK;
+    WCHAR *wtmp = NULL;
+    WCHAR *wfname = NULL;
+    HANDLE h = INVALID_HANDLE_VALUE;
+    unsigned int attempt;
+    char *tmp;
+
+    tmp = (char *) __PHYSFS_smallAlloc(tmplen);
+    BAIL_IF(!tmp, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+
+    /* a stale temp file from a dead process with our id isn't fatal. */
+    for (attempt = 0; attempt < 16; attempt++)
+    {
+        snprintf(tmp, tmplen, "%s.%lu.%u.tmp", filename,
+                 (unsigned long) GetCurrentProcessId(),
+                 (unsigned int) (GetTickCount() + attempt));
+        h = doOpen(tmp, GENERIC_WRITE, CREATE_NEW);
+        if ((h != INVALID_HANDLE_VALUE) && (h != NULL))
+            break;
+    } /* for */
+
+    if ((h == INVALID_HANDLE_VALUE) || (h == NULL))
+    {
+        __PHYSFS_smallFree(tmp);
+        return 0;  /* doOpen set the error. */
+    } /* if */
+
+    while ((len > 0) && (err == PHYSFS_ERR_OK))
+    {
+        const PHYSFS_sint64 rc = __PHYSFS_platformWrite((void *) h, ptr, len);
+        if (rc <= 0)
+            err = PHYSFS_ERR_IO;
+        else
+        {
+            ptr += rc;
+            len -= (PHYSFS_uint64) rc;
+        } /* else */
+    } /* while */
+
+    CloseHandle(h);
+
+    UTF8_TO_UNICODE_STACK(wtmp, tmp);
+    UTF8_TO_UNICODE_STACK(wfname, filename);
+    if ((!wtmp) || (!wfname))
+        err = PHYSFS_ERR_OUT_OF_MEMORY;
+    else if (err == PHYSFS_ERR_OK)
+    {
+        /* fails if someone has the old one mapped; theirs is just as good. */
+        if (!MoveFileExW(wtmp, wfname, MOVEFILE_REPLACE_EXISTING))
+            err = errcodeFromWinApi();
+    } /* else if */
+
+    if ((err != PHYSFS_ERR_OK) && (wtmp != NULL))
+        DeleteFileW(wtmp);
+
+    __PHYSFS_smallFree(wfname);
+    __PHYSFS_smallFree(wtmp);
+    __PHYSFS_smallFree(tmp);
+    BAIL_IF(err != PHYSFS_ERR_OK, err, 0);
+    return 1;
+} /* __PHYSFS_platformPublishFile */
+
+
+int __PHYSFS_platformTouch(const char *filename)
+{
+    FILETIME now;
+    BOOL rc;
+    HANDLE h = doOpen(filename, FILE_WRITE_ATTRIBUTES, OPEN_EXISTING);
+    BAIL_IF_ERRPASS(h == INVALID_HANDLE_VALUE, 0);
+    GetSystemTimeAsFileTime(&now);
+    rc = SetFileTime(h, NULL, NULL, &now);
+    if (!rc)
+    {
+        const PHYSFS_ErrorCode err = errcodeFromWinApi();
+        CloseHandle(h);
+        BAIL(err, 0);
+    } /* if */
+    CloseHandle(h);
+    return 1;
+} /* __PHYSFS_platformTouch */
+
 #endif  /* PHYSFS_PLATFORM_WINDOWS */
 
 /* end of physfs_platform_windows.c ... */
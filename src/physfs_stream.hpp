@@ -0,0 +1,367 @@
+/**
+ * \file physfs_stream.hpp
+ *
+ * Header-only std::streambuf for PhysicsFS files.
+ */
+
+/*
+ * For code (usually someone else's parser) that insists on a std::istream
+ *  or std::ostream:
+ *
+ * \code
+ * auto f = physfs::File::openRead("models/crate.obj");
+ * physfs::IStream in(std::move(*f));
+ * objParser.load(in);
+ * \endcode
+ *
+ * physfs::FileBuf keeps one large, cache-aligned buffer (64KB by default)
+ *  and refills it with a single PHYSFS_readBytes() at a time. Bulk reads
+ *  (istream::read(), and anything else that ends up in xsgetn()) that are
+ *  bigger than the buffer skip it and read straight into the caller's
+ *  memory. Seeks that land inside the buffered range just move the get
+ *  pointer, the same way PHYSFS_seek() treats its own buffer, so parsers
+ *  that peek and rewind don't cause any i/o.
+ *
+ * Don't also call PHYSFS_setBuffer() on the file; one layer of buffering
+ *  is plenty.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ */
+
+#ifndef _INCLUDE_PHYSFS_STREAM_HPP_
+#define _INCLUDE_PHYSFS_STREAM_HPP_
+
+#include "physfs.hpp"
+
+#include <istream>
+#include <new>
+#include <ostream>
+#include <streambuf>
+
+namespace physfs
+{
+
+/**
+ * \brief A std::streambuf over a File, for reading or writing.
+ *
+ * Opened for reading, it supports get, seek and putback. Opened for writing
+ *  or appending, it supports put, tellp and flushing via pubsync(). The
+ *  FileBuf owns the File and closes it on destruction.
+ */
+class FileBuf : public std::streambuf
+{
+public:
+    static constexpr std::size_t DefaultBufferSize = 64 * 1024;
+    static constexpr std::size_t BufferAlignment = 64;
+
+    FileBuf() = default;
+
+    explicit FileBuf(File &&f, std::ios_base::openmode mode = std::ios_base::in,
+                     std::size_t bufsize = DefaultBufferSize)
+        : file(std::move(f)), reading((mode & std::ios_base::out) == 0),
+          bufferSize(bufsize ? bufsize : 1)
+    {
+        buffer = static_cast<char *>(::operator new(bufferSize, std::align_val_t(BufferAlignment), std::nothrow));
+        if (!buffer)
+            bufferSize = 0;  /* run unbuffered; every get goes to PhysicsFS. */
+
+        Result<PHYSFS_uint64> pos = file.tell();
+        bufferPos = pos ? *pos : 0;
+        if (reading)
+            setg(buffer, buffer, buffer);
+        else if (buffer)
+            setp(buffer, buffer + bufferSize);
+    }
+
+    FileBuf(const FileBuf &) = delete;
+    FileBuf &operator=(const FileBuf &) = delete;
+
+    ~FileBuf() override
+    {
+        if (!reading)
+            (void) flushPutArea();
+        if (buffer)
+            ::operator delete(buffer, std::align_val_t(BufferAlignment));
+    }
+
+    File &getFile() noexcept { return file; }
+    bool is_open() const noexcept { return (bool) file; }
+
+protected:
+    int_type underflow() override
+    {
+        if (!reading || !file)
+            return traits_type::eof();
+        else if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+
+        bufferPos += (PHYSFS_uint64) (egptr() - eback());
+
+        if (bufferSize == 0)  /* no buffer; read one byte into our spare. */
+        {
+            Result<std::size_t> rc = file.read(&single, 1);
+            const bool got = (rc && (*rc == 1));
+            setg(&single, &single, &single + (got ? 1 : 0));
+            return got ? traits_type::to_int_type(single) : traits_type::eof();
+        }
+
+        Result<std::size_t> rc = file.read(buffer, bufferSize);
+        const std::size_t got = rc ? *rc : 0;
+        setg(buffer, buffer, buffer + got);
+        return got ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+    }
+
+    std::streamsize xsgetn(char_type *s, std::streamsize count) override
+    {
+        if (!reading || !file || (count <= 0))
+            return 0;
+
+        std::streamsize retval = 0;
+
+        /* hand out whatever is already buffered first... */
+        const std::streamsize avail = egptr() - gptr();
+        if (avail > 0)
+        {
+            const std::streamsize cpy = (count < avail) ? count : avail;
+            std::memcpy(s, gptr(), (std::size_t) cpy);
+            gbump((int) cpy);
+            s += cpy;
+            count -= cpy;
+            retval += cpy;
+        }
+
+        if (count == 0)
+            return retval;
+
+        /* ...then big reads go straight to the caller's memory... */
+        if ((std::size_t) count >= bufferSize)
+        {
+            bufferPos += (PHYSFS_uint64) (egptr() - eback());
+            setg(buffer, buffer, buffer);  /* buffer is now empty. */
+            Result<std::size_t> rc = file.read(s, (std::size_t) count);
+            if (rc)
+            {
+                bufferPos += *rc;
+                retval += (std::streamsize) *rc;
+            }
+            return retval;
+        }
+
+        /* ...and small ones refill the buffer once. */
+        while ((count > 0) && (underflow() != traits_type::eof()))
+        {
+            const std::streamsize have = egptr() - gptr();
+            const std::streamsize cpy = (count < have) ? count : have;
+            std::memcpy(s, gptr(), (std::size_t) cpy);
+            gbump((int) cpy);
+            s += cpy;
+            count -= cpy;
+            retval += cpy;
+        }
+
+        return retval;
+    }
+
+    std::streamsize showmanyc() override
+    {
+        if (!reading || !file)
+            return -1;
+        Result<PHYSFS_uint64> len = file.length();
+        if (!len)
+            return 0;  /* don't know. */
+        const PHYSFS_uint64 pos = currentPos();
+        return (*len > pos) ? (std::streamsize) (*len - pos) : -1;
+    }
+
+    int_type overflow(int_type ch) override
+    {
+        if (reading || !file)
+            return traits_type::eof();
+        else if (!flushPutArea())
+            return traits_type::eof();
+        else if (traits_type::eq_int_type(ch, traits_type::eof()))
+            return traits_type::not_eof(ch);
+
+        const char_type c = traits_type::to_char_type(ch);
+        if (pbase() && (pptr() < epptr()))
+        {
+            *pptr() = c;
+            pbump(1);
+        }
+        else  /* unbuffered. */
+        {
+            Result<std::size_t> rc = file.write(&c, 1);
+            if (!rc || (*rc != 1))
+                return traits_type::eof();
+            bufferPos++;
+        }
+        return ch;
+    }
+
+    std::streamsize xsputn(const char_type *s, std::streamsize count) override
+    {
+        if (reading || !file || (count <= 0))
+            return 0;
+
+        /* fits in what's left of the buffer? */
+        if (pbase() && (count <= (epptr() - pptr())))
+        {
+            std::memcpy(pptr(), s, (std::size_t) count);
+            pbump((int) count);
+            return count;
+        }
+
+        /* no; write what we have, then the new data directly. */
+        if (!flushPutArea())
+            return 0;
+        Result<std::size_t> rc = file.write(s, (std::size_t) count);
+        if (!rc)
+            return 0;
+        bufferPos += *rc;
+        return (std::streamsize) *rc;
+    }
+
+    int sync() override
+    {
+        if (reading || !file)
+            return 0;
+        return (flushPutArea() && file.flush()) ? 0 : -1;
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode which) override
+    {
+        const pos_type failed = pos_type(off_type(-1));
+        if (!file)
+            return failed;
+
+        if (!reading)  /* PhysicsFS can't seek a file open for writing usefully. */
+        {
+            if ((off == 0) && (dir == std::ios_base::cur) && (which & std::ios_base::out))
+                return pos_type((off_type) currentPos());
+            return failed;
+        }
+
+        if (!(which & std::ios_base::in))
+            return failed;
+
+        PHYSFS_sint64 target;
+        if (dir == std::ios_base::beg)
+            target = (PHYSFS_sint64) off;
+        else if (dir == std::ios_base::cur)
+            target = (PHYSFS_sint64) currentPos() + off;
+        else
+        {
+            Result<PHYSFS_uint64> len = file.length();
+            if (!len)
+                return failed;
+            target = (PHYSFS_sint64) *len + off;
+        }
+
+        if (target < 0)
+            return failed;
+        return seekTo((PHYSFS_uint64) target);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+private:
+    PHYSFS_uint64 currentPos() const noexcept
+    {
+        if (reading)
+            return bufferPos + (PHYSFS_uint64) (gptr() - eback());
+        return bufferPos + (PHYSFS_uint64) (pptr() - pbase());
+    }
+
+    /* Same idea as PHYSFS_seek(): only touch the file if we leave the buffer. */
+    pos_type seekTo(PHYSFS_uint64 target)
+    {
+        const PHYSFS_uint64 buffered = (PHYSFS_uint64) (egptr() - eback());
+        if ((target >= bufferPos) && (target <= bufferPos + buffered))
+        {
+            setg(eback(), eback() + (target - bufferPos), egptr());
+            return pos_type((off_type) target);
+        }
+
+        if (!file.seek(target))
+            return pos_type(off_type(-1));
+        bufferPos = target;
+        setg(buffer, buffer, buffer);
+        return pos_type((off_type) target);
+    }
+
+    bool flushPutArea()
+    {
+        const std::ptrdiff_t len = pptr() - pbase();
+        if (len <= 0)
+            return true;
+        Result<std::size_t> rc = file.write(pbase(), (std::size_t) len);
+        if (!rc || (*rc != (std::size_t) len))
+            return false;
+        bufferPos += *rc;
+        setp(pbase(), epptr());
+        return true;
+    }
+
+    File file;
+    bool reading = true;
+    char *buffer = nullptr;
+    std::size_t bufferSize = 0;
+    PHYSFS_uint64 bufferPos = 0;  /* file offset of eback() (or pbase()). */
+    char single = 0;
+};
+
+
+/**
+ * \brief A std::istream that reads from a PhysicsFS file.
+ */
+class IStream : public std::istream
+{
+public:
+    explicit IStream(File &&f, std::size_t bufsize = FileBuf::DefaultBufferSize)
+        : std::istream(nullptr), buf(std::move(f), std::ios_base::in, bufsize)
+    {
+        rdbuf(&buf);
+        if (!buf.is_open())
+            setstate(std::ios_base::failbit);
+    }
+
+    FileBuf *rdbuf() noexcept { return &buf; }
+
+private:
+    using std::istream::rdbuf;
+    FileBuf buf;
+};
+
+
+/**
+ * \brief A std::ostream that writes to a PhysicsFS file.
+ *
+ * Open the File with File::openWrite() or File::openAppend().
+ */
+class OStream : public std::ostream
+{
+public:
+    explicit OStream(File &&f, std::size_t bufsize = FileBuf::DefaultBufferSize)
+        : std::ostream(nullptr), buf(std::move(f), std::ios_base::out, bufsize)
+    {
+        rdbuf(&buf);
+        if (!buf.is_open())
+            setstate(std::ios_base::failbit);
+    }
+
+    FileBuf *rdbuf() noexcept { return &buf; }
+
+private:
+    using std::ostream::rdbuf;
+    FileBuf buf;
+};
+
+} /* namespace physfs */
+
+#endif  /* include-once blocker. */
+
+/* end of physfs_stream.hpp ... */
@@ -1,3 +1,12 @@
+/* vector headers may use malloc(), which physfs_internal.h won't allow. */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define PHYSFS_UNICODE_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PHYSFS_UNICODE_NEON 1
+#endif
+
 #define __PHYSICSFS_INTERNAL__
 #include "physfs_internal.h"
 
@@ -183,7 +192,7 @@ static PHYSFS_uint32 utf8codepoint(const char **_str)
         if ((octet & (128+64)) != 128)  /* Format isn't 10xxxxxx? */
             return UNICODE_BOGUS_CHAR_VALUE;
 
-        *_str += 6;  /* skip to next possible start of codepoint. */
+        *_str += 5;  /* skip to next possible start of codepoint. */
         return UNICODE_BOGUS_CHAR_VALUE;
     } /* else if */
 
@@ -233,12 +242,321 @@ static PHYSFS_uint32 utf32codepoint(const PHYSFS_uint32 **_str)
 } /* utf32codepoint */
 
 
+/*
+ * ASCII fast paths.
+ *
+ * Almost every string we convert is plain ASCII (or mostly ASCII), and an
+ *  ASCII char means the same thing in every encoding we deal with, so runs
+ *  of them get copied, widened or narrowed a block at a time instead of
+ *  going through the codepoint decoders. Each of these converts at most
+ *  (count) leading units that are below 0x80, and returns how many it did;
+ *  the caller handles whatever stopped it with the usual scalar code, so
+ *  the output is exactly what the one-codepoint-at-a-time path produces.
+ *
+ * (count) must never reach past the source's null terminator: we only read
+ *  memory the string actually owns, so callers measure the string first.
+ */
+
+static size_t utf16len(const PHYSFS_uint16 *str)
+{
+    const PHYSFS_uint16 *ptr = str;
+    while (*ptr)
+        ptr++;
+    return (size_t) (ptr - str);
+} /* utf16len */
+
+static size_t utf32len(const PHYSFS_uint32 *str)
+{
+    const PHYSFS_uint32 *ptr = str;
+    while (*ptr)
+        ptr++;
+    return (size_t) (ptr - str);
+} /* utf32len */
+
+/* how many units we may convert with (avail) source units and (room) out. */
+static size_t asciiCount(const size_t avail, const PHYSFS_uint64 room)
+{
+    return (room < (PHYSFS_uint64) avail) ? (size_t) room : avail;
+} /* asciiCount */
+
+static size_t asciiSpan(const PHYSFS_uint8 *src, const size_t count)
+{
+    size_t i = 0;
+#if PHYSFS_UNICODE_SSE2
+    for (; (i + 16) <= count; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+        if (_mm_movemask_epi8(v) != 0)
+            break;  /* something in here has the high bit set. */
+    } /* for */
+#elif PHYSFS_UNICODE_NEON
+    for (; (i + 16) <= count; i += 16)
+    {
+        if (vmaxvq_u8(vld1q_u8(src + i)) >= 0x80)
+            break;
+    } /* for */
+#endif
+    while ((i < count) && (src[i] < 0x80))
+        i++;
+    return i;
+} /* asciiSpan */
+
+static size_t asciiWiden16(const PHYSFS_uint8 *src, PHYSFS_uint16 *dst,
+                           const size_t count)
+{
+    size_t i = 0;
+#if PHYSFS_UNICODE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; (i + 16) <= count; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+        if (_mm_movemask_epi8(v) != 0)
+            break;
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128((__m128i *) (dst + i + 8), _mm_unpackhi_epi8(v, zero));
+    } /* for */
+#elif PHYSFS_UNICODE_NEON
+    for (; (i + 16) <= count; i += 16)
+    {
+        const uint8x16_t v = vld1q_u8(src + i);
+        if (vmaxvq_u8(v) >= 0x80)
+            break;
+        vst1q_u16(dst + i, vmovl_u8(vget_low_u8(v)));
+        vst1q_u16(dst + i + 8, vmovl_u8(vget_high_u8(v)));
+    } /* for */
+#endif
+    for (; (i < count) && (src[i] < 0x80); i++)
+        dst[i] = (PHYSFS_uint16) src[i];
+    return i;
+} /* asciiWiden16 */
+
+static size_t asciiWiden32(const PHYSFS_uint8 *src, PHYSFS_uint32 *dst,
+                           const size_t count)
+{
+    size_t i = 0;
+#if PHYSFS_UNICODE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; (i + 16) <= count; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+        __m128i lo, hi;
+        if (_mm_movemask_epi8(v) != 0)
+            break;
+        lo = _mm_unpacklo_epi8(v, zero);
+        hi = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_unpacklo_epi16(lo, zero));
+        _mm_storeu_si128((__m128i *) (dst + i + 4), _mm_unpackhi_epi16(lo, zero));
+        _mm_storeu_si128((__m128i *) (dst + i + 8), _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128((__m128i *) (dst + i + 12), _mm_unpackhi_epi16(hi, zero));
+    } /* for */
+#elif PHYSFS_UNICODE_NEON
+    for (; (i + 16) <= count; i += 16)
+    {
+        const uint8x16_t v = vld1q_u8(src + i);
+        uint16x8_t lo, hi;
+        if (vmaxvq_u8(v) >= 0x80)
+            break;
+        lo = vmovl_u8(vget_low_u8(v));
+        hi = vmovl_u8(vget_high_u8(v));
+        vst1q_u32(dst + i, vmovl_u16(vget_low_u16(lo)));
+        vst1q_u32(dst + i + 4, vmovl_u16(vget_high_u16(lo)));
+        vst1q_u32(dst + i + 8, vmovl_u16(vget_low_u16(hi)));
+        vst1q_u32(dst + i + 12, vmovl_u16(vget_high_u16(hi)));
+    } /* for */
+#endif
+    for (; (i < count) && (src[i] < 0x80); i++)
+        dst[i] = (PHYSFS_uint32) src[i];
+    return i;
+} /* asciiWiden32 */
+
+static size_t asciiNarrow8(const PHYSFS_uint8 *src, char *dst,
+                           const size_t count)
+{
+    const size_t retval = asciiSpan(src, count);
+    memcpy(dst, src, retval);
+    return retval;
+} /* asciiNarrow8 */
+
+static size_t asciiNarrow16(const PHYSFS_uint16 *src, char *dst,
+                            const size_t count)
+{
+    size_t i = 0;
+#if PHYSFS_UNICODE_SSE2
+    const __m128i himask = _mm_set1_epi16((short) 0xFF80);
+    const __m128i zero = _mm_setzero_si128();
+    for (; (i + 16) <= count; i += 16)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i *) (src + i));
+        const __m128i b = _mm_loadu_si128((const __m128i *) (src + i + 8));
+        const __m128i hi = _mm_and_si128(_mm_or_si128(a, b), himask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(hi, zero)) != 0xFFFF)
+            break;
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(a, b));
+    } /* for */
+#elif PHYSFS_UNICODE_NEON
+    for (; (i + 16) <= count; i += 16)
+    {
+        const uint16x8_t a = vld1q_u16(src + i);
+        const uint16x8_t b = vld1q_u16(src + i + 8);
+        if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80)
+            break;
+        vst1q_u8((uint8_t *) (dst + i), vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+    } /* for */
+#endif
+    for (; (i < count) && (src[i] < 0x80); i++)
+        dst[i] = (char) src[i];
+    return i;
+} /* asciiNarrow16 */
+
+static size_t asciiNarrow32(const PHYSFS_uint32 *src, char *dst,
+                            const size_t count)
+{
+    size_t i = 0;
+#if PHYSFS_UNICODE_SSE2
+    const __m128i himask = _mm_set1_epi32((int) 0xFFFFFF80);
+    const __m128i zero = _mm_setzero_si128();
+    for (; (i + 16) <= count; i += 16)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i *) (src + i));
+        const __m128i b = _mm_loadu_si128((const __m128i *) (src + i + 4));
+        const __m128i c = _mm_loadu_si128((const __m128i *) (src + i + 8));
+        const __m128i d = _mm_loadu_si128((const __m128i *) (src + i + 12));
+        const __m128i all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(all, himask), zero)) != 0xFFFF)
+            break;
+        /* everything is < 0x80, so the signed saturating packs are exact. */
+        _mm_storeu_si128((__m128i *) (dst + i),
+                         _mm_packus_epi16(_mm_packs_epi32(a, b),
+                                          _mm_packs_epi32(c, d)));
+    } /* for */
+#elif PHYSFS_UNICODE_NEON
+    for (; (i + 16) <= count; i += 16)
+    {
+        const uint32x4_t a = vld1q_u32(src + i);
+        const uint32x4_t b = vld1q_u32(src + i + 4);
+        const uint32x4_t c = vld1q_u32(src + i + 8);
+        const uint32x4_t d = vld1q_u32(src + i + 12);
+        const uint32x4_t all = vorrq_u32(vorrq_u32(a, b), vorrq_u32(c, d));
+        uint16x8_t ab, cd;
+        if (vmaxvq_u32(all) >= 0x80)
+            break;
+        ab = vcombine_u16(vmovn_u32(a), vmovn_u32(b));
+        cd = vcombine_u16(vmovn_u32(c), vmovn_u32(d));
+        vst1q_u8((uint8_t *) (dst + i), vcombine_u8(vmovn_u16(ab), vmovn_u16(cd)));
+    } /* for */
+#endif
+    for (; (i < count) && (src[i] < 0x80); i++)
+        dst[i] = (char) src[i];
+    return i;
+} /* asciiNarrow32 */
+
+static PHYSFS_uint8 asciiFold(const PHYSFS_uint8 ch)
+{
+    return ((ch >= 'A') && (ch <= 'Z')) ? (PHYSFS_uint8) (ch - ('A' - 'a')) : ch;
+} /* asciiFold */
+
+#if PHYSFS_UNICODE_SSE2
+/* lowercase 'A'-'Z'; only valid when every byte is < 0x80 (signed compares). */
+static __m128i asciiFoldVec(const __m128i v)
+{
+    const __m128i ge = _mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1));
+    const __m128i le = _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1));
+    const __m128i upper = _mm_and_si128(ge, le);
+    return _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+} /* asciiFoldVec */
+#elif PHYSFS_UNICODE_NEON
+static uint8x16_t asciiFoldVec(const uint8x16_t v)
+{
+    const uint8x16_t upper = vandq_u8(vcgeq_u8(v, vdupq_n_u8('A')),
+                                      vcleq_u8(v, vdupq_n_u8('Z')));
+    return vaddq_u8(v, vandq_u8(upper, vdupq_n_u8('a' - 'A')));
+} /* asciiFoldVec */
+#endif
+
+/* lowercase up to (count) leading ASCII bytes of (src) into (dst). */
+static size_t asciiFoldCopy(const PHYSFS_uint8 *src, PHYSFS_uint8 *dst,
+                            const size_t count)
+{
+    size_t i = 0;
+#if PHYSFS_UNICODE_SSE2
+    for (; (i + 16) <= count; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+        if (_mm_movemask_epi8(v) != 0)
+            break;
+        _mm_storeu_si128((__m128i *) (dst + i), asciiFoldVec(v));
+    } /* for */
+#elif PHYSFS_UNICODE_NEON
+    for (; (i + 16) <= count; i += 16)
+    {
+        const uint8x16_t v = vld1q_u8(src + i);
+        if (vmaxvq_u8(v) >= 0x80)
+            break;
+        vst1q_u8(dst + i, asciiFoldVec(v));
+    } /* for */
+#endif
+    for (; (i < count) && (src[i] < 0x80); i++)
+        dst[i] = asciiFold(src[i]);
+    return i;
+} /* asciiFoldCopy */
+
+/*
+ * Count the leading bytes, at most (count), that are ASCII in both (a) and
+ *  (b) and match once folded; this is exactly the prefix that the
+ *  codepoint-by-codepoint compare would walk through without finding a
+ *  difference.
+ */
+static size_t asciiFoldMatch(const PHYSFS_uint8 *a, const PHYSFS_uint8 *b,
+                             const size_t count)
+{
+    size_t i = 0;
+#if PHYSFS_UNICODE_SSE2
+    for (; (i + 16) <= count; i += 16)
+    {
+        const __m128i va = _mm_loadu_si128((const __m128i *) (a + i));
+        const __m128i vb = _mm_loadu_si128((const __m128i *) (b + i));
+        if (_mm_movemask_epi8(_mm_or_si128(va, vb)) != 0)
+            break;
+        else if (_mm_movemask_epi8(_mm_cmpeq_epi8(asciiFoldVec(va), asciiFoldVec(vb))) != 0xFFFF)
+            break;
+    } /* for */
+#elif PHYSFS_UNICODE_NEON
+    for (; (i + 16) <= count; i += 16)
+    {
+        const uint8x16_t va = vld1q_u8(a + i);
+        const uint8x16_t vb = vld1q_u8(b + i);
+        if (vmaxvq_u8(vorrq_u8(va, vb)) >= 0x80)
+            break;
+        else if (vminvq_u8(vceqq_u8(asciiFoldVec(va), asciiFoldVec(vb))) == 0)
+            break;
+    } /* for */
+#endif
+    while ((i < count) && (((a[i] | b[i]) & 0x80) == 0) &&
+           (asciiFold(a[i]) == asciiFold(b[i])))
+        i++;
+    return i;
+} /* asciiFoldMatch */
+
+
+
 void PHYSFS_utf8ToUcs4(const char *src, PHYSFS_uint32 *dst, PHYSFS_uint64 len)
 {
+    const char *end = src + strlen(src);
     len -= sizeof (PHYSFS_uint32);   /* save room for null char. */
     while (len >= sizeof (PHYSFS_uint32))
     {
-        PHYSFS_uint32 cp = utf8codepoint(&src);
+        PHYSFS_uint32 cp;
+        const size_t ascii = asciiWiden32((const PHYSFS_uint8 *) src, dst,
+                            asciiCount((size_t) (end - src), len / sizeof (PHYSFS_uint32)));
+        if (ascii > 0)
+        {
+            src += ascii;
+            dst += ascii;
+            len -= ascii * sizeof (PHYSFS_uint32);
+            continue;
+        } /* if */
+
+        cp = utf8codepoint(&src);
         if (cp == 0)
             break;
         else if (cp == UNICODE_BOGUS_CHAR_VALUE)
@@ -253,10 +571,22 @@ void PHYSFS_utf8ToUcs4(const char *src, PHYSFS_uint32 *dst, PHYSFS_uint64 len)
 
 void PHYSFS_utf8ToUcs2(const char *src, PHYSFS_uint16 *dst, PHYSFS_uint64 len)
 {
+    const char *end = src + strlen(src);
     len -= sizeof (PHYSFS_uint16);   /* save room for null char. */
     while (len >= sizeof (PHYSFS_uint16))
     {
-        PHYSFS_uint32 cp = utf8codepoint(&src);
+        PHYSFS_uint32 cp;
+        const size_t ascii = asciiWiden16((const PHYSFS_uint8 *) src, dst,
+                            asciiCount((size_t) (end - src), len / sizeof (PHYSFS_uint16)));
+        if (ascii > 0)
+        {
+            src += ascii;
+            dst += ascii;
+            len -= ascii * sizeof (PHYSFS_uint16);
+            continue;
+        } /* if */
+
+        cp = utf8codepoint(&src);
         if (cp == 0)
             break;
         else if (cp == UNICODE_BOGUS_CHAR_VALUE)
@@ -275,10 +605,22 @@ void PHYSFS_utf8ToUcs2(const char *src, PHYSFS_uint16 *dst, PHYSFS_uint64 len)
 
 void PHYSFS_utf8ToUtf16(const char *src, PHYSFS_uint16 *dst, PHYSFS_uint64 len)
 {
+    const char *end = src + strlen(src);
     len -= sizeof (PHYSFS_uint16);   /* save room for null char. */
     while (len >= sizeof (PHYSFS_uint16))
     {
-        PHYSFS_uint32 cp = utf8codepoint(&src);
+        PHYSFS_uint32 cp;
+        const size_t ascii = asciiWiden16((const PHYSFS_uint8 *) src, dst,
+                            asciiCount((size_t) (end - src), len / sizeof (PHYSFS_uint16)));
+        if (ascii > 0)
+        {
+            src += ascii;
+            dst += ascii;
+            len -= ascii * sizeof (PHYSFS_uint16);
+            continue;
+        } /* if */
+
+        cp = utf8codepoint(&src);
         if (cp == 0)
             break;
         else if (cp == UNICODE_BOGUS_CHAR_VALUE)
@@ -382,12 +724,23 @@ static void utf8fromcodepoint(PHYSFS_uint32 cp, char **_dst, PHYSFS_uint64 *_len
     *_len = len;
 } /* utf8fromcodepoint */
 
-#define UTF8FROMTYPE(typ, src, dst, len) \
+#define UTF8FROMTYPE(typ, src, dst, len, srclen, narrow) \
+    size_t total, i = 0; \
     if (len == 0) return; \
+    total = srclen; \
     len--;  \
     while (len) \
     { \
-        const PHYSFS_uint32 cp = (PHYSFS_uint32) ((typ) (*(src++))); \
+        PHYSFS_uint32 cp; \
+        const size_t ascii = narrow(src + i, dst, asciiCount(total - i, len)); \
+        if (ascii > 0) \
+        { \
+            i += ascii; \
+            dst += ascii; \
+            len -= ascii; \
+            continue; \
+        } \
+        cp = (PHYSFS_uint32) ((typ) src[i++]); \
         if (cp == 0) break; \
         utf8fromcodepoint(cp, &dst, &len); \
     } \
@@ -395,18 +748,19 @@ static void utf8fromcodepoint(PHYSFS_uint32 cp, char **_dst, PHYSFS_uint64 *_len
 
 void PHYSFS_utf8FromUcs4(const PHYSFS_uint32 *src, char *dst, PHYSFS_uint64 len)
 {
-    UTF8FROMTYPE(PHYSFS_uint32, src, dst, len);
+    UTF8FROMTYPE(PHYSFS_uint32, src, dst, len, utf32len(src), asciiNarrow32);
 } /* PHYSFS_utf8FromUcs4 */
 
 void PHYSFS_utf8FromUcs2(const PHYSFS_uint16 *src, char *dst, PHYSFS_uint64 len)
 {
-    UTF8FROMTYPE(PHYSFS_uint64, src, dst, len);
+    UTF8FROMTYPE(PHYSFS_uint64, src, dst, len, utf16len(src), asciiNarrow16);
 } /* PHYSFS_utf8FromUcs2 */
 
 /* latin1 maps to unicode codepoints directly, we just utf-8 encode it. */
 void PHYSFS_utf8FromLatin1(const char *src, char *dst, PHYSFS_uint64 len)
 {
-    UTF8FROMTYPE(PHYSFS_uint8, src, dst, len);
+    const PHYSFS_uint8 *usrc = (const PHYSFS_uint8 *) src;
+    UTF8FROMTYPE(PHYSFS_uint8, usrc, dst, len, strlen(src), asciiNarrow8);
 } /* PHYSFS_utf8FromLatin1 */
 
 #undef UTF8FROMTYPE
@@ -414,13 +768,27 @@ void PHYSFS_utf8FromLatin1(const char *src, char *dst, PHYSFS_uint64 len)
 
 void PHYSFS_utf8FromUtf16(const PHYSFS_uint16 *src, char *dst, PHYSFS_uint64 len)
 {
+    const PHYSFS_uint16 *end;
+
     if (len == 0)
         return;
 
+    end = src + utf16len(src);
     len--;
     while (len)
     {
-        const PHYSFS_uint32 cp = utf16codepoint(&src);
+        PHYSFS_uint32 cp;
+        const size_t ascii = asciiNarrow16(src, dst,
+                                 asciiCount((size_t) (end - src), len));
+        if (ascii > 0)
+        {
+            src += ascii;
+            dst += ascii;
+            len -= ascii;
+            continue;
+        } /* if */
+
+        cp = utf16codepoint(&src);
         if (!cp)
             break;
         utf8fromcodepoint(cp, &dst, &len);
@@ -430,6 +798,24 @@ void PHYSFS_utf8FromUtf16(const PHYSFS_uint16 *src, char *dst, PHYSFS_uint64 len
 } /* PHYSFS_utf8FromUtf16 */
 
 
+int PHYSFS_utf8Valid(const char *str)
+{
+    const char *end = str + strlen(str);
+    while (1)
+    {
+        str += asciiSpan((const PHYSFS_uint8 *) str, (size_t) (end - str));
+        switch (utf8codepoint(&str))
+        {
+            case 0: return 1;  /* made it to the null terminator. */
+            case UNICODE_BOGUS_CHAR_VALUE: return 0;
+            default: break;
+        } /* switch */
+    } /* while */
+
+    return 0;  /* shouldn't hit this. */
+} /* PHYSFS_utf8Valid */
+
+
 int PHYSFS_caseFold(const PHYSFS_uint32 from, PHYSFS_uint32 *to)
 {
     int i;
@@ -548,7 +934,53 @@ int PHYSFS_caseFold(const PHYSFS_uint32 from, PHYSFS_uint32 *to)
 
 int PHYSFS_utf8stricmp(const char *str1, const char *str2)
 {
-    UTFSTRICMP(8);
+    const char *end1 = str1 + strlen(str1);
+    const char *end2 = str2 + strlen(str2);
+    PHYSFS_uint32 folded1[3], folded2[3];
+    int head1 = 0, tail1 = 0, head2 = 0, tail2 = 0;
+    while (1)
+    {
+        PHYSFS_uint32 cp1, cp2;
+
+        /* in step with nothing pending from a fold? Skip matching ASCII. */
+        if ((head1 == tail1) && (head2 == tail2))
+        {
+            const size_t avail1 = (size_t) (end1 - str1);
+            const size_t avail2 = (size_t) (end2 - str2);
+            const size_t skip = asciiFoldMatch((const PHYSFS_uint8 *) str1,
+                                               (const PHYSFS_uint8 *) str2,
+                                               (avail1 < avail2) ? avail1 : avail2);
+            str1 += skip;
+            str2 += skip;
+        } /* if */
+
+        if (head1 != tail1)
+            cp1 = folded1[tail1++];
+        else
+        {
+            head1 = PHYSFS_caseFold(utf8codepoint(&str1), folded1);
+            cp1 = folded1[0];
+            tail1 = 1;
+        } /* else */
+
+        if (head2 != tail2)
+            cp2 = folded2[tail2++];
+        else
+        {
+            head2 = PHYSFS_caseFold(utf8codepoint(&str2), folded2);
+            cp2 = folded2[0];
+            tail2 = 1;
+        } /* else */
+
+        if (cp1 < cp2)
+            return -1;
+        else if (cp1 > cp2)
+            return 1;
+        else if (cp1 == 0)
+            break;  /* complete match. */
+    } /* while */
+
+    return 0;
 } /* PHYSFS_utf8stricmp */
 
 int PHYSFS_utf16stricmp(const PHYSFS_uint16 *str1, const PHYSFS_uint16 *str2)
@@ -563,5 +995,40 @@ int PHYSFS_ucs4stricmp(const PHYSFS_uint32 *str1, const PHYSFS_uint32 *str2)
 
 #undef UTFSTRICMP
 
+
+PHYSFS_uint32 PHYSFS_utf8CaseFoldHash(const char *str)
+{
+    const char *end = str + strlen(str);
+    PHYSFS_uint32 hash = 5381;
+
+    /* djb2-xor over the folded codepoints, same as what stricmp compares. */
+    while (1)
+    {
+        PHYSFS_uint8 lowered[64];
+        PHYSFS_uint32 folded[3];
+        const size_t avail = (size_t) (end - str);
+        const size_t ascii = asciiFoldCopy((const PHYSFS_uint8 *) str, lowered,
+                                 (avail < sizeof (lowered)) ? avail : sizeof (lowered));
+        size_t i;
+        int count;
+
+        for (i = 0; i < ascii; i++)
+            hash = ((hash << 5) + hash) ^ lowered[i];
+        str += ascii;
+
+        if (ascii == sizeof (lowered))
+            continue;  /* maybe more ASCII. */
+
+        count = PHYSFS_caseFold(utf8codepoint(&str), folded);
+        if (folded[0] == 0)
+            break;  /* end of string. */
+
+        for (i = 0; i < (size_t) count; i++)
+            hash = ((hash << 5) + hash) ^ folded[i];
+    } /* while */
+
+    return hash;
+} /* PHYSFS_utf8CaseFoldHash */
+
 /* end of physfs_unicode.c ... */
 
@@ -529,6 +529,28 @@ static int cmd_setbuffer(char *args)
 } /* cmd_setbuffer */
 
 
+static int cmd_setmaxopenfiles(char *args)
+{
+    PHYSFS_uint32 max;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    max = (PHYSFS_uint32) atoi(args);
+    if (!PHYSFS_setMaxOpenFiles(max))
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+    else if (max)
+        printf("Keeping at most (%lu) files open for reading.\n", (unsigned long) max);
+    else
+        printf("No limit on files open for reading.\n");
+
+    return 1;
+} /* cmd_setmaxopenfiles */
+
+
 static int cmd_stressbuffer(char *args)
 {
     int num;
@@ -1311,6 +1333,407 @@ static int cmd_stat(char *args)
 } /* cmd_filelength */
 
 
+static int cmd_stream64(char *args)
+{
+    PHYSFS_uint8 buffer[64 * 1024];
+    PHYSFS_uint64 total = 0;
+    PHYSFS_sint64 len;
+    PHYSFS_sint64 br;
+    PHYSFS_File *f;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    f = PHYSFS_openRead(args);
+    if (f == NULL)
+    {
+        printf("failed to open. Reason: [%s].\n", PHYSFS_getLastError());
+        return 1;
+    } /* if */
+
+    len = PHYSFS_fileLength(f);
+    while ((br = PHYSFS_readBytes(f, buffer, sizeof (buffer))) > 0)
+    {
+        total += (PHYSFS_uint64) br;
+        if (PHYSFS_tell(f) != (PHYSFS_sint64) total)
+        {
+            printf("tell() says %lld after reading %llu bytes.\n",
+                   (long long) PHYSFS_tell(f), (unsigned long long) total);
+            PHYSFS_close(f);
+            return 1;
+        } /* if */
+    } /* while */
+
+    if (br < 0)
+        printf("error while reading. Reason: [%s].\n", PHYSFS_getLastError());
+    else if ((PHYSFS_sint64) total != len)
+    {
+        printf("read %llu bytes, but fileLength() says %lld.\n",
+               (unsigned long long) total, (long long) len);
+    } /* else if */
+    else
+    {
+        /* go back to somewhere near the end, and the middle: past 4GB,
+           if the file is that big. */
+        const PHYSFS_uint64 spots[] = { total / 2, (total > 16) ? total - 16 : 0 };
+        int okay = 1;
+        size_t i;
+
+        for (i = 0; okay && (i < sizeof (spots) / sizeof (spots[0])); i++)
+        {
+            const PHYSFS_uint64 want = total - spots[i];
+            const PHYSFS_uint64 n = (want < 16) ? want : 16;
+            okay = ( (PHYSFS_seek(f, spots[i])) &&
+                     (PHYSFS_tell(f) == (PHYSFS_sint64) spots[i]) &&
+                     (PHYSFS_readBytes(f, buffer, n) == (PHYSFS_sint64) n) &&
+                     (PHYSFS_tell(f) == (PHYSFS_sint64) (spots[i] + n)) );
+            if (!okay)
+            {
+                printf("seek/tell/read at %llu failed. Reason: [%s].\n",
+                       (unsigned long long) spots[i], PHYSFS_getLastError());
+            } /* if */
+        } /* for */
+
+        if (okay)
+        {
+            printf("Streamed %llu bytes; tell() and seek() agree.\n",
+                   (unsigned long long) total);
+        } /* if */
+    } /* else */
+
+    PHYSFS_close(f);
+    return 1;
+} /* cmd_stream64 */
+
+
+static int cmd_statmany(char *args)
+{
+    const char **fnames;
+    PHYSFS_Stat *stats;
+    PHYSFS_ErrorCode *errors;
+    PHYSFS_uint32 count = 0;
+    PHYSFS_sint64 rc;
+    PHYSFS_uint32 i;
+    char *ptr;
+
+    if ((args == NULL) || (*args == '\0'))
+    {
+        printf("usage: statmany <file1> [file2 ...]\n");
+        return 1;
+    } /* if */
+
+    fnames = (const char **) malloc(sizeof (char *) * (strlen(args) + 1));
+    stats = (PHYSFS_Stat *) malloc(sizeof (PHYSFS_Stat) * (strlen(args) + 1));
+    errors = (PHYSFS_ErrorCode *) malloc(sizeof (PHYSFS_ErrorCode) * (strlen(args) + 1));
+    if ((!fnames) || (!stats) || (!errors))
+    {
+        printf("out of memory.\n");
+        free(fnames);
+        free(stats);
+        free(errors);
+        return 1;
+    } /* if */
+
+    for (ptr = strtok(args, " "); ptr != NULL; ptr = strtok(NULL, " "))
+        fnames[count++] = ptr;
+
+    rc = PHYSFS_statMany(fnames, count, stats, errors);
+    if (rc < 0)
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+    else
+    {
+        for (i = 0; i < count; i++)
+        {
+            if (errors[i] != PHYSFS_ERR_OK)
+                printf("%s: %s\n", fnames[i], PHYSFS_getErrorByCode(errors[i]));
+            else if (stats[i].filetype == PHYSFS_FILETYPE_DIRECTORY)
+                printf("%s: directory\n", fnames[i]);
+            else
+                printf("%s: %lld bytes\n", fnames[i],
+                       (long long) stats[i].filesize);
+        } /* for */
+        printf("\n %d of %d exist.\n", (int) rc, (int) count);
+    } /* else */
+
+    free(fnames);
+    free(stats);
+    free(errors);
+    return 1;
+} /* cmd_statmany */
+
+
+/* Split "<one> <two>" into two strings, either of which may be quoted. */
+static int split_two_args(char *args, char **one, char **two)
+{
+    char *ptr;
+
+    *one = args;
+    if (**one == '\"')
+    {
+        (*one)++;
+        ptr = strchr(*one, '\"');
+        if (ptr == NULL)
+        {
+            printf("missing string terminator in argument.\n");
+            return 0;
+        } /* if */
+        *(ptr) = '\0';
+        ptr++;
+    } /* if */
+    else
+    {
+        ptr = strchr(*one, ' ');
+        *ptr = '\0';
+        ptr++;
+    } /* else */
+
+    while (*ptr == ' ')
+        ptr++;
+
+    *two = ptr;
+    if (**two == '\"')
+    {
+        (*two)++;
+        ptr = strchr(*two, '\"');
+        if (ptr == NULL)
+        {
+            printf("missing string terminator in argument.\n");
+            return 0;
+        } /* if */
+        *(ptr) = '\0';
+    } /* if */
+
+    return 1;
+} /* split_two_args */
+
+
+static int cmd_catin(char *args)
+{
+    PHYSFS_Directory *dir;
+    PHYSFS_File *f;
+    PHYSFS_Stat statbuf;
+    char *dirname;
+    char *fname;
+
+    if (!split_two_args(args, &dirname, &fname))
+        return 1;
+
+    dir = PHYSFS_openDirectory(dirname);
+    if (dir == NULL)
+    {
+        printf("failed to open directory. Reason: [%s].\n", PHYSFS_getLastError());
+        return 1;
+    } /* if */
+
+    if (!PHYSFS_statIn(dir, fname, &statbuf))
+        printf("failed to stat. Reason: [%s].\n", PHYSFS_getLastError());
+    else
+    {
+        printf("(%d bytes)\n", (int) statbuf.filesize);
+        f = PHYSFS_openReadIn(dir, fname);
+        if (f == NULL)
+            printf("failed to open. Reason: [%s].\n", PHYSFS_getLastError());
+        else
+        {
+            while (!PHYSFS_eof(f))
+            {
+                char buffer[128];
+                PHYSFS_sint64 rc = PHYSFS_readBytes(f, buffer, sizeof (buffer));
+                if (rc > 0)
+                    fwrite(buffer, 1, (size_t) rc, stdout);
+                if (rc < (PHYSFS_sint64) sizeof (buffer))
+                {
+                    if (!PHYSFS_eof(f))
+                        printf("\n\nError condition in reading. Reason: [%s].\n\n", PHYSFS_getLastError());
+                    break;
+                } /* if */
+            } /* while */
+            printf("\n\n");
+            PHYSFS_close(f);
+        } /* else */
+    } /* else */
+
+    PHYSFS_closeDirectory(dir);
+    return 1;
+} /* cmd_catin */
+
+
+static PHYSFS_EnumerateCallbackResult lsin_callback(void *data,
+                                        const char *origdir, const char *fname)
+{
+    int *file_count = (int *) data;
+    printf("%s/%s\n", origdir, fname);
+    (*file_count)++;
+    return PHYSFS_ENUM_OK;
+} /* lsin_callback */
+
+
+static int cmd_lsin(char *args)
+{
+    PHYSFS_Directory *dir;
+    int file_count = 0;
+    char *dirname;
+    char *subdir;
+
+    if (!split_two_args(args, &dirname, &subdir))
+        return 1;
+
+    dir = PHYSFS_openDirectory(dirname);
+    if (dir == NULL)
+    {
+        printf("failed to open directory. Reason: [%s].\n", PHYSFS_getLastError());
+        return 1;
+    } /* if */
+
+    if (!PHYSFS_enumerateIn(dir, subdir, lsin_callback, &file_count))
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+    else
+        printf("\n total (%d) files.\n", file_count);
+
+    PHYSFS_closeDirectory(dir);
+    return 1;
+} /* cmd_lsin */
+
+
+static int cmd_refreshmount(char *args)
+{
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    if (PHYSFS_refreshMount(args))
+        printf("Successful.\n");
+    else
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+
+    return 1;
+} /* cmd_refreshmount */
+
+
+static int cmd_preload(char *args)
+{
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    if (PHYSFS_preload(args))
+        printf("Successful.\n");
+    else
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+
+    return 1;
+} /* cmd_preload */
+
+
+static int cmd_releasepreload(char *args)
+{
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    if (PHYSFS_releasePreload(args))
+        printf("Successful.\n");
+    else
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+
+    return 1;
+} /* cmd_releasepreload */
+
+
+static int cmd_setextractcache(char *args)
+{
+    PHYSFS_uint64 budget;
+    char *dirname;
+    char *budgetstr;
+
+    if (!split_two_args(args, &dirname, &budgetstr))
+        return 1;
+
+    budget = (PHYSFS_uint64) strtoul(budgetstr, NULL, 10);
+    if (!PHYSFS_setExtractCache(dirname, budget))
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+    else if (budget)
+        printf("Caching up to (%lu) bytes of extracted files.\n", (unsigned long) budget);
+    else
+        printf("Extraction cache is off.\n");
+
+    return 1;
+} /* cmd_setextractcache */
+
+
+/* Read a little of a file, then read everything else in a directory before
+   finishing it: with a small setmaxopenfiles limit, the first file's handle
+   gets closed (and its extraction cache copy evicted) in the meantime. */
+static int cmd_churnread(char *args)
+{
+    char buffer[4096];
+    PHYSFS_sint64 len;
+    PHYSFS_sint64 total = 0;
+    PHYSFS_sint64 rc;
+    PHYSFS_File *f;
+    char **rc2;
+    char **i;
+    char *fname;
+    char *dirname;
+    int count = 0;
+
+    if (!split_two_args(args, &fname, &dirname))
+        return 1;
+
+    f = PHYSFS_openRead(fname);
+    if (f == NULL)
+    {
+        printf("failed to open. Reason: [%s].\n", PHYSFS_getLastError());
+        return 1;
+    } /* if */
+
+    len = PHYSFS_fileLength(f);
+    rc = PHYSFS_readBytes(f, buffer, 10);
+    if (rc > 0)
+        total += rc;
+
+    rc2 = PHYSFS_enumerateFiles(dirname);
+    for (i = rc2; (i != NULL) && (*i != NULL); i++)
+    {
+        char path[512];
+        PHYSFS_File *other;
+        snprintf(path, sizeof (path), "%s/%s", dirname, *i);
+        other = PHYSFS_openRead(path);
+        if (other == NULL)
+            continue;  /* a directory, probably. */
+        while (PHYSFS_readBytes(other, buffer, sizeof (buffer)) > 0) {}
+        PHYSFS_close(other);
+        count++;
+    } /* for */
+    PHYSFS_freeList(rc2);
+
+    while ((rc = PHYSFS_readBytes(f, buffer, sizeof (buffer))) > 0)
+        total += rc;
+
+    if (rc < 0)
+        printf("error while reading. Reason: [%s].\n", PHYSFS_getLastError());
+    else if (total != len)
+        printf("read %d bytes, but fileLength() says %d.\n", (int) total, (int) len);
+    else
+    {
+        printf("Read all (%d) bytes around (%d) other files.\n",
+               (int) total, count);
+    } /* else */
+
+    PHYSFS_close(f);
+    return 1;
+} /* cmd_churnread */
+
+
 
 /* must have spaces trimmed prior to this call. */
 static int count_args(const char *str)
@@ -1385,9 +1808,19 @@ static const command_info commands[] =
     { "getlastmodtime", cmd_getlastmodtime, 1, "<fileToExamine>"            },
     { "setbuffer",      cmd_setbuffer,      1, "<bufferSize>"               },
     { "stressbuffer",   cmd_stressbuffer,   1, "<bufferSize>"               },
+    { "setmaxopenfiles", cmd_setmaxopenfiles, 1, "<max>"                   },
     { "crc32",          cmd_crc32,          1, "<fileToHash>"               },
     { "getmountpoint",  cmd_getmountpoint,  1, "<dir>"                      },
     { "setroot",        cmd_setroot,        2, "<archiveLocation> <root>"   },
+    { "stream64",       cmd_stream64,       1, "<fileToStream>"             },
+    { "statmany",       cmd_statmany,      -1, "<file1> [file2 ...]"        },
+    { "catin",          cmd_catin,          2, "<dir> <fileInDir>"          },
+    { "lsin",           cmd_lsin,           2, "<dir> <subdirInDir>"        },
+    { "refreshmount",   cmd_refreshmount,   1, "<archiveLocation>"          },
+    { "preload",        cmd_preload,        1, "<dirToPreload>"             },
+    { "releasepreload", cmd_releasepreload, 1, "<dirToRelease>"             },
+    { "setextractcache", cmd_setextractcache, 2, "<dir> <budget>"           },
+    { "churnread",      cmd_churnread,      2, "<fileToRead> <dirToChurn>"  },
     { NULL,             NULL,              -1, NULL                         }
 };
 